@@ -0,0 +1,118 @@
+/**
+ * @file
+ *
+ * @brief Benchmark for appending KeySets as done by the merge stage of kdbGet().
+ *
+ * Every stage is done once with ksAppend() and once by appending the keys
+ * one by one with ksAppendKey(), as ksAppend() did before it merged:
+ *
+ * - splitMergeBackends(): the keysets of dir backends are appended to an empty keyset
+ * - elektraRestoreProc(): a cut part of the keyset is appended back
+ * - elektraCacheLoad(): the cached keyset is appended to a keyset that is not empty
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <benchmarks.h>
+
+static KeySet * createBackend (int dir)
+{
+	KeySet * ks = ksNew (num_key, KS_END);
+	char name[KEY_NAME_LENGTH + 1];
+	for (int j = 0; j < num_key; ++j)
+	{
+		snprintf (name, KEY_NAME_LENGTH, "%s/dir%d/key%d", KEY_ROOT, dir, j);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, name, KEY_END));
+	}
+	return ks;
+}
+
+static void appendKeys (KeySet * ks, KeySet * toAppend, bool merge)
+{
+	if (merge)
+	{
+		ksAppend (ks, toAppend);
+		return;
+	}
+	for (ssize_t i = 0; i < ksGetSize (toAppend); ++i)
+	{
+		ksAppendKey (ks, ksAtCursor (toAppend, i));
+	}
+}
+
+static void benchmarkMerge (const char * method, bool merge)
+{
+	char msg[BUF_SIZ + 100];
+	KeySet ** backends = elektraMalloc (num_dir * sizeof (KeySet *));
+	if (!backends) printExit ("elektraMalloc");
+	for (int i = 0; i < num_dir; ++i)
+	{
+		backends[i] = createBackend (i);
+	}
+
+	// the backends are not sorted by name in the split
+	KeySet * ks = ksNew (0, KS_END);
+	timeInit ();
+	for (int i = 0; i < num_dir; ++i)
+	{
+		appendKeys (ks, backends[(i * 7) % num_dir], merge);
+	}
+	snprintf (msg, sizeof (msg), "Merged %d backends %s", num_dir, method);
+	timePrint (msg);
+
+	// cut out every tenth dir and put it back
+	KeySet * cut = ksNew (0, KS_END);
+	for (int i = 0; i < num_dir; i += 10)
+	{
+		snprintf (msg, sizeof (msg), "%s/dir%d", KEY_ROOT, i);
+		Key * cutKey = keyNew (msg, KEY_END);
+		KeySet * part = ksCut (ks, cutKey);
+		ksAppend (cut, part);
+		ksDel (part);
+		keyDel (cutKey);
+	}
+	timeInit ();
+	appendKeys (ks, cut, merge);
+	snprintf (msg, sizeof (msg), "Restored cut keys %s", method);
+	timePrint (msg);
+	ksDel (cut);
+
+	// the cache has all keys again, also the ones already in ks
+	KeySet * cache = ksDup (ks);
+	KeySet * dest = ksNew (0, KS_END);
+	for (int i = 0; i < num_dir; i += 2)
+	{
+		ksAppend (dest, backends[i]);
+	}
+	timeInit ();
+	appendKeys (dest, cache, merge);
+	snprintf (msg, sizeof (msg), "Appended cached keyset %s", method);
+	timePrint (msg);
+
+	if (ksGetSize (dest) != ksGetSize (ks)) printExit ("wrong size after merge");
+
+	ksDel (dest);
+	ksDel (cache);
+	ksDel (ks);
+	for (int i = 0; i < num_dir; ++i)
+	{
+		ksDel (backends[i]);
+	}
+	elektraFree (backends);
+}
+
+int main (int argc, char ** argv)
+{
+	if (argc == 3)
+	{
+		num_dir = atoi (argv[1]);
+		num_key = atoi (argv[2]);
+	}
+	else
+	{
+		printf ("usage %s dir key (both dir+key are numbers), using defaults\n", argv[0]);
+	}
+
+	benchmarkMerge ("key by key", false);
+	benchmarkMerge ("by merging", true);
+}
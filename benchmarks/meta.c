@@ -0,0 +1,101 @@
+/**
+ * @file
+ *
+ * @brief Benchmark for memory and time of metadata as set by spec-heavy mountpoints.
+ *
+ * Every key gets metadata like a specification would give it, most of it
+ * equal for many keys. The keys are created once with and once without an
+ * active intern table, see elektraMetaInternActivate().
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <benchmarks.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define BENCHMARK_META_MALLINFO
+#endif
+
+static const char * const types[] = { "long", "string", "boolean", "double" };
+static const char * const defaults[] = { "0", "1", "", "localhost", "true" };
+
+static size_t heapUsed (void)
+{
+#ifdef BENCHMARK_META_MALLINFO
+	struct mallinfo2 info = mallinfo2 ();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static KeySet * createSpec (void)
+{
+	KeySet * ks = ksNew (num_dir * num_key, KS_END);
+	char name[KEY_NAME_LENGTH + 1];
+	char description[BUF_SIZ];
+	char order[BUF_SIZ];
+
+	for (int i = 0; i < num_dir; ++i)
+	{
+		snprintf (description, BUF_SIZ, "setting of component %d", i);
+		for (int j = 0; j < num_key; ++j)
+		{
+			snprintf (name, KEY_NAME_LENGTH, "%s/dir%d/key%d", KEY_ROOT, i, j);
+			snprintf (order, BUF_SIZ, "%d", j);
+			Key * key = keyNew (name, KEY_END);
+			keySetMeta (key, "type", types[j % 4]);
+			keySetMeta (key, "default", defaults[j % 5]);
+			keySetMeta (key, "check/range", "0-65535");
+			keySetMeta (key, "check/validation/message", "not a valid value");
+			keySetMeta (key, "description", description);
+			keySetMeta (key, "order", order);
+			keySetMeta (key, "opt/long", "config");
+			ksAppendKey (ks, key);
+		}
+	}
+	return ks;
+}
+
+static void benchmarkMeta (const char * msg, int interning)
+{
+	size_t before = heapUsed ();
+	timeInit ();
+
+	ElektraMetaIntern * intern = interning ? elektraMetaInternNew () : 0;
+	if (interning && !intern) printExit ("elektraMetaInternNew");
+	ElektraMetaIntern * previous = elektraMetaInternActivate (intern);
+	KeySet * ks = createSpec ();
+	elektraMetaInternActivate (previous);
+
+	timePrint ((char *) msg);
+	size_t after = heapUsed ();
+#ifdef BENCHMARK_META_MALLINFO
+	printf ("%s: %zu keys use %zu bytes of heap\n", msg, (size_t) ksGetSize (ks), after - before);
+#else
+	(void) before;
+	(void) after;
+#endif
+
+	timeInit ();
+	elektraMetaInternDel (intern);
+	ksDel (ks);
+	timePrint ("Deleted keyset");
+}
+
+int main (int argc, char ** argv)
+{
+	if (argc == 3)
+	{
+		num_dir = atoi (argv[1]);
+		num_key = atoi (argv[2]);
+	}
+	else
+	{
+		printf ("usage %s dir key (both dir+key are numbers), using defaults\n", argv[0]);
+	}
+
+	benchmarkMeta ("Created keyset without interning", 0);
+	benchmarkMeta ("Created keyset with interning", 1);
+}
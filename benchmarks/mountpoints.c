@@ -0,0 +1,107 @@
+/**
+ * @file
+ *
+ * @brief Benchmark for mountGetBackend() with 10, 100 and 1000 mountpoints.
+ *
+ * The mountpoints are nested up to three levels, like dir/app/plugin, below
+ * user and system. Every run looks up keys below every mountpoint and keys
+ * that are below no mountpoint and thus get the default backend.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <../src/libs/elektra/backend.c>
+#include <../src/libs/elektra/mount.c>
+#include <../src/libs/elektra/split.c>
+#include <../src/libs/elektra/trie.c>
+#include <benchmarks.h>
+
+#define LOOKUP_ROUNDS 1000
+
+static Backend * createBackend (const char * name)
+{
+	Backend * backend = elektraCalloc (sizeof (Backend));
+	if (!backend) printExit ("elektraCalloc");
+	backend->mountpoint = keyNew (name, KEY_END);
+	backend->refcounter = 1;
+	keyIncRef (backend->mountpoint);
+	return backend;
+}
+
+static void mountpointName (char * name, size_t size, int i)
+{
+	const char * ns = i % 2 ? "system" : "user";
+	switch (i % 3)
+	{
+	case 0:
+		snprintf (name, size, "%s/benchmark/dir%d", ns, i);
+		break;
+	case 1:
+		snprintf (name, size, "%s/benchmark/dir%d/app%d", ns, i / 3, i);
+		break;
+	default:
+		snprintf (name, size, "%s/benchmark/dir%d/app%d/plugin%d", ns, i / 9, i / 3, i);
+		break;
+	}
+}
+
+static void benchmarkMountpoints (int mountpoints)
+{
+	char name[KEY_NAME_LENGTH + 1];
+	char msg[BUF_SIZ + 100];
+
+	KDB * handle = elektraCalloc (sizeof (KDB));
+	if (!handle) printExit ("elektraCalloc");
+	handle->defaultBackend = createBackend ("");
+
+	timeInit ();
+	for (int i = 0; i < mountpoints; ++i)
+	{
+		mountpointName (name, KEY_NAME_LENGTH, i);
+		Backend * backend = createBackend (name);
+		strncat (name, "/", KEY_NAME_LENGTH - strlen (name));
+		handle->trie = trieInsert (handle->trie, name, backend);
+	}
+	snprintf (msg, sizeof (msg), "Inserted %d mountpoints", mountpoints);
+	timePrint (msg);
+
+	// two keys below every mountpoint, one key below none
+	KeySet * keys = ksNew (3 * mountpoints, KS_END);
+	for (int i = 0; i < mountpoints; ++i)
+	{
+		mountpointName (name, KEY_NAME_LENGTH, i);
+		size_t len = strlen (name);
+		snprintf (name + len, KEY_NAME_LENGTH - len, "/key");
+		ksAppendKey (keys, keyNew (name, KEY_END));
+		snprintf (name + len, KEY_NAME_LENGTH - len, "/section/deep/key");
+		ksAppendKey (keys, keyNew (name, KEY_END));
+		snprintf (name, KEY_NAME_LENGTH, "user/unmounted/dir%d/key", i);
+		ksAppendKey (keys, keyNew (name, KEY_END));
+	}
+
+	size_t found = 0;
+	timeInit ();
+	for (int r = 0; r < LOOKUP_ROUNDS; ++r)
+	{
+		for (ssize_t i = 0; i < ksGetSize (keys); ++i)
+		{
+			if (mountGetBackend (handle, ksAtCursor (keys, i)) != handle->defaultBackend) ++found;
+		}
+	}
+	snprintf (msg, sizeof (msg), "%d x %zd lookups with %d mountpoints", LOOKUP_ROUNDS, ksGetSize (keys), mountpoints);
+	timePrint (msg);
+
+	if (found != (size_t) LOOKUP_ROUNDS * 2 * mountpoints) printExit ("wrong number of keys below mountpoints");
+
+	ksDel (keys);
+	trieClose (handle->trie, 0);
+	backendClose (handle->defaultBackend, 0);
+	elektraFree (handle);
+}
+
+int main (void)
+{
+	benchmarkMountpoints (10);
+	benchmarkMountpoints (100);
+	benchmarkMountpoints (1000);
+}
@@ -1216,6 +1216,177 @@ void benchmarkOPMPHMBuildTime (char * name)
  * END ==================================================== OPMPHM Build Time ========================================================== END
  */
 
+/**
+ * START ============================================= OPMPHM Parallel Build Time ================================================== START
+ *
+ * This benchmark measures the time of the OPMPHM build with different numbers of threads, see opmphmMappingParallel (...).
+ * Uses all KeySet shapes except 6, for all n (KeySet size) one KeySet and one seed is used to build the OPMPHM.
+ * Each measurement is repeated numberOfRepeats times and summarized with the median.
+ * The results are written out in the following format:
+ *
+ * n;threads;time
+ *
+ * The number of needed seeds for this benchmarks is: (numberOfShapes - 1) * nCount * 2
+ */
+
+/**
+ * @brief Measures the OPMPHM build with `threads` threads numberOfRepeats time and returns median
+ *
+ * @param ks the KeySet
+ * @param seed the seed for the mapping
+ * @param threads the number of threads
+ * @param repeats array to store repeated measurements
+ * @param numberOfRepeats fields in repeats
+ *
+ * @retval median time
+ */
+static size_t benchmarkOPMPHMParallelBuildTimeMeasure (KeySet * ks, int32_t seed, size_t threads, size_t * repeats,
+						       size_t numberOfRepeats)
+{
+	const size_t n = ks->size;
+	uint8_t r = opmphmOptR (n);
+	double c = opmphmMinC (r) + opmphmOptC (n);
+	for (size_t repeatsI = 0; repeatsI < numberOfRepeats; ++repeatsI)
+	{
+		// preparation for measurement
+		struct timeval start;
+		struct timeval end;
+		Opmphm * opmphm = opmphmNew ();
+		if (!opmphm)
+		{
+			printExit ("opmphmNew");
+		}
+		OpmphmInit init;
+		init.getName = getString;
+		init.data = (void **) ks->array;
+		init.initSeed = seed;
+
+		// START MEASUREMENT
+		__asm__("");
+		gettimeofday (&start, 0);
+		__asm__("");
+
+		OpmphmGraph * graph = opmphmGraphNew (opmphm, r, n, c);
+		if (!graph)
+		{
+			printExit ("opmphmGraphNew");
+		}
+		int ret;
+		size_t mappings = 0;
+		do
+		{
+			ret = opmphmMappingParallel (opmphm, graph, &init, n, threads);
+		} while (ret && ++mappings < 10);
+		if (ret)
+		{
+			printExit ("opmphmMappingParallel");
+		}
+		if (opmphmAssignment (opmphm, graph, n, 1))
+		{
+			printExit ("opmphmAssignment");
+		}
+		opmphmGraphDel (graph);
+
+		__asm__("");
+		gettimeofday (&end, 0);
+		__asm__("");
+		// END MEASUREMENT
+
+		// save result
+		repeats[repeatsI] = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+
+		// sanity check
+		if (opmphmLookup (opmphm, n, keyName (ks->array[n / 2])) != n / 2)
+		{
+			printExit ("Sanity Check Failed: OPMPHM returned wrong order");
+		}
+		opmphmDel (opmphm);
+	}
+	// sort repeats
+	qsort (repeats, numberOfRepeats, sizeof (size_t), cmpInteger);
+	return repeats[numberOfRepeats / 2]; // take median
+}
+
+static void benchmarkOPMPHMParallelBuildTime (char * name)
+{
+	const size_t nValues[] = { 65536, 262144, 1048576 };
+	const size_t nCount = sizeof (nValues) / sizeof (nValues[0]);
+	const size_t threadValues[] = { 1, 2, 4, 8, 16 };
+	const size_t threadCount = sizeof (threadValues) / sizeof (threadValues[0]);
+	const size_t numberOfRepeats = 5;
+
+	size_t * results = elektraMalloc (nCount * threadCount * sizeof (size_t));
+	if (!results)
+	{
+		printExit ("malloc");
+	}
+	size_t * repeats = elektraMalloc (numberOfRepeats * sizeof (size_t));
+	if (!repeats)
+	{
+		printExit ("malloc");
+	}
+
+	// get KeySet shapes
+	KeySetShape * keySetShapes = getKeySetShapes ();
+
+	printf ("Run Benchmark %s:\n", name);
+
+	// for all KeySet shapes except 6
+	for (size_t shapeI = 0; shapeI < numberOfShapes; ++shapeI)
+	{
+		if (shapeI == 6)
+		{
+			continue;
+		}
+		for (size_t nI = 0; nI < nCount; ++nI)
+		{
+			int32_t genSeed;
+			int32_t seed;
+			if (getRandomSeed (&genSeed) != &genSeed) printExit ("Seed Parsing Error or feed me more seeds");
+			if (getRandomSeed (&seed) != &seed) printExit ("Seed Parsing Error or feed me more seeds");
+			KeySet * ks = generateKeySet (nValues[nI], &genSeed, &keySetShapes[shapeI]);
+
+			for (size_t threadI = 0; threadI < threadCount; ++threadI)
+			{
+				printf ("now at: shape = %zu/%zu n = %zu threads = %zu\r", shapeI + 1, numberOfShapes, nValues[nI],
+					threadValues[threadI]);
+				fflush (stdout);
+				results[nI * threadCount + threadI] =
+					benchmarkOPMPHMParallelBuildTimeMeasure (ks, seed, threadValues[threadI], repeats, numberOfRepeats);
+			}
+			ksDel (ks);
+		}
+
+		// write out
+		FILE * out = openOutFileWithRPartitePostfix ("benchmark_opmphm_parallel_build_time", shapeI);
+		if (!out)
+		{
+			printExit ("open out file");
+		}
+		// print header
+		fprintf (out, "n;threads;time\n");
+		// print data
+		for (size_t nI = 0; nI < nCount; ++nI)
+		{
+			for (size_t threadI = 0; threadI < threadCount; ++threadI)
+			{
+				fprintf (out, "%zu;%zu;%zu\n", nValues[nI], threadValues[threadI], results[nI * threadCount + threadI]);
+			}
+		}
+
+		fclose (out);
+	}
+	printf ("\n");
+
+	elektraFree (repeats);
+	elektraFree (keySetShapes);
+	elektraFree (results);
+}
+
+/**
+ * END ============================================== OPMPHM Parallel Build Time ===================================================== END
+ */
+
 /**
  * START ================================================== OPMPHM Search Time ======================================================= START
  *
@@ -2102,7 +2273,7 @@ static void benchmarkPrintAllKeySetShapes (char * name)
 int main (int argc, char ** argv)
 {
 	// define all benchmarks
-	size_t benchmarksCount = 9;
+	size_t benchmarksCount = 10;
 #ifdef HAVE_HSEARCHR
 	// hsearchbuildtime
 	++benchmarksCount;
@@ -2158,6 +2329,11 @@ int main (int argc, char ** argv)
 	benchmarks[8].name = benchmarkNamePredictionTime;
 	benchmarks[8].benchmarkF = benchmarkPredictionTime;
 	benchmarks[8].numberOfSeedsNeeded = 3496500;
+	// opmphmparallelbuildtime
+	char * benchmarkNameOpmphmParallelBuildTime = "opmphmparallelbuildtime";
+	benchmarks[9].name = benchmarkNameOpmphmParallelBuildTime;
+	benchmarks[9].benchmarkF = benchmarkOPMPHMParallelBuildTime;
+	benchmarks[9].numberOfSeedsNeeded = 42;
 #ifdef HAVE_HSEARCHR
 	// hsearchbuildtime
 	char * benchmarkNameHsearchBuildTime = "hsearchbuildtime";
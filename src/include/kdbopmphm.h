@@ -127,6 +127,22 @@ typedef struct
 int opmphmMapping (Opmphm * opmphm, OpmphmGraph * graph, OpmphmInit * init, size_t n);
 int opmphmAssignment (Opmphm * opmphm, OpmphmGraph * graph, size_t n, int defaultOrder);
 
+/**
+ * Parallel build
+ *
+ * opmphmMappingParallel (...) hashes the elements with multiple threads and
+ * adds the edges of each component of the graph in its own thread.
+ * The resulting graph is the same as the one of opmphmMapping (...).
+ *
+ * OPMPHM_PARALLEL_MIN_N is the minimal number of elements for one thread,
+ * OPMPHM_PARALLEL_MAX_THREADS is the maximal number of threads.
+ */
+#define OPMPHM_PARALLEL_MIN_N 16384
+#define OPMPHM_PARALLEL_MAX_THREADS 16
+
+int opmphmMappingParallel (Opmphm * opmphm, OpmphmGraph * graph, OpmphmInit * init, size_t n, size_t threads);
+size_t opmphmMappingThreads (size_t n);
+
 /**
  * Lookup functions
  */
@@ -141,6 +157,44 @@ int opmphmIsBuild (const Opmphm * opmphm);
 int opmphmCopy (Opmphm * dest, const Opmphm * source);
 void opmphmClear (Opmphm * opmphm);
 
+/**
+ * The delta of the OPMPHM
+ *
+ * Logs the insertions and removals of elements since the OPMPHM was built,
+ * the OPMPHM still maps to the positions at build time.
+ * Replaying the log moves such a position to the current one.
+ * Inserted elements are found by the hash of their name in the log.
+ *
+ * OPMPHM_DELTA_MAX is the maximal length of the log.
+ */
+#define OPMPHM_DELTA_MAX 64
+
+typedef struct
+{
+	size_t position; /*!< position of the inserted or removed element */
+	uint32_t hash;   /*!< opmphmDeltaHash (...) of the inserted name, 0 for removals */
+	uint8_t insert;  /*!< 1 for insertions, 0 for removals */
+} OpmphmDeltaEntry;
+
+typedef struct
+{
+	OpmphmDeltaEntry entries[OPMPHM_DELTA_MAX]; /*!< the log */
+	size_t size;				    /*!< number of entries in the log */
+	size_t buildSize;			    /*!< number of elements the OPMPHM was built with */
+} OpmphmDelta;
+
+/**
+ * Delta functions
+ */
+OpmphmDelta * opmphmDeltaNew (void);
+void opmphmDeltaDel (OpmphmDelta * delta);
+void opmphmDeltaClear (OpmphmDelta * delta, size_t buildSize);
+uint32_t opmphmDeltaHash (const char * name);
+int opmphmDeltaInsert (OpmphmDelta * delta, size_t position, const char * name, size_t limit);
+int opmphmDeltaRemove (OpmphmDelta * delta, size_t position, size_t limit);
+size_t opmphmDeltaPosition (const OpmphmDelta * delta, size_t position, size_t from);
+size_t opmphmDeltaFind (const OpmphmDelta * delta, uint32_t hash, size_t * entry);
+
 /**
  * Hash function
  * By Bob Jenkins, May 2006
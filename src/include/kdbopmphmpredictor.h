@@ -25,6 +25,9 @@
  * without KeySet alteration that is worth using the OPMPHM or not.
  * The predictor looks at past events to predict the future, to keep track of past events
  * the `lookupCount` and the `ksSize` must be stored.
+ *
+ * Up to opmphmPredictorDeltaLimit (...) insertions and removals are logged in the OpmphmDelta
+ * instead of invalidating the OPMPHM, such alterations do not end a sequence.
  */
 
 /**
@@ -75,6 +78,7 @@ void opmphmPredictorCopy (OpmphmPredictor * dest, OpmphmPredictor * source);
  * Heuristic function
  */
 size_t opmphmPredictorWorthOpmphm (size_t n);
+size_t opmphmPredictorDeltaLimit (size_t n);
 
 /**
  * Predictor functions
@@ -33,6 +33,29 @@
 	it says how much can actually be stored.*/
 #define KEYSET_SIZE 16
 
+/** Minimal number of keys before the KeySet name prefix index is built. */
+#define KEYSET_PREFIX_MIN 64
+
+/** The name prefix index is built once there were more than size/KEYSET_PREFIX_RATIO
+	lookups since the last name change, so that building it amortizes. */
+#define KEYSET_PREFIX_RATIO 16
+
+/** Minimal number of keys to append before ksAppend() merges both KeySets
+	instead of inserting the keys one by one. */
+#define KEYSET_MERGE_MIN 16
+
+/** Size of the chunks of an arena, see elektraArenaCalloc(). */
+#define ELEKTRA_ARENA_CHUNK_SIZE (64 * 1024)
+
+/** Largest object that can be allocated from an arena. */
+#define ELEKTRA_ARENA_MAX_OBJECT 1024
+
+/** Initial and minimal number of slots of a metadata intern table, must be a power of two. */
+#define ELEKTRA_META_INTERN_MIN 64
+
+/** Maximal number of threads kdbGet() uses to read backends, see system/elektra/threads. */
+#define KDB_MAX_THREADS 64
+
 /** How many plugins can exist in an backend. */
 #define NR_OF_PLUGINS 10
 
@@ -61,6 +84,18 @@
 /** All keys below this are used for cache metadata in the global keyset */
 #define KDB_CACHE_PREFIX "system/elektra/cache"
 
+/** While this key is in the global keyset, resolvers add the directories to sync below it,
+ * so that kdbSet() syncs every directory only once after all commits. A resolver that does
+ * so keeps its locks and sets a value for this key; kdbSet() commits it a second time after
+ * the directories were synced, so that it releases its locks. */
+#define KDB_SYNC_PREFIX "system/elektra/sync"
+
+/** While kdbGet() checks if an update is needed, this key in the global keyset has the stat result
+ * (see ElektraStat) of the file of the backend the resolver is called for, so that the resolver does
+ * not stat it again. The ElektraStat is followed by the null-terminated name of the file, which is
+ * missing if the file is not known. Resolvers watching their file set ElektraStat.watched in it. */
+#define KDB_STAT_PREFIX "system/elektra/stat"
+
 
 #ifdef __cplusplus
 namespace ckdb
@@ -71,6 +106,12 @@ extern "C" {
 typedef struct _Trie Trie;
 typedef struct _Split Split;
 typedef struct _Backend Backend;
+typedef struct _ElektraArena ElektraArena;
+typedef struct _ElektraMetaIntern ElektraMetaIntern;
+typedef struct _ElektraThreadPool ElektraThreadPool;
+
+/** A task of a thread pool, gets an element of the array passed to elektraThreadPoolRun(). */
+typedef void (*ElektraThreadPoolTask) (void * data);
 
 
 /* These define the type for pointers to all the kdb functions */
@@ -139,11 +180,25 @@ typedef enum {
 			 This flag is set once a Key name has been moved to a mapped region,
 			 and is removed if the name moves out of the mapped region.
 			 It prevents erroneous free() calls on these keys. */
-	KEY_FLAG_MMAP_DATA = 1 << 6	/*!<
+	KEY_FLAG_MMAP_DATA = 1 << 6,	/*!<
 			 Key value lies inside a mmap region.
 			 This flag is set once a Key value has been moved to a mapped region,
 			 and is removed if the value moves out of the mapped region.
 			 It prevents erroneous free() calls on these keys. */
+	KEY_FLAG_ARENA_STRUCT = 1 << 7,	/*!<
+			 Key struct was allocated from an arena.
+			 It must be released with elektraArenaFree().
+			 KEY_FLAG_MMAP_STRUCT takes precedence. */
+	KEY_FLAG_ARENA_KEY = 1 << 8,	/*!<
+			 Key name was allocated from an arena with elektraArenaMalloc().
+			 It must be released with elektraArenaFree() and
+			 is moved to the heap before it is changed.
+			 KEY_FLAG_MMAP_KEY takes precedence. */
+	KEY_FLAG_ARENA_DATA = 1 << 9	/*!<
+			 Key value was allocated from an arena with elektraArenaMalloc().
+			 It must be released with elektraArenaFree() and
+			 is moved to the heap before it is changed.
+			 KEY_FLAG_MMAP_DATA takes precedence. */
 } keyflag_t;
 
 
@@ -176,6 +231,10 @@ typedef enum {
 		 This flag is set for KeySets where the array is in a mapped region,
 		 and is removed if the array is moved out from the mapped region.
 		 It prevents erroneous free() calls on these arrays. */
+	,KS_FLAG_ARENA_STRUCT = 1 << 4	/*!<
+		 KeySet struct was allocated from an arena.
+		 It must be released with elektraArenaFree().
+		 KS_FLAG_MMAP_STRUCT takes precedence. */
 } ksflag_t;
 
 
@@ -248,6 +307,25 @@ struct _Key
 };
 
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/**
+ * Fixed-width prefix of an unescaped key name.
+ *
+ * Holds the first 16 bytes of the unescaped name (zero padded) as big-endian
+ * integers, so that comparing two prefixes as integers yields the same
+ * order as memcmp() on the names.
+ * If two prefixes differ, the names differ in the same way,
+ * only equal prefixes need a comparison of the full names.
+ *
+ * @ingroup backend
+ */
+typedef struct
+{
+	uint64_t high; /*!< Bytes 0 to 7 of the unescaped name */
+	uint64_t low;  /*!< Bytes 8 to 15 of the unescaped name */
+} KeyNamePrefix;
+#endif
+
 /**
  * The private KeySet structure.
  *
@@ -276,6 +354,11 @@ struct _KeySet
 	 */
 	ksflag_t flags;
 
+	/**
+	 * The arena for the Keys created by kdbGet(), see elektraKsNewArena().
+	 */
+	ElektraArena * arena;
+
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 	/**
 	 * The Order Preserving Minimal Perfect Hash Map.
@@ -285,6 +368,19 @@ struct _KeySet
 	 * The Order Preserving Minimal Perfect Hash Map Predictor.
 	 */
 	OpmphmPredictor * opmphmPredictor;
+	/**
+	 * The insertions and removals since the OPMPHM was built.
+	 */
+	OpmphmDelta * opmphmDelta;
+
+	/**
+	 * Name prefixes of the keys, parallel to array.
+	 * Built lazily by lookups, kept up to date by ksAppendKey()
+	 * and dropped by every other name change.
+	 */
+	KeyNamePrefix * prefixes;
+	size_t prefixAlloc; /**< Allocated size of prefixes */
+	size_t lookups;	    /**< Lookups since prefixes were dropped */
 #endif
 };
 
@@ -328,6 +424,9 @@ struct _KDB
 	KeySet * global; /*!< This keyset can be used by plugins to pass data through
 			the KDB and communicate with other plugins. Plugins shall clean
 			up their parts of the global keyset, which they do not need any more.*/
+
+	ElektraThreadPool * threadPool; /*!< Reads backends in parallel in kdbGet(), if configured in
+			system/elektra/threads, see elektraGetDoUpdate().*/
 };
 
 
@@ -361,6 +460,10 @@ struct _Backend
 	Plugin * getplugins[NR_OF_PLUGINS];
 	Plugin * errorplugins[NR_OF_PLUGINS];
 
+	KeySet * config; /*!< The configuration below system/elektra/mountpoints/<name>
+	  as long as the plugins are not opened yet, see backendOpenLazy().
+	  0 once they were opened by backendOpenPlugins(). */
+
 	ssize_t specsize;	/*!< The size of the spec key from the previous get.
 		-1 if still uninitialized.
 		Needed to know if a key was removed from a keyset. */
@@ -374,11 +477,27 @@ struct _Backend
 		-1 if still uninitialized.
 		Needed to know if a key was removed from a keyset. */
 
+	char * specfile;   /*!< The file the resolver returned for spec in the previous get.
+		0 if still unknown.
+		Needed to stat all files at once before the resolvers run. */
+	char * dirfile;	   /*!< The file the resolver returned for dir in the previous get.
+		0 if still unknown. */
+	char * userfile;   /*!< The file the resolver returned for user in the previous get.
+		0 if still unknown. */
+	char * systemfile; /*!< The file the resolver returned for system in the previous get.
+		0 if still unknown. */
+
 	size_t refcounter; /*!< This refcounter shows how often the backend
 	   is used.  Not cascading or default backends have 1 in it.
 	   More than three is not possible, because a backend
 	   can be only mounted in dir, system and user each once
 	   OR only in spec.*/
+
+	int threadSafe; /*!< 1 if all get plugins are threadsafe (see infos/status),
+	   -1 if not, 0 if not checked yet. Only threadsafe backends are read in parallel.*/
+
+	int setThreadSafe; /*!< 1 if all set plugins between resolver and commit are threadsafe,
+	   -1 if not, 0 if not checked yet. Only threadsafe backends are written in parallel.*/
 };
 
 /**
@@ -424,6 +543,42 @@ struct _Plugin
 };
 
 
+/**
+ * The stat result of a configuration file, see KDB_STAT_PREFIX.
+ */
+typedef struct
+{
+	int found;	   /*!< 1 if the file exists, 0 if stat failed */
+	uint32_t mode;	   /*!< The mode of the file */
+	uint32_t uid;	   /*!< The owner of the file */
+	uint32_t gid;	   /*!< The group of the file */
+	int64_t mtimeSec;  /*!< The seconds of the modification time */
+	int64_t mtimeNsec; /*!< The nanoseconds of the modification time */
+	int watched;	   /*!< Set by the resolver if it watches the file, kdbGet() then does not stat it */
+} ElektraStat;
+
+/**
+ * An edge to a child in the trie, see struct _Trie.
+ */
+typedef struct
+{
+	uint64_t prefix; /*!< The first 8 bytes of the label as big-endian number, compared first */
+	size_t text;	 /*!< Offset of the label of the child */
+	size_t node;	 /*!< Index of the child */
+} TrieEdge;
+
+/**
+ * A node of the trie, see struct _Trie.
+ */
+typedef struct
+{
+	size_t text;	  /*!< Offset of the label in the text of the trie */
+	size_t textSize;  /*!< Size of the label, complete unescaped name parts with their null terminators */
+	TrieEdge * children; /*!< The children, sorted by the first part of their labels */
+	size_t childCount; /*!< Number of children */
+	Backend * value;  /*!< Pointer to a backend mounted here */
+} TrieNode;
+
 /**
  *
  * The private trie structure.
@@ -432,14 +587,19 @@ struct _Plugin
  * fast. This is exactly what needs to be done when using kdbGet() and kdbSet()
  * in a hierarchy where backends are mounted - you need the backend mounted
  * closest to the parentKey.
+ *
+ * The trie is path-compressed: an edge is labeled with whole parts of the
+ * unescaped names. All nodes are stored in one array, the root is nodes[0]
+ * and holds the backend for the empty string "".
  */
 struct _Trie
 {
-	struct _Trie * children[KDB_MAX_UCHAR]; /*!< The children building up the trie recursively */
-	char * text[KDB_MAX_UCHAR];		/*!< Text identifying this node */
-	size_t textlen[KDB_MAX_UCHAR];		/*!< Length of the text */
-	Backend * value[KDB_MAX_UCHAR];		/*!< Pointer to a backend */
-	Backend * empty_value;			/*!< Pointer to a backend for the empty string "" */
+	TrieNode * nodes; /*!< All nodes of the trie, the root first */
+	size_t size;	  /*!< Number of nodes */
+	size_t alloc;	  /*!< Allocated nodes */
+	char * text;	  /*!< The labels of all nodes */
+	size_t textSize;  /*!< Used size of text */
+	size_t textAlloc; /*!< Allocated size of text */
 };
 
 typedef enum {
@@ -450,9 +610,14 @@ typedef enum {
 		 the keys to database.
 		 */
 
-	SPLIT_FLAG_CASCADING = 1 << 1 /*!< Do we need relative checks?
+	SPLIT_FLAG_CASCADING = 1 << 1, /*!< Do we need relative checks?
 			  Is this a cascading backend?
 			  */
+
+	SPLIT_FLAG_CACHE = 1 << 2 /*!< The cache has the keys of the backend.
+			  Set if the resolver reported a cache hit,
+			  so that the backend does not need to be read.
+			  */
 } splitflag_t;
 
 
@@ -493,6 +658,7 @@ void splitUpdateFileName (Split * split, KDB * handle, Key * key);
 
 /* for kdbGet() algorithm */
 int splitAppoint (Split * split, KDB * handle, KeySet * ks);
+int splitCacheAppoint (Split * split, KDB * handle, KeySet * cache);
 int splitGet (Split * split, Key * warningKey, KDB * handle);
 int splitMergeBackends (Split * split, KeySet * dest);
 int splitMergeDefault (Split * split, KeySet * dest);
@@ -507,16 +673,21 @@ int splitUpdateSize (Split * split);
 void splitCacheStoreState (KDB * handle, Split * split, KeySet * global, Key * parentKey, Key * initialParent);
 int splitCacheCheckState (Split * split, KeySet * global);
 int splitCacheLoadState (Split * split, KeySet * global);
+const char * splitCacheFileName (Split * split, size_t i, KeySet * global);
 
 
 /*Backend handling*/
 Backend * backendOpen (KeySet * elektra_config, KeySet * modules, KeySet * global, Key * errorKey);
+Backend * backendOpenLazy (KeySet * elektra_config, Key * errorKey);
+int backendOpenPlugins (Backend * backend, KeySet * modules, KeySet * global, Key * errorKey);
 Backend * backendOpenDefault (KeySet * modules, KeySet * global, const char * file, Key * errorKey);
 Backend * backendOpenModules (KeySet * modules, KeySet * global, Key * errorKey);
 Backend * backendOpenVersion (KeySet * global, Key * errorKey);
 int backendClose (Backend * backend, Key * errorKey);
 
 int backendUpdateSize (Backend * backend, Key * parent, int size);
+int backendUpdateFile (Backend * backend, Key * parent, const char * file);
+const char * backendGetFile (Backend * backend, Key * parent);
 
 /*Plugin handling*/
 Plugin * elektraPluginOpen (const char * backendname, KeySet * modules, KeySet * config, Key * errorKey);
@@ -525,6 +696,7 @@ int elektraProcessPlugin (Key * cur, int * pluginNumber, char ** pluginName, cha
 int elektraProcessPlugins (Plugin ** plugins, KeySet * modules, KeySet * referencePlugins, KeySet * config, KeySet * systemConfig,
 			   KeySet * global, Key * errorKey);
 size_t elektraPluginGetFunction (Plugin * plugin, const char * name);
+int elektraPluginIsThreadSafe (Plugin * plugin);
 Plugin * elektraPluginFindGlobal (KDB * handle, const char * pluginName);
 
 Plugin * elektraPluginMissing (void);
@@ -547,6 +719,8 @@ Key * mountGetMountpoint (KDB * handle, const Key * where);
 Backend * mountGetBackend (KDB * handle, const Key * key);
 
 void keyInit (Key * key);
+void elektraKeyFreeName (Key * key, char * name);
+void elektraKeyFreeData (Key * key, void * data);
 
 int keyClearSync (Key * key);
 
@@ -561,6 +735,7 @@ KeySet * ksDeepDup (const KeySet * source);
 Key * elektraKsPopAtCursor (KeySet * ks, cursor_t pos);
 
 ssize_t ksSearchInternal (const KeySet * ks, const Key * toAppend);
+Key * ksPopAtInternal (KeySet * ks, size_t pos);
 
 /*Used for internal memcpy/memmove*/
 ssize_t elektraMemcpy (Key ** array1, Key ** array2, size_t size);
@@ -575,6 +750,30 @@ size_t elektraUnescapeKeyName (const char * source, char * dest);
 int elektraUnescapeKeyNamePartBegin (const char * source, size_t size, char ** dest);
 char * elektraUnescapeKeyNamePart (const char * source, size_t size, char * dest);
 
+ElektraArena * elektraArenaNew (void);
+void elektraArenaDel (ElektraArena * arena);
+ElektraArena * elektraArenaActivate (ElektraArena * arena);
+void * elektraArenaCalloc (size_t size);
+int elektraArenaReserve (ElektraArena * arena, size_t size, size_t count);
+void * elektraArenaMalloc (ElektraArena * arena, size_t size);
+void elektraArenaFree (void * object);
+
+ElektraMetaIntern * elektraMetaInternNew (void);
+void elektraMetaInternDel (ElektraMetaIntern * intern);
+ElektraMetaIntern * elektraMetaInternActivate (ElektraMetaIntern * intern);
+Key * elektraMetaInternLookup (const Key * name, const char * value, size_t valueSize);
+int elektraMetaInternInsert (Key * meta);
+
+ElektraThreadPool * elektraThreadPoolNew (size_t threads);
+void elektraThreadPoolDel (ElektraThreadPool * pool);
+size_t elektraThreadPoolSize (const ElektraThreadPool * pool);
+void elektraThreadPoolRun (ElektraThreadPool * pool, ElektraThreadPoolTask task, void * data, size_t count, size_t elementSize);
+
+char * elektraSnapshotFile (const char * bootstrapFile);
+int elektraSnapshotRead (const char * snapshotFile, const char * bootstrapFile, KeySet * keys);
+void elektraSnapshotRemove (const char * snapshotFile);
+int elektraSnapshotWrite (const char * snapshotFile, const char * bootstrapFile, KeySet * keys);
+
 
 /*Internally used for array handling*/
 int elektraValidateKeyName (const char * name, size_t size);
@@ -26,6 +26,16 @@ KeySet * elektraKeyGetMetaKeySet (const Key * key);
 
 Key * ksPopAtCursor (KeySet * ks, cursor_t c);
 
+// build large KeySets from unsorted input with a single sort
+ssize_t elektraKsBulkAppendKey (KeySet * ks, Key * toAppend);
+ssize_t elektraKsBulkFinish (KeySet * ks);
+
+// read-only range of the Keys below a Key
+ssize_t elektraKsFindHierarchy (const KeySet * ks, const Key * root, ssize_t * end);
+
+// KeySet whose Keys from kdbGet() are allocated from an arena
+KeySet * elektraKsNewArena (size_t alloc);
+
 #ifdef __cplusplus
 }
 }
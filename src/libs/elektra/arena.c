@@ -0,0 +1,276 @@
+/**
+ * @file
+ *
+ * @brief Arena for Key and KeySet structs.
+ *
+ * Structs are bump-allocated from large chunks. Every chunk counts
+ * its live objects and is freed as a whole once it is full (or its
+ * arena is deleted) and the last of its objects was released.
+ * So objects may outlive the arena they were allocated from. Objects may
+ * be released from any thread, allocating is limited to one thread per arena.
+ *
+ * A chunk is not freed before all of its objects are released: a single
+ * long-lived Key keeps its whole chunk of ELEKTRA_ARENA_CHUNK_SIZE bytes
+ * allocated. Arenas are therefore meant for KeySets that are loaded in bulk
+ * and deleted as a whole, like the ones of kdbGet().
+ *
+ * Storage plugins may also allocate the names and values of the keys
+ * they read from an arena, see elektraArenaReserve().
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <string.h>
+
+#include <kdbassert.h>
+#include <kdbprivate.h>
+
+#if defined(__GNUC__)
+#define ELEKTRA_ARENA_THREAD_LOCAL __thread
+#endif
+
+/**
+ * Header of a chunk, the objects follow it.
+ *
+ * Objects may be released by other threads than the one allocating from
+ * the arena, so `live` is only changed atomically. The allocations of the
+ * current chunk are counted in its arena and only added once the chunk is
+ * retired. Until then `live` stays below zero (wrapped around) as soon as an
+ * object was released, so only the last release or the retirement sees zero.
+ */
+typedef struct _ElektraArenaChunk
+{
+	size_t live; /*!< Number of allocated objects not yet released */
+} ElektraArenaChunk;
+
+/**
+ * Header in front of every object, to find the chunk of the object.
+ */
+typedef union
+{
+	ElektraArenaChunk * chunk;
+	size_t align;
+	void * alignPointer;
+} ElektraArenaObject;
+
+struct _ElektraArena
+{
+	ElektraArenaChunk * current; /*!< The chunk new objects are allocated from */
+	char * next;		     /*!< Next free byte in current */
+	char * end;		     /*!< End of current */
+	size_t allocated;	     /*!< Number of objects allocated from current */
+};
+
+#ifdef ELEKTRA_ARENA_THREAD_LOCAL
+/** The arena used by elektraArenaCalloc(), see elektraArenaActivate() */
+static ELEKTRA_ARENA_THREAD_LOCAL ElektraArena * elektraArenaActive = 0;
+#endif
+
+/**
+ * @internal
+ *
+ * @brief Stops allocating from the current chunk of @p arena and frees it if it is unused.
+ */
+static void elektraArenaRetire (ElektraArena * arena)
+{
+	ElektraArenaChunk * chunk = arena->current;
+	if (!chunk) return;
+	if (__atomic_add_fetch (&chunk->live, arena->allocated, __ATOMIC_ACQ_REL) == 0) elektraFree (chunk);
+	arena->current = 0;
+	arena->allocated = 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Creates a new arena.
+ *
+ * @return the new arena
+ * @retval NULL on memory error
+ */
+ElektraArena * elektraArenaNew (void)
+{
+	return elektraCalloc (sizeof (ElektraArena));
+}
+
+/**
+ * @internal
+ *
+ * @brief Deletes an arena.
+ *
+ * Objects allocated from the arena stay valid, their chunks are
+ * freed once their last object is released.
+ *
+ * @param arena the arena to delete
+ */
+void elektraArenaDel (ElektraArena * arena)
+{
+	if (!arena) return;
+#ifdef ELEKTRA_ARENA_THREAD_LOCAL
+	if (elektraArenaActive == arena) elektraArenaActive = 0;
+#endif
+	elektraArenaRetire (arena);
+	elektraFree (arena);
+}
+
+/**
+ * @internal
+ *
+ * @brief Sets the arena used by elektraArenaCalloc() in the current thread.
+ *
+ * @param arena the arena to use, NULL to allocate from the heap
+ *
+ * @return the arena used before, to restore it later
+ */
+ElektraArena * elektraArenaActivate (ElektraArena * arena)
+{
+#ifdef ELEKTRA_ARENA_THREAD_LOCAL
+	ElektraArena * previous = elektraArenaActive;
+	elektraArenaActive = arena;
+	return previous;
+#else
+	(void) arena;
+	return 0;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Retires the current chunk of @p arena and starts a new one.
+ *
+ * @param arena the arena
+ * @param size the space needed in the new chunk
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraArenaGrow (ElektraArena * arena, size_t size)
+{
+	const size_t align = sizeof (ElektraArenaObject);
+	size_t header = (sizeof (ElektraArenaChunk) + align - 1) / align * align;
+	size_t chunkSize = header + size < ELEKTRA_ARENA_CHUNK_SIZE ? ELEKTRA_ARENA_CHUNK_SIZE : header + size;
+
+	ElektraArenaChunk * chunk = elektraMalloc (chunkSize);
+	if (!chunk) return -1;
+	chunk->live = 0;
+
+	elektraArenaRetire (arena);
+	arena->current = chunk;
+	arena->next = (char *) chunk + header;
+	arena->end = (char *) chunk + chunkSize;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates an object of @p size bytes from @p arena.
+ */
+static void * elektraArenaAllocate (ElektraArena * arena, size_t size)
+{
+	const size_t align = sizeof (ElektraArenaObject);
+	size_t needed = sizeof (ElektraArenaObject) + (size + align - 1) / align * align;
+
+	if ((!arena->current || (size_t) (arena->end - arena->next) < needed) && elektraArenaGrow (arena, needed) == -1)
+	{
+		return 0;
+	}
+
+	ElektraArenaObject * header = (ElektraArenaObject *) arena->next;
+	arena->next += needed;
+	header->chunk = arena->current;
+	++arena->allocated;
+	return header + 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates zeroed memory from the active arena.
+ *
+ * @param size the size of the object, at most ELEKTRA_ARENA_MAX_OBJECT
+ *
+ * @return the object, must be released with elektraArenaFree()
+ * @retval NULL if no arena is active or on memory error,
+ *         the caller has to use the heap then
+ */
+void * elektraArenaCalloc (size_t size)
+{
+#ifdef ELEKTRA_ARENA_THREAD_LOCAL
+	ElektraArena * arena = elektraArenaActive;
+	if (!arena) return 0;
+
+	ELEKTRA_ASSERT (size <= ELEKTRA_ARENA_MAX_OBJECT, "object too large for arena: %zu", size);
+	void * object = elektraArenaAllocate (arena, size);
+	if (!object) return 0;
+	memset (object, 0, size);
+	return object;
+#else
+	(void) size;
+	return 0;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Makes sure that the next objects allocated from @p arena fit into one chunk.
+ *
+ * A chunk with enough space for @p count objects with together @p size bytes
+ * is allocated, unless the current chunk has enough space left. So a storage
+ * plugin can put the names and values of all keys it reads into a single
+ * allocation, which is freed once the last of these keys is deleted.
+ *
+ * @param arena the arena to allocate from later
+ * @param size the sum of the sizes of the objects
+ * @param count the number of objects
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+int elektraArenaReserve (ElektraArena * arena, size_t size, size_t count)
+{
+	const size_t align = sizeof (ElektraArenaObject);
+	size_t needed = size + count * (sizeof (ElektraArenaObject) + align - 1);
+	if (arena->current && (size_t) (arena->end - arena->next) >= needed) return 0;
+	return elektraArenaGrow (arena, needed);
+}
+
+/**
+ * @internal
+ *
+ * @brief Allocates uninitialized memory from @p arena.
+ *
+ * Unlike elektraArenaCalloc(), the arena is given explicitly and the size
+ * is not limited. Names and values allocated this way must be marked with
+ * KEY_FLAG_ARENA_KEY and KEY_FLAG_ARENA_DATA.
+ *
+ * @param arena the arena to allocate from
+ * @param size the size of the object
+ *
+ * @return the object, must be released with elektraArenaFree()
+ * @retval NULL on memory error
+ */
+void * elektraArenaMalloc (ElektraArena * arena, size_t size)
+{
+	return elektraArenaAllocate (arena, size);
+}
+
+/**
+ * @internal
+ *
+ * @brief Releases an object allocated by elektraArenaCalloc().
+ *
+ * @param object the object to release
+ */
+void elektraArenaFree (void * object)
+{
+	if (!object) return;
+	ElektraArenaChunk * chunk = ((ElektraArenaObject *) object - 1)->chunk;
+	if (__atomic_sub_fetch (&chunk->live, 1, __ATOMIC_ACQ_REL) == 0) elektraFree (chunk);
+}
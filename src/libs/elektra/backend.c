@@ -132,59 +132,37 @@ static Backend * backendOpenMissing (KeySet * global, Key * mp)
 	return backend;
 }
 
-/**Builds a backend out of the configuration supplied
- * from:
- *
-@verbatim
-system/elektra/mountpoints/<name>
-@endverbatim
- *
- * The root key must be like the above example. You do
- * not need to rewind the keyset. But every key must be
- * below the root key.
- *
- * The internal consistency will be checked in this
- * function. If necessary parts are missing, like
- * no plugins, they cant be loaded or similar 0
- * will be returned.
+/**
+ * @internal
  *
- * ksCut() is perfectly suitable for cutting out the
- * configuration like needed.
+ * @brief Opens the plugins of a backend as configured below
+ * system/elektra/mountpoints/<name>.
  *
- * @note The given KeySet will be deleted within the function,
- * don't use it afterwards.
+ * @note The given KeySet will be deleted within the function.
  *
- * @param elektraConfig the configuration to work with.
- *        It is used to build up this backend.
+ * @param backend the backend to put the plugins into
+ * @param elektraConfig the configuration of the backend
  * @param modules used to load new modules or get references
  *        to existing one
  * @param global the global keyset of the KDB instance
- * @param errorKey the key where an error and warnings are added
+ * @param failure 1 if a problem was already reported, no further
+ *        warnings are added then
+ * @param errorKey the key where warnings are added
  *
- * @return a pointer to a freshly allocated backend
- *         this could be the requested backend or a so called
- *         "missing backend".
- * @retval 0 if out of memory
- * @ingroup backend
+ * @retval 1 if a plugin could not be opened or failure was given
+ * @retval 0 on success
  */
-Backend * backendOpen (KeySet * elektraConfig, KeySet * modules, KeySet * global, Key * errorKey)
+static int elektraBackendProcessConfig (Backend * backend, KeySet * elektraConfig, KeySet * modules, KeySet * global, int failure,
+					Key * errorKey)
 {
 	Key * cur;
-	KeySet * referencePlugins = 0;
+	KeySet * referencePlugins = ksNew (0, KS_END);
 	KeySet * systemConfig = 0;
-	int failure = 0;
 
-	referencePlugins = ksNew (0, KS_END);
 	ksRewind (elektraConfig);
 
 	Key * root = ksNext (elektraConfig);
 
-	Backend * backend = elektraBackendAllocate ();
-	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
-	{ // warning already set
-		failure = 1;
-	}
-
 	while ((cur = ksNext (elektraConfig)) != 0)
 	{
 		if (keyIsDirectlyBelow (root, cur) == 1)
@@ -248,6 +226,94 @@ Backend * backendOpen (KeySet * elektraConfig, KeySet * modules, KeySet * global
 		}
 	}
 
+	ksDel (systemConfig);
+	ksDel (elektraConfig);
+	ksDel (referencePlugins);
+
+	return failure;
+}
+
+/**
+ * @internal
+ *
+ * @brief Closes all plugins of a backend.
+ *
+ * @return the number of plugins that could not be closed
+ */
+static int elektraBackendClosePlugins (Backend * backend, Key * errorKey)
+{
+	int errorOccurred = 0;
+
+	for (int i = 0; i < NR_OF_PLUGINS; ++i)
+	{
+		int ret = elektraPluginClose (backend->setplugins[i], errorKey);
+		if (ret == -1) ++errorOccurred;
+
+		ret = elektraPluginClose (backend->getplugins[i], errorKey);
+		if (ret == -1) ++errorOccurred;
+
+		ret = elektraPluginClose (backend->errorplugins[i], errorKey);
+		if (ret == -1) ++errorOccurred;
+
+		backend->setplugins[i] = 0;
+		backend->getplugins[i] = 0;
+		backend->errorplugins[i] = 0;
+	}
+
+	return errorOccurred;
+}
+
+/**Builds a backend out of the configuration supplied
+ * from:
+ *
+@verbatim
+system/elektra/mountpoints/<name>
+@endverbatim
+ *
+ * The root key must be like the above example. You do
+ * not need to rewind the keyset. But every key must be
+ * below the root key.
+ *
+ * The internal consistency will be checked in this
+ * function. If necessary parts are missing, like
+ * no plugins, they cant be loaded or similar 0
+ * will be returned.
+ *
+ * ksCut() is perfectly suitable for cutting out the
+ * configuration like needed.
+ *
+ * @note The given KeySet will be deleted within the function,
+ * don't use it afterwards.
+ *
+ * @param elektraConfig the configuration to work with.
+ *        It is used to build up this backend.
+ * @param modules used to load new modules or get references
+ *        to existing one
+ * @param global the global keyset of the KDB instance
+ * @param errorKey the key where an error and warnings are added
+ *
+ * @return a pointer to a freshly allocated backend
+ *         this could be the requested backend or a so called
+ *         "missing backend".
+ * @retval 0 if out of memory
+ * @see backendOpenLazy() to open the plugins on first use
+ * @ingroup backend
+ */
+Backend * backendOpen (KeySet * elektraConfig, KeySet * modules, KeySet * global, Key * errorKey)
+{
+	int failure = 0;
+
+	ksRewind (elektraConfig);
+	ksNext (elektraConfig);
+
+	Backend * backend = elektraBackendAllocate ();
+	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
+	{ // warning already set
+		failure = 1;
+	}
+
+	failure = elektraBackendProcessConfig (backend, elektraConfig, modules, global, failure, errorKey);
+
 	if (failure)
 	{
 		Backend * tmpBackend = backendOpenMissing (global, backend->mountpoint);
@@ -255,13 +321,84 @@ Backend * backendOpen (KeySet * elektraConfig, KeySet * modules, KeySet * global
 		backend = tmpBackend;
 	}
 
-	ksDel (systemConfig);
-	ksDel (elektraConfig);
-	ksDel (referencePlugins);
+	return backend;
+}
 
+/**
+ * @brief Builds a backend without opening its plugins.
+ *
+ * Only the mountpoint is read, so that the backend can be mounted.
+ * The rest of the configuration, i.e. which plugins are placed where
+ * and their config, is kept within the backend until backendOpenPlugins()
+ * is called the first time the backend is used.
+ *
+ * @note The given KeySet will be deleted or owned by the backend,
+ * don't use it afterwards.
+ *
+ * @param elektraConfig the configuration below
+ *        system/elektra/mountpoints/<name>, see backendOpen()
+ * @param errorKey the key where warnings are added
+ *
+ * @return a pointer to a freshly allocated backend,
+ *         without mountpoint if none was found
+ * @ingroup backend
+ */
+Backend * backendOpenLazy (KeySet * elektraConfig, Key * errorKey)
+{
+	ksRewind (elektraConfig);
+	ksNext (elektraConfig);
+
+	Backend * backend = elektraBackendAllocate ();
+	if (elektraBackendSetMountpoint (backend, elektraConfig, errorKey) == -1)
+	{ // warning already set
+		ksDel (elektraConfig);
+		return backend;
+	}
+
+	backend->config = elektraConfig;
 	return backend;
 }
 
+/**
+ * @brief Opens the plugins of a backend built by backendOpenLazy().
+ *
+ * Does nothing if the plugins are already open. If a plugin cannot
+ * be opened, the backend becomes a "missing backend" (see backendOpen()).
+ *
+ * @param backend the backend to open the plugins for
+ * @param modules used to load new modules or get references
+ *        to existing one
+ * @param global the global keyset of the KDB instance
+ * @param errorKey the key where warnings are added
+ *
+ * @retval -1 if the plugins could not be opened
+ * @retval 0 on success or if the plugins were open already
+ * @ingroup backend
+ */
+int backendOpenPlugins (Backend * backend, KeySet * modules, KeySet * global, Key * errorKey)
+{
+	if (!backend->config) return 0;
+
+	KeySet * elektraConfig = backend->config;
+	backend->config = 0;
+
+	if (!elektraBackendProcessConfig (backend, elektraConfig, modules, global, 0, errorKey)) return 0;
+
+	elektraBackendClosePlugins (backend, errorKey);
+
+	Plugin * plugin = elektraPluginMissing ();
+	if (plugin)
+	{
+		plugin->global = global;
+		backend->getplugins[0] = plugin;
+		backend->setplugins[0] = plugin;
+		plugin->refcounter = 2;
+	}
+	keySetString (backend->mountpoint, "missing");
+
+	return -1;
+}
+
 /**
  * Opens a default backend using the plugin named KDB_RESOLVER
  * and KDB_STORAGE.
@@ -457,6 +594,81 @@ int backendUpdateSize (Backend * backend, Key * parent, int size)
 	return 0;
 }
 
+/**
+ * @internal
+ *
+ * @brief The field for the file of the namespace of parent
+ *
+ * @retval 0 if the namespace has no file
+ */
+static char ** elektraBackendFile (Backend * backend, Key * parent)
+{
+	switch (keyGetNamespace (parent))
+	{
+	case KEY_NS_SPEC:
+		return &backend->specfile;
+	case KEY_NS_DIR:
+		return &backend->dirfile;
+	case KEY_NS_USER:
+		return &backend->userfile;
+	case KEY_NS_SYSTEM:
+		return &backend->systemfile;
+	case KEY_NS_PROC:
+	case KEY_NS_EMPTY:
+	case KEY_NS_META:
+	case KEY_NS_CASCADING:
+	case KEY_NS_NONE:
+		break;
+	}
+	return 0;
+}
+
+/**
+ * @brief Update the file the resolver returned in backend
+ *
+ * @param backend the backend to update
+ * @param parent for parent
+ * @param file the file the resolver returned, 0 if none,
+ *        "" if the file must not be stat'ed (the resolver watches it)
+ *
+ * @retval -1 if invalid parent
+ * @retval 0 on success
+ */
+int backendUpdateFile (Backend * backend, Key * parent, const char * file)
+{
+	char ** field = elektraBackendFile (backend, parent);
+	if (!field) return -1;
+
+	if (!file)
+	{
+		elektraFree (*field);
+		*field = 0;
+		return 0;
+	}
+
+	if (*field && !strcmp (*field, file)) return 0;
+
+	elektraFree (*field);
+	*field = elektraStrDup (file);
+	return 0;
+}
+
+/**
+ * @brief Get the file the resolver returned in the previous get
+ *
+ * @param backend the backend
+ * @param parent for parent
+ *
+ * @return the file
+ * @retval 0 if the file is not known yet
+ * @retval "" if the file must not be stat'ed
+ */
+const char * backendGetFile (Backend * backend, Key * parent)
+{
+	char ** field = elektraBackendFile (backend, parent);
+	return field ? *field : 0;
+}
+
 int backendClose (Backend * backend, Key * errorKey)
 {
 	int errorOccurred = 0;
@@ -472,17 +684,12 @@ int backendClose (Backend * backend, Key * errorKey)
 	keySetName (errorKey, keyName (backend->mountpoint));
 	keyDel (backend->mountpoint);
 
-	for (int i = 0; i < NR_OF_PLUGINS; ++i)
-	{
-		int ret = elektraPluginClose (backend->setplugins[i], errorKey);
-		if (ret == -1) ++errorOccurred;
-
-		ret = elektraPluginClose (backend->getplugins[i], errorKey);
-		if (ret == -1) ++errorOccurred;
-
-		ret = elektraPluginClose (backend->errorplugins[i], errorKey);
-		if (ret == -1) ++errorOccurred;
-	}
+	errorOccurred = elektraBackendClosePlugins (backend, errorKey);
+	ksDel (backend->config);
+	elektraFree (backend->specfile);
+	elektraFree (backend->dirfile);
+	elektraFree (backend->userfile);
+	elektraFree (backend->systemfile);
 	elektraFree (backend);
 
 	if (errorOccurred)
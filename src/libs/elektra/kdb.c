@@ -11,6 +11,10 @@
 #include "kdbconfig.h"
 #endif
 
+#ifdef HAVE_STATX
+#define _GNU_SOURCE /* For statx */
+#endif
+
 #if DEBUG && defined(HAVE_STDIO_H)
 #include <stdio.h>
 #endif
@@ -45,7 +49,15 @@
 #include <errno.h>
 #endif
 
+#ifdef HAVE_UNISTD_H
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <sys/stat.h>
+
 #include <kdbinternal.h>
+#include "../../plugins/resolver/shared.h"
 
 
 /**
@@ -189,14 +201,17 @@ KeySet * ksRenameKeys (KeySet * config, const char * name)
  * @param handle already allocated, but without defaultBackend
  * @param [out] keys for bootstrapping
  * @param errorKey key to add errors too
+ * @param [out] bootstrapFile the file the keys were read from, to be freed with
+ *        elektraFree(), 0 if they were not read from KDB_DB_INIT
  *
  * @retval -1 failure: cannot initialize defaultBackend
  * @retval 0 warning: could not get initial config
  * @retval 1 success
  * @retval 2 success in fallback mode
  */
-int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
+int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey, char ** bootstrapFile)
 {
+	*bootstrapFile = 0;
 	handle->defaultBackend = backendOpenDefault (handle->modules, handle->global, KDB_DB_INIT, errorKey);
 	if (!handle->defaultBackend) return -1;
 
@@ -209,7 +224,12 @@ int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 	int funret = 1;
 	int ret = kdbGet (handle, keys, errorKey);
 	int fallbackret = 0;
-	if (ret == 0 || ret == -1)
+	if (ret == 1)
+	{
+		// the resolver stored the name of the bootstrap file
+		*bootstrapFile = elektraStrDup (keyString (errorKey));
+	}
+	else
 	{
 		// could not get KDB_DB_INIT, try KDB_DB_FILE
 		// first cleanup:
@@ -232,13 +252,12 @@ int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 		fallbackret = kdbGet (handle, keys, errorKey);
 		keySetName (errorKey, "system/elektra/mountpoints");
 
-		KeySet * cutKeys = ksCut (keys, errorKey);
-		if (fallbackret == 1 && ksGetSize (cutKeys) != 0)
+		ssize_t end;
+		ssize_t mountpoints = elektraKsFindHierarchy (keys, errorKey, &end);
+		if (fallbackret == 1 && end > mountpoints)
 		{
 			funret = 2;
 		}
-		ksAppend (keys, cutKeys);
-		ksDel (cutKeys);
 	}
 
 	if (ret == -1 && fallbackret == -1)
@@ -250,6 +269,45 @@ int elektraOpenBootstrap (KDB * handle, KeySet * keys, Key * errorKey)
 	return funret;
 }
 
+/**
+ * @internal
+ *
+ * @brief Resolves the bootstrap file like the default backend does.
+ *
+ * The bootstrap file depends on the environment of the process, e.g. on
+ * XDG_CONFIG_DIRS, so a snapshot must only be used for the same file.
+ *
+ * @param handle with the modules to open the resolver with
+ *
+ * @return the absolute path of KDB_DB_INIT, to be freed with elektraFree()
+ * @retval NULL if the resolver could not resolve it
+ */
+static char * elektraResolveBootstrap (KDB * handle)
+{
+	typedef ElektraResolved * (*resolveFileFunc) (elektraNamespace, const char *, ElektraResolveTempfile, Key *);
+	typedef void (*freeHandleFunc) (ElektraResolved *);
+
+	// warnings of the resolver are reported by elektraOpenBootstrap()
+	Key * warningsKey = keyNew (0, KEY_END);
+	KeySet * config = ksNew (1, keyNew ("system/path", KEY_VALUE, KDB_DB_INIT, KEY_END), KS_END);
+	Plugin * resolver = elektraPluginOpen (KDB_RESOLVER, handle->modules, config, warningsKey);
+	char * path = 0;
+	if (resolver)
+	{
+		resolveFileFunc resolveFile = (resolveFileFunc) elektraPluginGetFunction (resolver, "filename");
+		freeHandleFunc freeHandle = (freeHandleFunc) elektraPluginGetFunction (resolver, "freeHandle");
+		ElektraResolved * resolved = 0;
+		if (resolveFile && freeHandle)
+		{
+			resolved = resolveFile (KEY_NS_SYSTEM, KDB_DB_INIT, ELEKTRA_RESOLVER_TEMPFILE_NONE, warningsKey);
+		}
+		if (resolved && resolved->fullPath && resolved->fullPath[0] == '/') path = elektraStrDup (resolved->fullPath);
+		if (resolved) freeHandle (resolved);
+		elektraPluginClose (resolver, warningsKey);
+	}
+	keyDel (warningsKey);
+	return path;
+}
 
 /**
  * @brief Opens the session with the Key database.
@@ -320,9 +378,16 @@ KDB * kdbOpen (Key * errorKey)
 
 	KeySet * keys = ksNew (0, KS_END);
 	int inFallback = 0;
-	switch (elektraOpenBootstrap (handle, keys, errorKey))
+	char * resolvedFile = elektraResolveBootstrap (handle);
+	char * snapshotFile = elektraSnapshotFile (resolvedFile);
+	char * bootstrapFile = 0;
+	int snapshot = snapshotFile ? elektraSnapshotRead (snapshotFile, resolvedFile, keys) : 0;
+	switch (snapshot == 1 ? 1 : elektraOpenBootstrap (handle, keys, errorKey, &bootstrapFile))
 	{
 	case -1:
+		elektraFree (resolvedFile);
+		elektraFree (snapshotFile);
+		elektraFree (bootstrapFile);
 		ksDel (handle->global);
 		ksDel (handle->modules);
 		elektraFree (handle);
@@ -339,6 +404,8 @@ KDB * kdbOpen (Key * errorKey)
 		ELEKTRA_ADD_INSTALLATION_WARNING (errorKey, "Initial 'kdbGet()' failed, you should either fix " KDB_DB_INIT
 							    " or the fallback " KDB_DB_FILE);
 		break;
+	case 1:
+		break;
 	case 2:
 		ELEKTRA_LOG ("entered fallback code for bootstrapping");
 		inFallback = 1;
@@ -347,8 +414,22 @@ KDB * kdbOpen (Key * errorKey)
 
 	keySetString (errorKey, "kdbOpen(): mountGlobals");
 
+	// a snapshot is only written if all of its keys can be mounted
+	KeySet * snapshotKeys = 0;
+	if (snapshotFile && bootstrapFile && !strcmp (bootstrapFile, resolvedFile) &&
+	    ksLookupByName (keys, KDB_SYSTEM_ELEKTRA "/snapshot", 0))
+	{
+		snapshotKeys = ksDup (keys);
+	}
+	else if (bootstrapFile && snapshot == -1)
+	{
+		elektraSnapshotRemove (snapshotFile);
+	}
+
 	if (mountGlobals (handle, ksDup (keys), handle->modules, errorKey) == -1)
 	{
+		ksDel (snapshotKeys);
+		snapshotKeys = 0;
 		// mountGlobals also sets a warning containing the name of the plugin that failed to load
 		ELEKTRA_ADD_INSTALLATION_WARNING (errorKey, "Mounting global plugins failed. Please see warning of concrete plugin");
 	}
@@ -356,8 +437,9 @@ KDB * kdbOpen (Key * errorKey)
 	keySetName (errorKey, keyName (initialParent));
 	keySetString (errorKey, "kdbOpen(): backendClose");
 
-	backendClose (handle->defaultBackend, errorKey);
-	splitDel (handle->split);
+	// without default backend and split, if the keys were read from the snapshot
+	if (handle->defaultBackend) backendClose (handle->defaultBackend, errorKey);
+	if (handle->split) splitDel (handle->split);
 	handle->defaultBackend = 0;
 	handle->trie = 0;
 
@@ -375,17 +457,27 @@ KDB * kdbOpen (Key * errorKey)
 
 	handle->split = splitNew ();
 
+	Key * threadsKey = ksLookupByName (keys, KDB_SYSTEM_ELEKTRA "/threads", 0);
+	long threads = threadsKey ? strtol (keyString (threadsKey), 0, 10) : 0;
+	if (threads > KDB_MAX_THREADS) threads = KDB_MAX_THREADS;
+
 	keySetString (errorKey, "kdbOpen(): mountOpen");
 	// Open the trie, keys will be deleted within mountOpen
 	if (mountOpen (handle, keys, handle->modules, errorKey) == -1)
 	{
 		ELEKTRA_ADD_INSTALLATION_WARNING (errorKey, "Initial loading of trie did not work");
+		ksDel (snapshotKeys);
+		snapshotKeys = 0;
 	}
 
 	keySetString (errorKey, "kdbOpen(): mountDefault");
 	if (mountDefault (handle, handle->modules, inFallback, errorKey) == -1)
 	{
 		ELEKTRA_SET_INSTALLATION_ERROR (errorKey, "Could not reopen and mount default backend");
+		ksDel (snapshotKeys);
+		elektraFree (resolvedFile);
+		elektraFree (bootstrapFile);
+		elektraFree (snapshotFile);
 		keySetString (errorKey, "kdbOpen(): close");
 		kdbClose (handle, errorKey);
 
@@ -405,6 +497,18 @@ KDB * kdbOpen (Key * errorKey)
 		ELEKTRA_ADD_INTERNAL_WARNING (errorKey, "Mounting modules did not work");
 	}
 
+	// without thread pool the backends are read one after another
+	if (threads > 0) handle->threadPool = elektraThreadPoolNew (threads);
+
+	if (snapshotKeys && elektraSnapshotWrite (snapshotFile, bootstrapFile, snapshotKeys) == -1)
+	{
+		ELEKTRA_LOG_WARNING ("could not write bootstrap snapshot %s", snapshotFile);
+	}
+	ksDel (snapshotKeys);
+	elektraFree (resolvedFile);
+	elektraFree (bootstrapFile);
+	elektraFree (snapshotFile);
+
 	keySetName (errorKey, keyName (initialParent));
 	keySetString (errorKey, keyString (initialParent));
 	keyDel (initialParent);
@@ -479,6 +583,8 @@ int kdbClose (KDB * handle, Key * errorKey)
 
 	if (handle->global) ksDel (handle->global);
 
+	elektraThreadPoolDel (handle->threadPool);
+
 	elektraFree (handle);
 
 	keySetName (errorKey, keyName (initialParent));
@@ -488,6 +594,120 @@ int kdbClose (KDB * handle, Key * errorKey)
 	return 0;
 }
 
+/** Below this number of files elektraGetStatFiles() does not use the thread pool */
+#define ELEKTRA_STAT_PARALLEL_MIN 16
+
+typedef struct
+{
+	const char * file; /*!< The file to stat, 0 if the file is not known */
+	ElektraStat stat;  /*!< The result */
+} ElektraStatTask;
+
+static void elektraStatTaskRun (void * data)
+{
+	ElektraStatTask * task = data;
+	ElektraStat * result = &task->stat;
+	if (!task->file) return;
+#ifdef HAVE_STATX
+	struct statx buf;
+	if (statx (AT_FDCWD, task->file, 0, STATX_MODE | STATX_UID | STATX_GID | STATX_MTIME, &buf) == -1) return;
+	result->mode = buf.stx_mode;
+	result->uid = buf.stx_uid;
+	result->gid = buf.stx_gid;
+	result->mtimeSec = buf.stx_mtime.tv_sec;
+	result->mtimeNsec = buf.stx_mtime.tv_nsec;
+#else
+	struct stat buf;
+	if (stat (task->file, &buf) == -1) return;
+	result->mode = buf.st_mode;
+	result->uid = buf.st_uid;
+	result->gid = buf.st_gid;
+	result->mtimeSec = ELEKTRA_STAT_SECONDS (buf);
+	result->mtimeNsec = ELEKTRA_STAT_NANO_SECONDS (buf);
+#endif
+	result->found = 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Stats the files of all backends in split at once
+ *
+ * The files are the ones the resolvers returned in the previous kdbGet()
+ * or, in the first kdbGet(), the ones stored in the cache metadata.
+ * Files watched by their resolver are not stat'ed.
+ * Many files are stat'ed in parallel if a thread pool is available.
+ *
+ * @param handle the handle with the global keyset
+ * @param split the backends to stat the files of
+ *
+ * @return the stat results, one for every split entry
+ * @retval 0 if no file is known
+ */
+static ElektraStatTask * elektraGetStatFiles (KDB * handle, Split * split)
+{
+	if (!handle->global || split->size == 0) return 0;
+
+	ElektraStatTask * stats = elektraCalloc (split->size * sizeof (ElektraStatTask));
+	if (!stats) return 0;
+
+	size_t count = 0;
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		const char * file = backendGetFile (split->handles[i], split->parents[i]);
+		if (!file) file = splitCacheFileName (split, i, handle->global);
+		if (!file || !*file) continue;
+		stats[i].file = file;
+		++count;
+	}
+
+	if (count == 0)
+	{
+		elektraFree (stats);
+		return 0;
+	}
+
+	elektraThreadPoolRun (count >= ELEKTRA_STAT_PARALLEL_MIN ? handle->threadPool : 0, elektraStatTaskRun, stats, split->size,
+			      sizeof (ElektraStatTask));
+	return stats;
+}
+
+/**
+ * @internal
+ *
+ * Sets the KDB_STAT_PREFIX key to the stat result of @p task, followed by a copy of the name of its file.
+ *
+ * @param task the stat result, 0 if the file is not known
+ */
+static void elektraStatKeySet (Key * statKey, const ElektraStatTask * task)
+{
+	static const ElektraStat unknown = { 0 };
+	size_t fileSize = task && task->file ? strlen (task->file) + 1 : 0;
+	char * value = elektraMalloc (sizeof (ElektraStat) + fileSize);
+	if (!value)
+	{
+		keySetRaw (statKey, &unknown, sizeof (ElektraStat));
+		return;
+	}
+	memcpy (value, fileSize ? &task->stat : &unknown, sizeof (ElektraStat));
+	if (fileSize) memcpy (value + sizeof (ElektraStat), task->file, fileSize);
+	keySetRaw (statKey, value, sizeof (ElektraStat) + fileSize);
+	elektraFree (value);
+}
+
+/**
+ * @internal
+ *
+ * @retval 1 if the resolver reported in the KDB_STAT_PREFIX key that it watches its file
+ */
+static int elektraStatKeyWatched (Key * statKey)
+{
+	ElektraStat result;
+	if (!statKey || keyGetValueSize (statKey) < (ssize_t) sizeof (ElektraStat)) return 0;
+	memcpy (&result, keyValue (statKey), sizeof (ElektraStat));
+	return result.watched;
+}
+
 /**
  * @internal
  *
@@ -498,25 +718,36 @@ int kdbClose (KDB * handle, Key * errorKey)
  * @retval 0 no update needed
  * @retval number of plugins which need update
  */
-static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
+static int elektraGetCheckUpdateNeeded (KDB * handle, Split * split, Key * parentKey)
 {
 	int updateNeededOccurred = 0;
 	size_t cacheHits = 0;
+
+	ElektraStatTask * stats = elektraGetStatFiles (handle, split);
+	Key * statKey = 0;
+	if (handle->global)
+	{
+		statKey = keyNew (KDB_STAT_PREFIX, KEY_BINARY, KEY_END);
+		ksAppendKey (handle->global, statKey);
+	}
+
 	for (size_t i = 0; i < split->size; i++)
 	{
 		int ret = -1;
 		Backend * backend = split->handles[i];
-		clear_bit (split->syncbits[i], (splitflag_t) SPLIT_FLAG_SYNC);
+		clear_bit (split->syncbits[i], (splitflag_t) (SPLIT_FLAG_SYNC | SPLIT_FLAG_CACHE));
 
 		Plugin * resolver = backend->getplugins[RESOLVER_PLUGIN];
 		if (resolver && resolver->kdbGet)
 		{
+			if (statKey) elektraStatKeySet (statKey, stats ? &stats[i] : 0);
 			ksRewind (split->keysets[i]);
 			keySetName (parentKey, keyName (split->parents[i]));
 			keySetString (parentKey, "");
 			ret = resolver->kdbGet (resolver, split->keysets[i], parentKey);
 			// store resolved filename
 			keySetString (split->parents[i], keyString (parentKey));
+			backendUpdateFile (backend, split->parents[i], elektraStatKeyWatched (statKey) ? "" : keyString (parentKey));
 			// no keys in that backend
 			ELEKTRA_LOG_DEBUG ("backend: %s,%s ;; ret: %d", keyName (split->parents[i]), keyString (split->parents[i]), ret);
 
@@ -529,6 +760,7 @@ static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
 		case ELEKTRA_PLUGIN_STATUS_CACHE_HIT:
 			// Keys in cache are up-to-date
 			++cacheHits;
+			set_bit (split->syncbits[i], SPLIT_FLAG_CACHE);
 			// Set sync flag, needed in case of cache miss
 			// FALLTHROUGH
 		case ELEKTRA_PLUGIN_STATUS_SUCCESS:
@@ -544,16 +776,20 @@ static int elektraGetCheckUpdateNeeded (Split * split, Key * parentKey)
 		case ELEKTRA_PLUGIN_STATUS_ERROR:
 			// Ohh, an error occurred, lets stop the
 			// process.
-			return -1;
+			updateNeededOccurred = -1;
+			goto cleanup;
 		}
 	}
 
 	if (cacheHits == split->size)
 	{
 		ELEKTRA_LOG_DEBUG ("all backends report cache is up-to-date");
-		return -2;
+		updateNeededOccurred = -2;
 	}
 
+cleanup:
+	if (statKey) keyDel (ksLookup (handle->global, statKey, KDB_O_POP));
+	elektraFree (stats);
 	return updateNeededOccurred;
 }
 
@@ -604,6 +840,346 @@ static int elektraGetDoUpdate (Split * split, Key * parentKey)
 	return 0;
 }
 
+static int copyError (Key * dest, Key * src)
+{
+	keyRewindMeta (src);
+	const Key * metaKey = keyGetMeta (src, "error");
+	if (!metaKey) return 0;
+	keySetMeta (dest, keyName (metaKey), keyString (metaKey));
+	while ((metaKey = keyNextMeta (src)) != NULL)
+	{
+		if (strncmp (keyName (metaKey), "error/", 6)) break;
+		keySetMeta (dest, keyName (metaKey), keyString (metaKey));
+	}
+	return 1;
+}
+
+static void clearError (Key * key)
+{
+	keySetMeta (key, "error", 0);
+	keySetMeta (key, "error/number", 0);
+	keySetMeta (key, "error/description", 0);
+	keySetMeta (key, "error/reason", 0);
+	keySetMeta (key, "error/module", 0);
+	keySetMeta (key, "error/file", 0);
+	keySetMeta (key, "error/line", 0);
+	keySetMeta (key, "error/configfile", 0);
+	keySetMeta (key, "error/mountpoint", 0);
+}
+
+/**
+ * @internal
+ *
+ * Adds the error or warning below the meta key @p from of @p src as warning to @p dest.
+ */
+static void addWarningFrom (Key * dest, Key * src, const char * from)
+{
+	static const char * const fields[] = { "", "/number", "/description", "/module", "/file",
+					       "/line", "/mountpoint", "/configfile", "/reason" };
+
+	const Key * destCount = keyGetMeta (dest, "warnings");
+	int next = destCount ? (atoi (keyString (destCount)) + 1) % 100 : 0;
+	char field[sizeof ("warnings/#00/configfile")];
+	char name[sizeof ("warnings/#00/configfile")];
+	snprintf (name, sizeof (name), "%02d", next);
+	keySetMeta (dest, "warnings", name);
+
+	for (size_t f = 0; f < sizeof (fields) / sizeof (fields[0]); ++f)
+	{
+		snprintf (field, sizeof (field), "%s%s", from, fields[f]);
+		snprintf (name, sizeof (name), "warnings/#%02d%s", next, fields[f]);
+		keySetMeta (dest, name, keyString (keyGetMeta (src, field)));
+	}
+}
+
+static void copyWarnings (Key * dest, Key * src)
+{
+	const Key * count = keyGetMeta (src, "warnings");
+	if (!count) return;
+	int last = atoi (keyString (count));
+	for (int i = 0; i <= last && i < 100; ++i)
+	{
+		char from[sizeof ("warnings/#00")];
+		snprintf (from, sizeof (from), "warnings/#%02d", i);
+		if (keyGetMeta (src, from)) addWarningFrom (dest, src, from);
+	}
+}
+
+/**
+ * @internal
+ *
+ * Opens the plugins of the backends in @p split that are used the first time,
+ * see system/elektra/lazy. If system/elektra/modules is in @p split, the plugins
+ * of all backends are opened, so that it lists all modules.
+ *
+ * Problems while opening the plugins are added as warnings to @p parentKey,
+ * the backend then behaves like a missing backend.
+ */
+static void elektraOpenBackends (KDB * handle, Split * split, Key * parentKey)
+{
+	Key * modulesKey = keyNew (KDB_SYSTEM_ELEKTRA "/modules", KEY_END);
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		if (keyIsBelowOrSame (modulesKey, split->parents[i]) == 1)
+		{
+			split = handle->split;
+			break;
+		}
+	}
+	keyDel (modulesKey);
+
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		Backend * backend = split->handles[i];
+		if (!backend->config) continue;
+
+		Key * errorKey = keyNew (keyName (backend->mountpoint), KEY_END);
+		backendOpenPlugins (backend, handle->modules, handle->global, errorKey);
+		if (keyGetMeta (errorKey, "error")) addWarningFrom (parentKey, errorKey, "error");
+		copyWarnings (parentKey, errorKey);
+		keyDel (errorKey);
+	}
+}
+
+/**
+ * @internal
+ *
+ * Copies the global keyset for a task, including the metadata of its keys,
+ * so that the copy shares no Key objects and reference counters with @p global.
+ *
+ * @return the copy or 0 on memory error
+ */
+static KeySet * elektraGlobalDup (const KeySet * global)
+{
+	KeySet * copy = ksDeepDup (global);
+	for (size_t i = 0; copy && i < copy->size; ++i)
+	{
+		Key * key = copy->array[i];
+		if (!key->meta) continue;
+		KeySet * meta = ksDeepDup (key->meta);
+		if (!meta)
+		{
+			ksDel (copy);
+			return 0;
+		}
+		ksDel (key->meta);
+		key->meta = meta;
+	}
+	return copy;
+}
+
+/**
+ * @internal
+ *
+ * The plugin calls of elektraGetDoUpdateParallel() or elektraSetPrepareParallel()
+ * that must be done by one thread.
+ */
+typedef struct
+{
+	Split * split;
+	const size_t * next; /*!< The next split entry with the same backend, split->size if none */
+	size_t first;	     /*!< The first split entry of the task */
+	size_t last;	     /*!< The last split entry read, the last split entry of the task when writing */
+	size_t start;	     /*!< The first plugin to call */
+	size_t end;	     /*!< The plugin after the last one to call */
+	Key * parentKey;     /*!< The parent key of the task, collects errors and warnings */
+	KeySet * global;     /*!< The global keyset of the task */
+	Key * errorKey;	     /*!< The key that caused the last error, only used by kdbSet() */
+	size_t errorEntry;   /*!< The split entry of errorKey, only used by kdbSet() */
+	const char * skipped; /*!< Non-zero for split entries the resolver skipped, only used by kdbSet() */
+	size_t failed;	     /*!< The split entry where a plugin failed first, split->size if none */
+	int ret;	     /*!< -1 if a plugin failed */
+} ElektraBackendTask;
+
+/**
+ * @internal
+ *
+ * Adds split entry i to the task of its backend, which is new if its first entry is i.
+ *
+ * @return the task of split entry i
+ */
+static ElektraBackendTask * elektraBackendTaskAdd (ElektraBackendTask * tasks, size_t * taskCount, size_t * next, Split * split, size_t i)
+{
+	size_t t = 0;
+	while (t < *taskCount && split->handles[tasks[t].last] != split->handles[i])
+		++t;
+	if (t < *taskCount)
+	{
+		next[tasks[t].last] = i;
+		tasks[t].last = i;
+		return &tasks[t];
+	}
+
+	tasks[t].split = split;
+	tasks[t].next = next;
+	tasks[t].first = i;
+	tasks[t].last = i;
+	tasks[t].failed = split->size;
+	++*taskCount;
+	return &tasks[t];
+}
+
+static void elektraGetTaskRun (void * data)
+{
+	ElektraBackendTask * task = *(ElektraBackendTask **) data;
+	Split * split = task->split;
+	for (size_t i = task->first; i < split->size; i = task->next[i])
+	{
+		Backend * backend = split->handles[i];
+		task->last = i;
+		ksRewind (split->keysets[i]);
+		keySetName (task->parentKey, keyName (split->parents[i]));
+		keySetString (task->parentKey, keyString (split->parents[i]));
+
+		for (size_t p = task->start; p < task->end; ++p)
+		{
+			if (backend->getplugins[p] && backend->getplugins[p]->kdbGet &&
+			    backend->getplugins[p]->kdbGet (backend->getplugins[p], split->keysets[i], task->parentKey) == -1)
+			{
+				task->ret = -1;
+				return;
+			}
+		}
+	}
+}
+
+static int elektraGetIsThreadSafe (Backend * backend)
+{
+	if (backend->threadSafe == 0)
+	{
+		backend->threadSafe = 1;
+		for (size_t p = 1; p < NR_OF_PLUGINS; ++p)
+		{
+			if (backend->getplugins[p] && !elektraPluginIsThreadSafe (backend->getplugins[p])) backend->threadSafe = -1;
+		}
+	}
+	return backend->threadSafe == 1;
+}
+
+static void elektraGetSetGlobal (Backend * backend, KeySet * global)
+{
+	for (size_t p = 1; p < NR_OF_PLUGINS; ++p)
+	{
+		if (backend->getplugins[p]) backend->getplugins[p]->global = global;
+	}
+}
+
+/**
+ * @internal
+ * @brief Do the real update, reading independent backends in parallel.
+ *
+ * Backends whose get plugins are all threadsafe (see elektraPluginIsThreadSafe())
+ * are read on the thread pool of the handle, the others one after another in the
+ * calling thread. Split entries of the same backend are always read by the same
+ * thread in the order of the split.
+ *
+ * Every backend gets its own parent key and a copy of the global keyset (see
+ * elektraGlobalDup()), so that plugins do not need to synchronize. If the copy
+ * cannot be made, the backend is read by the calling thread with the global
+ * keyset itself. Afterwards the warnings of all backends,
+ * the error of the first failing backend and the keys of the global keysets are
+ * merged back. Keys plugins remove from their copy of the global keyset are not
+ * removed from the global keyset.
+ *
+ * Unlike elektraGetDoUpdate(), a failing backend does not stop the others:
+ * backends after it in the split are still read and their warnings and global
+ * keys are merged too. The error reported is the one of the first failing split
+ * entry, i.e. the same error the sequential read would report.
+ *
+ * @param start the first get plugin to call
+ * @param end the get plugin after the last one to call
+ *
+ * @retval -1 on error
+ * @retval 0 on success
+ */
+static int elektraGetDoUpdateParallel (KDB * handle, Split * split, Key * parentKey, size_t start, size_t end)
+{
+	const int bypassedSplits = 1;
+	ElektraBackendTask * tasks = elektraCalloc (split->size * sizeof (ElektraBackendTask));
+	ElektraBackendTask ** safe = elektraCalloc (split->size * sizeof (ElektraBackendTask *));
+	ElektraBackendTask ** unsafe = elektraCalloc (split->size * sizeof (ElektraBackendTask *));
+	size_t * next = elektraMalloc (split->size * sizeof (size_t));
+	if (!tasks || !safe || !unsafe || !next)
+	{
+		elektraFree (tasks);
+		elektraFree (safe);
+		elektraFree (unsafe);
+		elektraFree (next);
+		ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+		return -1;
+	}
+
+	// one task per backend, split entries of the same backend are chained
+	size_t taskCount = 0;
+	size_t safeCount = 0;
+	size_t unsafeCount = 0;
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		next[i] = split->size;
+		if (i >= split->size - bypassedSplits || !test_bit (split->syncbits[i], SPLIT_FLAG_SYNC)) continue;
+
+		ElektraBackendTask * task = elektraBackendTaskAdd (tasks, &taskCount, next, split, i);
+		if (task->first != i) continue;
+		task->start = start;
+		task->end = end;
+	}
+
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		tasks[t].parentKey = keyNew (keyName (parentKey), KEY_END);
+		// without a copy the task uses the global keyset in the calling thread
+		tasks[t].global = elektraGlobalDup (handle->global);
+		if (tasks[t].global) elektraGetSetGlobal (split->handles[tasks[t].first], tasks[t].global);
+		if (tasks[t].global && elektraGetIsThreadSafe (split->handles[tasks[t].first]))
+			safe[safeCount++] = &tasks[t];
+		else
+			unsafe[unsafeCount++] = &tasks[t];
+	}
+
+	elektraThreadPoolRun (handle->threadPool, elektraGetTaskRun, safe, safeCount, sizeof (ElektraBackendTask *));
+	elektraThreadPoolRun (0, elektraGetTaskRun, unsafe, unsafeCount, sizeof (ElektraBackendTask *));
+
+	// merge in the order of the split, as if the backends were read one after another
+	int ret = 0;
+	size_t failed = split->size;
+	size_t lastTask = split->size;
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		if (tasks[t].global)
+		{
+			elektraGetSetGlobal (split->handles[tasks[t].first], handle->global);
+			ksAppend (handle->global, tasks[t].global);
+			ksDel (tasks[t].global);
+		}
+
+		copyWarnings (parentKey, tasks[t].parentKey);
+		if (tasks[t].ret == -1 && tasks[t].last < failed)
+		{
+			failed = tasks[t].last;
+			clearError (parentKey);
+			copyError (parentKey, tasks[t].parentKey);
+			ret = -1;
+		}
+		if (lastTask == split->size || tasks[t].last > tasks[lastTask].last) lastTask = t;
+	}
+
+	if (lastTask < split->size)
+	{
+		keySetName (parentKey, keyName (tasks[lastTask].parentKey));
+		keySetString (parentKey, keyString (tasks[lastTask].parentKey));
+	}
+
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		keyDel (tasks[t].parentKey);
+	}
+	elektraFree (tasks);
+	elektraFree (safe);
+	elektraFree (unsafe);
+	elektraFree (next);
+	return ret;
+}
+
 static KeySet * prepareGlobalKS (KeySet * ks, Key * parentKey)
 {
 	ksRewind (ks);
@@ -654,7 +1230,20 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 
 	// elektraGlobalGet (handle, ks, parentKey, POSTGETSTORAGE, INIT);
 
-	for (size_t i = 0; i < split->size - bypassedSplits; i++)
+	// up to the storage there are no global hooks between the plugins of the backends
+	size_t sequential = split->size - bypassedSplits;
+	if (run == FIRST && handle->threadPool)
+	{
+		sequential = 0;
+		if (elektraGetDoUpdateParallel (handle, split, parentKey, 1, STORAGE_PLUGIN + 1) == -1)
+		{
+			keySetName (parentKey, keyName (initialParent));
+			elektraGlobalError (handle, ks, parentKey, GETSTORAGE, DEINIT);
+			return -1;
+		}
+	}
+
+	for (size_t i = 0; i < sequential; i++)
 	{
 		Backend * backend = split->handles[i];
 		ksRewind (split->keysets[i]);
@@ -742,31 +1331,6 @@ static int elektraGetDoUpdateWithGlobalHooks (KDB * handle, Split * split, KeySe
 	return 0;
 }
 
-static int copyError (Key * dest, Key * src)
-{
-	keyRewindMeta (src);
-	const Key * metaKey = keyGetMeta (src, "error");
-	if (!metaKey) return 0;
-	keySetMeta (dest, keyName (metaKey), keyString (metaKey));
-	while ((metaKey = keyNextMeta (src)) != NULL)
-	{
-		if (strncmp (keyName (metaKey), "error/", 6)) break;
-		keySetMeta (dest, keyName (metaKey), keyString (metaKey));
-	}
-	return 1;
-}
-static void clearError (Key * key)
-{
-	keySetMeta (key, "error", 0);
-	keySetMeta (key, "error/number", 0);
-	keySetMeta (key, "error/description", 0);
-	keySetMeta (key, "error/reason", 0);
-	keySetMeta (key, "error/module", 0);
-	keySetMeta (key, "error/file", 0);
-	keySetMeta (key, "error/line", 0);
-	keySetMeta (key, "error/configfile", 0);
-	keySetMeta (key, "error/mountpoint", 0);
-}
 
 static int elektraCacheCheckParent (KeySet * global, Key * cacheParent, Key * initialParent)
 {
@@ -818,6 +1382,34 @@ static void elektraRestoreProc (KeySet * ks, KeySet * proc)
 	ksDel (proc);
 }
 
+/**
+ * @internal
+ *
+ * @brief Checks if the cached keys of unchanged backends can be used
+ *
+ * After a cache miss the cache still has the keys of the backends whose
+ * resolver reported a cache hit, as long as the split did not change.
+ *
+ * @retval 0 if the keys of backends with SPLIT_FLAG_CACHE can be taken from the cache
+ * @retval -1 if all backends need to be read
+ */
+static int elektraCacheCheckPartial (KDB * handle, Split * split)
+{
+	if (!handle->global || !ksLookupByName (handle->global, KDB_CACHE_PREFIX "/lastSplitSize", KDB_O_NONE)) return -1;
+
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		if (test_bit (split->syncbits[i], SPLIT_FLAG_CACHE))
+		{
+			if (splitCacheCheckState (split, handle->global) == 0) return 0;
+			ELEKTRA_LOG_DEBUG ("PARTIAL CACHE MISS: split state does not match");
+			elektraCacheCutMeta (handle);
+			return -1;
+		}
+	}
+	return -1;
+}
+
 static void elektraCacheLoad (KDB * handle, KeySet * cache, Key * parentKey, Key * initialParent ELEKTRA_UNUSED, Key * cacheParent)
 {
 	// prune old cache info
@@ -918,12 +1510,20 @@ static int elektraCacheLoadSplit (KDB * handle, Split * split, KeySet * ks, KeyS
 		ks->array = (*cache)->array;
 		ks->size = (*cache)->size;
 		ks->alloc = (*cache)->alloc;
-		ks->flags = (*cache)->flags;
+		ks->flags = ((*cache)->flags & ~KS_FLAG_ARENA_STRUCT) | (ks->flags & KS_FLAG_ARENA_STRUCT);
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 		ks->opmphm = (*cache)->opmphm;
 		ks->opmphmPredictor = (*cache)->opmphmPredictor;
+		if (ks->opmphmDelta) elektraFree (ks->opmphmDelta);
+		ks->opmphmDelta = (*cache)->opmphmDelta;
+		ks->prefixes = (*cache)->prefixes;
+		ks->prefixAlloc = (*cache)->prefixAlloc;
+		ks->lookups = (*cache)->lookups;
 #endif
-		elektraFree (*cache);
+		if (test_bit ((*cache)->flags, KS_FLAG_ARENA_STRUCT))
+			elektraArenaFree (*cache);
+		else
+			elektraFree (*cache);
 		*cache = 0;
 	}
 	else
@@ -948,6 +1548,8 @@ static int elektraCacheLoadSplit (KDB * handle, Split * split, KeySet * ks, KeyS
 }
 
 
+static int elektraGetInternal (KDB * handle, KeySet * ks, Key * parentKey);
+
 /**
  * @brief Retrieve keys in an atomic and universal way.
  *
@@ -1022,6 +1624,25 @@ static int elektraCacheLoadSplit (KDB * handle, Split * split, KeySet * ks, KeyS
  * @ingroup kdb
  */
 int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
+{
+	// Keys created while getting are allocated from the arena of ks, if it has one
+	ElektraArena * previousArena = elektraArenaActivate (ks ? ks->arena : 0);
+	// Equal metadata of these keys is shared, a missing intern table only disables sharing
+	ElektraMetaIntern * metaIntern = handle ? elektraMetaInternNew () : 0;
+	ElektraMetaIntern * previousIntern = elektraMetaInternActivate (metaIntern);
+	int ret = elektraGetInternal (handle, ks, parentKey);
+	elektraMetaInternActivate (previousIntern);
+	elektraMetaInternDel (metaIntern);
+	elektraArenaActivate (previousArena);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Implementation of kdbGet(), see there.
+ */
+static int elektraGetInternal (KDB * handle, KeySet * ks, Key * parentKey)
 {
 	elektraNamespace ns = keyGetNamespace (parentKey);
 	if (ns == KEY_NS_NONE)
@@ -1076,6 +1697,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 		ELEKTRA_SET_INTERNAL_ERROR (parentKey, "Error in splitBuildup");
 		goto error;
 	}
+	elektraOpenBackends (handle, split, parentKey);
 
 	cache = ksNew (0, KS_END);
 	cacheParent = keyDup (mountGetMountpoint (handle, initialParent));
@@ -1086,7 +1708,7 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	}
 
 	// Check if a update is needed at all
-	switch (elektraGetCheckUpdateNeeded (split, parentKey))
+	switch (elektraGetCheckUpdateNeeded (handle, split, parentKey))
 	{
 	case -2: // We have a cache hit
 		if (elektraCacheLoadSplit (handle, split, ks, &cache, &cacheParent, parentKey, initialParent, debugGlobalPositions) != 0)
@@ -1169,8 +1791,11 @@ int kdbGet (KDB * handle, KeySet * ks, Key * parentKey)
 	}
 
 cachemiss:
-	ksDel (cache);
-	cache = 0;
+	if (!cache || elektraCacheCheckPartial (handle, split) != 0)
+	{
+		ksDel (cache);
+		cache = 0;
+	}
 
 	if (elektraGlobalGet (handle, ks, parentKey, PREGETSTORAGE, INIT) == ELEKTRA_PLUGIN_STATUS_ERROR)
 	{
@@ -1193,6 +1818,14 @@ cachemiss:
 		goto error;
 	}
 
+	if (cache)
+	{
+		// unchanged backends get their keys from the cache, only the others are read
+		splitCacheAppoint (split, handle, cache);
+		ksDel (cache);
+		cache = 0;
+	}
+
 	if (handle->globalPlugins[POSTGETSTORAGE][FOREACH] || handle->globalPlugins[POSTGETCLEANUP][FOREACH] ||
 	    handle->globalPlugins[PROCGETSTORAGE][FOREACH] || handle->globalPlugins[PROCGETSTORAGE][INIT] ||
 	    handle->globalPlugins[PROCGETSTORAGE][MAXONCE] || handle->globalPlugins[PROCGETSTORAGE][DEINIT])
@@ -1234,7 +1867,9 @@ cachemiss:
 		   but not for bypassed keys in split->size-1 */
 		clearError (parentKey);
 		// do everything up to position get_storage
-		if (elektraGetDoUpdate (split, parentKey) == -1)
+		int ret = handle->threadPool ? elektraGetDoUpdateParallel (handle, split, parentKey, 1, NR_OF_PLUGINS) :
+					       elektraGetDoUpdate (split, parentKey);
+		if (ret == -1)
 		{
 			goto error;
 		}
@@ -1411,14 +2046,234 @@ static int elektraSetPrepare (Split * split, Key * parentKey, Key ** errorKey, P
 	return any_error;
 }
 
+/**
+ * @internal
+ *
+ * Records that a set plugin of split entry i failed. As in elektraSetPrepare(),
+ * the error key is the current key of the last failing split entry.
+ */
+static void elektraSetTaskFail (ElektraBackendTask * task, size_t i)
+{
+	Split * split = task->split;
+	if (task->failed == split->size || i >= task->errorEntry)
+	{
+		task->errorEntry = i;
+		task->errorKey = ksCurrent (split->keysets[i]);
+	}
+	if (task->failed == split->size) task->failed = i;
+	task->ret = -1;
+}
+
+static void elektraSetTaskRun (void * data)
+{
+	ElektraBackendTask * task = *(ElektraBackendTask **) data;
+	Split * split = task->split;
+	for (size_t i = task->first; i < split->size; i = task->next[i])
+	{
+		Backend * backend = split->handles[i];
+		if (task->skipped[i]) continue;
+		for (size_t p = task->start; p < task->end; ++p)
+		{
+			ksRewind (split->keysets[i]);
+			if (backend->setplugins[p] && backend->setplugins[p]->kdbSet)
+			{
+				keySetString (task->parentKey, keyString (split->parents[i]));
+				keySetName (task->parentKey, keyName (split->parents[i]));
+				if (backend->setplugins[p]->kdbSet (backend->setplugins[p], split->keysets[i], task->parentKey) == -1)
+				{
+					// keep going like elektraSetPrepare()
+					elektraSetTaskFail (task, i);
+				}
+			}
+		}
+	}
+}
+
+static void elektraSetSetGlobal (Backend * backend, KeySet * global)
+{
+	for (size_t p = 1; p < COMMIT_PLUGIN; ++p)
+	{
+		if (backend->setplugins[p]) backend->setplugins[p]->global = global;
+	}
+}
+
+static int elektraSetIsThreadSafe (Backend * backend)
+{
+	if (backend->setThreadSafe == 0)
+	{
+		backend->setThreadSafe = 1;
+		for (size_t p = 1; p < COMMIT_PLUGIN; ++p)
+		{
+			if (backend->setplugins[p] && !elektraPluginIsThreadSafe (backend->setplugins[p])) backend->setThreadSafe = -1;
+		}
+	}
+	return backend->setThreadSafe == 1;
+}
+
+/**
+ * @internal
+ * @brief Does all set steps but not commit, writing independent backends in parallel
+ *
+ * The resolvers run one after another in the calling thread, as they lock the
+ * configuration files until the commit. Afterwards the other plugins up to the commit,
+ * i.e. the storage plugins writing the temporary files, run on the thread pool of the
+ * handle for backends whose plugins are all threadsafe (see elektraPluginIsThreadSafe()).
+ * Split entries of the same backend are always written by the same thread.
+ *
+ * Every backend gets its own parent key and a copy of the global keyset (see
+ * elektraGlobalDup()). Afterwards the warnings of all backends, the keys of the
+ * global keysets in the order of the split and the error of the first failing
+ * backend are merged back, later errors become warnings and @p errorKey points
+ * to the key of the last failing backend as in elektraSetPrepare(). Keys plugins
+ * remove from their copy of the global keyset are not removed from the global keyset.
+ *
+ * @param split all information for iteration
+ * @param parentKey to add warnings (also passed to plugins for the same reason)
+ * @param [out] errorKey may point to which key caused the error or 0 otherwise
+ *
+ * @retval -1 on error
+ * @retval 0 on success
+ */
+static int elektraSetPrepareParallel (KDB * handle, Split * split, Key * parentKey, Key ** errorKey)
+{
+	Plugin * storageHook = handle->globalPlugins[PRESETSTORAGE][FOREACH];
+	ElektraBackendTask * tasks = elektraCalloc (split->size * sizeof (ElektraBackendTask));
+	ElektraBackendTask ** safe = elektraCalloc (split->size * sizeof (ElektraBackendTask *));
+	ElektraBackendTask ** unsafe = elektraCalloc (split->size * sizeof (ElektraBackendTask *));
+	size_t * next = elektraMalloc (split->size * sizeof (size_t));
+	ElektraBackendTask ** taskOf = elektraMalloc (split->size * sizeof (ElektraBackendTask *));
+	char * skipped = elektraCalloc (split->size);
+	if (!tasks || !safe || !unsafe || !next || !taskOf || !skipped)
+	{
+		elektraFree (tasks);
+		elektraFree (safe);
+		elektraFree (unsafe);
+		elektraFree (next);
+		elektraFree (taskOf);
+		elektraFree (skipped);
+		ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+		return -1;
+	}
+
+	// one task per backend, split entries of the same backend are chained
+	size_t taskCount = 0;
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		next[i] = split->size;
+		taskOf[i] = elektraBackendTaskAdd (tasks, &taskCount, next, split, i);
+		if (taskOf[i]->first != i) continue;
+		taskOf[i]->start = 1;
+		taskOf[i]->end = COMMIT_PLUGIN;
+		taskOf[i]->parentKey = keyNew (keyName (parentKey), KEY_END);
+	}
+
+	// the resolvers, see elektraSetPrepare()
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		ElektraBackendTask * task = taskOf[i];
+		Backend * backend = split->handles[i];
+		int ret = 0;
+
+		ksRewind (split->keysets[i]);
+		if (backend->setplugins[0] && backend->setplugins[0]->kdbSet)
+		{
+			keySetString (task->parentKey, "");
+			keySetName (task->parentKey, keyName (split->parents[i]));
+			ret = backend->setplugins[0]->kdbSet (backend->setplugins[0], split->keysets[i], task->parentKey);
+			if (ret == 0)
+			{
+				// resolver says that sync is not needed, so we skip the other pre-commit plugins
+				skipped[i] = 1;
+				continue;
+			}
+			keySetString (split->parents[i], keyString (task->parentKey));
+		}
+
+		if (storageHook)
+		{
+			ksRewind (split->keysets[i]);
+			storageHook->kdbSet (storageHook, split->keysets[i], task->parentKey);
+		}
+
+		if (ret == -1) elektraSetTaskFail (task, i);
+	}
+
+	size_t safeCount = 0;
+	size_t unsafeCount = 0;
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		// without a copy the task uses the global keyset in the calling thread
+		tasks[t].global = elektraGlobalDup (handle->global);
+		if (tasks[t].global) elektraSetSetGlobal (split->handles[tasks[t].first], tasks[t].global);
+		tasks[t].skipped = skipped;
+		if (tasks[t].global && elektraSetIsThreadSafe (split->handles[tasks[t].first]))
+			safe[safeCount++] = &tasks[t];
+		else
+			unsafe[unsafeCount++] = &tasks[t];
+	}
+
+	elektraThreadPoolRun (handle->threadPool, elektraSetTaskRun, safe, safeCount, sizeof (ElektraBackendTask *));
+	elektraThreadPoolRun (0, elektraSetTaskRun, unsafe, unsafeCount, sizeof (ElektraBackendTask *));
+
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		if (!tasks[t].global) continue;
+		elektraSetSetGlobal (split->handles[tasks[t].first], handle->global);
+		ksAppend (handle->global, tasks[t].global);
+		ksDel (tasks[t].global);
+	}
+
+	// the first error in the order of the split wins, as if the backends were written one after another
+	size_t failed = split->size;
+	ElektraBackendTask * last = 0;
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		if (tasks[t].ret != -1) continue;
+		if (tasks[t].failed < failed) failed = tasks[t].failed;
+		if (!last || tasks[t].errorEntry > last->errorEntry) last = &tasks[t];
+	}
+	if (last) *errorKey = last->errorKey;
+
+	int ret = 0;
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		copyWarnings (parentKey, tasks[t].parentKey);
+		if (tasks[t].ret != -1) continue;
+		ret = -1;
+		if (tasks[t].failed == failed)
+		{
+			clearError (parentKey);
+			copyError (parentKey, tasks[t].parentKey);
+		}
+		else
+		{
+			addWarningFrom (parentKey, tasks[t].parentKey, "error");
+		}
+	}
+
+	for (size_t t = 0; t < taskCount; ++t)
+	{
+		keyDel (tasks[t].parentKey);
+	}
+	elektraFree (tasks);
+	elektraFree (safe);
+	elektraFree (unsafe);
+	elektraFree (next);
+	elektraFree (taskOf);
+	elektraFree (skipped);
+	return ret;
+}
+
 /**
  * @internal
  * @brief Does the commit
  *
  * @param split all information for iteration
  * @param parentKey to add warnings (also passed to plugins for the same reason)
+ * @param syncKey the key KDB_SYNC_PREFIX in the global keyset or 0, see elektraSetSyncDirs()
+ * @param [out] locked set for the split entries whose commit plugin kept its locks, only if @p syncKey is given
  */
-static void elektraSetCommit (Split * split, Key * parentKey)
+static void elektraSetCommit (Split * split, Key * parentKey, Key * syncKey, char * locked)
 {
 	for (size_t p = COMMIT_PLUGIN; p < NR_OF_PLUGINS; ++p)
 	{
@@ -1444,6 +2299,12 @@ static void elektraSetCommit (Split * split, Key * parentKey)
 					ret = backend->setplugins[p]->kdbCommit (backend->setplugins[p], split->keysets[i], parentKey);
 					// name of non-temp file
 					keySetString (split->parents[i], keyString (parentKey));
+					if (syncKey && *keyString (syncKey))
+					{
+						// the resolver keeps its locks until its directory is synced
+						locked[i] = 1;
+						keySetString (syncKey, "");
+					}
 				}
 				else
 				{
@@ -1460,6 +2321,114 @@ static void elektraSetCommit (Split * split, Key * parentKey)
 	}
 }
 
+#ifdef HAVE_UNISTD_H
+typedef struct
+{
+	const char * directory;
+	int error; /*!< errno if the directory could not be synced, 0 otherwise */
+} ElektraSyncTask;
+
+static void elektraSyncTaskRun (void * data)
+{
+	ElektraSyncTask * task = data;
+	int fd = open (task->directory, O_RDONLY);
+	if (fd == -1 || fsync (fd) == -1) task->error = errno;
+	if (fd != -1) close (fd);
+}
+#endif
+
+/**
+ * @internal
+ * @brief Syncs the directories the resolvers added below KDB_SYNC_PREFIX
+ *
+ * Every directory is only synced once, also if several configuration files
+ * in it were committed. The directories are synced in parallel on the thread
+ * pool of the handle.
+ *
+ * The resolvers still hold their locks (see elektraSetUnlock()), so no other
+ * writer sees a renamed file before its directory is synced.
+ *
+ * @param handle the handle with the global keyset
+ * @param parentKey to set the error
+ *
+ * @retval -1 if a directory could not be synced
+ * @retval 0 on success
+ */
+static int elektraSetSyncDirs (KDB * handle, Key * parentKey)
+{
+	Key * syncKey = keyNew (KDB_SYNC_PREFIX, KEY_END);
+	KeySet * directories = ksCut (handle->global, syncKey);
+	keyDel (syncKey);
+	int ret = 0;
+#ifdef HAVE_UNISTD_H
+	ElektraSyncTask * tasks = directories->size ? elektraCalloc (directories->size * sizeof (ElektraSyncTask)) : 0;
+	if (!tasks)
+	{
+		if (directories->size)
+		{
+			clearError (parentKey);
+			ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+			ret = -1;
+		}
+		ksDel (directories);
+		return ret;
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < directories->size; ++i)
+	{
+		// the key below which the directories are added has no value
+		const char * directory = keyString (directories->array[i]);
+		if (*directory) tasks[count++].directory = directory;
+	}
+
+	elektraThreadPoolRun (handle->threadPool, elektraSyncTaskRun, tasks, count, sizeof (ElektraSyncTask));
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!tasks[i].error) continue;
+		// the first failing directory sets the error, the others add warnings
+		if (ret == 0) clearError (parentKey);
+		ELEKTRA_SET_RESOURCE_ERRORF (parentKey, "Could not sync directory '%s'. Reason: %s", tasks[i].directory,
+					     strerror (tasks[i].error));
+		ret = -1;
+	}
+	elektraFree (tasks);
+#else
+	(void) parentKey;
+#endif
+	ksDel (directories);
+	return ret;
+}
+
+/**
+ * @internal
+ * @brief Commits the split entries a second time whose resolvers kept their locks
+ *
+ * A resolver that added its directory below KDB_SYNC_PREFIX keeps its locks until
+ * elektraSetSyncDirs() synced the directory. The second call of its commit releases them.
+ *
+ * @param split all information for iteration
+ * @param parentKey to add warnings (also passed to plugins for the same reason)
+ * @param locked the split entries whose resolvers kept their locks
+ */
+static void elektraSetUnlock (Split * split, Key * parentKey, const char * locked)
+{
+	for (size_t i = 0; i < split->size; i++)
+	{
+		if (!locked[i]) continue;
+
+		Backend * backend = split->handles[i];
+		keySetName (parentKey, keyName (split->parents[i]));
+		ksRewind (split->keysets[i]);
+		if (backend->setplugins[COMMIT_PLUGIN]->kdbCommit (backend->setplugins[COMMIT_PLUGIN], split->keysets[i], parentKey) == -1)
+		{
+			ELEKTRA_ADD_INTERNAL_WARNINGF (parentKey, "Error during commit. This means backend is broken: %s",
+						       keyName (backend->mountpoint));
+		}
+	}
+}
+
 /**
  * @internal
  * @brief Does the rollback
@@ -1556,7 +2525,9 @@ static void elektraSetRollback (Split * split, Key * parentKey)
  *           - empty/invalid (error C01320)
  * @retval 1 on success
  * @retval 0 if nothing had to be done, no changes in KDB
- * @retval -1 on failure, no changes in KDB
+ * @retval -1 on failure, no changes in KDB, unless the directories of the committed
+ *         configuration files could not be synced (error C01100); then the keys still
+ *         need to be synced
  * @see keyNeedSync()
  * @see ksCurrent() contains the error key
  * @see kdbOpen() and kdbGet() that must be called first
@@ -1618,6 +2589,7 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 		ELEKTRA_SET_INTERNAL_ERROR (parentKey, "Error in splitBuildup");
 		goto error;
 	}
+	elektraOpenBackends (handle, split, parentKey);
 	ELEKTRA_LOG ("after splitBuildup");
 
 	// 1.) Search for syncbits
@@ -1666,7 +2638,11 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	splitPrepare (split);
 
 	clearError (parentKey); // clear previous error to set new one
-	if (elektraSetPrepare (split, parentKey, &errorKey, handle->globalPlugins) == -1)
+	// the storage plugins can write in parallel, unless global hooks run between them
+	int prepared = handle->threadPool && !handle->globalPlugins[PRESETCLEANUP][FOREACH] ?
+			       elektraSetPrepareParallel (handle, split, parentKey, &errorKey) :
+			       elektraSetPrepare (split, parentKey, &errorKey, handle->globalPlugins);
+	if (prepared == -1)
 	{
 		goto error;
 	}
@@ -1681,7 +2657,14 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	elektraGlobalSet (handle, ks, parentKey, PRECOMMIT, MAXONCE);
 	elektraGlobalSet (handle, ks, parentKey, PRECOMMIT, DEINIT);
 
-	elektraSetCommit (split, parentKey);
+	// with thread pool the resolvers leave syncing the directories to elektraSetSyncDirs()
+	char * locked = handle->threadPool ? elektraCalloc (split->size) : 0;
+	Key * syncKey = locked ? keyNew (KDB_SYNC_PREFIX, KEY_END) : 0;
+	if (syncKey) ksAppendKey (handle->global, syncKey);
+	elektraSetCommit (split, parentKey, syncKey, locked);
+	int synced = locked ? elektraSetSyncDirs (handle, parentKey) : 0;
+	if (locked) elektraSetUnlock (split, parentKey, locked);
+	elektraFree (locked);
 
 	elektraGlobalSet (handle, ks, parentKey, COMMIT, INIT);
 	elektraGlobalSet (handle, ks, parentKey, COMMIT, MAXONCE);
@@ -1695,7 +2678,8 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 	elektraGlobalSet (handle, ks, parentKey, POSTCOMMIT, MAXONCE);
 	elektraGlobalSet (handle, ks, parentKey, POSTCOMMIT, DEINIT);
 
-	for (size_t i = 0; i < ks->size; ++i)
+	// the files are renamed, but may not be durable if their directories could not be synced
+	for (size_t i = 0; synced == 0 && i < ks->size; ++i)
 	{
 		// remove all flags from all keys
 		clear_bit (ks->array[i]->flags, (keyflag_t) KEY_FLAG_SYNC);
@@ -1707,8 +2691,8 @@ int kdbSet (KDB * handle, KeySet * ks, Key * parentKey)
 
 	keyDel (oldError);
 	errno = errnosave;
-	ELEKTRA_LOG ("before RETURN 1");
-	return 1;
+	ELEKTRA_LOG ("before RETURN %d", synced == 0 ? 1 : -1);
+	return synced == 0 ? 1 : -1;
 
 error:
 	keySetName (parentKey, keyName (initialParent));
@@ -1890,6 +2874,7 @@ static int ensurePluginUnmounted (KDB * handle, const char * mountpoint, const c
 {
 	Key * mountpointKey = keyNew (mountpoint, KEY_END);
 	Backend * backend = mountGetBackend (handle, mountpointKey);
+	backendOpenPlugins (backend, handle->modules, handle->global, errorKey);
 
 	int ret = 1;
 	for (int i = 0; i < NR_OF_PLUGINS; ++i)
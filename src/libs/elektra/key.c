@@ -72,6 +72,27 @@
  * ordering or different Models of your configuration.
  */
 
+/**
+ * @internal
+ *
+ * @brief Allocates an initialized Key struct.
+ *
+ * The struct is taken from the active arena, if there is one.
+ *
+ * @return the new Key
+ * @retval NULL on memory error
+ */
+static Key * elektraKeyAlloc (void)
+{
+	Key * key = elektraArenaCalloc (sizeof (Key));
+	if (key)
+	{
+		key->flags = KEY_FLAG_ARENA_STRUCT;
+		return key;
+	}
+	return elektraCalloc (sizeof (Key));
+}
+
 /**
  * A practical way to fully create a Key object in one step.
  *
@@ -170,7 +191,7 @@ Key * keyNew (const char * name, ...)
 
 	if (!name)
 	{
-		k = elektraCalloc (sizeof (Key));
+		k = elektraKeyAlloc ();
 	}
 	else
 	{
@@ -224,9 +245,9 @@ static int elektraSetMode (Key * key, mode_t mode)
  */
 Key * keyVNew (const char * name, va_list va)
 {
-	Key * key = elektraCalloc (sizeof (Key));
+	Key * key = elektraKeyAlloc ();
+	if (!key) return 0;
 
-	keyInit (key);
 	if (name)
 	{
 		keyswitch_t action = 0;
@@ -389,12 +410,14 @@ Key * keyDup (const Key * source)
 	dest = keyNew (0, KEY_END);
 	if (!dest) return 0;
 
+	keyflag_t arenaStruct = dest->flags & KEY_FLAG_ARENA_STRUCT;
+
 	/* Copy the struct data */
 	*dest = *source;
 
 	/* get rid of properties bound to old key */
 	dest->ksReference = 0;
-	dest->flags = KEY_FLAG_SYNC;
+	dest->flags = KEY_FLAG_SYNC | arenaStruct;
 
 	/* prepare to set dynamic properties */
 	dest->key = dest->data.v = dest->meta = 0;
@@ -520,8 +543,8 @@ int keyCopy (Key * dest, const Key * source)
 	dest->dataSize = source->dataSize;
 
 	// free old resources of destination
-	if (!test_bit (dest->flags, KEY_FLAG_MMAP_KEY)) elektraFree (destKey);
-	if (!test_bit (dest->flags, KEY_FLAG_MMAP_DATA)) elektraFree (destData);
+	elektraKeyFreeName (dest, destKey);
+	elektraKeyFreeData (dest, destData);
 	ksDel (destMeta);
 
 	return 1;
@@ -577,6 +600,7 @@ int keyDel (Key * key)
 	}
 
 	int keyInMmap = test_bit (key->flags, KEY_FLAG_MMAP_STRUCT);
+	int keyInArena = test_bit (key->flags, KEY_FLAG_ARENA_STRUCT);
 
 	rc = keyClear (key);
 
@@ -584,7 +608,10 @@ int keyDel (Key * key)
 
 	if (!keyInMmap)
 	{
-		elektraFree (key);
+		if (keyInArena)
+			elektraArenaFree (key);
+		else
+			elektraFree (key);
 	}
 
 	return rc;
@@ -631,15 +658,17 @@ int keyClear (Key * key)
 	ref = key->ksReference;
 
 	int keyStructInMmap = test_bit (key->flags, KEY_FLAG_MMAP_STRUCT);
+	int keyStructInArena = test_bit (key->flags, KEY_FLAG_ARENA_STRUCT);
 
-	if (key->key && !test_bit (key->flags, KEY_FLAG_MMAP_KEY)) elektraFree (key->key);
-	if (key->data.v && !test_bit (key->flags, KEY_FLAG_MMAP_DATA)) elektraFree (key->data.v);
+	if (key->key) elektraKeyFreeName (key, key->key);
+	if (key->data.v) elektraKeyFreeData (key, key->data.v);
 
 	ksDel (key->meta);
 
 	keyInit (key);
 
 	if (keyStructInMmap) key->flags |= KEY_FLAG_MMAP_STRUCT;
+	if (keyStructInArena) key->flags |= KEY_FLAG_ARENA_STRUCT;
 
 	/* Set reference properties */
 	key->ksReference = ref;
@@ -196,3 +196,49 @@ void keyInit (Key * key)
 {
 	memset (key, 0, sizeof (Key));
 }
+
+/**
+ * @internal
+ *
+ * @brief Frees a name of @p key.
+ *
+ * Nothing is freed if the name lies in a mmap region, a name in an
+ * arena is released with elektraArenaFree(). KEY_FLAG_MMAP_KEY and
+ * KEY_FLAG_ARENA_KEY are cleared, key->key is not changed.
+ *
+ * @param key the key the name belongs to
+ * @param name the name to free, key->key or a previous name of @p key
+ */
+void elektraKeyFreeName (Key * key, char * name)
+{
+	if (!test_bit (key->flags, KEY_FLAG_MMAP_KEY))
+	{
+		if (test_bit (key->flags, KEY_FLAG_ARENA_KEY))
+			elektraArenaFree (name);
+		else
+			elektraFree (name);
+	}
+	clear_bit (key->flags, (keyflag_t) (KEY_FLAG_MMAP_KEY | KEY_FLAG_ARENA_KEY));
+}
+
+/**
+ * @internal
+ *
+ * @brief Frees a value of @p key.
+ *
+ * Like elektraKeyFreeName(), but for values.
+ *
+ * @param key the key the value belongs to
+ * @param data the value to free, key->data.v or a previous value of @p key
+ */
+void elektraKeyFreeData (Key * key, void * data)
+{
+	if (!test_bit (key->flags, KEY_FLAG_MMAP_DATA))
+	{
+		if (test_bit (key->flags, KEY_FLAG_ARENA_DATA))
+			elektraArenaFree (data);
+		else
+			elektraFree (data);
+	}
+	clear_bit (key->flags, (keyflag_t) (KEY_FLAG_MMAP_DATA | KEY_FLAG_ARENA_DATA));
+}
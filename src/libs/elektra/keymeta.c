@@ -444,6 +444,9 @@ const Key * keyGetMeta (const Key * key, const char * metaName)
  *
  * It will remove a meta information if newMetaString is 0.
  *
+ * Within kdbGet() equal metadata is interned, so that all keys
+ * with the same metaName and newMetaString share one meta key.
+ *
  * @param key the key object to work with
  * @param metaName the name of the meta information where you
  *                 want to change the value
@@ -459,6 +462,7 @@ const Key * keyGetMeta (const Key * key, const char * metaName)
 ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString)
 {
 	Key * toSet;
+	Key * interned;
 	char * metaStringDup;
 	ssize_t metaNameSize;
 	ssize_t metaStringSize = 0;
@@ -491,7 +495,22 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 		}
 	}
 
-	if (newMetaString)
+	if (!newMetaString)
+	{
+		/*The request is to remove the meta string.
+		  So simply drop it.*/
+		keyDel (toSet);
+		return 0;
+	}
+
+	/*Share the meta key if an equal one was interned*/
+	interned = elektraMetaInternLookup (toSet, newMetaString, metaStringSize);
+	if (interned)
+	{
+		keyDel (toSet);
+		toSet = interned;
+	}
+	else
 	{
 		/*Add the meta information to the key*/
 		metaStringDup = elektraStrNDup (newMetaString, metaStringSize);
@@ -507,13 +526,12 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 		clear_bit (toSet->flags, (keyflag_t) KEY_FLAG_MMAP_DATA);
 		toSet->data.c = metaStringDup;
 		toSet->dataSize = metaStringSize;
-	}
-	else
-	{
-		/*The request is to remove the meta string.
-		  So simply drop it.*/
-		keyDel (toSet);
-		return 0;
+
+		set_bit (toSet->flags, KEY_FLAG_RO_NAME);
+		set_bit (toSet->flags, KEY_FLAG_RO_VALUE);
+		set_bit (toSet->flags, KEY_FLAG_RO_META);
+
+		elektraMetaInternInsert (toSet);
 	}
 
 	if (!key->meta)
@@ -527,10 +545,6 @@ ssize_t keySetMeta (Key * key, const char * metaName, const char * newMetaString
 		}
 	}
 
-	set_bit (toSet->flags, KEY_FLAG_RO_NAME);
-	set_bit (toSet->flags, KEY_FLAG_RO_VALUE);
-	set_bit (toSet->flags, KEY_FLAG_RO_META);
-
 	ksAppendKey (key->meta, toSet);
 	key->flags |= KEY_FLAG_SYNC;
 	return metaStringSize;
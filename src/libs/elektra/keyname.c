@@ -418,10 +418,35 @@ static void elektraHandleUserName (Key * key, const char * newName)
 	elektraFree (owner);
 }
 
+/**
+ * @internal
+ *
+ * @brief Resizes the allocation of the name of @p key.
+ *
+ * A name in a mmap region or an arena is copied to the heap instead.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error, the name is unchanged then
+ */
+static int elektraReallocKeyName (Key * key, size_t newSize)
+{
+	if (!test_bit (key->flags, KEY_FLAG_MMAP_KEY | KEY_FLAG_ARENA_KEY))
+	{
+		return elektraRealloc ((void **) &key->key, newSize);
+	}
+
+	char * name = elektraMalloc (newSize);
+	if (!name) return -1;
+	size_t size = elektraStrLen (key->key); // only the escaped name is used before finalizing
+	memcpy (name, key->key, size < newSize ? size : newSize);
+	elektraKeyFreeName (key, key->key);
+	key->key = name;
+	return 0;
+}
+
 static void elektraRemoveKeyName (Key * key)
 {
-	if (key->key && !test_bit (key->flags, KEY_FLAG_MMAP_KEY)) elektraFree (key->key);
-	clear_bit (key->flags, (keyflag_t) KEY_FLAG_MMAP_KEY);
+	elektraKeyFreeName (key, key->key);
 	key->key = 0;
 	key->keySize = 0;
 	key->keyUSize = 0;
@@ -857,16 +882,7 @@ ssize_t keyAddBaseName (Key * key, const char * baseName)
 	}
 
 	const size_t newSize = key->keySize * 2;
-	if (test_bit (key->flags, KEY_FLAG_MMAP_KEY))
-	{
-		// key was in mmap region, clear flag and trigger malloc instead of realloc
-		key->key = elektraMalloc (newSize);
-		clear_bit (key->flags, (keyflag_t) KEY_FLAG_MMAP_KEY);
-	}
-	else
-	{
-		if (-1 == elektraRealloc ((void **) &key->key, newSize)) return -1;
-	}
+	if (-1 == elektraReallocKeyName (key, newSize)) return -1;
 
 	if (!key->key)
 	{
@@ -976,16 +992,7 @@ ssize_t keyAddName (Key * key, const char * newName)
 	const size_t origSize = key->keySize;
 	const size_t newSize = (origSize + nameSize) * 2;
 
-	if (test_bit (key->flags, KEY_FLAG_MMAP_KEY))
-	{
-		// key was in mmap region, clear flag and trigger malloc instead of realloc
-		key->key = elektraMalloc (newSize);
-		clear_bit (key->flags, (keyflag_t) KEY_FLAG_MMAP_KEY);
-	}
-	else
-	{
-		if (-1 == elektraRealloc ((void **) &key->key, newSize)) return -1;
-	}
+	if (-1 == elektraReallocKeyName (key, newSize)) return -1;
 
 	if (!key->key) return -1;
 
@@ -1124,16 +1131,7 @@ ssize_t keySetBaseName (Key * key, const char * baseName)
 	size_t sizeEscaped = elektraStrLen (escaped);
 
 	const size_t newSize = (key->keySize + sizeEscaped) * 2;
-	if (test_bit (key->flags, KEY_FLAG_MMAP_KEY))
-	{
-		// key was in mmap region, clear flag and trigger malloc instead of realloc
-		key->key = elektraMalloc (newSize);
-		clear_bit (key->flags, (keyflag_t) KEY_FLAG_MMAP_KEY);
-	}
-	else
-	{
-		if (-1 == elektraRealloc ((void **) &key->key, newSize)) return -1;
-	}
+	if (-1 == elektraReallocKeyName (key, newSize)) return -1;
 
 	if (!key->key)
 	{
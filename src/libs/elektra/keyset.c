@@ -52,6 +52,211 @@ static void elektraOpmphmInvalidate (KeySet * ks ELEKTRA_UNUSED)
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 	set_bit (ks->flags, KS_FLAG_NAME_CHANGE);
 	if (ks && ks->opmphm) opmphmClear (ks->opmphm);
+	if (ks && ks->opmphmDelta) opmphmDeltaClear (ks->opmphmDelta, 0);
+#endif
+}
+
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/**
+ * @internal
+ *
+ * @brief Prepares the OPMPHM delta for logging an alteration.
+ *
+ * Logging is only needed if there is an OPMPHM to keep or a
+ * sequence of lookups the predictor counts.
+ *
+ * @param ks the KeySet
+ * @param size the size of the KeySet before the alteration
+ *
+ * @retval 1 if the alteration can be logged
+ * @retval 0 if the KeySet must be invalidated
+ */
+static int elektraOpmphmDeltaPrepare (KeySet * ks, size_t size)
+{
+	if (!ks->opmphmPredictor && !opmphmIsBuild (ks->opmphm)) return 0;
+	if (!ks->opmphmDelta)
+	{
+		// e.g. OPMPHM from mmapstorage, built with the current Keys
+		ks->opmphmDelta = opmphmDeltaNew ();
+		if (!ks->opmphmDelta) return 0;
+		opmphmDeltaClear (ks->opmphmDelta, opmphmIsBuild (ks->opmphm) ? size : 0);
+	}
+	return 1;
+}
+#endif
+
+/**
+ * @internal
+ *
+ * @brief KeySets OPMPHM update for an inserted Key.
+ *
+ * Must be invoked instead of elektraOpmphmInvalidate() when a Key was inserted
+ * and the Keys behind it moved one position back.
+ * Invalidates only if the OPMPHM delta is full.
+ *
+ * @param ks the KeySet
+ * @param pos the position of the inserted Key
+ */
+static void elektraOpmphmInsert (KeySet * ks ELEKTRA_UNUSED, size_t pos ELEKTRA_UNUSED)
+{
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	size_t limit = opmphmPredictorDeltaLimit (ks->size);
+	if (!elektraOpmphmDeltaPrepare (ks, ks->size - 1) || opmphmDeltaInsert (ks->opmphmDelta, pos, keyName (ks->array[pos]), limit))
+	{
+		elektraOpmphmInvalidate (ks);
+	}
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief KeySets OPMPHM update for a removed Key.
+ *
+ * Must be invoked instead of elektraOpmphmInvalidate() when a Key is removed
+ * and the Keys behind it move one position forward.
+ * Invalidates only if the OPMPHM delta is full.
+ *
+ * @param ks the KeySet
+ * @param pos the position of the removed Key
+ */
+static void elektraOpmphmRemove (KeySet * ks ELEKTRA_UNUSED, size_t pos ELEKTRA_UNUSED)
+{
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	size_t limit = opmphmPredictorDeltaLimit (ks->size);
+	if (!elektraOpmphmDeltaPrepare (ks, ks->size) || opmphmDeltaRemove (ks->opmphmDelta, pos, limit))
+	{
+		elektraOpmphmInvalidate (ks);
+	}
+#endif
+}
+
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/**
+ * @internal
+ *
+ * @brief Loads 8 bytes as big-endian integer.
+ *
+ * @param bytes the bytes to load
+ *
+ * @return the integer, which compares like memcmp() on the bytes
+ */
+static inline uint64_t elektraKsPrefixLoad (const unsigned char * bytes)
+{
+	uint64_t ret = 0;
+	for (size_t i = 0; i < sizeof (uint64_t); ++i)
+	{
+		ret = (ret << 8) | bytes[i];
+	}
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Fills the name prefix of a Key.
+ *
+ * @param prefix the prefix to fill
+ * @param key the Key, must have a name
+ */
+static void elektraKsPrefixSet (KeyNamePrefix * prefix, const Key * key)
+{
+	unsigned char buffer[2 * sizeof (uint64_t)] = { 0 };
+	size_t size = key->keyUSize < sizeof (buffer) ? key->keyUSize : sizeof (buffer);
+	memcpy (buffer, key->key + key->keySize, size);
+	prefix->high = elektraKsPrefixLoad (buffer);
+	prefix->low = elektraKsPrefixLoad (buffer + sizeof (uint64_t));
+}
+
+/**
+ * @internal
+ *
+ * @brief Compares two name prefixes.
+ *
+ * @retval 0 if the prefixes are equal, the full names need to be compared then
+ * @return otherwise the same sign as the comparison of the full names
+ */
+static inline int elektraKsPrefixCmp (const KeyNamePrefix * p1, const KeyNamePrefix * p2)
+{
+	if (p1->high != p2->high) return p1->high < p2->high ? -1 : 1;
+	if (p1->low != p2->low) return p1->low < p2->low ? -1 : 1;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Builds the name prefixes of all Keys in the KeySet.
+ *
+ * @param ks the KeySet, must not have prefixes
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraKsPrefixBuild (KeySet * ks)
+{
+	ELEKTRA_ASSERT (!ks->prefixes, "prefixes already build");
+	KeyNamePrefix * prefixes = elektraMalloc (sizeof (KeyNamePrefix) * ks->alloc);
+	if (!prefixes)
+	{
+		return -1;
+	}
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		elektraKsPrefixSet (&prefixes[i], ks->array[i]);
+	}
+	ks->prefixes = prefixes;
+	ks->prefixAlloc = ks->alloc;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Inserts the prefix of a freshly inserted Key.
+ *
+ * Must be called after the Key was inserted in the array.
+ * Drops the prefixes on memory errors.
+ *
+ * @param ks the KeySet with prefixes
+ * @param pos the position where the Key was inserted
+ */
+static void elektraKsPrefixInsert (KeySet * ks, size_t pos)
+{
+	if (ks->size > ks->prefixAlloc)
+	{
+		if (elektraRealloc ((void **) &ks->prefixes, sizeof (KeyNamePrefix) * ks->alloc) == -1)
+		{
+			elektraFree (ks->prefixes);
+			ks->prefixes = 0;
+			ks->prefixAlloc = 0;
+			return;
+		}
+		ks->prefixAlloc = ks->alloc;
+	}
+	memmove (ks->prefixes + pos + 1, ks->prefixes + pos, (ks->size - pos - 1) * sizeof (KeyNamePrefix));
+	elektraKsPrefixSet (&ks->prefixes[pos], ks->array[pos]);
+}
+#endif
+
+/**
+ * @internal
+ *
+ * @brief KeySets name prefix cleaner.
+ *
+ * Must be invoked by every function that removes Keys from a KeySet
+ * or changes Key names within a KeySet.
+ * ksAppendKey() keeps the prefixes up to date instead.
+ *
+ * @param ks the KeySet
+ */
+static void elektraKsPrefixInvalidate (KeySet * ks ELEKTRA_UNUSED)
+{
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	if (ks->prefixes) elektraFree (ks->prefixes);
+	ks->prefixes = 0;
+	ks->prefixAlloc = 0;
+	ks->lookups = 0;
 #endif
 }
 
@@ -98,6 +303,28 @@ static void elektraOpmphmCopy (KeySet * dest ELEKTRA_UNUSED, const KeySet * sour
 	{
 		opmphmCopy (dest->opmphm, source->opmphm);
 	}
+	// OPMPHM delta, the OPMPHM is useless without it
+	if (!dest->opmphmDelta)
+	{
+		dest->opmphmDelta = opmphmDeltaNew ();
+	}
+	if (dest->opmphmDelta && source->opmphmDelta)
+	{
+		memcpy (dest->opmphmDelta, source->opmphmDelta, sizeof (OpmphmDelta));
+	}
+	else if (dest->opmphmDelta)
+	{
+		opmphmDeltaClear (dest->opmphmDelta, source->size);
+	}
+	else if (dest->opmphm)
+	{
+		opmphmClear (dest->opmphm);
+	}
+	// the copy continues the lookup sequence of source
+	if (opmphmIsBuild (dest->opmphm) && !test_bit (source->flags, KS_FLAG_NAME_CHANGE))
+	{
+		clear_bit (dest->flags, (keyflag_t) KS_FLAG_NAME_CHANGE);
+	}
 #endif
 }
 
@@ -245,8 +472,17 @@ KeySet * ksNew (size_t alloc, ...)
 KeySet * ksVNew (size_t alloc, va_list va)
 {
 	KeySet * keyset = 0;
+	int inArena = 0;
 
-	keyset = (KeySet *) elektraMalloc (sizeof (KeySet));
+	keyset = (KeySet *) elektraArenaCalloc (sizeof (KeySet));
+	if (keyset)
+	{
+		inArena = 1;
+	}
+	else
+	{
+		keyset = (KeySet *) elektraMalloc (sizeof (KeySet));
+	}
 	if (!keyset)
 	{
 		/*errno = KDB_ERR_NOMEM;*/
@@ -254,6 +490,7 @@ KeySet * ksVNew (size_t alloc, va_list va)
 	}
 
 	ksInit (keyset);
+	if (inArena) keyset->flags |= KS_FLAG_ARENA_STRUCT;
 
 	if (alloc == 0) return keyset;
 
@@ -276,15 +513,48 @@ KeySet * ksVNew (size_t alloc, va_list va)
 		Key * key = (struct _Key *) va_arg (va, struct _Key *);
 		while (key)
 		{
-			ksAppendKey (keyset, key);
+			elektraKsBulkAppendKey (keyset, key);
 			key = (struct _Key *) va_arg (va, struct _Key *);
 		}
 	}
 
-	ksRewind (keyset); // ksAppendKey changed the internal cursor
+	elektraKsBulkFinish (keyset); // also rewinds the internal cursor
 	return keyset;
 }
 
+/**
+ * @brief Allocate a KeySet with an arena.
+ *
+ * Key and KeySet structs created while kdbGet() fills the KeySet,
+ * including the meta KeySets, are bump-allocated from the arena
+ * instead of the heap. The memory of the arena is freed in large
+ * chunks once the Keys are deleted, e.g. by ksDel().
+ * Keys may outlive the KeySet, they stay valid and can be
+ * modified as usual. But every Key kept keeps the chunk of
+ * 64 KiB it was allocated from, so only use an arena for
+ * KeySets whose Keys are deleted together.
+ *
+ * @param alloc gives a hint for how many Keys may be stored initially
+ *
+ * @return a ready to use KeySet object
+ * @retval 0 on memory error
+ * @see ksNew(), kdbGet()
+ * @ingroup proposal
+ */
+KeySet * elektraKsNewArena (size_t alloc)
+{
+	KeySet * ks = ksNew (alloc, KS_END);
+	if (!ks) return 0;
+
+	ks->arena = elektraArenaNew ();
+	if (!ks->arena)
+	{
+		ksDel (ks);
+		return 0;
+	}
+	return ks;
+}
+
 /**
  * Return a duplicate of a keyset.
  *
@@ -314,8 +584,8 @@ KeySet * ksDup (const KeySet * source)
 	}
 
 	KeySet * keyset = ksNew (size, KS_END);
+	// also copies the OPMPHM
 	ksAppend (keyset, source);
-	elektraOpmphmCopy (keyset, source);
 	return keyset;
 }
 
@@ -413,10 +683,9 @@ int ksCopy (KeySet * dest, const KeySet * source)
 	ksClear (dest);
 	if (!source) return 0;
 
+	// also copies the OPMPHM
 	ksAppend (dest, source);
 	ksSetCursor (dest, ksGetCursor (source));
-
-	elektraOpmphmCopy (dest, source);
 	return 1;
 }
 
@@ -441,6 +710,7 @@ int ksDel (KeySet * ks)
 	if (!ks) return -1;
 
 	rc = ksClose (ks);
+	elektraArenaDel (ks->arena);
 
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 	if (ks->opmphm)
@@ -451,12 +721,19 @@ int ksDel (KeySet * ks)
 	{
 		opmphmPredictorDel (ks->opmphmPredictor);
 	}
+	if (ks->opmphmDelta)
+	{
+		opmphmDeltaDel (ks->opmphmDelta);
+	}
 
 #endif
 
 	if (!test_bit (ks->flags, KS_FLAG_MMAP_STRUCT))
 	{
-		elektraFree (ks);
+		if (test_bit (ks->flags, KS_FLAG_ARENA_STRUCT))
+			elektraArenaFree (ks);
+		else
+			elektraFree (ks);
 	}
 
 	return rc;
@@ -704,6 +981,32 @@ ssize_t ksGetSize (const KeySet * ks)
  *******************************************/
 
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/**
+ * @internal
+ *
+ * @brief Compares a Key with the Key at a position, using the prefixes when available.
+ *
+ * @param ks the KeySet
+ * @param prefix the prefix of key, only used if ks has prefixes
+ * @param key the Key to compare
+ * @param pos the position in the KeySet
+ *
+ * @return the same as keyCompareByNameOwner()
+ */
+static inline int elektraKsSearchCmp (const KeySet * ks, const KeyNamePrefix * prefix, const Key * key, size_t pos)
+{
+	if (ks->prefixes)
+	{
+		int cmpresult = elektraKsPrefixCmp (prefix, &ks->prefixes[pos]);
+		if (cmpresult) return cmpresult;
+	}
+	return keyCompareByNameOwner (&key, &ks->array[pos]);
+}
+#else
+#define elektraKsSearchCmp(ks, prefix, key, pos) keyCompareByNameOwner (&(key), &(ks)->array[pos])
+#endif
+
 /**
  * @internal
  *
@@ -743,7 +1046,15 @@ ssize_t ksSearchInternal (const KeySet * ks, const Key * toAppend)
 		return -1;
 	}
 
-	cmpresult = keyCompareByNameOwner (&toAppend, &ks->array[right]);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	KeyNamePrefix prefix = { 0, 0 };
+	if (ks->prefixes)
+	{
+		elektraKsPrefixSet (&prefix, toAppend);
+	}
+#endif
+
+	cmpresult = elektraKsSearchCmp (ks, &prefix, toAppend, right);
 	if (cmpresult > 0)
 	{
 		return -((ssize_t) ks->size) - 1;
@@ -758,7 +1069,7 @@ ssize_t ksSearchInternal (const KeySet * ks, const Key * toAppend)
 			break;
 		}
 		middle = left + ((right - left) / 2);
-		cmpresult = keyCompareByNameOwner (&toAppend, &ks->array[middle]);
+		cmpresult = elektraKsSearchCmp (ks, &prefix, toAppend, middle);
 		if (cmpresult > 0)
 		{
 			insertpos = left = middle + 1;
@@ -912,13 +1223,268 @@ ssize_t ksAppendKey (KeySet * ks, Key * toAppend)
 			ks->array[insertpos] = toAppend;
 			ksSetCursor (ks, insertpos);
 		}
-		elektraOpmphmInvalidate (ks);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		if (ks->prefixes) elektraKsPrefixInsert (ks, insertpos);
+#endif
+		elektraOpmphmInsert (ks, insertpos);
 	}
 
 	return ks->size;
 }
 
 
+/**
+ * @internal
+ *
+ * @brief Stable merge sort of Keys by name and owner.
+ *
+ * @param array the Keys to sort
+ * @param buffer scratch space for size Keys
+ * @param size the number of Keys
+ */
+static void elektraKsMergeSort (Key ** array, Key ** buffer, size_t size)
+{
+	Key ** from = array;
+	Key ** to = buffer;
+	for (size_t width = 1; width < size; width *= 2)
+	{
+		for (size_t left = 0; left < size; left += 2 * width)
+		{
+			size_t middle = left + width < size ? left + width : size;
+			size_t right = middle + width < size ? middle + width : size;
+			size_t i = left;
+			size_t j = middle;
+			size_t k = left;
+			while (i < middle && j < right)
+			{
+				// take from the left on equality, so that the order of equal Keys is kept
+				to[k++] = keyCompareByNameOwner (&from[j], &from[i]) < 0 ? from[j++] : from[i++];
+			}
+			while (i < middle)
+				to[k++] = from[i++];
+			while (j < right)
+				to[k++] = from[j++];
+		}
+		Key ** swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != array) memcpy (array, from, size * sizeof (Key *));
+}
+
+/**
+ * @internal
+ *
+ * @brief Stable insertion sort of Keys by name and owner, used if no memory is left for elektraKsMergeSort().
+ *
+ * @param array the Keys to sort
+ * @param size the number of Keys
+ */
+static void elektraKsInsertionSort (Key ** array, size_t size)
+{
+	for (size_t i = 1; i < size; ++i)
+	{
+		Key * current = array[i];
+		size_t j = i;
+		while (j > 0 && keyCompareByNameOwner (&current, &array[j - 1]) < 0)
+		{
+			array[j] = array[j - 1];
+			--j;
+		}
+		array[j] = current;
+	}
+}
+
+/**
+ * @brief Append a Key to a KeySet without sorting it in.
+ *
+ * For building large KeySets from unsorted input:
+ * Instead of searching the position of every Key as ksAppendKey()
+ * does, the Keys are only appended to the end of the array and
+ * sorted once by elektraKsBulkFinish().
+ *
+ * The reference counter and the name lock of the Key are handled
+ * exactly as by ksAppendKey().
+ *
+ * @pre Between the first elektraKsBulkAppendKey() and
+ *      elektraKsBulkFinish() no other function may be used on
+ *      @p ks, except ksGetSize() and ksDel().
+ *
+ * @param ks KeySet that will receive the key
+ * @param toAppend Key that will be appended to ks or deleted
+ *
+ * @return the size of the KeySet after appending, including possible duplicates
+ * @retval -1 on NULL pointers
+ * @retval -1 if appending failed (only on memory problems), the key will be deleted then.
+ * @see elektraKsBulkFinish(), ksAppendKey()
+ * @ingroup proposal
+ */
+ssize_t elektraKsBulkAppendKey (KeySet * ks, Key * toAppend)
+{
+	if (!ks) return -1;
+	if (!toAppend) return -1;
+	if (!toAppend->key)
+	{
+		keyDel (toAppend);
+		return -1;
+	}
+
+	keyLock (toAppend, KEY_LOCK_NAME);
+
+	if (ks->size + 1 >= ks->alloc)
+	{
+		size_t newSize = ks->alloc == 0 ? KEYSET_SIZE : ks->alloc * 2;
+		--newSize;
+
+		if (ksResize (ks, newSize) == -1)
+		{
+			keyDel (toAppend);
+			return -1;
+		}
+	}
+
+	keyIncRef (toAppend);
+	ks->array[ks->size++] = toAppend;
+	ks->array[ks->size] = 0;
+
+	elektraOpmphmInvalidate (ks);
+	elektraKsPrefixInvalidate (ks);
+
+	return ks->size;
+}
+
+/**
+ * @brief Sort a KeySet after elektraKsBulkAppendKey().
+ *
+ * Sorts all Keys once in O(n log n) and removes duplicates.
+ * Of Keys with the same name the one appended last wins,
+ * the same as if all Keys were appended by ksAppendKey().
+ *
+ * The internal cursor is rewound.
+ *
+ * @param ks the KeySet to sort
+ *
+ * @return the size of the sorted KeySet
+ * @retval -1 on NULL pointer
+ * @see elektraKsBulkAppendKey()
+ * @ingroup proposal
+ */
+ssize_t elektraKsBulkFinish (KeySet * ks)
+{
+	if (!ks) return -1;
+
+	size_t sorted = 1;
+	while (sorted < ks->size && keyCompareByNameOwner (&ks->array[sorted - 1], &ks->array[sorted]) < 0)
+	{
+		++sorted;
+	}
+
+	if (sorted < ks->size)
+	{
+		Key ** buffer = elektraMalloc (ks->size * sizeof (Key *));
+		if (buffer)
+		{
+			elektraKsMergeSort (ks->array, buffer, ks->size);
+			elektraFree (buffer);
+		}
+		else
+		{
+			elektraKsInsertionSort (ks->array, ks->size);
+		}
+
+		// equal Keys are adjacent now, keep the last one of them
+		size_t to = 0;
+		for (size_t from = 0; from < ks->size; ++from)
+		{
+			if (from + 1 < ks->size && keyCompareByNameOwner (&ks->array[from], &ks->array[from + 1]) == 0)
+			{
+				keyDecRef (ks->array[from]);
+				keyDel (ks->array[from]);
+				continue;
+			}
+			ks->array[to++] = ks->array[from];
+		}
+		ks->size = to;
+		ks->array[ks->size] = 0;
+	}
+
+	elektraOpmphmInvalidate (ks);
+	elektraKsPrefixInvalidate (ks);
+	ksRewind (ks);
+
+	return ks->size;
+}
+
+/**
+ * @internal
+ *
+ * @brief Merges the sorted Keys of toAppend into the sorted Keys of ks.
+ *
+ * Works in O(ks->size + toAppend->size) by merging from the end of
+ * the array, so ks must already have room for all Keys of both KeySets.
+ * The semantics are the same as calling ksAppendKey() for every Key of
+ * toAppend: Keys of ks with the same name are replaced and the cursor
+ * points to the last Key of toAppend.
+ *
+ * The OPMPHM and the name prefixes of ks are invalidated.
+ *
+ * @param ks the KeySet that will receive the Keys, alloc must be larger than the size of both KeySets
+ * @param toAppend the KeySet that provides the Keys, must not be ks
+ */
+static void elektraKsMerge (KeySet * ks, const KeySet * toAppend)
+{
+	ssize_t i = ks->size - 1;
+	ssize_t j = toAppend->size - 1;
+	size_t k = ks->size + toAppend->size;
+	size_t cursor = k - 1;
+
+	while (j >= 0)
+	{
+		Key * key = toAppend->array[j];
+		int cmp = i >= 0 ? keyCompareByNameOwner (&ks->array[i], &key) : -1;
+		if (cmp > 0)
+		{
+			ks->array[--k] = ks->array[i--];
+			continue;
+		}
+
+		if (j == (ssize_t) toAppend->size - 1) cursor = k - 1;
+		keyLock (key, KEY_LOCK_NAME);
+		if (cmp == 0)
+		{
+			/* Pop the key with the same name, unless it is the same key */
+			Key * old = ks->array[i--];
+			if (old != key)
+			{
+				keyDecRef (old);
+				keyDel (old);
+				keyIncRef (key);
+			}
+		}
+		else
+		{
+			keyIncRef (key);
+		}
+		ks->array[--k] = key;
+		--j;
+	}
+
+	/* The remaining Keys of ks are in place, close the gap left by replaced Keys */
+	size_t gap = k - (i + 1);
+	size_t size = ks->size + toAppend->size - gap;
+	if (gap > 0)
+	{
+		memmove (ks->array + (i + 1), ks->array + k, (size - (i + 1)) * sizeof (struct Key *));
+		cursor -= gap;
+	}
+	ks->size = size;
+	ks->array[ks->size] = 0;
+
+	elektraOpmphmInvalidate (ks);
+	elektraKsPrefixInvalidate (ks);
+	ksSetCursor (ks, cursor);
+}
+
 /**
  * Append all @p toAppend contained keys to the end of the @p ks.
  *
@@ -958,10 +1524,25 @@ ssize_t ksAppend (KeySet * ks, const KeySet * toAppend)
 		;
 	ksResize (ks, toAlloc - 1);
 
-	/* TODO: here is lots of room for optimizations */
-	for (size_t i = 0; i < toAppend->size; ++i)
+	const int wasEmpty = ks->size == 0;
+
+	if (ks->array && ks->size + toAppend->size < ks->alloc && ks != toAppend && toAppend->size >= KEYSET_MERGE_MIN)
+	{
+		/* Both KeySets are sorted, merge them in linear time */
+		elektraKsMerge (ks, toAppend);
+	}
+	else
+	{
+		for (size_t i = 0; i < toAppend->size; ++i)
+		{
+			ksAppendKey (ks, toAppend->array[i]);
+		}
+	}
+
+	if (wasEmpty)
 	{
-		ksAppendKey (ks, toAppend->array[i]);
+		// same keys at the same positions, the OPMPHM of toAppend fits
+		elektraOpmphmCopy (ks, toAppend);
 	}
 	return ks->size;
 }
@@ -1000,7 +1581,11 @@ ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from)
 
 	ks->array[ks->size] = 0;
 
-	if (ret) elektraOpmphmInvalidate (ks);
+	if (ret)
+	{
+		elektraOpmphmInvalidate (ks);
+		elektraKsPrefixInvalidate (ks);
+	}
 
 	return ret;
 }
@@ -1149,6 +1734,7 @@ KeySet * ksCut (KeySet * ks, const Key * cutpoint)
 	// if (strcmp(name, "")) return 0;
 
 	elektraOpmphmInvalidate (ks);
+	elektraKsPrefixInvalidate (ks);
 
 	if (name[0] == '/')
 	{
@@ -1250,6 +1836,78 @@ KeySet * ksCut (KeySet * ks, const Key * cutpoint)
 	return returned;
 }
 
+/**
+ * @internal
+ *
+ * @brief Checks if the unescaped name of key starts with the unescaped name of root.
+ *
+ * Unlike keyIsBelowOrSame() the namespaces must be equal, so that all
+ * Keys for which this is true are adjacent in a KeySet.
+ */
+static inline int elektraKsIsInHierarchy (const Key * root, const Key * key)
+{
+	return key->keyUSize >= root->keyUSize && !memcmp (key->key + key->keySize, root->key + root->keySize, root->keyUSize);
+}
+
+/**
+ * @brief Finds the Keys below a Key without copying them.
+ *
+ * The Keys below or same as @p root are adjacent in @p ks, this function
+ * returns their range in O(log n). Unlike ksCut() the KeySet is neither
+ * copied nor changed, so this is a read-only view of the hierarchy:
+ *
+ * @code
+ssize_t end;
+for (ssize_t it = elektraKsFindHierarchy (ks, root, &end); it < end; ++it)
+{
+	Key * cur = ksAtCursor (ks, it);
+}
+ * @endcode
+ *
+ * Lookups in the hierarchy can be done with ksLookup() on @p ks.
+ * The range is only valid until @p ks is changed.
+ *
+ * Only Keys in the namespace of @p root are in the range, e.g. for
+ * the cascading Key @p /sw only cascading Keys like @p /sw/app,
+ * but not @p user/sw/app.
+ *
+ * @param ks the KeySet to search in
+ * @param root the root of the hierarchy, does not need to be in @p ks
+ * @param end set to the position after the last Key of the hierarchy
+ *
+ * @return the position of the first Key of the hierarchy, equal to @p end if there is none
+ * @retval -1 on NULL pointers or if @p root has no name
+ * @see ksCut() to move the hierarchy out of the KeySet
+ * @ingroup proposal
+ */
+ssize_t elektraKsFindHierarchy (const KeySet * ks, const Key * root, ssize_t * end)
+{
+	if (!ks || !root || !end) return -1;
+	if (!root->key) return -1;
+
+	ssize_t search = ksSearchInternal (ks, root);
+	size_t from = search < 0 ? -search - 1 : search;
+
+	// the first Key not in the hierarchy, all Keys in it are before
+	size_t left = from;
+	size_t right = ks->size;
+	while (left < right)
+	{
+		size_t middle = left + (right - left) / 2;
+		if (elektraKsIsInHierarchy (root, ks->array[middle]))
+		{
+			left = middle + 1;
+		}
+		else
+		{
+			right = middle;
+		}
+	}
+
+	*end = left;
+	return from;
+}
+
 
 /**
  * Remove and return the last key of @p ks.
@@ -1291,19 +1949,52 @@ ksDel (ks2);
  */
 Key * ksPop (KeySet * ks)
 {
-	Key * ret = 0;
-
 	if (!ks) return 0;
 
 	ks->flags |= KS_FLAG_SYNC;
 
 	if (ks->size == 0) return 0;
 
-	elektraOpmphmInvalidate (ks);
+	return ksPopAtInternal (ks, ks->size - 1);
+}
+
+/**
+ * @internal
+ *
+ * @brief Removes the Key at a position from the KeySet.
+ *
+ * The Keys behind the position move one position forward.
+ *
+ * @param ks the KeySet
+ * @param pos the position, must be less than the size of ks
+ *
+ * @return the removed Key
+ */
+Key * ksPopAtInternal (KeySet * ks, size_t pos)
+{
+	ELEKTRA_ASSERT (pos < ks->size, "pos %zu out of range %zu", pos, ks->size);
+
+	ks->flags |= KS_FLAG_SYNC;
+
+	elektraOpmphmRemove (ks, pos);
+	elektraKsPrefixInvalidate (ks);
+
+	Key * ret = ks->array[pos];
+	/* Move the array over the place where key was found
+	 *
+	 * e.g. pos = 2
+	 *     size = 6
+	 *
+	 * 0  1  2  3  4  5  6
+	 * |--|--|p |--|--|--|size
+	 * move to (pos is overwritten):
+	 * |--|--|--|--|--|
+	 *
+	 * */
+	memmove (ks->array + pos, ks->array + pos + 1, (ks->size - pos - 1) * sizeof (Key *));
 
 	--ks->size;
 	if (ks->size + 1 < ks->alloc / 2) ksResize (ks, ks->alloc / 2 - 1);
-	ret = ks->array[ks->size];
 	ks->array[ks->size] = 0;
 	keyDecRef (ret);
 
@@ -1942,14 +2633,75 @@ static Key * elektraLookupByCascading (KeySet * ks, Key * key, option_t options)
 	return found;
 }
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/**
+ * @internal
+ *
+ * @brief Binary search by name using the name prefixes.
+ *
+ * Most probes are decided by the prefixes, which lie contiguously in memory,
+ * so only probes with equal prefixes need to touch the Key.
+ *
+ * @param ks the KeySet with prefixes
+ * @param key the Key to search for
+ *
+ * @return pointer into the array where the Key was found
+ * @retval NULL when not found
+ */
+static Key ** elektraLookupPrefixSearch (KeySet * ks, Key const * key)
+{
+	KeyNamePrefix prefix;
+	elektraKsPrefixSet (&prefix, key);
+
+	size_t left = 0;
+	size_t right = ks->size;
+	while (left < right)
+	{
+		size_t middle = left + ((right - left) / 2);
+		int cmpresult = elektraKsPrefixCmp (&prefix, &ks->prefixes[middle]);
+		if (cmpresult == 0)
+		{
+			cmpresult = keyCompareByName (&key, &ks->array[middle]);
+		}
+		if (cmpresult == 0)
+		{
+			return ks->array + middle;
+		}
+		if (cmpresult > 0)
+		{
+			left = middle + 1;
+		}
+		else
+		{
+			right = middle;
+		}
+	}
+	return 0;
+}
+#endif
+
 static Key * elektraLookupBinarySearch (KeySet * ks, Key const * key, option_t options)
 {
 	cursor_t cursor = 0;
 	cursor = ksGetCursor (ks);
 	Key ** found;
 	size_t jump = 0;
-	/*If there is a known offset in the beginning jump could be set*/
-	found = (Key **) bsearch (&key, ks->array + jump, ks->size - jump, sizeof (Key *), keyCompareByName);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	// build the prefixes when enough lookups happened to amortize the build
+	if (!ks->prefixes && ks->size >= KEYSET_PREFIX_MIN && ++ks->lookups * KEYSET_PREFIX_RATIO >= ks->size)
+	{
+		elektraKsPrefixBuild (ks);
+	}
+	if (ks->prefixes)
+	{
+		found = elektraLookupPrefixSearch (ks, key);
+	}
+	else
+#endif
+	{
+		/*If there is a known offset in the beginning jump could be set*/
+		found = (Key **) bsearch (&key, ks->array + jump, ks->size - jump, sizeof (Key *), keyCompareByName);
+	}
 
 	if (found)
 	{
@@ -1994,13 +2746,15 @@ static const char * elektraOpmphmGetString (void * data)
  *
  * Creates the OPMPHM when not here.
  * The passed KeySet must have a not build OPMPHM.
+ * With ::KDB_O_OPMPHM_PARALLEL the mapping uses multiple threads.
  *
  * @param ks the KeySet which OPMPHM is to build
+ * @param options lookup options
  *
  * @retval 0 on success
  * @retval -1 on memory error or to many mapping invocations
  */
-static int elektraLookupBuildOpmphm (KeySet * ks)
+static int elektraLookupBuildOpmphm (KeySet * ks, option_t options)
 {
 	if (ks->size > KDB_OPMPHM_MAX_N)
 	{
@@ -2014,6 +2768,14 @@ static int elektraLookupBuildOpmphm (KeySet * ks)
 			return -1;
 		}
 	}
+	if (!ks->opmphmDelta)
+	{
+		ks->opmphmDelta = opmphmDeltaNew ();
+		if (!ks->opmphmDelta)
+		{
+			return -1;
+		}
+	}
 	ELEKTRA_ASSERT (!opmphmIsBuild (ks->opmphm), "OPMPHM already build");
 	// make graph
 	uint8_t r = opmphmOptR (ks->size);
@@ -2031,11 +2793,12 @@ static int elektraLookupBuildOpmphm (KeySet * ks)
 	init.initSeed = elektraRandGetInitSeed ();
 
 	// mapping
+	size_t threads = (options & KDB_O_OPMPHM_PARALLEL) ? opmphmMappingThreads (ks->size) : 1;
 	size_t mappings = 0; // counts mapping invocations
 	int ret;
 	do
 	{
-		ret = opmphmMapping (ks->opmphm, graph, &init, ks->size);
+		ret = opmphmMappingParallel (ks->opmphm, graph, &init, ks->size, threads);
 		++mappings;
 	} while (ret && mappings < 10);
 	if (ret && mappings == 10)
@@ -2052,6 +2815,8 @@ static int elektraLookupBuildOpmphm (KeySet * ks)
 	}
 
 	opmphmGraphDel (graph);
+	// the OPMPHM maps to the positions from now on
+	opmphmDeltaClear (ks->opmphmDelta, ks->size);
 	return 0;
 }
 
@@ -2061,6 +2826,7 @@ static int elektraLookupBuildOpmphm (KeySet * ks)
  * @brief Searches for a Key in an already build OPMPHM.
  *
  * The OPMPHM must be build.
+ * Keys inserted or moved since the build are found with the OPMPHM delta.
  *
  * @param ks the KeySet
  * @param key the Key to search for
@@ -2073,33 +2839,42 @@ static int elektraLookupBuildOpmphm (KeySet * ks)
 static Key * elektraLookupOpmphmSearch (KeySet * ks, Key const * key, option_t options)
 {
 	ELEKTRA_ASSERT (opmphmIsBuild (ks->opmphm), "OPMPHM not build");
-	cursor_t cursor = 0;
-	cursor = ksGetCursor (ks);
-	size_t index = opmphmLookup (ks->opmphm, ks->size, keyName (key));
+	// without delta (e.g. from mmapstorage) nothing changed since the build
+	OpmphmDelta * delta = ks->opmphmDelta;
+	size_t index = opmphmLookup (ks->opmphm, delta ? delta->buildSize : ks->size, keyName (key));
+	if (!delta || !delta->size)
+	{
+		if (index >= ks->size || strcmp (keyName (ks->array[index]), keyName (key))) return 0;
+	}
+	else
+	{
+		// keys from the build are moved by the delta
+		index = opmphmDeltaPosition (delta, index, 0);
+		if (index >= ks->size || strcmp (keyName (ks->array[index]), keyName (key)))
+		{
+			// keys inserted after the build are only in the delta
+			uint32_t hash = opmphmDeltaHash (keyName (key));
+			size_t entry = delta->size;
+			do
+			{
+				index = opmphmDeltaFind (delta, hash, &entry);
+			} while (index < ks->size && strcmp (keyName (ks->array[index]), keyName (key)));
+		}
+	}
 	if (index >= ks->size)
 	{
 		return 0;
 	}
 
 	Key * found = ks->array[index];
-
-	if (!strcmp (keyName (found), keyName (key)))
+	if (options & KDB_O_POP)
 	{
-		cursor = index;
-		if (options & KDB_O_POP)
-		{
-			return elektraKsPopAtCursor (ks, cursor);
-		}
-		else
-		{
-			ksSetCursor (ks, cursor);
-			return found;
-		}
+		return elektraKsPopAtCursor (ks, index);
 	}
 	else
 	{
-		ksSetCursor (ks, cursor);
-		return 0;
+		ksSetCursor (ks, index);
+		return found;
 	}
 }
 
@@ -2177,7 +2952,7 @@ static Key * elektraLookupSearch (KeySet * ks, Key * key, option_t options)
 	// the actual lookup
 	if ((options & (KDB_O_BINSEARCH | KDB_O_OPMPHM)) == KDB_O_OPMPHM)
 	{
-		if (opmphmIsBuild (ks->opmphm) || !elektraLookupBuildOpmphm (ks))
+		if (opmphmIsBuild (ks->opmphm) || !elektraLookupBuildOpmphm (ks, options))
 		{
 			found = elektraLookupOpmphmSearch (ks, key, options);
 		}
@@ -2205,7 +2980,7 @@ static Key * elektraLookupSearch (KeySet * ks, Key * key, option_t options)
 	}
 
 	// remove flags to not interfere with callback
-	clear_bit (options, (KDB_O_OPMPHM | KDB_O_BINSEARCH));
+	clear_bit (options, (KDB_O_OPMPHM | KDB_O_BINSEARCH | KDB_O_OPMPHM_PARALLEL));
 #else
 	found = elektraLookupBinarySearch (ks, key, options);
 #endif
@@ -2311,6 +3086,7 @@ static Key * elektraLookupCreateKey (KeySet * ks, Key * key, ELEKTRA_UNUSED opti
  * When Elektra is compiled with `ENABLE_OPTIMIZATIONS=ON` a hybrid search decides
  * dynamically between the binary search and the [OPMPHM](https://master.libelektra.org/doc/dev/data-structures.md#order-preserving-minimal-perfect-hash-map-aka-opmphm).
  * The hybrid search can be overruled by passing ::KDB_O_OPMPHM or ::KDB_O_BINSEARCH in the options to ksLookup().
+ * Passing ::KDB_O_OPMPHM_PARALLEL builds the OPMPHM with multiple threads, which pays off for very large KeySets.
  *
  *
  *
@@ -2525,14 +3301,19 @@ int ksInit (KeySet * ks)
 	ks->size = 0;
 	ks->alloc = 0;
 	ks->flags = 0;
+	ks->arena = NULL;
 
 	ksRewind (ks);
 
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 	ks->opmphm = NULL;
+	ks->opmphmDelta = NULL;
 	// first lookup should predict so invalidate it
 	elektraOpmphmInvalidate (ks);
 	ks->opmphmPredictor = NULL;
+	ks->prefixes = NULL;
+	ks->prefixAlloc = 0;
+	ks->lookups = 0;
 #endif
 
 	return 0;
@@ -2570,6 +3351,7 @@ int ksClose (KeySet * ks)
 	ks->size = 0;
 
 	elektraOpmphmInvalidate (ks);
+	elektraKsPrefixInvalidate (ks);
 
 	return 0;
 }
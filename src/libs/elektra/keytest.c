@@ -56,6 +56,9 @@ int keyClearSync (Key * key)
 {
 	if (!key) return -1;
 
+	// do not write to keys without the flag, they might be in a private mapping
+	if (!test_bit (key->flags, KEY_FLAG_SYNC)) return key->flags;
+
 	keyflag_t semiflag = KEY_FLAG_SYNC;
 
 	semiflag = ~semiflag;
@@ -515,9 +515,8 @@ ssize_t keySetRaw (Key * key, const void * newBinary, size_t dataSize)
 	{
 		if (key->data.v)
 		{
-			if (!test_bit (key->flags, KEY_FLAG_MMAP_DATA)) elektraFree (key->data.v);
+			elektraKeyFreeData (key, key->data.v);
 			key->data.v = NULL;
-			clear_bit (key->flags, (keyflag_t) KEY_FLAG_MMAP_DATA);
 		}
 		key->dataSize = 0;
 		set_bit (key->flags, KEY_FLAG_SYNC);
@@ -526,21 +525,10 @@ ssize_t keySetRaw (Key * key, const void * newBinary, size_t dataSize)
 	}
 
 	key->dataSize = dataSize;
-	if (key->data.v)
+	if (key->data.v && !test_bit (key->flags, KEY_FLAG_MMAP_DATA | KEY_FLAG_ARENA_DATA))
 	{
 		char * previous = key->data.v;
 
-		if (test_bit (key->flags, KEY_FLAG_MMAP_DATA))
-		{
-			clear_bit (key->flags, (keyflag_t) KEY_FLAG_MMAP_DATA);
-			key->data.v = elektraMalloc (key->dataSize);
-			if (key->data.v == NULL) return -1;
-		}
-		else
-		{
-			if (-1 == elektraRealloc ((void **) &key->data.v, key->dataSize)) return -1;
-		}
-
 		if (-1 == elektraRealloc ((void **) &key->data.v, key->dataSize)) return -1;
 		if (previous == key->data.v)
 		{
@@ -556,8 +544,10 @@ ssize_t keySetRaw (Key * key, const void * newBinary, size_t dataSize)
 	{
 		char * p = elektraMalloc (key->dataSize);
 		if (NULL == p) return -1;
+		memcpy (p, newBinary, key->dataSize);
+		// a value in a mmap region or an arena is not reallocated, but moved to the heap
+		if (key->data.v) elektraKeyFreeData (key, key->data.v);
 		key->data.v = p;
-		memcpy (key->data.v, newBinary, key->dataSize);
 	}
 
 	set_bit (key->flags, KEY_FLAG_SYNC);
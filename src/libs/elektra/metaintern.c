@@ -0,0 +1,244 @@
+/**
+ * @file
+ *
+ * @brief Intern table for metadata.
+ *
+ * Meta keys are read-only, so keys with equal metadata can share one
+ * meta key. While a table is active, keySetMeta() looks up the meta
+ * key in the table and only creates a new one if there is no equal
+ * meta key yet. The table holds a reference to every meta key in it
+ * until it is deleted.
+ *
+ * kdbGet() uses a new table for every call, so afterwards the meta keys
+ * belong to the returned keys alone. Like all reference counts of keys,
+ * the ones of shared meta keys are not atomic: keys returned by one
+ * kdbGet() must not be changed or deleted by several threads at once.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <string.h>
+
+#include <kdbprivate.h>
+
+#if defined(__GNUC__)
+#define ELEKTRA_META_INTERN_THREAD_LOCAL __thread
+#endif
+
+struct _ElektraMetaIntern
+{
+	Key ** slots;	 /*!< Open addressing hash table of meta keys, size is a power of two */
+	size_t capacity; /*!< Number of slots */
+	size_t size;	 /*!< Number of meta keys in slots */
+};
+
+#ifdef ELEKTRA_META_INTERN_THREAD_LOCAL
+/** The table used by keySetMeta(), see elektraMetaInternActivate() */
+static ELEKTRA_META_INTERN_THREAD_LOCAL ElektraMetaIntern * elektraMetaInternActive = 0;
+#endif
+
+/**
+ * @internal
+ *
+ * @brief FNV-1a hash of unescaped name and value of a meta key.
+ */
+static size_t elektraMetaInternHash (const char * name, size_t nameSize, const char * value, size_t valueSize)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < nameSize; ++i)
+	{
+		hash = (hash ^ (unsigned char) name[i]) * 1099511628211ULL;
+	}
+	for (size_t i = 0; i < valueSize; ++i)
+	{
+		hash = (hash ^ (unsigned char) value[i]) * 1099511628211ULL;
+	}
+	return (size_t) hash;
+}
+
+static size_t elektraMetaInternKeyHash (const Key * meta)
+{
+	return elektraMetaInternHash (meta->key + meta->keySize, meta->keyUSize, meta->data.c, meta->dataSize);
+}
+
+/**
+ * @internal
+ *
+ * @brief Inserts a meta key into slots without checking for duplicates or size.
+ */
+static void elektraMetaInternPlace (Key ** slots, size_t capacity, Key * meta)
+{
+	size_t i = elektraMetaInternKeyHash (meta) & (capacity - 1);
+	while (slots[i])
+	{
+		i = (i + 1) & (capacity - 1);
+	}
+	slots[i] = meta;
+}
+
+/**
+ * @internal
+ *
+ * @brief Rehashes the table into a new array of slots.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error, the table is unchanged then
+ */
+static int elektraMetaInternRehash (ElektraMetaIntern * intern, size_t capacity)
+{
+	Key ** slots = elektraCalloc (capacity * sizeof (Key *));
+	if (!slots) return -1;
+
+	for (size_t i = 0; i < intern->capacity; ++i)
+	{
+		if (intern->slots[i]) elektraMetaInternPlace (slots, capacity, intern->slots[i]);
+	}
+
+	elektraFree (intern->slots);
+	intern->slots = slots;
+	intern->capacity = capacity;
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Creates a new, empty intern table.
+ *
+ * @return the new table
+ * @retval NULL on memory error
+ */
+ElektraMetaIntern * elektraMetaInternNew (void)
+{
+	ElektraMetaIntern * intern = elektraCalloc (sizeof (ElektraMetaIntern));
+	if (!intern) return 0;
+
+	intern->capacity = ELEKTRA_META_INTERN_MIN;
+	intern->slots = elektraCalloc (intern->capacity * sizeof (Key *));
+	if (!intern->slots)
+	{
+		elektraFree (intern);
+		return 0;
+	}
+	return intern;
+}
+
+/**
+ * @internal
+ *
+ * @brief Deletes an intern table.
+ *
+ * The meta keys stay valid as long as keys use them.
+ *
+ * @param intern the table to delete
+ */
+void elektraMetaInternDel (ElektraMetaIntern * intern)
+{
+	if (!intern) return;
+#ifdef ELEKTRA_META_INTERN_THREAD_LOCAL
+	if (elektraMetaInternActive == intern) elektraMetaInternActive = 0;
+#endif
+	for (size_t i = 0; i < intern->capacity; ++i)
+	{
+		if (!intern->slots[i]) continue;
+		keyDecRef (intern->slots[i]);
+		keyDel (intern->slots[i]);
+	}
+	elektraFree (intern->slots);
+	elektraFree (intern);
+}
+
+/**
+ * @internal
+ *
+ * @brief Sets the table used by keySetMeta() in the current thread.
+ *
+ * @param intern the table to use, NULL to disable interning
+ *
+ * @return the table used before, to restore it later
+ */
+ElektraMetaIntern * elektraMetaInternActivate (ElektraMetaIntern * intern)
+{
+#ifdef ELEKTRA_META_INTERN_THREAD_LOCAL
+	ElektraMetaIntern * previous = elektraMetaInternActive;
+	elektraMetaInternActive = intern;
+	return previous;
+#else
+	(void) intern;
+	return 0;
+#endif
+}
+
+/**
+ * @internal
+ *
+ * @brief Looks up a meta key in the active table.
+ *
+ * @param name a key with the name of the meta key
+ * @param value the value of the meta key
+ * @param valueSize the size of value including the null terminator
+ *
+ * @return the meta key with equal name and value
+ * @retval NULL if no table is active or there is no such meta key
+ */
+Key * elektraMetaInternLookup (const Key * name, const char * value, size_t valueSize)
+{
+#ifdef ELEKTRA_META_INTERN_THREAD_LOCAL
+	ElektraMetaIntern * intern = elektraMetaInternActive;
+	if (!intern) return 0;
+
+	const char * unescaped = name->key + name->keySize;
+	size_t i = elektraMetaInternHash (unescaped, name->keyUSize, value, valueSize) & (intern->capacity - 1);
+	for (Key * meta = intern->slots[i]; meta; meta = intern->slots[i])
+	{
+		if (meta->keyUSize == name->keyUSize && meta->dataSize == valueSize &&
+		    !memcmp (meta->key + meta->keySize, unescaped, name->keyUSize) && !memcmp (meta->data.c, value, valueSize))
+		{
+			return meta;
+		}
+		i = (i + 1) & (intern->capacity - 1);
+	}
+#else
+	(void) name;
+	(void) value;
+	(void) valueSize;
+#endif
+	return 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Adds a meta key to the active table.
+ *
+ * The meta key must be read-only and must not be in the table yet.
+ *
+ * @param meta the meta key to add
+ *
+ * @retval 1 if the meta key was added
+ * @retval 0 if no table is active or on memory error
+ */
+int elektraMetaInternInsert (Key * meta)
+{
+#ifdef ELEKTRA_META_INTERN_THREAD_LOCAL
+	ElektraMetaIntern * intern = elektraMetaInternActive;
+	if (!intern) return 0;
+
+	if ((intern->size + 1) * 2 > intern->capacity && elektraMetaInternRehash (intern, intern->capacity * 2) == -1)
+	{
+		return 0;
+	}
+
+	keyIncRef (meta);
+	elektraMetaInternPlace (intern->slots, intern->capacity, meta);
+	++intern->size;
+	return 1;
+#else
+	(void) meta;
+	return 0;
+#endif
+}
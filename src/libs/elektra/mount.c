@@ -40,6 +40,11 @@
  *
  * The config will be deleted within this function.
  *
+ * With system/elektra/lazy in @p config, the plugins of the backends
+ * are not opened here, but the first time a backend is used by kdbGet()
+ * or kdbSet() (see backendOpenLazy()). Problems while opening them are
+ * then only reported as warnings of these calls.
+ *
  * @note mountDefault is not allowed to be executed before
  *
  * @param kdb the handle to work with
@@ -54,6 +59,7 @@ int mountOpen (KDB * kdb, KeySet * config, KeySet * modules, Key * errorKey)
 {
 	Key * root;
 	Key * cur;
+	int lazy = ksLookupByName (config, KDB_SYSTEM_ELEKTRA "/lazy", 0) != 0;
 
 	ksRewind (config);
 	root = ksLookupByName (config, "system/elektra/mountpoints", KDB_O_CREATE);
@@ -64,7 +70,7 @@ int mountOpen (KDB * kdb, KeySet * config, KeySet * modules, Key * errorKey)
 		if (keyIsDirectlyBelow (root, cur) == 1)
 		{
 			KeySet * cut = ksCut (config, cur);
-			Backend * backend = backendOpen (cut, modules, kdb->global, errorKey);
+			Backend * backend = lazy ? backendOpenLazy (cut, errorKey) : backendOpen (cut, modules, kdb->global, errorKey);
 
 			if (!backend)
 			{
@@ -309,6 +315,13 @@ int elektraMountGlobalsLoadPlugin (Plugin ** plugin, KeySet * referencePlugins,
 			return 0;
 		}
 
+		Key * cacheShm = ksLookupByName (system, "system/elektra/cache/shm", 0);
+		if (cacheShm && !elektraStrCmp (pluginName, "cache"))
+		{
+			// the cache is shared by all processes of the given name
+			ksAppendKey (config, keyNew ("system/shm", KEY_VALUE, keyString (cacheShm), KEY_END));
+		}
+
 		// loading the new plugin
 		*plugin = elektraPluginOpen (pluginName, modules, config, openKey);
 		if (!(*plugin) && !elektraStrCmp (pluginName, "cache") && !ksLookupByName (system, "system/elektra/cache/enabled", 0))
@@ -18,6 +18,11 @@
 
 #include <string.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 static int hasCycle (Opmphm * opmphm, OpmphmGraph * graph, size_t n);
 
 /**
@@ -162,6 +167,151 @@ int opmphmAssignment (Opmphm * opmphm, OpmphmGraph * graph, size_t n, int defaul
  * @retval -1 mapping not possible
  */
 int opmphmMapping (Opmphm * opmphm, OpmphmGraph * graph, OpmphmInit * init, size_t n)
+{
+	return opmphmMappingParallel (opmphm, graph, init, n, 1);
+}
+
+/**
+ * Work of one thread during the mapping
+ */
+typedef struct
+{
+	Opmphm * opmphm;
+	OpmphmGraph * graph;
+	OpmphmInit * init;
+	size_t n;     /*!< the number of elements */
+	size_t start; /*!< first element to hash or first component to link */
+	size_t end;   /*!< end of the elements to hash or components to link */
+} OpmphmMappingTask;
+
+/**
+ * @brief Hashes the elements of a OpmphmMappingTask to the vertices of their edges.
+ *
+ * @param data the OpmphmMappingTask
+ *
+ * @retval NULL always
+ */
+static void * opmphmMappingHash (void * data)
+{
+	OpmphmMappingTask * task = data;
+#ifndef OPMPHM_TEST
+	const Opmphm * opmphm = task->opmphm;
+	for (size_t i = task->start; i < task->end; ++i)
+	{
+		const char * name = task->init->getName (task->init->data[i]);
+		size_t nameLength = strlen (name);
+		for (uint8_t r = 0; r < opmphm->rUniPar; ++r)
+		{
+			// set edge.h[]
+			task->graph->edges[i].vertices[r] =
+				opmphmHashfunction (name, nameLength, opmphm->hashFunctionSeeds[r]) % opmphm->componentSize;
+		}
+	}
+#else
+	(void) task;
+#endif
+	return NULL;
+}
+
+/**
+ * @brief Adds all edges to the graph, only to the components of a OpmphmMappingTask.
+ *
+ * The edges are added in order, so the lists of edges do not depend on the number of threads.
+ *
+ * @param data the OpmphmMappingTask
+ *
+ * @retval NULL always
+ */
+static void * opmphmMappingLink (void * data)
+{
+	OpmphmMappingTask * task = data;
+	const Opmphm * opmphm = task->opmphm;
+	OpmphmGraph * graph = task->graph;
+	for (size_t r = task->start; r < task->end; ++r)
+	{
+		for (size_t i = 0; i < task->n; ++i)
+		{
+			// add edge to graph
+			// set edge.nextEdge[r]
+			size_t v = r * opmphm->componentSize + graph->edges[i].vertices[r];
+			graph->edges[i].nextEdge[r] = graph->vertices[v].firstEdge;
+			// set vertex.firstEdge
+			graph->vertices[v].firstEdge = i;
+			// increment degree
+			++graph->vertices[v].degree;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Runs all tasks, each in its own thread.
+ *
+ * The first task runs in the calling thread, so do tasks whose thread could not be created.
+ *
+ * @param work the function to run
+ * @param tasks the tasks
+ * @param count the number of tasks, at most OPMPHM_PARALLEL_MAX_THREADS
+ */
+static void opmphmMappingRun (void * (*work) (void *), OpmphmMappingTask * tasks, size_t count)
+{
+#ifdef HAVE_PTHREAD
+	pthread_t threads[OPMPHM_PARALLEL_MAX_THREADS];
+	int started[OPMPHM_PARALLEL_MAX_THREADS];
+	for (size_t t = 1; t < count; ++t)
+	{
+		started[t] = !pthread_create (&threads[t], NULL, work, &tasks[t]);
+	}
+	work (&tasks[0]);
+	for (size_t t = 1; t < count; ++t)
+	{
+		if (started[t])
+		{
+			pthread_join (threads[t], NULL);
+		}
+		else
+		{
+			work (&tasks[t]);
+		}
+	}
+#else
+	for (size_t t = 0; t < count; ++t)
+	{
+		work (&tasks[t]);
+	}
+#endif
+}
+
+/**
+ * @brief Splits [0, size) evenly into the tasks.
+ */
+static void opmphmMappingSplit (OpmphmMappingTask * tasks, size_t count, size_t size)
+{
+	for (size_t t = 0; t < count; ++t)
+	{
+		tasks[t].start = size * t / count;
+		tasks[t].end = size * (t + 1) / count;
+	}
+}
+
+/**
+ * @brief Maps the elements to edges in the r-uniform r-partite hypergraph with multiple threads.
+ *
+ * Like opmphmMapping (...), the resulting graph is the same for any number of threads.
+ * The elements are hashed by `threads` threads, then the edges are added to the
+ * components of the graph by at most `Opmphm->rUniPar` threads.
+ * Without thread support everything is done in the calling thread.
+ *
+ * @param opmphm the OPMPHM
+ * @param graph the OpmphmGraph
+ * @param init the OpmphmInit
+ * @param n the number of elements
+ * @param threads the number of threads, see opmphmMappingThreads (...)
+ *
+ * @retval 0 on success
+ * @retval -1 mapping not possible
+ */
+int opmphmMappingParallel (Opmphm * opmphm, OpmphmGraph * graph, OpmphmInit * init, size_t n, size_t threads)
 {
 	ELEKTRA_NOT_NULL (opmphm);
 	ELEKTRA_ASSERT (opmphm->rUniPar > 0 && opmphm->componentSize > 0, "passed opmphm is uninitialized");
@@ -171,34 +321,39 @@ int opmphmMapping (Opmphm * opmphm, OpmphmGraph * graph, OpmphmInit * init, size
 	ELEKTRA_ASSERT (init->data != NULL, "passed init->data is a Null Pointer");
 	ELEKTRA_ASSERT (n > 0, "n is 0");
 	ELEKTRA_ASSERT (n <= KDB_OPMPHM_MAX_N, "n > KDB_OPMPHM_MAX");
+	if (threads > OPMPHM_PARALLEL_MAX_THREADS)
+	{
+		threads = OPMPHM_PARALLEL_MAX_THREADS;
+	}
+	if (threads > n)
+	{
+		threads = n;
+	}
+	if (!threads)
+	{
+		threads = 1;
+	}
 	// set seeds
 	for (uint8_t r = 0; r < opmphm->rUniPar; ++r)
 	{
 		elektraRand (&(init->initSeed));
 		opmphm->hashFunctionSeeds[r] = init->initSeed;
 	}
-	for (size_t i = 0; i < n; ++i)
+	OpmphmMappingTask tasks[OPMPHM_PARALLEL_MAX_THREADS];
+	for (size_t t = 0; t < threads; ++t)
 	{
-#ifndef OPMPHM_TEST
-		const char * name = init->getName (init->data[i]);
-#endif
-		for (uint8_t r = 0; r < opmphm->rUniPar; ++r)
-		{
-#ifndef OPMPHM_TEST
-			// set edge.h[]
-			graph->edges[i].vertices[r] =
-				opmphmHashfunction (name, strlen (name), opmphm->hashFunctionSeeds[r]) % opmphm->componentSize;
-#endif
-			// add edge to graph
-			// set edge.nextEdge[r]
-			size_t v = r * opmphm->componentSize + graph->edges[i].vertices[r];
-			graph->edges[i].nextEdge[r] = graph->vertices[v].firstEdge;
-			// set vertex.firstEdge
-			graph->vertices[v].firstEdge = i;
-			// increment degree
-			++graph->vertices[v].degree;
-		}
+		tasks[t].opmphm = opmphm;
+		tasks[t].graph = graph;
+		tasks[t].init = init;
+		tasks[t].n = n;
 	}
+	// hash the elements
+	opmphmMappingSplit (tasks, threads, n);
+	opmphmMappingRun (opmphmMappingHash, tasks, threads);
+	// add the edges, the components do not share vertices
+	size_t linkThreads = threads < opmphm->rUniPar ? threads : opmphm->rUniPar;
+	opmphmMappingSplit (tasks, linkThreads, opmphm->rUniPar);
+	opmphmMappingRun (opmphmMappingLink, tasks, linkThreads);
 	if (hasCycle (opmphm, graph, n))
 	{
 		// reset graph vertices
@@ -212,11 +367,40 @@ int opmphmMapping (Opmphm * opmphm, OpmphmGraph * graph, OpmphmInit * init, size
 }
 
 /**
- * @brief Recursive function used by hasCycle
+ * @brief Provides the number of threads for the parallel mapping of `n` elements.
+ *
+ * Every thread gets at least OPMPHM_PARALLEL_MIN_N elements,
+ * there are not more threads than online processors.
+ *
+ * @param n the number of elements
+ *
+ * @retval size_t the number of threads, 1 without thread support
+ */
+size_t opmphmMappingThreads (size_t n)
+{
+#ifdef HAVE_PTHREAD
+	size_t threads = n / OPMPHM_PARALLEL_MIN_N;
+	long processors = sysconf (_SC_NPROCESSORS_ONLN);
+	if (processors > 0 && threads > (size_t) processors)
+	{
+		threads = processors;
+	}
+	if (threads > OPMPHM_PARALLEL_MAX_THREADS)
+	{
+		threads = OPMPHM_PARALLEL_MAX_THREADS;
+	}
+	return threads ? threads : 1;
+#else
+	(void) n;
+	return 1;
+#endif
+}
+
+/**
+ * @brief Function used by hasCycle
  *
  * `v` is a degree 1 vertex with edge `e`. The edge `e` will be removed completely from the graph and
  * inserted in the `OpmphmGraph->removeSequence`.
- * For all vertices connected through `e` with degree 1 the function will be called again.
  *
  * @param opmphm the OPMPHM
  * @param graph the OpmphmGraph
@@ -241,16 +425,6 @@ static void peel_off (Opmphm * opmphm, OpmphmGraph * graph, size_t v)
 		// decrease degree
 		--graph->vertices[w].degree;
 	}
-	// all vertices adjacent to v through e
-	for (uint8_t r = 0; r < opmphm->rUniPar; ++r)
-	{
-		size_t w = r * opmphm->componentSize + graph->edges[e].vertices[r];
-		// if degree 1, go on
-		if (graph->vertices[w].degree == 1)
-		{
-			peel_off (opmphm, graph, w);
-		}
-	}
 }
 
 /**
@@ -258,6 +432,8 @@ static void peel_off (Opmphm * opmphm, OpmphmGraph * graph, size_t v)
  *
  * Removes edges that have a degree 1 vertex, until the graph is empty.
  * The sequence of removed edges will be saved in `OpmphmGraph->removeSequence`.
+ * The not yet visited part of the sequence serves as queue, vertices adjacent to removed
+ * edges are peeled from there. Unlike recursion this needs no stack for large graphs.
  * The passed OpmphmGraph is will be destroyed.
  *
  * @param opmphm the OPMPHM
@@ -270,6 +446,7 @@ static void peel_off (Opmphm * opmphm, OpmphmGraph * graph, size_t v)
 static int hasCycle (Opmphm * opmphm, OpmphmGraph * graph, size_t n)
 {
 	graph->removeIndex = 0;
+	size_t visitIndex = 0;
 	// search all vertices
 	for (size_t v = 0; v < opmphm->componentSize * opmphm->rUniPar; ++v)
 	{
@@ -278,6 +455,20 @@ static int hasCycle (Opmphm * opmphm, OpmphmGraph * graph, size_t n)
 		{
 			peel_off (opmphm, graph, v);
 		}
+		// all vertices adjacent through removed edges
+		for (; visitIndex < graph->removeIndex; ++visitIndex)
+		{
+			uint32_t e = graph->removeSequence[visitIndex];
+			for (uint8_t r = 0; r < opmphm->rUniPar; ++r)
+			{
+				size_t w = r * opmphm->componentSize + graph->edges[e].vertices[r];
+				// if degree 1, go on
+				if (graph->vertices[w].degree == 1)
+				{
+					peel_off (opmphm, graph, w);
+				}
+			}
+		}
 	}
 	if (graph->removeIndex == n)
 	{
@@ -634,6 +825,165 @@ void opmphmClear (Opmphm * opmphm)
 	}
 }
 
+/**
+ * @brief Allocates an empty OPMPHM delta.
+ *
+ * @retval OpmphmDelta * success
+ * @retval NULL memory error
+ */
+OpmphmDelta * opmphmDeltaNew (void)
+{
+	return elektraCalloc (sizeof (OpmphmDelta));
+}
+
+/**
+ * @brief Deletes the OPMPHM delta.
+ *
+ * @param delta the OPMPHM delta
+ */
+void opmphmDeltaDel (OpmphmDelta * delta)
+{
+	ELEKTRA_NOT_NULL (delta);
+	elektraFree (delta);
+}
+
+/**
+ * @brief Empties the log of the OPMPHM delta.
+ *
+ * Must be invoked when the OPMPHM is built or cleared.
+ *
+ * @param delta the OPMPHM delta
+ * @param buildSize the number of elements of the built OPMPHM, 0 when cleared
+ */
+void opmphmDeltaClear (OpmphmDelta * delta, size_t buildSize)
+{
+	ELEKTRA_NOT_NULL (delta);
+	delta->size = 0;
+	delta->buildSize = buildSize;
+}
+
+/**
+ * @brief Hashes a name for the OPMPHM delta.
+ *
+ * @param name the name
+ *
+ * @retval uint32_t the hash
+ */
+uint32_t opmphmDeltaHash (const char * name)
+{
+	ELEKTRA_NOT_NULL (name);
+	return opmphmHashfunction (name, strlen (name), 0);
+}
+
+/**
+ * @brief Logs the insertion of an element.
+ *
+ * All elements at and behind the position move one position back.
+ *
+ * @param delta the OPMPHM delta
+ * @param position the position of the inserted element
+ * @param name the name of the inserted element
+ * @param limit the maximal length of the log, at most OPMPHM_DELTA_MAX
+ *
+ * @retval 0 on success
+ * @retval -1 if the log is full, the OPMPHM must be rebuilt then
+ */
+int opmphmDeltaInsert (OpmphmDelta * delta, size_t position, const char * name, size_t limit)
+{
+	ELEKTRA_NOT_NULL (delta);
+	ELEKTRA_ASSERT (limit <= OPMPHM_DELTA_MAX, "limit > OPMPHM_DELTA_MAX");
+	if (delta->size >= limit) return -1;
+	OpmphmDeltaEntry * entry = &delta->entries[delta->size++];
+	entry->position = position;
+	entry->hash = opmphmDeltaHash (name);
+	entry->insert = 1;
+	return 0;
+}
+
+/**
+ * @brief Logs the removal of an element.
+ *
+ * All elements behind the position move one position forward.
+ *
+ * @param delta the OPMPHM delta
+ * @param position the position of the removed element
+ * @param limit the maximal length of the log, at most OPMPHM_DELTA_MAX
+ *
+ * @retval 0 on success
+ * @retval -1 if the log is full, the OPMPHM must be rebuilt then
+ */
+int opmphmDeltaRemove (OpmphmDelta * delta, size_t position, size_t limit)
+{
+	ELEKTRA_NOT_NULL (delta);
+	ELEKTRA_ASSERT (limit <= OPMPHM_DELTA_MAX, "limit > OPMPHM_DELTA_MAX");
+	if (delta->size >= limit) return -1;
+	OpmphmDeltaEntry * entry = &delta->entries[delta->size++];
+	entry->position = position;
+	entry->hash = 0;
+	entry->insert = 0;
+	return 0;
+}
+
+/**
+ * @brief Replays the log on a position.
+ *
+ * @param delta the OPMPHM delta
+ * @param position the position before the log entry `from`
+ * @param from the first log entry to replay, 0 for positions returned by `opmphmLookup (...)`
+ *
+ * @retval size_t the current position
+ * @retval SIZE_MAX if the element on the position was removed
+ */
+size_t opmphmDeltaPosition (const OpmphmDelta * delta, size_t position, size_t from)
+{
+	ELEKTRA_NOT_NULL (delta);
+	for (size_t i = from; i < delta->size; ++i)
+	{
+		const OpmphmDeltaEntry * entry = &delta->entries[i];
+		if (entry->insert)
+		{
+			if (entry->position <= position) ++position;
+		}
+		else if (entry->position < position)
+		{
+			--position;
+		}
+		else if (entry->position == position)
+		{
+			return SIZE_MAX;
+		}
+	}
+	return position;
+}
+
+/**
+ * @brief Finds an inserted element by the hash of its name.
+ *
+ * Searches from the newest to the oldest log entry, so that repeated invocations with the
+ * same `entry` return all candidates. The caller must compare the names, since different
+ * names can have the same hash.
+ *
+ * @param delta the OPMPHM delta
+ * @param hash the opmphmDeltaHash (...) of the name
+ * @param entry the log entry to start before, must be `delta->size` initially, is set to the found entry
+ *
+ * @retval size_t the current position of the candidate
+ * @retval SIZE_MAX if there is no further candidate
+ */
+size_t opmphmDeltaFind (const OpmphmDelta * delta, uint32_t hash, size_t * entry)
+{
+	ELEKTRA_NOT_NULL (delta);
+	ELEKTRA_NOT_NULL (entry);
+	while (*entry > 0)
+	{
+		const OpmphmDeltaEntry * candidate = &delta->entries[--*entry];
+		if (!candidate->insert || candidate->hash != hash) continue;
+		size_t position = opmphmDeltaPosition (delta, candidate->position, *entry + 1);
+		if (position != SIZE_MAX) return position;
+	}
+	return SIZE_MAX;
+}
+
 /**
  * Hash function
  * By Bob Jenkins, May 2006
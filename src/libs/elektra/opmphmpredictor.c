@@ -52,6 +52,22 @@ inline size_t opmphmPredictorWorthOpmphm (size_t n)
 	return n + 5000;
 }
 
+/**
+ * @brief Heuristic function for the number of alterations the OPMPHM delta takes.
+ *
+ * Every ksLookup (...) replays the log of the OpmphmDelta, so the log must stay short.
+ * But larger KeySets are more expensive to rebuild and so can take more alterations.
+ *
+ * @param n the number of elements in the KeySet
+ *
+ * @retval size_t the maximal length of the log, at most OPMPHM_DELTA_MAX
+ */
+inline size_t opmphmPredictorDeltaLimit (size_t n)
+{
+	size_t limit = (n >> 10) + 8;
+	return limit < OPMPHM_DELTA_MAX ? limit : OPMPHM_DELTA_MAX;
+}
+
 /**
  * @brief Increases the counter when the OPMPHM was used for the ksLookup (...) .
  *
@@ -388,6 +388,46 @@ size_t elektraPluginGetFunction (Plugin * plugin, const char * name)
 	return func;
 }
 
+/**
+ * @brief Checks if a plugin declared in its contract that it is threadsafe.
+ *
+ * A plugin is threadsafe if `infos/status` contains `threadsafe`, i.e. it can be
+ * used concurrently with other instances of itself, as long as each instance
+ * is only used by one thread at a time.
+ *
+ * @param  plugin Plugin handle
+ * @retval 1 if the plugin is threadsafe or has no kdbGet()
+ * @retval 0 otherwise
+ */
+int elektraPluginIsThreadSafe (Plugin * plugin)
+{
+	ELEKTRA_NOT_NULL (plugin);
+
+	if (!plugin->kdbGet) return 1;
+	if (!plugin->name) return 0;
+
+	KeySet * contract = ksNew (0, KS_END);
+	Key * pk = keyNew ("system/elektra/modules", KEY_END);
+	keyAddBaseName (pk, plugin->name);
+	plugin->kdbGet (plugin, contract, pk);
+	keyAddBaseName (pk, "infos");
+	keyAddBaseName (pk, "status");
+
+	int threadSafe = 0;
+	const char * status = keyString (ksLookup (contract, pk, 0));
+	const char * word = strstr (status, "threadsafe");
+	while (word && !threadSafe)
+	{
+		size_t size = sizeof ("threadsafe") - 1;
+		threadSafe = (word == status || word[-1] == ' ') && (word[size] == '\0' || word[size] == ' ');
+		word = strstr (word + size, "threadsafe");
+	}
+
+	ksDel (contract);
+	keyDel (pk);
+	return threadSafe;
+}
+
 static int elektraMissingGet (Plugin * plugin ELEKTRA_UNUSED, KeySet * ks ELEKTRA_UNUSED, Key * error)
 {
 	ELEKTRA_SET_INSTALLATION_ERRORF (error, "Tried to get a key from a missing backend: %s", keyName (error));
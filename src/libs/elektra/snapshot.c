@@ -0,0 +1,390 @@
+/**
+ * @file
+ *
+ * @brief Snapshot of the bootstrap configuration for kdbOpen().
+ *
+ * Without snapshot, kdbOpen() opens the default backend and reads
+ * system/elektra with it, i.e. the resolver and storage plugin parse
+ * the bootstrap file on every start. With system/elektra/snapshot set,
+ * kdbOpen() writes the keys read this way to a snapshot file and reads
+ * them from there as long as the bootstrap file is not modified.
+ *
+ * Which bootstrap file is used depends on the environment, e.g. on
+ * XDG_CONFIG_DIRS. kdbOpen() resolves it with the resolver before
+ * reading a snapshot, and every bootstrap file has its own snapshot file
+ * named after a hash of the path.
+ *
+ * The snapshot file starts with a SnapshotHeader, which also identifies
+ * the bootstrap file by its path, device, inode, size and modification
+ * time. It is followed by one SnapshotEntry per key with the name and the
+ * value, and one SnapshotEntry per metakey. All entries are aligned to
+ * 8 bytes, so the file is read directly from its mapping. The names are
+ * parsed again with keyNew(), so a snapshot only contains keys below
+ * system/elektra with valid names, whatever was written to the file.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#include <kdbprivate.h>
+
+#if defined(HAVE_UNISTD_H) && !defined(__MINGW32__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC "EKDBSNAP"
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_DIR "/.cache/elektra"
+#define SNAPSHOT_ALIGN(size) (((size) + 7) & ~(uint64_t) 7)
+
+typedef struct
+{
+	char magic[8];	       /*!< SNAPSHOT_MAGIC without null terminator */
+	uint32_t version;      /*!< SNAPSHOT_VERSION */
+	uint32_t headerSize;   /*!< sizeof (SnapshotHeader), changes with the layout */
+	uint64_t snapshotSize; /*!< Size of the whole snapshot file */
+	uint64_t device;       /*!< Device of the bootstrap file */
+	uint64_t inode;	       /*!< Inode of the bootstrap file */
+	uint64_t size;	       /*!< Size of the bootstrap file */
+	uint64_t mtimeSec;     /*!< Modification time of the bootstrap file */
+	uint64_t mtimeNsec;    /*!< Nanoseconds of the modification time */
+	uint64_t pathSize;     /*!< Size of the path of the bootstrap file */
+	uint64_t keyCount;     /*!< Number of keys */
+} SnapshotHeader;
+
+typedef struct
+{
+	uint64_t nameSize;  /*!< Size of the name with null terminator */
+	uint64_t valueSize; /*!< Size of the value, with null terminator for strings */
+	uint64_t metaCount; /*!< Number of metakeys following the key */
+	uint64_t binary;    /*!< 1 if the value is binary */
+} SnapshotEntry;
+
+typedef struct
+{
+	char * data;  /*!< The snapshot */
+	size_t size;  /*!< Used size */
+	size_t alloc; /*!< Allocated size */
+} SnapshotBuffer;
+
+/**
+ * @internal
+ *
+ * @brief Returns the path of the snapshot file for a bootstrap file.
+ *
+ * There is no snapshot for processes running with changed user or group
+ * ids, as the snapshot file is found via HOME.
+ *
+ * @param bootstrapFile the bootstrap file as resolved by the current process
+ *
+ * @return the path, to be freed with elektraFree()
+ * @retval NULL if there is no snapshot file
+ */
+char * elektraSnapshotFile (const char * bootstrapFile)
+{
+	if (!bootstrapFile || bootstrapFile[0] != '/') return 0;
+	if (getuid () != geteuid () || getgid () != getegid ()) return 0;
+	const char * home = getenv ("HOME");
+	if (!home || home[0] != '/') return 0;
+
+	// FNV-1a, collisions are detected by the path in the header
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char * c = bootstrapFile; *c; ++c)
+	{
+		hash = (hash ^ (unsigned char) *c) * 1099511628211ULL;
+	}
+	return elektraFormat ("%s%s/bootstrap-%016llx.snapshot", home, SNAPSHOT_DIR, (unsigned long long) hash);
+}
+
+static void elektraSnapshotFill (SnapshotHeader * header, const struct stat * buf)
+{
+	header->device = buf->st_dev;
+	header->inode = buf->st_ino;
+	header->size = buf->st_size;
+	header->mtimeSec = buf->st_mtim.tv_sec;
+	header->mtimeNsec = buf->st_mtim.tv_nsec;
+}
+
+/**
+ * @internal
+ *
+ * @brief Reads the keys of a snapshot.
+ *
+ * @param snapshotFile the snapshot file
+ * @param bootstrapFile the bootstrap file as resolved by the current process
+ * @param keys the keyset to append the keys to, unchanged if the snapshot is not used
+ *
+ * @retval 1 if the keys were read
+ * @retval 0 if there is no snapshot
+ * @retval -1 if the snapshot is invalid, outdated or of another bootstrap file
+ */
+int elektraSnapshotRead (const char * snapshotFile, const char * bootstrapFile, KeySet * keys)
+{
+	int fd = open (snapshotFile, O_RDONLY);
+	if (fd == -1) return 0;
+
+	struct stat buf;
+	if (fstat (fd, &buf) == -1 || buf.st_uid != geteuid () || (size_t) buf.st_size < sizeof (SnapshotHeader))
+	{
+		close (fd);
+		return -1;
+	}
+
+	size_t mappedSize = buf.st_size;
+	char * mapped = mmap (0, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (mapped == MAP_FAILED) return -1;
+
+	const SnapshotHeader * header = (const SnapshotHeader *) mapped;
+	const char * path = mapped + sizeof (SnapshotHeader);
+	size_t pathSize = strlen (bootstrapFile) + 1;
+	if (memcmp (header->magic, SNAPSHOT_MAGIC, sizeof (header->magic)) || header->version != SNAPSHOT_VERSION ||
+	    header->headerSize != sizeof (SnapshotHeader) || header->snapshotSize != mappedSize ||
+	    header->keyCount > mappedSize / sizeof (SnapshotEntry) || header->pathSize != pathSize ||
+	    SNAPSHOT_ALIGN (pathSize) > mappedSize - sizeof (SnapshotHeader) || memcmp (path, bootstrapFile, pathSize))
+	{
+		munmap (mapped, mappedSize);
+		return -1;
+	}
+
+	SnapshotHeader current = *header;
+	if (stat (bootstrapFile, &buf) == -1)
+	{
+		munmap (mapped, mappedSize);
+		return -1;
+	}
+	elektraSnapshotFill (&current, &buf);
+	if (memcmp (&current, header, sizeof (SnapshotHeader)))
+	{
+		// the bootstrap file was modified
+		munmap (mapped, mappedSize);
+		return -1;
+	}
+
+	size_t keyCount = header->keyCount;
+	KeySet * read = ksNew (keyCount, KS_END);
+	Key * root = keyNew (KDB_SYSTEM_ELEKTRA, KEY_END);
+	const char * end = mapped + mappedSize;
+	const char * cur = path + SNAPSHOT_ALIGN (header->pathSize);
+	Key * key = 0;
+	uint64_t metaLeft = 0;
+	uint64_t keysLeft = keyCount;
+	while (keysLeft > 0 || metaLeft > 0)
+	{
+		if ((size_t) (end - cur) < sizeof (SnapshotEntry)) break;
+		const SnapshotEntry * entry = (const SnapshotEntry *) cur;
+		const char * name = cur + sizeof (SnapshotEntry);
+		if (entry->nameSize == 0 || SNAPSHOT_ALIGN (entry->nameSize) > (size_t) (end - name) || name[entry->nameSize - 1] != '\0' ||
+		    strlen (name) + 1 != entry->nameSize)
+			break;
+		const char * value = name + SNAPSHOT_ALIGN (entry->nameSize);
+		if (SNAPSHOT_ALIGN (entry->valueSize) > (size_t) (end - value)) break;
+		if (!entry->binary && (entry->valueSize == 0 || value[entry->valueSize - 1] != '\0')) break;
+		cur = value + SNAPSHOT_ALIGN (entry->valueSize);
+
+		if (metaLeft > 0)
+		{
+			if (entry->binary || keySetMeta (key, name, value) == -1 || !keyGetMeta (key, name)) break;
+			--metaLeft;
+			continue;
+		}
+
+		key = keyNew (name, KEY_END);
+		if (!key) break;
+		if (!keyIsBelowOrSame (root, key) || entry->binary > 1)
+		{
+			keyDel (key);
+			break;
+		}
+		if (entry->binary)
+			keySetBinary (key, entry->valueSize ? value : 0, entry->valueSize);
+		else
+			keySetString (key, value);
+		ksAppendKey (read, key);
+		metaLeft = entry->metaCount;
+		--keysLeft;
+	}
+
+	munmap (mapped, mappedSize);
+	keyDel (root);
+	if (keysLeft > 0 || metaLeft > 0 || ksGetSize (read) != (ssize_t) keyCount)
+	{
+		ksDel (read);
+		return -1;
+	}
+
+	ksAppend (keys, read);
+	ksDel (read);
+	return 1;
+}
+
+/**
+ * @internal
+ *
+ * @brief Removes an outdated snapshot.
+ */
+void elektraSnapshotRemove (const char * snapshotFile)
+{
+	unlink (snapshotFile);
+}
+
+/**
+ * Appends @p size bytes of @p data, padded to 8 bytes if @p align is set.
+ */
+static int elektraSnapshotAppend (SnapshotBuffer * buffer, const void * data, size_t size, int align)
+{
+	size_t aligned = align ? SNAPSHOT_ALIGN (buffer->size + size) - buffer->size : size;
+	if (buffer->size + aligned > buffer->alloc)
+	{
+		size_t alloc = buffer->alloc ? buffer->alloc : 4096;
+		while (alloc < buffer->size + aligned)
+		{
+			alloc *= 2;
+		}
+		if (elektraRealloc ((void **) &buffer->data, alloc) < 0) return -1;
+		buffer->alloc = alloc;
+	}
+	if (size) memcpy (buffer->data + buffer->size, data, size);
+	memset (buffer->data + buffer->size + size, 0, aligned - size);
+	buffer->size += aligned;
+	return 0;
+}
+
+static int elektraSnapshotAppendEntry (SnapshotBuffer * buffer, const Key * key, size_t metaCount)
+{
+	SnapshotEntry entry = { .nameSize = keyGetNameSize (key),
+				.valueSize = keyGetValueSize (key),
+				.metaCount = metaCount == (size_t) -1 ? 0 : metaCount,
+				.binary = keyIsBinary (key) == 1 };
+	if (elektraSnapshotAppend (buffer, &entry, sizeof (SnapshotEntry), 1) < 0) return -1;
+	if (elektraSnapshotAppend (buffer, keyName (key), entry.nameSize, 1) < 0) return -1;
+	return elektraSnapshotAppend (buffer, keyValue (key), entry.valueSize, 1);
+}
+
+static int elektraSnapshotMkdir (const char * home)
+{
+	char * dir = elektraFormat ("%s/.cache", home);
+	int ret = mkdir (dir, KDB_FILE_MODE | KDB_DIR_MODE) == -1 && errno != EEXIST ? -1 : 0;
+	elektraFree (dir);
+	if (ret == -1) return -1;
+
+	dir = elektraFormat ("%s%s", home, SNAPSHOT_DIR);
+	ret = mkdir (dir, KDB_FILE_MODE | KDB_DIR_MODE) == -1 && errno != EEXIST ? -1 : 0;
+	elektraFree (dir);
+	return ret;
+}
+
+/**
+ * @internal
+ *
+ * @brief Writes a snapshot of the bootstrap keys.
+ *
+ * The snapshot is written to a temporary file and renamed, so that other
+ * processes only read complete snapshots.
+ *
+ * @param snapshotFile the snapshot file
+ * @param bootstrapFile the file the keys were read from
+ * @param keys the keys to write
+ *
+ * @retval 0 on success
+ * @retval -1 if the snapshot could not be written
+ */
+int elektraSnapshotWrite (const char * snapshotFile, const char * bootstrapFile, KeySet * keys)
+{
+	struct stat buf;
+	if (!bootstrapFile || bootstrapFile[0] != '/' || stat (bootstrapFile, &buf) == -1) return -1;
+
+	SnapshotHeader header;
+	memset (&header, 0, sizeof (SnapshotHeader));
+	memcpy (header.magic, SNAPSHOT_MAGIC, sizeof (header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.headerSize = sizeof (SnapshotHeader);
+	header.pathSize = strlen (bootstrapFile) + 1;
+	header.keyCount = ksGetSize (keys);
+	elektraSnapshotFill (&header, &buf);
+
+	SnapshotBuffer buffer = { 0, 0, 0 };
+	int ret = elektraSnapshotAppend (&buffer, &header, sizeof (SnapshotHeader), 1);
+	if (ret == 0) ret = elektraSnapshotAppend (&buffer, bootstrapFile, header.pathSize, 1);
+
+	for (cursor_t it = 0; ret == 0 && it < ksGetSize (keys); ++it)
+	{
+		Key * key = ksAtCursor (keys, it);
+		const Key * meta;
+		size_t metaCount = 0;
+		keyRewindMeta (key);
+		while (keyNextMeta (key))
+		{
+			++metaCount;
+		}
+
+		ret = elektraSnapshotAppendEntry (&buffer, key, metaCount);
+		keyRewindMeta (key);
+		while (ret == 0 && (meta = keyNextMeta (key)) != 0)
+		{
+			// metakeys get their name with keySetMeta()
+			ret = elektraSnapshotAppendEntry (&buffer, meta, (size_t) -1);
+		}
+	}
+
+	if (ret == 0)
+	{
+		((SnapshotHeader *) buffer.data)->snapshotSize = buffer.size;
+
+		const char * home = getenv ("HOME");
+		char * tmpFile = elektraFormat ("%s.XXXXXX", snapshotFile);
+		int fd = mkstemp (tmpFile);
+		if (fd == -1 && home && elektraSnapshotMkdir (home) == 0)
+		{
+			strcpy (tmpFile + strlen (snapshotFile), ".XXXXXX");
+			fd = mkstemp (tmpFile);
+		}
+
+		ret = -1;
+		if (fd != -1)
+		{
+			int written = write (fd, buffer.data, buffer.size) == (ssize_t) buffer.size;
+			if (close (fd) == 0 && written) ret = rename (tmpFile, snapshotFile);
+			if (ret == -1) unlink (tmpFile);
+		}
+		elektraFree (tmpFile);
+	}
+
+	elektraFree (buffer.data);
+	return ret;
+}
+
+#else
+
+char * elektraSnapshotFile (const char * bootstrapFile ELEKTRA_UNUSED)
+{
+	return 0;
+}
+
+int elektraSnapshotRead (const char * snapshotFile ELEKTRA_UNUSED, const char * bootstrapFile ELEKTRA_UNUSED, KeySet * keys ELEKTRA_UNUSED)
+{
+	return 0;
+}
+
+void elektraSnapshotRemove (const char * snapshotFile ELEKTRA_UNUSED)
+{
+}
+
+int elektraSnapshotWrite (const char * snapshotFile ELEKTRA_UNUSED, const char * bootstrapFile ELEKTRA_UNUSED,
+			  KeySet * keys ELEKTRA_UNUSED)
+{
+	return -1;
+}
+
+#endif
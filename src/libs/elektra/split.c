@@ -352,6 +352,109 @@ int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
 }
 
 
+/**
+ * @internal
+ *
+ * A range of keys of a KeySet that belong to the same backend.
+ */
+typedef struct
+{
+	size_t start;	   /*!< The first key of the range */
+	size_t end;	   /*!< The key after the last key of the range */
+	Backend * backend; /*!< The backend of all keys, NULL if it must be looked up for every key */
+} SplitRange;
+
+static int splitCmpMountpoint (const void * p1, const void * p2)
+{
+	return keyCmp (*(const Key **) p1, *(const Key **) p2);
+}
+
+static void splitAddRange (SplitRange * ranges, size_t * count, size_t start, size_t end, Backend * backend)
+{
+	if (start >= end) return;
+	ranges[*count].start = start;
+	ranges[*count].end = end;
+	ranges[*count].backend = backend;
+	++*count;
+}
+
+/**
+ * @internal
+ *
+ * Partitions a KeySet by the mountpoints of the handle.
+ *
+ * The keys below a mountpoint are adjacent in the KeySet, so their range
+ * is found with two binary searches, see elektraKsFindHierarchy(). Keys
+ * below a mountpoint but not below a deeper one belong to the backend of
+ * the mountpoint, so the backend only needs to be looked up once per
+ * mountpoint instead of once per key. This makes the partition
+ * O(m log n) for m mountpoints and n keys.
+ *
+ * Keys not below any mountpoint (e.g. cascading keys) get ranges without
+ * backend, the backend of each of them must be looked up with mountGetBackend().
+ *
+ * @param handle the handle with the mountpoints
+ * @param ks the KeySet to partition
+ * @param [out] ranges set to the ranges in the order of the KeySet, free with elektraFree()
+ *
+ * @return the number of ranges
+ * @retval -1 on memory error, @p ranges is not changed then
+ */
+static ssize_t splitPartition (KDB * handle, KeySet * ks, SplitRange ** ranges)
+{
+	const size_t mountpoints = handle->split->size;
+	const Key ** sorted = elektraMalloc (mountpoints * sizeof (Key *));
+	SplitRange * stack = elektraMalloc (mountpoints * sizeof (SplitRange));
+	SplitRange * result = elektraMalloc ((2 * mountpoints + 1) * sizeof (SplitRange));
+	if (!sorted || !stack || !result)
+	{
+		elektraFree (sorted);
+		elektraFree (stack);
+		elektraFree (result);
+		return -1;
+	}
+
+	// in the order of the KeySet a mountpoint comes before the ones below it
+	memcpy (sorted, handle->split->parents, mountpoints * sizeof (Key *));
+	qsort (sorted, mountpoints, sizeof (Key *), splitCmpMountpoint);
+
+	size_t count = 0;
+	size_t depth = 0;
+	size_t pos = 0;
+	for (size_t m = 0; m < mountpoints; ++m)
+	{
+		ssize_t end;
+		ssize_t start = elektraKsFindHierarchy (ks, sorted[m], &end);
+		if (start < 0 || start == end) continue;
+
+		// finish the mountpoints this one is not below
+		while (depth > 0 && stack[depth - 1].end <= (size_t) start)
+		{
+			--depth;
+			splitAddRange (result, &count, pos, stack[depth].end, stack[depth].backend);
+			if (stack[depth].end > pos) pos = stack[depth].end;
+		}
+		splitAddRange (result, &count, pos, start, depth > 0 ? stack[depth - 1].backend : 0);
+
+		pos = start;
+		stack[depth].end = end;
+		stack[depth].backend = mountGetBackend (handle, sorted[m]);
+		++depth;
+	}
+	while (depth > 0)
+	{
+		--depth;
+		splitAddRange (result, &count, pos, stack[depth].end, stack[depth].backend);
+		if (stack[depth].end > pos) pos = stack[depth].end;
+	}
+	splitAddRange (result, &count, pos, ks->size, 0);
+
+	elektraFree (sorted);
+	elektraFree (stack);
+	*ranges = result;
+	return count;
+}
+
 /**
  * Splits up the keysets and search for a sync bit in every key.
  *
@@ -375,33 +478,51 @@ int splitBuildup (Split * split, KDB * kdb, Key * parentKey)
 int splitDivide (Split * split, KDB * handle, KeySet * ks)
 {
 	int needsSync = 0;
-	Key * curKey = 0;
+	SplitRange whole = { 0, ks->size, 0 };
+	SplitRange * ranges = &whole;
+	ssize_t count = splitPartition (handle, ks, &ranges);
+	if (count == -1) count = 1; // look up the backend of every key
 
-	ksRewind (ks);
-	while ((curKey = ksNext (ks)) != 0)
+	for (ssize_t r = 0; r < count; ++r)
 	{
-		// TODO: handle keys in wrong namespaces
-		Backend * curHandle = mountGetBackend (handle, curKey);
-		if (!curHandle) return -1;
+		ssize_t curFound = -1;
+		for (size_t i = ranges[r].start; i < ranges[r].end; ++i)
+		{
+			Key * curKey = ks->array[i];
+			// all keys of a range with backend are in the same split entry
+			if (!ranges[r].backend || i == ranges[r].start)
+			{
+				// TODO: handle keys in wrong namespaces
+				Backend * curHandle = ranges[r].backend ? ranges[r].backend : mountGetBackend (handle, curKey);
+				if (!curHandle)
+				{
+					ksSetCursor (ks, i);
+					if (ranges != &whole) elektraFree (ranges);
+					return -1;
+				}
 
-		/* If key could be appended to any of the existing split keysets */
-		ssize_t curFound = splitSearchBackend (split, curHandle, curKey);
+				/* If key could be appended to any of the existing split keysets */
+				curFound = splitSearchBackend (split, curHandle, curKey);
+			}
 
-		if (curFound == -1)
-		{
-			ELEKTRA_LOG_DEBUG ("SKIPPING NOT RELEVANT KEY: %p key: %s, string: %s", (void *) curKey, keyName (curKey),
-					   keyString (curKey));
-			continue; // key not relevant in this kdbSet
-		}
+			if (curFound == -1)
+			{
+				ELEKTRA_LOG_DEBUG ("SKIPPING NOT RELEVANT KEY: %p key: %s, string: %s", (void *) curKey, keyName (curKey),
+						   keyString (curKey));
+				continue; // key not relevant in this kdbSet
+			}
 
-		ksAppendKey (split->keysets[curFound], curKey);
-		if (keyNeedSync (curKey) == 1)
-		{
-			split->syncbits[curFound] |= 1;
-			needsSync = 1;
+			ksAppendKey (split->keysets[curFound], curKey);
+			if (keyNeedSync (curKey) == 1)
+			{
+				split->syncbits[curFound] |= 1;
+				needsSync = 1;
+			}
 		}
 	}
 
+	if (ranges != &whole) elektraFree (ranges);
+	ksRewind (ks);
 	return needsSync;
 }
 
@@ -442,31 +563,106 @@ void splitUpdateFileName (Split * split, KDB * handle, Key * key)
  */
 int splitAppoint (Split * split, KDB * handle, KeySet * ks)
 {
-	Key * curKey = 0;
 	ssize_t defFound = splitAppend (split, 0, 0, 0);
+	SplitRange whole = { 0, ks->size, 0 };
+	SplitRange * ranges = &whole;
+	ssize_t count = splitPartition (handle, ks, &ranges);
+	if (count == -1) count = 1; // look up the backend of every key
 
-	ksRewind (ks);
-	while ((curKey = ksNext (ks)) != 0)
+	for (ssize_t r = 0; r < count; ++r)
 	{
-		Backend * curHandle = mountGetBackend (handle, curKey);
-		if (!curHandle) return -1;
+		ssize_t curFound = -1;
+		for (size_t i = ranges[r].start; i < ranges[r].end; ++i)
+		{
+			Key * curKey = ks->array[i];
+			// all keys of a range with backend are in the same split entry
+			if (!ranges[r].backend || i == ranges[r].start)
+			{
+				Backend * curHandle = ranges[r].backend ? ranges[r].backend : mountGetBackend (handle, curKey);
+				if (!curHandle)
+				{
+					ksSetCursor (ks, i);
+					if (ranges != &whole) elektraFree (ranges);
+					return -1;
+				}
 
-		/* If key could be appended to any of the existing split keysets */
-		ssize_t curFound = splitSearchBackend (split, curHandle, curKey);
+				/* If key could be appended to any of the existing split keysets */
+				curFound = splitSearchBackend (split, curHandle, curKey);
 
-		if (curFound == -1) curFound = defFound;
+				if (curFound == -1) curFound = defFound;
+			}
 
-		if (split->syncbits[curFound] & SPLIT_FLAG_SYNC)
-		{
-			continue;
-		}
+			if (split->syncbits[curFound] & SPLIT_FLAG_SYNC)
+			{
+				continue;
+			}
 
-		ksAppendKey (split->keysets[curFound], curKey);
+			ksAppendKey (split->keysets[curFound], curKey);
+		}
 	}
 
+	if (ranges != &whole) elektraFree (ranges);
+	ksRewind (ks);
 	return 1;
 }
 
+/**
+ * Appoints the cached keys of the backends with a cache hit.
+ *
+ * Only the keys of split entries with SPLIT_FLAG_CACHE are appended,
+ * the other keys of @p cache are stale and ignored. The flagged entries
+ * got their keys from the cache and need no update anymore, so their
+ * SPLIT_FLAG_SYNC is removed.
+ *
+ * @pre splitAppoint() needs to be executed before, so that the
+ * entries with SPLIT_FLAG_CACHE did not get keys from the user.
+ *
+ * @param split the split object to work with
+ * @param handle to get information where the individual keys belong
+ * @param cache the keys of the cache
+ *
+ * @return the number of split entries which got their keys from the cache
+ * @ingroup split
+ */
+int splitCacheAppoint (Split * split, KDB * handle, KeySet * cache)
+{
+	SplitRange whole = { 0, cache->size, 0 };
+	SplitRange * ranges = &whole;
+	ssize_t count = splitPartition (handle, cache, &ranges);
+	if (count == -1) count = 1; // look up the backend of every key
+
+	for (ssize_t r = 0; r < count; ++r)
+	{
+		ssize_t curFound = -1;
+		for (size_t i = ranges[r].start; i < ranges[r].end; ++i)
+		{
+			Key * curKey = cache->array[i];
+			if (!ranges[r].backend || i == ranges[r].start)
+			{
+				Backend * curHandle = ranges[r].backend ? ranges[r].backend : mountGetBackend (handle, curKey);
+				curFound = curHandle ? splitSearchBackend (split, curHandle, curKey) : -1;
+			}
+
+			if (curFound == -1 || !test_bit (split->syncbits[curFound], SPLIT_FLAG_CACHE))
+			{
+				continue;
+			}
+
+			ksAppendKey (split->keysets[curFound], curKey);
+		}
+	}
+	if (ranges != &whole) elektraFree (ranges);
+
+	int appointed = 0;
+	for (size_t i = 0; i < split->size; ++i)
+	{
+		if (!test_bit (split->syncbits[i], SPLIT_FLAG_CACHE)) continue;
+		clear_bit (split->syncbits[i], (splitflag_t) (SPLIT_FLAG_SYNC | SPLIT_FLAG_CACHE));
+		++appointed;
+	}
+	return appointed;
+}
+
 static void elektraDropCurrentKey (KeySet * ks, Key * warningKey, const Backend * curHandle, const Backend * otherHandle, const char * msg)
 {
 	const Key * k = ksCurrent (ks);
@@ -948,6 +1144,49 @@ void splitCacheStoreState (KDB * handle, Split * split, KeySet * global, Key * p
 	}
 }
 
+/**
+ * @brief The file of a split entry stored by splitCacheStoreState()
+ *
+ * Allows to know the file before the resolver of the backend ran.
+ *
+ * @param split the split
+ * @param i the split entry
+ * @param global the global keyset with the cache metadata
+ *
+ * @return the file, valid as long as the cache metadata in global
+ * @retval 0 if the split entry is not in the cache metadata
+ */
+const char * splitCacheFileName (Split * split, size_t i, KeySet * global)
+{
+	char * name = 0;
+	if (strlen (keyName (split->handles[i]->mountpoint)) != 0)
+	{
+		name = elektraStrConcat (KDB_CACHE_PREFIX "/splitState/mountpoint/", keyName (split->handles[i]->mountpoint));
+	}
+	else
+	{
+		name = elektraStrConcat (KDB_CACHE_PREFIX "/splitState/", "default/");
+	}
+	// Append parent name for uniqueness (spec, dir, user, system, ...)
+	char * tmp = name;
+	name = elektraStrConcat (name, keyName (split->parents[i]));
+	elektraFree (tmp);
+	Key * key = keyNew (name, KEY_END);
+	elektraFree (name);
+
+	keyAddBaseName (key, "splitParentName");
+	Key * found = ksLookup (global, key, KDB_O_NONE);
+	if (!found || elektraStrCmp (keyString (found), keyName (split->parents[i])) != 0)
+	{
+		keyDel (key);
+		return 0;
+	}
+
+	keySetBaseName (key, "splitParentValue");
+	found = ksLookup (global, key, KDB_O_DEL);
+	return found ? keyString (found) : 0;
+}
+
 int splitCacheCheckState (Split * split, KeySet * global)
 {
 	ELEKTRA_LOG_DEBUG ("SIZE STORAGE CHCK");
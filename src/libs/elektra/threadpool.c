@@ -0,0 +1,215 @@
+/**
+ * @file
+ *
+ * @brief Pool of worker threads.
+ *
+ * The pool runs batches of independent tasks, e.g. the storage reads of
+ * the backends in kdbGet(). The thread calling elektraThreadPoolRun()
+ * works on the batch too and returns once every task of it is done.
+ * Without pthreads the tasks simply run one after another.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#ifdef HAVE_KDBCONFIG_H
+#include "kdbconfig.h"
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <kdbprivate.h>
+
+struct _ElektraThreadPool
+{
+#ifdef HAVE_PTHREAD
+	pthread_t * threads;   /*!< The worker threads */
+	pthread_mutex_t mutex; /*!< Protects all fields below */
+	pthread_cond_t work;   /*!< Signaled when a batch starts or the pool stops */
+	pthread_cond_t done;   /*!< Signaled when the last task of a batch is done */
+#endif
+	size_t size; /*!< Number of worker threads */
+
+	ElektraThreadPoolTask task; /*!< The function of the current batch */
+	char * data;		    /*!< The array of arguments of the current batch */
+	size_t elementSize;	    /*!< The size of one argument */
+	size_t count;		    /*!< Number of tasks of the current batch */
+	size_t next;		    /*!< The next task to start */
+	size_t running;		    /*!< Number of started but unfinished tasks */
+	int stop;		    /*!< Set to stop the worker threads */
+};
+
+#ifdef HAVE_PTHREAD
+/**
+ * @internal
+ *
+ * @brief Runs tasks of the current batch until all are started.
+ *
+ * Must be called with the mutex locked, returns with the mutex locked.
+ */
+static void elektraThreadPoolWork (ElektraThreadPool * pool)
+{
+	while (pool->next < pool->count)
+	{
+		char * argument = pool->data + pool->next * pool->elementSize;
+		++pool->next;
+		++pool->running;
+		pthread_mutex_unlock (&pool->mutex);
+
+		pool->task (argument);
+
+		pthread_mutex_lock (&pool->mutex);
+		--pool->running;
+		if (pool->next >= pool->count && pool->running == 0)
+		{
+			pthread_cond_signal (&pool->done);
+		}
+	}
+}
+
+static void * elektraThreadPoolWorker (void * data)
+{
+	ElektraThreadPool * pool = data;
+	pthread_mutex_lock (&pool->mutex);
+	while (!pool->stop)
+	{
+		elektraThreadPoolWork (pool);
+		if (!pool->stop) pthread_cond_wait (&pool->work, &pool->mutex);
+	}
+	pthread_mutex_unlock (&pool->mutex);
+	return 0;
+}
+#endif
+
+/**
+ * @internal
+ *
+ * @brief Creates a pool of worker threads.
+ *
+ * If not all threads can be started, the pool uses the ones started.
+ * Without pthreads the pool has no threads.
+ *
+ * @param threads the number of worker threads
+ *
+ * @return the new pool
+ * @retval NULL on memory error
+ */
+ElektraThreadPool * elektraThreadPoolNew (size_t threads)
+{
+	ElektraThreadPool * pool = elektraCalloc (sizeof (ElektraThreadPool));
+	if (!pool) return 0;
+
+#ifdef HAVE_PTHREAD
+	if (threads == 0) return pool;
+
+	pool->threads = elektraMalloc (threads * sizeof (pthread_t));
+	if (!pool->threads)
+	{
+		elektraFree (pool);
+		return 0;
+	}
+	pthread_mutex_init (&pool->mutex, 0);
+	pthread_cond_init (&pool->work, 0);
+	pthread_cond_init (&pool->done, 0);
+
+	for (; pool->size < threads; ++pool->size)
+	{
+		if (pthread_create (&pool->threads[pool->size], 0, elektraThreadPoolWorker, pool) != 0) break;
+	}
+#else
+	(void) threads;
+#endif
+	return pool;
+}
+
+/**
+ * @internal
+ *
+ * @brief Stops the worker threads and deletes the pool.
+ *
+ * @param pool the pool to delete, must not run a batch
+ */
+void elektraThreadPoolDel (ElektraThreadPool * pool)
+{
+	if (!pool) return;
+
+#ifdef HAVE_PTHREAD
+	if (pool->threads)
+	{
+		pthread_mutex_lock (&pool->mutex);
+		pool->stop = 1;
+		pthread_cond_broadcast (&pool->work);
+		pthread_mutex_unlock (&pool->mutex);
+
+		for (size_t i = 0; i < pool->size; ++i)
+		{
+			pthread_join (pool->threads[i], 0);
+		}
+
+		pthread_cond_destroy (&pool->done);
+		pthread_cond_destroy (&pool->work);
+		pthread_mutex_destroy (&pool->mutex);
+		elektraFree (pool->threads);
+	}
+#endif
+	elektraFree (pool);
+}
+
+/**
+ * @internal
+ *
+ * @brief Returns the number of worker threads of a pool.
+ */
+size_t elektraThreadPoolSize (const ElektraThreadPool * pool)
+{
+	return pool ? pool->size : 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Runs a batch of tasks on the pool.
+ *
+ * Calls @p task for every element of @p data, concurrently on the worker
+ * threads and the calling thread. Returns once all calls returned.
+ * Only one thread at a time may run a batch on a pool.
+ *
+ * @param pool the pool, NULL to run all tasks in the calling thread
+ * @param task the function to call
+ * @param data the array of arguments for @p task
+ * @param count the number of elements of @p data
+ * @param elementSize the size of an element of @p data
+ */
+void elektraThreadPoolRun (ElektraThreadPool * pool, ElektraThreadPoolTask task, void * data, size_t count, size_t elementSize)
+{
+	if (!pool || pool->size == 0 || count < 2)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			task ((char *) data + i * elementSize);
+		}
+		return;
+	}
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock (&pool->mutex);
+	pool->task = task;
+	pool->data = data;
+	pool->elementSize = elementSize;
+	pool->count = count;
+	pool->next = 0;
+	pool->running = 0;
+	pthread_cond_broadcast (&pool->work);
+
+	elektraThreadPoolWork (pool);
+	while (pool->running > 0)
+	{
+		pthread_cond_wait (&pool->done, &pool->mutex);
+	}
+
+	pool->count = 0;
+	pool->next = 0;
+	pthread_mutex_unlock (&pool->mutex);
+#endif
+}
@@ -3,6 +3,13 @@
  *
  * @brief Interna of trie functionality.
  *
+ * The trie is a radix tree over the unescaped names of the mountpoints.
+ * An edge is labeled with one or more complete parts of a name, so
+ * lookups compare whole parts with memcmp() and never match in the middle
+ * of a part. All nodes of a trie are stored in one array and all labels in
+ * one buffer, nodes refer to their children by index. The children of a
+ * node are sorted, so they are found by binary search.
+ *
  * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
  */
 
@@ -10,14 +17,6 @@
 #include "kdbconfig.h"
 #endif
 
-#if VERBOSE && defined(HAVE_STDIO_H)
-#include <stdio.h>
-#endif
-
-#ifdef HAVE_LOCALE_H
-#include <locale.h>
-#endif
-
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
@@ -26,14 +25,13 @@
 #include <string.h>
 #endif
 
-#ifdef HAVE_STDIO_H
-#include <stdio.h>
-#endif
-
 #include "kdbinternal.h"
 
-static char * elektraTrieStartsWith (const char * str, const char * substr);
-static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
+static uint64_t elektraTriePrefix (const char * part);
+static size_t elektraTrieFindChild (const Trie * trie, const TrieNode * node, const char * name, int * found);
+static size_t elektraTrieCommonPrefix (const char * label, size_t labelSize, const char * name, size_t nameSize);
+static size_t elektraTrieAddNode (Trie * trie, const char * label, size_t labelSize);
+static int elektraTrieAddChild (Trie * trie, size_t node, size_t pos, size_t child);
 
 /**
  * @brief The Trie structure
@@ -50,21 +48,31 @@ static Backend * elektraTriePrefixLookup (Trie * trie, const char * name);
  */
 Backend * trieLookup (Trie * trie, const Key * key)
 {
-	char * where = 0;
-	Backend * ret = 0;
-	size_t len = 0;
-
 	if (!key) return 0;
 	if (!trie) return 0;
 
-	len = keyGetNameSize (key) + 1;
-	if (len <= 1) return 0; // would crash otherwise
-	where = elektraMalloc (len);
-	strncpy (where, keyName (key), len);
-	where[len - 2] = '/';
+	const TrieNode * nodes = trie->nodes;
+	Backend * ret = nodes[0].value;
+	if (!key->key) return ret;
+
+	const char * name = key->key + key->keySize;
+	size_t nameSize = key->keyUSize;
+	size_t node = 0;
 
-	ret = elektraTriePrefixLookup (trie, where);
-	elektraFree (where);
+	while (nameSize > 0)
+	{
+		int found;
+		size_t pos = elektraTrieFindChild (trie, &nodes[node], name, &found);
+		if (!found) break;
+
+		const TrieNode * child = &nodes[nodes[node].children[pos].node];
+		if (child->textSize > nameSize || memcmp (trie->text + child->text, name, child->textSize)) break;
+
+		name += child->textSize;
+		nameSize -= child->textSize;
+		if (child->value) ret = child->value;
+		node = nodes[node].children[pos].node;
+	}
 
 	return ret;
 }
@@ -79,21 +87,14 @@ Backend * trieLookup (Trie * trie, const Key * key)
  */
 int trieClose (Trie * trie, Key * errorKey)
 {
-	size_t i;
 	if (trie == NULL) return 0;
-	for (i = 0; i < KDB_MAX_UCHAR; ++i)
-	{
-		if (trie->text[i] != NULL)
-		{
-			trieClose (trie->children[i], errorKey);
-			if (trie->value[i]) backendClose (trie->value[i], errorKey);
-			elektraFree (trie->text[i]);
-		}
-	}
-	if (trie->empty_value)
+	for (size_t i = 0; i < trie->size; ++i)
 	{
-		backendClose (trie->empty_value, errorKey);
+		if (trie->nodes[i].value) backendClose (trie->nodes[i].value, errorKey);
+		elektraFree (trie->nodes[i].children);
 	}
+	elektraFree (trie->nodes);
+	elektraFree (trie->text);
 	elektraFree (trie);
 	return 0;
 }
@@ -101,6 +102,8 @@ int trieClose (Trie * trie, Key * errorKey)
 /**
  * @brief Insert into trie
  *
+ * A backend already inserted with the same name is replaced.
+ *
  * @ingroup trie
  *
  * @param trie the trie to insert to (0 to create a new trie)
@@ -108,170 +111,224 @@ int trieClose (Trie * trie, Key * errorKey)
  * @param value the value to insert
  *
  * @retval trie on success
+ * @retval 0 if a new trie could not be allocated
  */
 Trie * trieInsert (Trie * trie, const char * name, Backend * value)
 {
-	unsigned char idx;
-
-	if (name == 0)
-	{
-		name = "";
-	}
-	idx = (unsigned char) name[0];
-
 	if (trie == NULL)
 	{
 		trie = elektraCalloc (sizeof (Trie));
-
-		if (!strcmp ("", name))
+		if (!trie) return 0;
+		elektraTrieAddNode (trie, 0, 0);
+		if (trie->size != 1)
 		{
-			trie->empty_value = value;
-			return trie;
+			elektraFree (trie);
+			return 0;
 		}
+	}
 
-		trie->textlen[idx] = strlen (name);
-
-		trie->text[idx] = elektraStrDup (name);
-
-		trie->value[idx] = value;
+	if (name == 0 || !strcmp ("", name))
+	{
+		trie->nodes[0].value = value;
 		return trie;
 	}
 
-	if (!strcmp ("", name))
+	Key * key = keyNew (name, KEY_CASCADING_NAME, KEY_END);
+	if (!key || !key->key)
 	{
-		trie->empty_value = value;
+		keyDel (key);
 		return trie;
 	}
 
-	if (trie->text[idx])
+	const char * rest = key->key + key->keySize;
+	size_t restSize = key->keyUSize;
+	size_t node = 0;
+
+	while (restSize > 0)
 	{
-		char * p;
-		/* there exists an entry with the same first character */
-		if ((p = elektraTrieStartsWith (name, trie->text[idx])) == 0)
+		int found;
+		size_t pos = elektraTrieFindChild (trie, &trie->nodes[node], rest, &found);
+
+		if (!found)
 		{
-			/* the name in the trie is part of the searched name --> continue search */
-			trie->children[idx] = trieInsert (trie->children[idx], name + trie->textlen[idx], value);
+			/* no label starts with the same part --> new leaf */
+			size_t leaf = elektraTrieAddNode (trie, rest, restSize);
+			if (!leaf || elektraTrieAddChild (trie, node, pos, leaf) < 0) break;
+			node = leaf;
+			restSize = 0;
+			break;
 		}
-		else
-		{
-			/* name in trie doesn't match name --> split trie */
-			char * newname;
-			Trie * child;
-			unsigned char idx2;
-
-			newname = elektraStrDup (p);
-			*p = 0; /* shorten the old name in the trie */
-			trie->textlen[idx] = strlen (trie->text[idx]);
-
-			child = trie->children[idx];
-
-			/* insert the name given as a parameter into the new trie entry */
-			trie->children[idx] = trieInsert (NULL, name + (p - trie->text[idx]), value);
 
-			/* insert the split try into the new trie entry */
+		size_t child = trie->nodes[node].children[pos].node;
+		size_t common = elektraTrieCommonPrefix (trie->text + trie->nodes[child].text, trie->nodes[child].textSize, rest, restSize);
 
-			idx2 = (unsigned char) newname[0];
-			trie->children[idx]->text[idx2] = newname;
-			trie->children[idx]->textlen[idx2] = strlen (newname);
-			trie->children[idx]->value[idx2] = trie->value[idx];
-			trie->children[idx]->children[idx2] = child;
-
-			trie->value[idx] = 0;
+		if (common < trie->nodes[child].textSize)
+		{
+			/* the label only partly matches --> split the edge, the lower part keeps the children */
+			size_t lower = elektraTrieAddNode (trie, 0, 0);
+			if (!lower) break;
+			TrieNode * upper = &trie->nodes[child];
+			TrieNode * moved = &trie->nodes[lower];
+			moved->text = upper->text + common;
+			moved->textSize = upper->textSize - common;
+			moved->children = upper->children;
+			moved->childCount = upper->childCount;
+			moved->value = upper->value;
+			upper->textSize = common;
+			upper->children = 0;
+			upper->childCount = 0;
+			upper->value = 0;
+			if (elektraTrieAddChild (trie, child, 0, lower) < 0)
+			{
+				upper = &trie->nodes[child];
+				moved = &trie->nodes[lower];
+				upper->textSize += moved->textSize;
+				upper->children = moved->children;
+				upper->childCount = moved->childCount;
+				upper->value = moved->value;
+				--trie->size;
+				break;
+			}
 		}
-	}
-	else
-	{
-		/* there doesn't exist an entry with the same first character */
-		trie->text[idx] = elektraStrDup (name);
-		trie->value[idx] = (void *) value;
-		trie->textlen[idx] = strlen (name);
+
+		rest += common;
+		restSize -= common;
+		node = child;
 	}
 
+	if (restSize == 0) trie->nodes[node].value = value;
+	keyDel (key);
 	return trie;
 }
 
-
-#if 0
-
-static Trie *delete_trie(Trie *trie, char *name, CloseMapper closemapper)
+/**
+ * Searches the child of @p node whose label starts with the first part of @p name.
+ *
+ * The children are sorted by the first part of their labels, which differs for all children.
+ *
+ * @param found set to 1 if there is such a child, to 0 otherwise
+ *
+ * @return the position of the child in the children of @p node,
+ * or the position where it would be inserted
+ */
+static size_t elektraTrieFindChild (const Trie * trie, const TrieNode * node, const char * name, int * found)
 {
-	Trie *tr;
-	unsigned char idx;
-	if (trie==NULL) {
-		return NULL;
-	}
-
-	idx=(unsigned char) name[0];
-
-	if (trie->text[idx]==NULL) {
-		return NULL;
-	}
-
-	if (elektraTrieStartsWith(name,trie->text[idx])==0) {
-
-		tr=delete_trie(trie->children[idx],name+trie->textlen[idx],closemapper);
-
-		if (tr==NULL) {
-			/* child trie has been deleted */
-			trie->children[idx]=NULL;
-			elektraFree (trie->text[idx]);
-			closemapper(trie->value[idx]);
-			trie->text[idx]=NULL;
+	uint64_t prefix = elektraTriePrefix (name);
+	size_t left = 0;
+	size_t right = node->childCount;
+	while (left < right)
+	{
+		size_t middle = left + (right - left) / 2;
+		const TrieEdge * edge = &node->children[middle];
+		int cmp = prefix < edge->prefix ? -1 : prefix > edge->prefix;
+		if (cmp == 0 && (prefix & 0xff) != 0)
+		{
+			/* the first 8 bytes are equal and the parts are longer */
+			cmp = strcmp (name + 8, trie->text + edge->text + 8);
 		}
-
-		return trie;
+		if (cmp == 0)
+		{
+			*found = 1;
+			return middle;
+		}
+		if (cmp < 0)
+			right = middle;
+		else
+			left = middle + 1;
 	}
-	return NULL;
+	*found = 0;
+	return left;
 }
 
-#endif
-
 /**
- * return NULL if string starts with substring, except for the terminating '\0',
- * otherwise return a pointer to the first mismatch in substr.
- *
- * Takes const char* arguments but return char* pointer to it.
- * (like e.g. strchr)
+ * @return the first 8 bytes of a part of a name as big-endian number,
+ * padded with zeros after its null terminator. Comparing these numbers
+ * gives the same order as strcmp().
  */
-static char * elektraTrieStartsWith (const char * str, const char * substr)
+static uint64_t elektraTriePrefix (const char * part)
 {
-	size_t i = 0;
-	size_t sublen = strlen (substr);
-
-	for (i = 0; i < sublen; i++)
+	uint64_t prefix = 0;
+	for (int i = 0; i < 8; ++i)
 	{
-		if (substr[i] != str[i]) return (char *) substr + i;
+		unsigned char c = (unsigned char) part[i];
+		prefix |= (uint64_t) c << (56 - 8 * i);
+		if (!c) break;
 	}
-	return 0;
+	return prefix;
 }
 
-static Backend * elektraTriePrefixLookup (Trie * trie, const char * name)
+/**
+ * @return the size of the longest common prefix of @p label and @p name
+ * that consists of complete parts of the names, including their null terminators.
+ */
+static size_t elektraTrieCommonPrefix (const char * label, size_t labelSize, const char * name, size_t nameSize)
 {
-	if (trie == NULL) return NULL;
-
-	unsigned char idx = (unsigned char) name[0];
-	const char * trieText = trie->text[idx];
-
-	if (trieText == NULL)
+	size_t common = 0;
+	while (common < labelSize && common < nameSize)
 	{
-		return trie->empty_value;
+		size_t part = strlen (label + common) + 1;
+		if (part > nameSize - common || memcmp (label + common, name + common, part)) break;
+		common += part;
 	}
+	return common;
+}
 
-	void * ret = NULL;
-	if (elektraTrieStartsWith (name, trieText) == 0)
-	{
-		ret = elektraTriePrefixLookup (trie->children[idx], name + trie->textlen[idx]);
-	}
-	else
+/**
+ * Appends a node without children and value to the node array.
+ *
+ * @param label the label to copy into the text buffer, 0 to leave the label empty
+ * @param labelSize the size of @p label
+ *
+ * @return the index of the new node
+ * @retval 0 on memory error (except for the root)
+ */
+static size_t elektraTrieAddNode (Trie * trie, const char * label, size_t labelSize)
+{
+	if (trie->size == trie->alloc)
 	{
-		return trie->empty_value;
+		size_t alloc = trie->alloc ? 2 * trie->alloc : APPROXIMATE_NR_OF_BACKENDS;
+		if (elektraRealloc ((void **) &trie->nodes, alloc * sizeof (TrieNode)) < 0) return 0;
+		trie->alloc = alloc;
 	}
 
-	if (ret == NULL && trie->value[idx] == NULL)
+	TrieNode * node = &trie->nodes[trie->size];
+	memset (node, 0, sizeof (TrieNode));
+
+	if (label)
 	{
-		return trie->empty_value;
+		if (trie->textSize + labelSize > trie->textAlloc)
+		{
+			size_t textAlloc = trie->textAlloc ? 2 * trie->textAlloc : 16 * APPROXIMATE_NR_OF_BACKENDS;
+			while (textAlloc < trie->textSize + labelSize)
+			{
+				textAlloc *= 2;
+			}
+			if (elektraRealloc ((void **) &trie->text, textAlloc) < 0) return 0;
+			trie->textAlloc = textAlloc;
+		}
+		memcpy (trie->text + trie->textSize, label, labelSize);
+		node->text = trie->textSize;
+		node->textSize = labelSize;
+		trie->textSize += labelSize;
 	}
-	if (ret == NULL) return trie->value[idx];
 
-	return ret;
+	return trie->size++;
+}
+
+/**
+ * Inserts @p child at position @p pos into the children of @p node.
+ *
+ * @retval 0 on success
+ * @retval -1 on memory error
+ */
+static int elektraTrieAddChild (Trie * trie, size_t node, size_t pos, size_t child)
+{
+	TrieNode * parent = &trie->nodes[node];
+	if (elektraRealloc ((void **) &parent->children, (parent->childCount + 1) * sizeof (TrieEdge)) < 0) return -1;
+	memmove (parent->children + pos + 1, parent->children + pos, (parent->childCount - pos) * sizeof (TrieEdge));
+	parent->children[pos].prefix = elektraTriePrefix (trie->text + trie->nodes[child].text);
+	parent->children[pos].text = trie->nodes[child].text;
+	parent->children[pos].node = child;
+	++parent->childCount;
+	return 0;
 }
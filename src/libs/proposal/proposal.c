@@ -63,9 +63,9 @@ ssize_t keySetStringF (Key * key, const char * format, ...)
 		return -1;
 	}
 
-	if (key->data.c && !test_bit (key->flags, KEY_FLAG_MMAP_DATA))
+	if (key->data.c)
 	{
-		elektraFree (key->data.c);
+		elektraKeyFreeData (key, key->data.c);
 	}
 
 	key->data.c = p;
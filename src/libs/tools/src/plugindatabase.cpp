@@ -147,6 +147,7 @@ const std::map<std::string, int> PluginDatabase::statusMap = {
    {"configurable",    50},
    {"final",           50},
    {"global",           1},
+   {"threadsafe",       0},
    {"readonly",         0},
    {"writeonly",        0},
    {"preview",        -50},
@@ -27,6 +27,7 @@
 #include <stdio.h>     // rename(), sprintf()
 #include <stdlib.h>    // nftw()
 #include <string.h>    // nftw()
+#include <sys/mman.h>  // mmap()
 #include <sys/stat.h>  // elektraMkdirParents
 #include <sys/time.h>  // gettimeofday()
 #include <sys/types.h> // elektraMkdirParents
@@ -36,6 +37,10 @@
 #define POSTFIX_SIZE 50
 #define MAX_FD_USED 32
 
+#define KDB_CACHE_SHM_DIRECTORY "/dev/shm"
+#define KDB_CACHE_GENERATION_FILE "generation"
+#define KDB_CACHE_GENERATION_KEY KDB_CACHE_PREFIX "/generation"
+
 typedef enum
 {
 	modeFile = 0,
@@ -50,8 +55,111 @@ struct _cacheHandle
 	Key * cachePath;
 	Plugin * resolver;
 	Plugin * cacheStorage;
+	uint64_t * generation; ///< shared by all processes using the segment, 0 if not in shared memory
 };
 
+/**
+ * @brief Use a directory in shared memory for the cache files
+ *
+ * All processes with the same segment name share the cache files and
+ * the generation counter. The name defaults to the user id.
+ *
+ * The directory is only used if it is a directory with mode 0700 owned
+ * by the effective user, so that no other user can read or replace the
+ * cache files, even if they created the directory before.
+ *
+ * @param ch the cache handle to set the cache path and generation of
+ * @param shm the configuration key `shm`, its value is the segment name
+ * @param errorKey to add warnings to
+ *
+ * @retval 0 on success
+ * @retval -1 if the cache cannot be in shared memory
+ */
+static int resolveSharedDirectory (CacheHandle * ch, Key * shm, Key * errorKey)
+{
+	const char * name = keyString (shm);
+	char * directory;
+	if (!*name)
+	{
+		directory = elektraFormat ("%s/elektra-%u", KDB_CACHE_SHM_DIRECTORY, (unsigned int) getuid ());
+	}
+	else if (strchr (name, '/') || !strcmp (name, ".") || !strcmp (name, ".."))
+	{
+		ELEKTRA_ADD_VALIDATION_SEMANTIC_WARNINGF (errorKey, "Invalid name of the shared memory cache: %s", name);
+		return -1;
+	}
+	else
+	{
+		directory = elektraFormat ("%s/elektra-%s", KDB_CACHE_SHM_DIRECTORY, name);
+	}
+
+	struct stat buf;
+	if ((mkdir (directory, S_IRWXU) == -1 && errno != EEXIST) || lstat (directory, &buf) == -1)
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (errorKey, "Could not create shared memory cache %s. Reason: %s", directory,
+					       strerror (errno));
+		elektraFree (directory);
+		return -1;
+	}
+
+	if (!S_ISDIR (buf.st_mode) || buf.st_uid != geteuid () || (buf.st_mode & (S_IRWXU | S_IRWXG | S_IRWXO)) != S_IRWXU)
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (errorKey,
+					       "Shared memory cache %s is not a directory with mode 0700 owned by user %u, using the cache "
+					       "in the home directory instead",
+					       directory, (unsigned int) geteuid ());
+		elektraFree (directory);
+		return -1;
+	}
+
+	char * generationFile = elektraFormat ("%s/" KDB_CACHE_GENERATION_FILE, directory);
+	int fd = open (generationFile, O_RDWR | O_CREAT | O_NOFOLLOW, KDB_FILE_MODE);
+	elektraFree (generationFile);
+	if (fd == -1 || fstat (fd, &buf) == -1)
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (errorKey, "Could not open generation of shared memory cache %s. Reason: %s", directory,
+					       strerror (errno));
+		if (fd != -1) close (fd);
+		elektraFree (directory);
+		return -1;
+	}
+
+	if (!S_ISREG (buf.st_mode) || buf.st_uid != geteuid ())
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (errorKey,
+					       "Generation of shared memory cache %s is not a file owned by user %u, using the cache "
+					       "in the home directory instead",
+					       directory, (unsigned int) geteuid ());
+		close (fd);
+		elektraFree (directory);
+		return -1;
+	}
+
+	if (buf.st_size < (off_t) sizeof (uint64_t) && ftruncate (fd, sizeof (uint64_t)) == -1)
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (errorKey, "Could not open generation of shared memory cache %s. Reason: %s", directory,
+					       strerror (errno));
+		close (fd);
+		elektraFree (directory);
+		return -1;
+	}
+
+	void * generation = mmap (0, sizeof (uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+	if (generation == MAP_FAILED)
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (errorKey, "Could not map generation of shared memory cache %s. Reason: %s", directory,
+					       strerror (errno));
+		elektraFree (directory);
+		return -1;
+	}
+
+	ch->generation = generation;
+	keySetString (ch->cachePath, directory);
+	elektraFree (directory);
+	return 0;
+}
+
 static int resolveCacheDirectory (Plugin * handle, CacheHandle * ch, Key * errorKey)
 {
 	KeySet * resolverConfig = ksNew (5, keyNew ("user/path", KEY_VALUE, "/.cache/elektra", KEY_END), KS_END);
@@ -74,12 +182,13 @@ static int resolveCacheDirectory (Plugin * handle, CacheHandle * ch, Key * error
 
 static int loadCacheStoragePlugin (Plugin * handle, CacheHandle * ch, Key * errorKey)
 {
-	KeySet * mmapstorageConfig = ksNew (0, KS_END);
+	KeySet * mmapstorageConfig = ksNew (1, keyNew ("user/globalcache", KEY_END), KS_END);
 	ch->cacheStorage = elektraPluginOpen (KDB_CACHE_STORAGE, ch->modules, mmapstorageConfig, ch->cachePath);
 	if (!ch->cacheStorage)
 	{
 		ELEKTRA_ADD_PLUGIN_MISBEHAVIOR_WARNINGF (errorKey, "Open of plugin returned unsuccessfully: %s", KDB_CACHE_STORAGE);
-		elektraPluginClose (ch->resolver, 0);
+		if (ch->resolver) elektraPluginClose (ch->resolver, 0);
+		if (ch->generation) munmap (ch->generation, sizeof (uint64_t));
 		elektraModulesClose (ch->modules, 0);
 		ksDel (ch->modules);
 		keyDel (ch->cachePath);
@@ -223,14 +332,24 @@ static char * kdbCacheFileName (CacheHandle * ch, Key * parentKey, PathMode mode
 	return cacheFileName;
 }
 
-static int unlinkCacheFiles (const char * fpath, const struct stat * sb ELEKTRA_UNUSED, int tflag ELEKTRA_UNUSED,
-			     struct FTW * ftwbuf ELEKTRA_UNUSED)
+static int unlinkCacheFiles (const char * fpath, const struct stat * sb ELEKTRA_UNUSED, int tflag ELEKTRA_UNUSED, struct FTW * ftwbuf)
 {
+	// other processes keep using the generation of a shared memory cache
+	if (ftwbuf->level == 1 && !strcmp (fpath + ftwbuf->base, KDB_CACHE_GENERATION_FILE)) return 0;
+
 	ELEKTRA_LOG_DEBUG ("UNLINKING cache file: %s", fpath);
 	remove (fpath);
 	return 0;
 }
 
+static uint64_t cacheGeneration (KeySet * global)
+{
+	uint64_t generation = UINT64_MAX;
+	Key * key = global ? ksLookupByName (global, KDB_CACHE_GENERATION_KEY, 0) : 0;
+	if (key && keyGetValueSize (key) == sizeof (uint64_t)) keyGetBinary (key, &generation, sizeof (uint64_t));
+	return generation;
+}
+
 int elektraCacheOpen (Plugin * handle, Key * errorKey)
 {
 	// plugin initialization logic
@@ -241,8 +360,14 @@ int elektraCacheOpen (Plugin * handle, Key * errorKey)
 	ch->modules = ksNew (0, KS_END);
 	elektraModulesInit (ch->modules, 0);
 	ch->cachePath = keyNew ("user/elektracache", KEY_END);
+	ch->resolver = 0;
+	ch->generation = 0;
 
-	if (resolveCacheDirectory (handle, ch, errorKey) == -1) return ELEKTRA_PLUGIN_STATUS_ERROR;
+	Key * shm = ksLookupByName (elektraPluginGetConfig (handle), "/shm", 0);
+	if ((!shm || resolveSharedDirectory (ch, shm, errorKey) == -1) && resolveCacheDirectory (handle, ch, errorKey) == -1)
+	{
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
 	if (loadCacheStoragePlugin (handle, ch, errorKey) == -1) return ELEKTRA_PLUGIN_STATUS_ERROR;
 
 	elektraPluginSetData (handle, ch);
@@ -256,8 +381,9 @@ int elektraCacheClose (Plugin * handle, Key * errorKey ELEKTRA_UNUSED)
 	CacheHandle * ch = elektraPluginGetData (handle);
 	if (ch)
 	{
-		elektraPluginClose (ch->resolver, 0);
+		if (ch->resolver) elektraPluginClose (ch->resolver, 0);
 		elektraPluginClose (ch->cacheStorage, 0);
+		if (ch->generation) munmap (ch->generation, sizeof (uint64_t));
 
 		elektraModulesClose (ch->modules, 0);
 		ksDel (ch->modules);
@@ -303,6 +429,8 @@ int elektraCacheGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * pa
 		ELEKTRA_LOG_DEBUG ("CLEAR CACHES path: %s", cacheFileName);
 
 		keySetString (cacheFile, cacheFileName);
+		// processes sharing the cache must not use what they have loaded already
+		if (ch->generation) __atomic_add_fetch (ch->generation, 1, __ATOMIC_SEQ_CST);
 		nftw (cacheFileName, unlinkCacheFiles, MAX_FD_USED, FTW_DEPTH);
 		elektraFree (cacheFileName);
 		keyDel (cacheFile);
@@ -321,6 +449,11 @@ int elektraCacheGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * pa
 	if (ch->cacheStorage->kdbGet (ch->cacheStorage, returned, cacheFile) == ELEKTRA_PLUGIN_STATUS_SUCCESS)
 	{
 		keyDel (cacheFile);
+		if (ch->generation && cacheGeneration (elektraPluginGetGlobalKeySet (handle)) != __atomic_load_n (ch->generation, __ATOMIC_SEQ_CST))
+		{
+			ELEKTRA_LOG_DEBUG ("cache was written before the last clear");
+			return ELEKTRA_PLUGIN_STATUS_ERROR;
+		}
 		return ELEKTRA_PLUGIN_STATUS_SUCCESS;
 	}
 
@@ -353,6 +486,13 @@ int elektraCacheSet (Plugin * handle, KeySet * returned, Key * parentKey)
 	ELEKTRA_ASSERT (tmpFile != 0, "Could not construct temp file name.");
 	ELEKTRA_LOG_DEBUG ("tmpFile: %s", tmpFile);
 
+	if (ch->generation)
+	{
+		uint64_t generation = __atomic_load_n (ch->generation, __ATOMIC_SEQ_CST);
+		ksAppendKey (elektraPluginGetGlobalKeySet (handle), keyNew (KDB_CACHE_GENERATION_KEY, KEY_BINARY, KEY_SIZE, sizeof (uint64_t),
+									  KEY_VALUE, &generation, KEY_END));
+	}
+
 	// write cache to temp file
 	keySetString (cacheFile, tmpFile);
 	if (ch->cacheStorage->kdbSet (ch->cacheStorage, returned, cacheFile) == ELEKTRA_PLUGIN_STATUS_SUCCESS)
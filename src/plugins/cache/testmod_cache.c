@@ -7,8 +7,11 @@
  *
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <kdb.h>
 #include <kdbconfig.h>
@@ -63,6 +66,146 @@ static void test_cacheNonBackendKeys (void)
 	kdbClose (handle, 0);
 }
 
+static void test_sharedMemory (void)
+{
+	printf ("test shared memory\n");
+
+	char * name = elektraFormat ("testmod_cache-%d", (int) getpid ());
+	char * directory = elektraFormat ("/dev/shm/elektra-%s", name);
+	Key * parentKey = keyNew ("user/tests/cache", KEY_END);
+	KeySet * conf = ksNew (1, keyNew ("system/shm", KEY_VALUE, name, KEY_END), KS_END);
+	PLUGIN_OPEN ("cache");
+
+	KeySet * global = ksNew (0, KS_END);
+	plugin->global = global;
+	KeySet * ks = ksNew (1, keyNew ("user/tests/cache/key", KEY_VALUE, "value", KEY_END), KS_END);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "could not write cache");
+
+	char * cacheFile = elektraFormat ("%s/backend/user/tests/cache/cache.mmap", directory);
+	succeed_if (access (cacheFile, F_OK) == 0, "cache file not in shared memory");
+
+	KeySet * cached = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, cached, parentKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "could not read cache");
+	succeed_if (ksLookupByName (cached, "user/tests/cache/key", 0) != 0, "cached key missing");
+	ksDel (cached);
+
+	// a cache written before a clear must not be used
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "could not write cache");
+	Key * clearKey = keyNew ("user/tests/cache", KEY_META, "cache/clear", "1", KEY_END);
+	KeySet * unused = ksNew (0, KS_END);
+	plugin->kdbGet (plugin, unused, clearKey);
+	succeed_if (access (cacheFile, F_OK) == -1, "cache file not removed");
+
+	char * generationFile = elektraFormat ("%s/generation", directory);
+	succeed_if (access (generationFile, F_OK) == 0, "generation removed");
+
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "could not write cache");
+	cached = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, cached, parentKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "cache written after clear not used");
+	ksDel (cached);
+
+	// another process clears the cache, but the file is still there
+	FILE * generation = fopen (generationFile, "r+");
+	exit_if_fail (generation, "could not open generation");
+	uint64_t value = 0;
+	succeed_if (fread (&value, sizeof (uint64_t), 1, generation) == 1, "could not read generation");
+	succeed_if (value == 1, "generation not incremented by clear");
+	++value;
+	rewind (generation);
+	succeed_if (fwrite (&value, sizeof (uint64_t), 1, generation) == 1, "could not write generation");
+	fclose (generation);
+
+	cached = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, cached, parentKey) == ELEKTRA_PLUGIN_STATUS_ERROR, "cache of old generation used");
+	ksDel (cached);
+
+	plugin->kdbGet (plugin, unused, clearKey);
+	ksDel (unused);
+	keyDel (clearKey);
+	unlink (generationFile);
+	rmdir (directory);
+	elektraFree (generationFile);
+	elektraFree (cacheFile);
+	elektraFree (directory);
+	elektraFree (name);
+	ksDel (global);
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+/**
+ * Opens the cache with the shared memory segment @p name, expecting it to fall back to the home directory.
+ */
+static void openUnsafeSharedMemory (const char * name, const char * directory)
+{
+	Key * parentKey = keyNew ("user/tests/cache", KEY_END);
+	KeySet * conf = ksNew (1, keyNew ("system/shm", KEY_VALUE, name, KEY_END), KS_END);
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+	Key * errorKey = keyNew ("", KEY_END);
+	Plugin * plugin = elektraPluginOpen ("cache", modules, conf, errorKey);
+	exit_if_fail (plugin, "could not open cache plugin");
+	succeed_if (keyGetMeta (errorKey, "warnings"), "no warning for unsafe shared memory cache");
+	succeed_if (!keyGetMeta (errorKey, "error"), "error for unsafe shared memory cache");
+	keyDel (errorKey);
+
+	KeySet * global = ksNew (0, KS_END);
+	plugin->global = global;
+	KeySet * ks = ksNew (1, keyNew ("user/tests/cache/key", KEY_VALUE, "value", KEY_END), KS_END);
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "could not write cache");
+
+	char * generationFile = elektraFormat ("%s/generation", directory);
+	char * cacheDirectory = elektraFormat ("%s/backend", directory);
+	succeed_if (access (generationFile, F_OK) == -1, "generation created in unsafe shared memory cache");
+	succeed_if (access (cacheDirectory, F_OK) == -1, "cache written to unsafe shared memory cache");
+	elektraFree (cacheDirectory);
+	elektraFree (generationFile);
+
+	Key * clearKey = keyNew ("user/tests/cache", KEY_META, "cache/clear", "1", KEY_END);
+	KeySet * unused = ksNew (0, KS_END);
+	plugin->kdbGet (plugin, unused, clearKey);
+	ksDel (unused);
+	keyDel (clearKey);
+
+	ksDel (global);
+	ksDel (ks);
+	keyDel (parentKey);
+	elektraPluginClose (plugin, 0);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+static void test_sharedMemoryUnsafe (void)
+{
+	printf ("test unsafe shared memory\n");
+
+	char * name = elektraFormat ("testmod_cache-%d", (int) getpid ());
+	char * directory = elektraFormat ("/dev/shm/elektra-%s", name);
+
+	// other users could read the cache files
+	exit_if_fail (mkdir (directory, 0755) == 0, "could not create directory");
+	chmod (directory, 0755);
+	openUnsafeSharedMemory (name, directory);
+	rmdir (directory);
+
+	// the directory could be replaced by the owner of the link
+	char * target = elektraFormat ("%s-target", directory);
+	exit_if_fail (mkdir (target, 0700) == 0, "could not create directory");
+	exit_if_fail (symlink (target, directory) == 0, "could not create link");
+	openUnsafeSharedMemory (name, target);
+	unlink (directory);
+	rmdir (target);
+	elektraFree (target);
+
+	// another user created the directory, only root can test this
+	exit_if_fail (mkdir (directory, 0700) == 0, "could not create directory");
+	if (chown (directory, geteuid () + 1, getegid ()) == 0) openUnsafeSharedMemory (name, directory);
+	rmdir (directory);
+
+	elektraFree (directory);
+	elektraFree (name);
+}
 
 int main (int argc, char ** argv)
 {
@@ -73,6 +216,8 @@ int main (int argc, char ** argv)
 
 	test_basics ();
 	test_cacheNonBackendKeys ();
+	test_sharedMemory ();
+	test_sharedMemoryUnsafe ();
 
 	print_result ("testmod_cache");
 
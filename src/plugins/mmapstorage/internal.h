@@ -16,6 +16,7 @@
 #define SIZEOF_MMAPHEADER (sizeof (MmapHeader))
 #define SIZEOF_MMAPMETADATA (sizeof (MmapMetaData))
 #define SIZEOF_MMAPFOOTER (sizeof (MmapFooter))
+#define SIZEOF_MMAPJOURNALHEADER (sizeof (MmapJournalHeader))
 
 #define OFFSET_MAGIC_KEYSET (SIZEOF_MMAPHEADER)
 
@@ -56,8 +57,26 @@
 /** Magic number used in mmap format (8 bytes). Previously used: 0x0A6172746B656C45 */
 #define ELEKTRA_MAGIC_MMAP_NUMBER (0x0A3472746B656C45)
 
+/** Magic number used for journal files (8 bytes). */
+#define ELEKTRA_MAGIC_MMAP_JOURNAL_NUMBER (0x0A4A72746B656C45)
+
 /** Mmap format version (1 byte). Increment on breaking changes to invalidate old files. */
-#define ELEKTRA_MMAP_FORMAT_VERSION (2)
+#define ELEKTRA_MMAP_FORMAT_VERSION (6)
+
+/** Base addresses of new files are random multiples of ELEKTRA_MMAP_BASE_ALIGN in [ELEKTRA_MMAP_BASE_MIN, ELEKTRA_MMAP_BASE_MAX) */
+#define ELEKTRA_MMAP_BASE_MIN ((uint64_t) 1 << 42)
+#define ELEKTRA_MMAP_BASE_MAX ((uint64_t) 1 << 45)
+#define ELEKTRA_MMAP_BASE_ALIGN ((uint64_t) 2 * 1024 * 1024)
+
+/** Default maximum size of the journal in percent of the size of the base file */
+#define ELEKTRA_MMAP_JOURNAL_DEFAULT_SIZE (10)
+
+/** Suffix of the files holding the base file of a journal */
+#define ELEKTRA_MMAP_JOURNAL_BASE_SUFFIX ".base"
+
+/** Journal record types (1 byte) */
+#define ELEKTRA_MMAP_JOURNAL_REMOVED ('-')
+#define ELEKTRA_MMAP_JOURNAL_KEY ('+')
 
 /** Mmap temp file template */
 #define ELEKTRA_MMAP_TMP_NAME "/tmp/elektraMmapTmpXXXXXX"
@@ -110,12 +129,42 @@ struct _mmapAddr
 	char * keyPtr;			/**<Pointer to the current Key struct. */
 	char * dataPtr;			/**<Pointer to the data region, where Key->key and Key->data is stored. */
 
-	const uintptr_t mmapAddrInt;	/**<Address of the mapped region as integer. */
+	const uintptr_t mmapAddrInt;	/**<Distance of the mapped region to the base address of the file. */
 	// clang-format on
 };
 
 typedef struct _mmapAddr MmapAddr;
 
+/**
+ * Internal MmapFile structure.
+ * Remembers the file read by kdbGet() for a mountpoint, such that kdbSet()
+ * can compare the keyset with the file and write only the changed values.
+ */
+struct _mmapFile
+{
+	// clang-format off
+	char * parentName;		/**<Name of the parent key of the mountpoint. */
+	char * fileName;		/**<Name of the file. */
+	struct _mmapFile * next;	/**<Next file. */
+	// clang-format on
+};
+
+typedef struct _mmapFile MmapFile;
+
+/**
+ * Plugin data of mmapstorage.
+ */
+struct _mmapHandle
+{
+	// clang-format off
+	int globalCache;		/**<Plugin is used as global cache, configured with `globalcache`. */
+	size_t journal;			/**<Maximum size of the journal in percent of the base file, 0 if disabled. */
+	MmapFile * files;		/**<Files read in storage mode. */
+	// clang-format on
+};
+
+typedef struct _mmapHandle MmapHandle;
+
 /* Header, metadata and footer needed for mmap file format */
 typedef struct _mmapHeader MmapHeader;
 typedef struct _mmapMetaData MmapMetaData;
@@ -167,6 +216,7 @@ struct _mmapMetaData
 	size_t numKeySets;	/**<Number of KeySets inlcuding meta KS */
 	size_t ksAlloc;		/**<Sum of all KeySet->alloc sizes */
 	size_t numKeys;		/**<Number of Keys including meta Keys */
+	uintptr_t baseAddr;	/**<Random address the pointers are valid for, 0 if they are relative */
 	// clang-format on
 };
 
@@ -185,4 +235,53 @@ struct _mmapFooter
 #define STATIC_SIZEOF_MMAPFOOTER 8
 #define STATIC_FOOTER_OFFSETOF_MAGICNUMBER 0
 
+typedef struct _mmapJournalHeader MmapJournalHeader;
+typedef struct _mmapJournalBuffer MmapJournalBuffer;
+
+/**
+ * Mmap journal header
+ *
+ * A journal file starts with this header, followed by the name of the base file
+ * (relative to the directory of the journal) and the journal records. The base
+ * file is a regular mmap file, the records contain the keys changed since then:
+ *
+ * - `-` followed by the name of a removed key
+ * - `+` followed by the name, value and metadata of an added or modified key
+ *
+ * Names and values are stored as uint64_t size followed by the data,
+ * the metadata as uint64_t number of meta keys followed by their names and values.
+ *
+ * Shall contain only fixed-width types.
+ */
+struct _mmapJournalHeader
+{
+	// clang-format off
+	uint64_t mmapMagicNumber;	/**<Magic number for journal files */
+	uint64_t journalSize;		/**<Size of the complete journal file in bytes */
+	uint64_t baseSize;		/**<Size of the base file in bytes */
+	uint64_t baseInode;		/**<Inode number of the base file */
+	uint64_t baseAddr;		/**<Base address of the base file, see MmapMetaData */
+
+	uint32_t checksum;		/**<Checksum of the base file name and records */
+	uint8_t formatFlags;		/**<Mmap format flags (e.g. checksum ON/OFF) */
+	uint8_t formatVersion;		/**<Mmap format version */
+	uint16_t baseNameSize;		/**<Size of the base file name including the null terminator */
+	// clang-format on
+};
+
+#define STATIC_SIZEOF_MMAPJOURNALHEADER 48
+
+/**
+ * Buffer for writing a journal file.
+ */
+struct _mmapJournalBuffer
+{
+	// clang-format off
+	char * data;			/**<The journal file. */
+	size_t size;			/**<Bytes used. */
+	size_t alloc;			/**<Bytes allocated. */
+	size_t maxSize;			/**<Maximum size of the journal, beyond the base file should be written. */
+	// clang-format on
+};
+
 #endif
@@ -24,6 +24,7 @@
 #include "kdbconfig.h"
 #endif
 
+#include <dirent.h>    // opendir(), readdir()
 #include <errno.h>
 #include <fcntl.h>     // fcntl()
 #include <limits.h>    // SSIZE_MAX
@@ -31,10 +32,15 @@
 #include <stdio.h>     // fopen(), fileno()
 #include <stdlib.h>    // strtol()
 #include <string.h>    // memcmp()
+#include <sys/ioctl.h> // ioctl()
 #include <sys/mman.h>  // mmap()
 #include <sys/stat.h>  // stat(), fstat()
 #include <sys/types.h> // ftruncate (), size_t
-#include <unistd.h>    // close(), ftruncate(), unlink(), read(), write()
+#include <unistd.h>    // close(), ftruncate(), unlink(), read(), pread(), write(), pwrite(), fsync(), sysconf(), link()
+
+#ifdef __linux__
+#include <linux/fs.h> // FICLONE
+#endif
 
 #ifdef ELEKTRA_MMAP_CHECKSUM
 #include <zlib.h> // crc32()
@@ -213,6 +219,29 @@ static int copyFile (int sourceFd, int destFd)
 	return 0;
 }
 
+#ifndef ELEKTRA_MMAP_CHECKSUM
+/**
+ * @brief Clone file
+ *
+ * The destination file shares the data blocks of the source file,
+ * until they are written.
+ *
+ * @param sourceFd source file descriptor
+ * @param destFd destination file descriptor
+ *
+ * @retval 0 on success
+ * @retval -1 if the file system does not support it or any error occured
+ */
+static int cloneFile (int sourceFd ELEKTRA_UNUSED, int destFd ELEKTRA_UNUSED)
+{
+#ifdef FICLONE
+	return ioctl (destFd, FICLONE, sourceFd) == 0 ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+#endif
+
 /**
  * @brief Copy file to anonymous temporary file
  *
@@ -606,6 +635,24 @@ static int verifyChecksum (char * mappedRegion, MmapHeader * mmapHeader, PluginM
 }
 #endif
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+/**
+ * @brief Size of the OPMPHM graph of the KeySet that is stored.
+ *
+ * If the OPMPHM delta logged alterations, the graph maps to outdated positions
+ * and is not stored, the OPMPHM is built again after loading.
+ *
+ * @param keySet the KeySet with an OPMPHM
+ *
+ * @return the size of the graph in bytes
+ */
+static size_t storedOpmphmGraphSize (const KeySet * keySet)
+{
+	if (keySet->opmphmDelta && keySet->opmphmDelta->size) return 0;
+	return keySet->opmphm->size;
+}
+#endif
+
 /**
  * @brief Calculates the size, in bytes, needed to store the KeySet in a mmap region.
  *
@@ -697,7 +744,7 @@ static void calculateMmapDataSize (MmapHeader * mmapHeader, MmapMetaData * mmapM
 	if (opmphm)
 	{
 		if (opmphm->rUniPar) dataBlocksSize += opmphm->rUniPar * sizeof (int32_t);
-		dataBlocksSize += opmphm->size;
+		dataBlocksSize += storedOpmphmGraphSize (returned);
 	}
 	OpmphmPredictor * opmphmPredictor = returned->opmphmPredictor;
 	if (opmphmPredictor)
@@ -745,6 +792,8 @@ static void writeMetaKeys (MmapAddr * mmapAddr, DynArray * dynArray)
 		Key * mmapMetaKey = (Key *) mmapAddr->keyPtr; // new key location
 		*mmapMetaKey = *curMeta;
 		mmapAddr->keyPtr += SIZEOF_KEY;
+		// name and value are copied into the mapping, they are not in an arena anymore
+		clear_bit (mmapMetaKey->flags, (keyflag_t) (KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA));
 
 		// move Key name
 		if (curMeta->key)
@@ -792,6 +841,14 @@ static KeySet * writeMetaKeySet (Key * key, MmapAddr * mmapAddr, DynArray * dynA
 	mmapAddr->metaKsPtr += SIZEOF_KEYSET;
 
 	newMeta->flags = key->meta->flags | KS_FLAG_MMAP_STRUCT | KS_FLAG_MMAP_ARRAY;
+	newMeta->arena = 0;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	// name prefixes are heap-only, they are built again on demand
+	newMeta->prefixes = 0;
+	newMeta->prefixAlloc = 0;
+	newMeta->lookups = 0;
+	newMeta->opmphmDelta = 0;
+#endif
 	newMeta->array = (Key **) mmapAddr->metaKsArrayPtr;
 	mmapAddr->metaKsArrayPtr += SIZEOF_KEY_PTR * key->meta->alloc;
 
@@ -849,6 +906,8 @@ static void writeKeys (KeySet * keySet, MmapAddr * mmapAddr, DynArray * dynArray
 		Key * mmapKey = (Key *) mmapAddr->keyPtr; // new key location
 		mmapAddr->keyPtr += SIZEOF_KEY;
 		*mmapKey = *cur;
+		// kdbGet() needs to clear the flag anyway, so the pages of the mapping are not touched there
+		clear_bit (mmapKey->flags, (keyflag_t) (KEY_FLAG_SYNC | KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA));
 
 		// move Key name
 		if (cur->key)
@@ -944,7 +1003,7 @@ static int copyKeySetToMmap (char * const dest, KeySet * keySet, KeySet * global
 			      .metaKsArrayPtr = mmapAddr.ksArrayPtr + (SIZEOF_KEY_PTR * keySet->alloc),
 			      .keyPtr = mmapAddr.globalKsArrayPtr + (SIZEOF_KEY_PTR * mmapMetaData->ksAlloc),
 			      .dataPtr = mmapAddr.keyPtr + (SIZEOF_KEY * mmapMetaData->numKeys),
-			      .mmapAddrInt = (uintptr_t) dest };
+			      .mmapAddrInt = (uintptr_t) dest - mmapMetaData->baseAddr };
 
 	printMmapAddr (&mmapAddr);
 	printMmapMetaData (mmapMetaData);
@@ -968,12 +1027,15 @@ static int copyKeySetToMmap (char * const dest, KeySet * keySet, KeySet * global
 			mmapAddr.ksPtr->opmphm->hashFunctionSeeds =
 				(int32_t *) (((char *) mmapAddr.ksPtr->opmphm->hashFunctionSeeds) - mmapAddr.mmapAddrInt);
 		}
-		if (keySet->opmphm->size)
+		size_t graphSize = storedOpmphmGraphSize (keySet);
+		mmapAddr.ksPtr->opmphm->size = graphSize;
+		mmapAddr.ksPtr->opmphm->graph = 0;
+		if (graphSize)
 		{
 			mmapAddr.ksPtr->opmphm->graph = (uint32_t *) mmapAddr.dataPtr;
-			memcpy (mmapAddr.ksPtr->opmphm->graph, keySet->opmphm->graph, keySet->opmphm->size);
+			memcpy (mmapAddr.ksPtr->opmphm->graph, keySet->opmphm->graph, graphSize);
 			set_bit (mmapAddr.ksPtr->opmphm->flags, OPMPHM_FLAG_MMAP_GRAPH);
-			mmapAddr.dataPtr += keySet->opmphm->size;
+			mmapAddr.dataPtr += graphSize;
 			mmapAddr.ksPtr->opmphm->graph = (uint32_t *) (((char *) mmapAddr.ksPtr->opmphm->graph) - mmapAddr.mmapAddrInt);
 		}
 		mmapAddr.ksPtr->opmphm = (Opmphm *) (((char *) mmapAddr.ksPtr->opmphm) - mmapAddr.mmapAddrInt);
@@ -1009,6 +1071,13 @@ static int copyKeySetToMmap (char * const dest, KeySet * keySet, KeySet * global
 		mmapAddr.globalKsPtr->array = (Key **) (mmapAddr.globalKsArrayPtr - mmapAddr.mmapAddrInt);
 		mmapAddr.globalKsPtr->alloc = global->alloc;
 		mmapAddr.globalKsPtr->size = global->size;
+		mmapAddr.globalKsPtr->arena = 0;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		mmapAddr.globalKsPtr->prefixes = 0;
+		mmapAddr.globalKsPtr->prefixAlloc = 0;
+		mmapAddr.globalKsPtr->lookups = 0;
+		mmapAddr.globalKsPtr->opmphmDelta = 0;
+#endif
 	}
 
 	if (keySet->size != 0)
@@ -1023,6 +1092,13 @@ static int copyKeySetToMmap (char * const dest, KeySet * keySet, KeySet * global
 	mmapAddr.ksPtr->array = (Key **) (mmapAddr.ksArrayPtr - mmapAddr.mmapAddrInt);
 	mmapAddr.ksPtr->alloc = keySet->alloc;
 	mmapAddr.ksPtr->size = keySet->size;
+	mmapAddr.ksPtr->arena = 0;
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	mmapAddr.ksPtr->prefixes = 0;
+	mmapAddr.ksPtr->prefixAlloc = 0;
+	mmapAddr.ksPtr->lookups = 0;
+	mmapAddr.ksPtr->opmphmDelta = 0;
+#endif
 
 	memcpy ((dest + OFFSET_MMAPMETADATA), mmapMetaData, SIZEOF_MMAPMETADATA);
 #ifdef ELEKTRA_MMAP_CHECKSUM
@@ -1098,13 +1174,16 @@ static void mmapToKeySet (Plugin * handle, char * mappedRegion, KeySet * returne
 	returned->size = keySet->size;
 	returned->alloc = keySet->alloc;
 	// to be able to free() the returned KeySet, just set the array flag here
-	returned->flags = KS_FLAG_MMAP_ARRAY;
+	returned->flags = KS_FLAG_MMAP_ARRAY | (returned->flags & KS_FLAG_ARENA_STRUCT);
 
 #ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
 	if (keySet->opmphm)
 	{
 		if (returned->opmphm) mmapOpmphmDel (returned->opmphm);
 		returned->opmphm = keySet->opmphm;
+		// the mapped OPMPHM has no delta, it maps to the current positions
+		if (returned->opmphmDelta) elektraFree (returned->opmphmDelta);
+		returned->opmphmDelta = 0;
 	}
 	if (keySet->opmphmPredictor)
 	{
@@ -1122,25 +1201,79 @@ static void mmapToKeySet (Plugin * handle, char * mappedRegion, KeySet * returne
 		global->size = mmapTimeStamps->size;
 		global->alloc = mmapTimeStamps->alloc;
 		// to be able to free() the timeStamps KeySet, just set the array flag here
-		global->flags = KS_FLAG_MMAP_ARRAY;
+		global->flags = KS_FLAG_MMAP_ARRAY | (global->flags & KS_FLAG_ARENA_STRUCT);
 		// we intentionally do not change the KeySet->opmphm here!
 	}
 }
 
+/**
+ * @brief Chooses the base address of a new file.
+ *
+ * The pointers of the file are written for a mapping at this address. It is
+ * random rather than the address of the mapping used for writing, so that
+ * the file does not reveal the memory layout of the writing process.
+ *
+ * @return a random address in [ELEKTRA_MMAP_BASE_MIN, ELEKTRA_MMAP_BASE_MAX)
+ * @retval 0 if the pointers are written relative to the start of the file
+ */
+static uintptr_t randomBaseAddress (void)
+{
+#if UINTPTR_MAX > 0xFFFFFFFFu
+	uint64_t random;
+	int fd = open ("/dev/urandom", O_RDONLY);
+	if (fd == -1) return 0;
+	ssize_t size = read (fd, &random, sizeof (random));
+	close (fd);
+	if (size != (ssize_t) sizeof (random)) return 0;
+
+	const uint64_t slots = (ELEKTRA_MMAP_BASE_MAX - ELEKTRA_MMAP_BASE_MIN) / ELEKTRA_MMAP_BASE_ALIGN;
+	return ELEKTRA_MMAP_BASE_MIN + (random % slots) * ELEKTRA_MMAP_BASE_ALIGN;
+#else
+	// the address space is too small to find a free random address
+	return 0;
+#endif
+}
+
+/**
+ * @brief Reads the base address of a file.
+ *
+ * The pointers in the file are valid for a mapping at the base address,
+ * see randomBaseAddress(). If the file is mapped there, no pointer needs
+ * to be updated.
+ *
+ * @param fd file descriptor of the file
+ *
+ * @return the base address to use as hint for mmap()
+ * @retval 0 if the file has no usable base address
+ */
+static void * readBaseAddress (int fd)
+{
+	MmapMetaData mmapMetaData;
+	if (pread (fd, &mmapMetaData, SIZEOF_MMAPMETADATA, OFFSET_MMAPMETADATA) != (ssize_t) SIZEOF_MMAPMETADATA) return 0;
+
+	long pageSize = sysconf (_SC_PAGESIZE);
+	if (pageSize <= 0 || mmapMetaData.baseAddr % pageSize != 0) return 0;
+	return (void *) mmapMetaData.baseAddr;
+}
+
 /**
  * @brief Updates pointers of a mapped keyset to a new location in memory.
  *
- * After mapping a file to a new location, all pointers have to be updated
- * in order to be consistent. When the mapped keyset is written, we subtract
- * the base address. Therefore, after mapping the keyset to a new memory location,
- * we only have to add the new base address to all pointers.
+ * Only needed if the file could not be mapped at its base address.
+ * When the mapped keyset is written, we subtract the distance of the
+ * mapping to the base address. Therefore, after mapping the keyset to
+ * a new memory location, we only have to add the distance of the new
+ * mapping to the base address to all pointers.
+ *
+ * This writes to every page of the private mapping, so the pages are
+ * not shared with the page cache anymore.
  *
  * @param mmapMetaData meta-data of the old mapped region
  * @param dest new mapped memory region
  */
 static void updatePointers (MmapMetaData * mmapMetaData, char * dest)
 {
-	uintptr_t destInt = (uintptr_t) dest;
+	uintptr_t destInt = (uintptr_t) dest - mmapMetaData->baseAddr;
 
 	char * ksPtr = (dest + OFFSET_GLOBAL_KEYSET);
 	char * ksArrayPtr = ksPtr + SIZEOF_KEYSET * mmapMetaData->numKeySets;
@@ -1204,6 +1337,812 @@ static void updatePointers (MmapMetaData * mmapMetaData, char * dest)
 	}
 }
 
+/**
+ * @brief Maps a file read-only to compare a keyset with it.
+ *
+ * A shared read-only mapping shows the file as stored, regardless of changes to the keys of kdbGet().
+ *
+ * @param fd file descriptor of the file
+ * @param size size of the file
+ * @param mmapHeader set to the MmapHeader of the mapped file
+ * @param mmapMetaData set to the MmapMetaData of the mapped file
+ *
+ * @return the mapped file
+ * @retval MAP_FAILED if the file could not be mapped or is no valid mmap file
+ */
+static char * mapStoredFile (int fd, size_t size, MmapHeader ** mmapHeader, MmapMetaData ** mmapMetaData)
+{
+	if (size < ELEKTRA_MMAP_MINSIZE) return MAP_FAILED;
+	char * mappedRegion = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (mappedRegion == MAP_FAILED) return MAP_FAILED;
+
+	if (verifyMagicData (mappedRegion) != 0 || readHeader (mappedRegion, mmapHeader, mmapMetaData) != 0 ||
+	    size != (*mmapHeader)->allocSize || readFooter (mappedRegion, *mmapHeader) != 0)
+	{
+		munmap (mappedRegion, size);
+		return MAP_FAILED;
+	}
+	return mappedRegion;
+}
+
+/**
+ * @brief Finds the file read for a mountpoint.
+ *
+ * @param mh the plugin data
+ * @param parentName name of the parent key of the mountpoint
+ *
+ * @return the file read by kdbGet()
+ * @retval 0 if no file was read for the mountpoint
+ */
+static MmapFile * findFile (MmapHandle * mh, const char * parentName)
+{
+	MmapFile * file = mh->files;
+	while (file && elektraStrCmp (file->parentName, parentName) != 0)
+	{
+		file = file->next;
+	}
+	return file;
+}
+
+/**
+ * @brief Remembers the file read for a mountpoint.
+ *
+ * @param mh the plugin data
+ * @param parentName name of the parent key of the mountpoint
+ * @param fileName name of the file
+ */
+static void rememberFile (MmapHandle * mh, const char * parentName, const char * fileName)
+{
+	MmapFile * file = findFile (mh, parentName);
+
+	if (file && elektraStrCmp (file->fileName, fileName) == 0) return;
+
+	if (!file)
+	{
+		file = elektraCalloc (sizeof (MmapFile));
+		if (!file) return;
+		file->parentName = elektraStrDup (parentName);
+		file->next = mh->files;
+		mh->files = file;
+	}
+	else
+	{
+		elektraFree (file->fileName);
+	}
+	file->fileName = elektraStrDup (fileName);
+}
+
+/**
+ * @brief Translates a pointer stored in a file to the data in a read-only mapping of the file.
+ *
+ * @param mappedRegion the mapped file
+ * @param mmapHeader the MmapHeader of the mapped file
+ * @param mmapMetaData the MmapMetaData of the mapped file
+ * @param stored the pointer as stored in the file
+ * @param size the number of bytes needed at the pointer
+ *
+ * @return pointer into the mapped file
+ * @retval 0 if the data is not inside the file
+ */
+static const char * storedData (const char * mappedRegion, MmapHeader * mmapHeader, MmapMetaData * mmapMetaData, const void * stored,
+				size_t size)
+{
+	uintptr_t offset = (uintptr_t) stored - mmapMetaData->baseAddr;
+	if ((uintptr_t) stored < mmapMetaData->baseAddr || offset > mmapHeader->allocSize || size > mmapHeader->allocSize - offset)
+	{
+		return 0;
+	}
+	return mappedRegion + offset;
+}
+
+/**
+ * @brief Compares a key with a key stored in the file.
+ *
+ * @param mappedRegion the mapped file
+ * @param mmapHeader the MmapHeader of the mapped file
+ * @param mmapMetaData the MmapMetaData of the mapped file
+ * @param stored the Key struct stored in the file
+ * @param key the key to compare
+ * @param compareValue whether to compare the value
+ *
+ * @retval 1 if the name, value and size of the value are equal
+ * @retval 0 otherwise
+ */
+static int isStoredKeyEqual (const char * mappedRegion, MmapHeader * mmapHeader, MmapMetaData * mmapMetaData, const Key * stored,
+			     const Key * key, int compareValue)
+{
+	size_t nameSize = key->keySize + key->keyUSize;
+	if (stored->keySize != key->keySize || stored->keyUSize != key->keyUSize) return 0;
+	const char * name = storedData (mappedRegion, mmapHeader, mmapMetaData, stored->key, nameSize);
+	if (!name || memcmp (name, key->key, nameSize) != 0) return 0;
+
+	if (stored->dataSize != key->dataSize) return 0;
+	if (!compareValue || key->dataSize == 0) return 1;
+	const char * value = storedData (mappedRegion, mmapHeader, mmapMetaData, stored->data.v, key->dataSize);
+	return value && memcmp (value, key->data.v, key->dataSize) == 0;
+}
+
+/**
+ * @brief Compares the meta keyset of a key with the one stored in the file.
+ *
+ * @param mappedRegion the mapped file
+ * @param mmapHeader the MmapHeader of the mapped file
+ * @param mmapMetaData the MmapMetaData of the mapped file
+ * @param stored the Key struct stored in the file
+ * @param key the key to compare
+ *
+ * @retval 1 if the meta keysets are equal
+ * @retval 0 otherwise
+ */
+static int isStoredMetaEqual (const char * mappedRegion, MmapHeader * mmapHeader, MmapMetaData * mmapMetaData, const Key * stored,
+			      const Key * key)
+{
+	size_t size = key->meta ? key->meta->size : 0;
+	if (!stored->meta) return size == 0;
+
+	const KeySet * meta = (const KeySet *) storedData (mappedRegion, mmapHeader, mmapMetaData, stored->meta, SIZEOF_KEYSET);
+	if (!meta || meta->size != size) return 0;
+
+	Key * const * array = (Key * const *) storedData (mappedRegion, mmapHeader, mmapMetaData, meta->array, SIZEOF_KEY_PTR * size);
+	if (!array) return 0;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		const Key * metaKey = (const Key *) storedData (mappedRegion, mmapHeader, mmapMetaData, array[i], SIZEOF_KEY);
+		if (!metaKey || !isStoredKeyEqual (mappedRegion, mmapHeader, mmapMetaData, metaKey, key->meta->array[i], 1)) return 0;
+	}
+	return 1;
+}
+
+#ifndef ELEKTRA_MMAP_CHECKSUM
+/**
+ * @brief Writes only the changed values of a keyset to a copy of the file read before.
+ *
+ * Only works on file systems which can clone files. The file read by kdbGet()
+ * for the same mountpoint is cloned, which shares its data blocks, and compared with
+ * the keyset. If only values were changed and no value changed its size, the layout
+ * of the file stays the same. Then only the changed values are written to the clone.
+ *
+ * @param mh the plugin data
+ * @param ks the keyset to be written
+ * @param parentKey holding the filename
+ * @param mode the current plugin mode
+ *
+ * @retval 1 if the file was written
+ * @retval 0 if the whole keyset needs to be written
+ */
+static int writeChangedValues (MmapHandle * mh, KeySet * ks, Key * parentKey, PluginMode mode)
+{
+	MmapFile * file = findFile (mh, keyName (parentKey));
+	if (!file || ks->size == 0) return 0;
+
+	int sourceFd = open (file->fileName, O_RDONLY);
+	if (sourceFd == -1) return 0;
+
+	int fd = -1;
+	char * mappedRegion = MAP_FAILED;
+	size_t * changed = 0;
+	struct stat sbuf;
+	if (fstat (sourceFd, &sbuf) != 0 || sbuf.st_size < 0 || (size_t) sbuf.st_size < ELEKTRA_MMAP_MINSIZE) goto fallback;
+
+	if (unlink (keyString (parentKey)) != 0 && errno != ENOENT) goto fallback;
+	if ((fd = openFile (parentKey, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR, mode)) == -1) goto fallback;
+	// without cloning, the whole file would be written anyway
+	if (cloneFile (sourceFd, fd) != 0) goto fallback;
+
+	MmapHeader * mmapHeader;
+	MmapMetaData * mmapMetaData;
+	if ((mappedRegion = mapStoredFile (sourceFd, sbuf.st_size, &mmapHeader, &mmapMetaData)) == MAP_FAILED) goto fallback;
+
+	const KeySet * storedKs = (const KeySet *) (mappedRegion + OFFSET_KEYSET);
+	if (storedKs->size != ks->size || mmapMetaData->numKeys < ks->size) goto fallback;
+
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	// a built OPMPHM is worth storing
+	if (ks->opmphm && storedOpmphmGraphSize (ks) != 0 && (!storedKs->opmphm || ((Opmphm *) (mappedRegion + OFFSET_OPMPHM))->size == 0))
+	{
+		goto fallback;
+	}
+#endif
+
+	// the keys of the (main) KeySet are the last Key structs, in the same order as the sorted keyset
+	const Key * storedKeys = (const Key *) (mappedRegion + OFFSET_GLOBAL_KEYSET + (SIZEOF_KEYSET * mmapMetaData->numKeySets) +
+						(SIZEOF_KEY_PTR * mmapMetaData->ksAlloc) +
+						(SIZEOF_KEY * (mmapMetaData->numKeys - ks->size)));
+	if ((const char *) (storedKeys + ks->size) > mappedRegion + mmapHeader->allocSize) goto fallback;
+
+	size_t numChanged = 0;
+	size_t allocChanged = 0;
+	for (size_t i = 0; i < ks->size; ++i)
+	{
+		const Key * cur = ks->array[i];
+		if (!isStoredKeyEqual (mappedRegion, mmapHeader, mmapMetaData, &storedKeys[i], cur, 0)) goto fallback;
+		if (!isStoredMetaEqual (mappedRegion, mmapHeader, mmapMetaData, &storedKeys[i], cur)) goto fallback;
+		if (isStoredKeyEqual (mappedRegion, mmapHeader, mmapMetaData, &storedKeys[i], cur, 1)) continue;
+
+		if (numChanged == allocChanged)
+		{
+			allocChanged = allocChanged ? allocChanged * 2 : 16;
+			if (elektraRealloc ((void **) &changed, allocChanged * sizeof (size_t)) != 0) goto fallback;
+		}
+		changed[numChanged++] = i;
+	}
+
+	for (size_t i = 0; i < numChanged; ++i)
+	{
+		const Key * cur = ks->array[changed[i]];
+		off_t offset = (uintptr_t) storedKeys[changed[i]].data.v - mmapMetaData->baseAddr;
+		if (pwrite (fd, cur->data.v, cur->dataSize, offset) != (ssize_t) cur->dataSize) goto fallback;
+	}
+
+	if (fsync (fd) != 0) goto fallback;
+	ELEKTRA_LOG_DEBUG ("wrote %zu changed values of %zd keys", numChanged, ks->size);
+
+	elektraFree (changed);
+	munmap (mappedRegion, sbuf.st_size);
+	close (fd);
+	close (sourceFd);
+	return 1;
+
+fallback:
+	ELEKTRA_LOG_DEBUG ("write the whole keyset");
+	if (changed) elektraFree (changed);
+	if (mappedRegion != MAP_FAILED) munmap (mappedRegion, sbuf.st_size);
+	if (fd != -1) close (fd);
+	close (sourceFd);
+	return 0;
+}
+#endif
+
+/**
+ * @brief Reads the magic number of a file to check whether it is a journal file.
+ *
+ * @param fd file descriptor of the file
+ *
+ * @retval 1 if the file is a journal file
+ * @retval 0 otherwise
+ */
+static int isJournalFile (int fd)
+{
+	uint64_t magicNumber;
+	if (pread (fd, &magicNumber, sizeof (uint64_t), 0) != (ssize_t) sizeof (uint64_t)) return 0;
+	return magicNumber == ELEKTRA_MAGIC_MMAP_JOURNAL_NUMBER;
+}
+
+/**
+ * @brief Reads a journal file and verifies its header.
+ *
+ * @param fd file descriptor of the journal file
+ * @param journalHeader buffer where the MmapJournalHeader is stored
+ * @param mode the current plugin mode
+ *
+ * @return the complete journal file, to be freed by the caller
+ * @retval 0 if the journal file could not be read or is corrupt
+ */
+static char * readJournal (int fd, MmapJournalHeader * journalHeader, PluginMode mode)
+{
+	struct stat sbuf;
+	if (fstat (fd, &sbuf) != 0 || sbuf.st_size < (off_t) SIZEOF_MMAPJOURNALHEADER) return 0;
+
+	size_t size = sbuf.st_size;
+	char * journal = elektraMalloc (size);
+	if (!journal) return 0;
+
+	size_t readBytes = 0;
+	while (readBytes < size)
+	{
+		ssize_t ret = pread (fd, journal + readBytes, size - readBytes, readBytes);
+		if (ret == -1 && errno == EINTR) continue;
+		if (ret <= 0) goto error;
+		readBytes += ret;
+	}
+
+	memcpy (journalHeader, journal, SIZEOF_MMAPJOURNALHEADER);
+	if (journalHeader->mmapMagicNumber != ELEKTRA_MAGIC_MMAP_JOURNAL_NUMBER ||
+	    journalHeader->formatVersion != ELEKTRA_MMAP_FORMAT_VERSION || journalHeader->journalSize != size ||
+	    journalHeader->baseNameSize < 2 || journalHeader->baseNameSize > size - SIZEOF_MMAPJOURNALHEADER)
+	{
+		goto error;
+	}
+
+	// the base file has to be in the same directory
+	const char * baseName = journal + SIZEOF_MMAPJOURNALHEADER;
+	if (memchr (baseName, '\0', journalHeader->baseNameSize) != baseName + journalHeader->baseNameSize - 1 || strchr (baseName, '/'))
+	{
+		goto error;
+	}
+
+#ifdef ELEKTRA_MMAP_CHECKSUM
+	if (test_bit (journalHeader->formatFlags, MMAP_FLAG_CHECKSUM))
+	{
+		uint32_t checksum = crc32 (0L, Z_NULL, 0);
+		checksum = crc32 (checksum, (const unsigned char *) baseName, size - SIZEOF_MMAPJOURNALHEADER);
+		if (checksum != journalHeader->checksum) goto error;
+	}
+#endif
+
+	return journal;
+
+error:
+	ELEKTRA_MMAP_LOG_WARNING ("could not read journal file");
+	elektraFree (journal);
+	return 0;
+}
+
+/**
+ * @brief Builds the path of the base file of a journal file.
+ *
+ * @param fileName name of the journal file
+ * @param baseName name of the base file, relative to the directory of the journal file
+ *
+ * @return the path of the base file, to be freed by the caller
+ */
+static char * journalBasePath (const char * fileName, const char * baseName)
+{
+	const char * slash = strrchr (fileName, '/');
+	if (!slash) return elektraStrDup (baseName);
+	return elektraFormat ("%.*s%s", (int) (slash - fileName + 1), fileName, baseName);
+}
+
+/**
+ * @brief Removes the base files of a file, which are not used anymore.
+ *
+ * Base files are hard links named `<file>.<inode>.base` in the directory of the file.
+ * A base file is not needed anymore, once a kdbSet() replaced the journal file using it.
+ * Readers might still have opened that journal file, so base files are only removed by
+ * the next compaction, when the base file of the current journal file becomes unused.
+ *
+ * @param fileName name of the file
+ * @param basePath path of the base file used by the file, which is kept
+ */
+static void removeStaleBaseFiles (const char * fileName, const char * basePath)
+{
+	const char * slash = strrchr (fileName, '/');
+	const char * name = slash ? slash + 1 : fileName;
+	const char * keep = strrchr (basePath, '/');
+	keep = keep ? keep + 1 : basePath;
+
+	char * dirName = slash ? elektraFormat ("%.*s", (int) (slash - fileName + 1), fileName) : elektraStrDup ("./");
+	DIR * dir = opendir (dirName);
+	if (!dir)
+	{
+		elektraFree (dirName);
+		return;
+	}
+
+	size_t nameSize = strlen (name);
+	size_t suffixSize = sizeof (ELEKTRA_MMAP_JOURNAL_BASE_SUFFIX) - 1;
+	struct dirent * entry;
+	while ((entry = readdir (dir)) != 0)
+	{
+		size_t entrySize = strlen (entry->d_name);
+		if (entrySize <= nameSize + 1 + suffixSize) continue;
+		if (strncmp (entry->d_name, name, nameSize) != 0 || entry->d_name[nameSize] != '.' ||
+		    strcmp (entry->d_name + entrySize - suffixSize, ELEKTRA_MMAP_JOURNAL_BASE_SUFFIX) != 0)
+		{
+			continue;
+		}
+		if (strspn (entry->d_name + nameSize + 1, "0123456789abcdef") != entrySize - nameSize - 1 - suffixSize) continue;
+		if (strcmp (entry->d_name, keep) == 0) continue;
+
+		char * path = elektraFormat ("%s%s", dirName, entry->d_name);
+		ELEKTRA_LOG_DEBUG ("removing base file %s", path);
+		unlink (path);
+		elektraFree (path);
+	}
+
+	closedir (dir);
+	elektraFree (dirName);
+}
+
+/**
+ * @brief Appends data to a journal file.
+ *
+ * @param buffer the journal file
+ * @param data the data to append
+ * @param size the number of bytes to append
+ *
+ * @retval 0 on success
+ * @retval -1 if the journal file would exceed its maximum size or on memory error
+ */
+static int appendJournal (MmapJournalBuffer * buffer, const void * data, size_t size)
+{
+	if (size > buffer->maxSize - buffer->size) return -1;
+
+	if (buffer->size + size > buffer->alloc)
+	{
+		size_t alloc = buffer->alloc ? buffer->alloc : ELEKTRA_MMAP_BUFSIZE;
+		while (alloc < buffer->size + size)
+		{
+			alloc *= 2;
+		}
+		if (alloc > buffer->maxSize) alloc = buffer->maxSize;
+		if (elektraRealloc ((void **) &buffer->data, alloc) != 0) return -1;
+		buffer->alloc = alloc;
+	}
+
+	if (size > 0) memcpy (buffer->data + buffer->size, data, size);
+	buffer->size += size;
+	return 0;
+}
+
+/**
+ * @brief Appends the size of the data followed by the data to a journal file.
+ *
+ * @param buffer the journal file
+ * @param data the data to append
+ * @param size the number of bytes to append
+ *
+ * @retval 0 on success
+ * @retval -1 if the journal file would exceed its maximum size or on memory error
+ */
+static int appendJournalData (MmapJournalBuffer * buffer, const void * data, size_t size)
+{
+	uint64_t dataSize = size;
+	if (appendJournal (buffer, &dataSize, sizeof (uint64_t)) != 0) return -1;
+	return appendJournal (buffer, data, size);
+}
+
+/**
+ * @brief Appends the record of an added or modified key to a journal file.
+ *
+ * @param buffer the journal file
+ * @param key the key
+ *
+ * @retval 0 on success
+ * @retval -1 if the journal file would exceed its maximum size or on memory error
+ */
+static int appendJournalKey (MmapJournalBuffer * buffer, const Key * key)
+{
+	const char type = ELEKTRA_MMAP_JOURNAL_KEY;
+	uint64_t numMeta = key->meta ? key->meta->size : 0;
+	if (appendJournal (buffer, &type, 1) != 0 || appendJournalData (buffer, key->key, key->keySize) != 0 ||
+	    appendJournalData (buffer, key->data.v, key->dataSize) != 0 || appendJournal (buffer, &numMeta, sizeof (uint64_t)) != 0)
+	{
+		return -1;
+	}
+
+	for (size_t i = 0; i < numMeta; ++i)
+	{
+		const Key * metaKey = key->meta->array[i];
+		if (appendJournalData (buffer, metaKey->key, metaKey->keySize) != 0 ||
+		    appendJournalData (buffer, metaKey->data.v, metaKey->dataSize) != 0)
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Compares two unescaped key names in the order of keyCmp().
+ *
+ * @param name1 the first unescaped name
+ * @param size1 the size of the first unescaped name
+ * @param name2 the second unescaped name
+ * @param size2 the size of the second unescaped name
+ *
+ * @return a number less than, equal to or greater than zero if the first name is sorted before, equal to or after the second
+ */
+static int compareUnescapedNames (const char * name1, size_t size1, const char * name2, size_t size2)
+{
+	int ret = memcmp (name1, name2, size1 < size2 ? size1 : size2);
+	if (ret == 0 && size1 != size2)
+	{
+		ret = size1 < size2 ? -1 : 1;
+	}
+	return ret;
+}
+
+/**
+ * @brief Appends the changes of a keyset compared with the keyset stored in a file to a journal file.
+ *
+ * Both keysets are sorted, so they are compared in a single pass.
+ *
+ * @param buffer the journal file
+ * @param mappedRegion the mapped file
+ * @param mmapHeader the MmapHeader of the mapped file
+ * @param mmapMetaData the MmapMetaData of the mapped file
+ * @param ks the keyset
+ *
+ * @retval 0 on success
+ * @retval -1 if the journal file would exceed its maximum size, the file is corrupt or on memory error
+ */
+static int appendJournalChanges (MmapJournalBuffer * buffer, const char * mappedRegion, MmapHeader * mmapHeader,
+				 MmapMetaData * mmapMetaData, KeySet * ks)
+{
+	const KeySet * storedKs = (const KeySet *) (mappedRegion + OFFSET_KEYSET);
+	Key * const * storedArray =
+		(Key * const *) storedData (mappedRegion, mmapHeader, mmapMetaData, storedKs->array, SIZEOF_KEY_PTR * storedKs->size);
+	if (storedKs->size > 0 && !storedArray) return -1;
+
+	size_t i = 0;
+	size_t j = 0;
+	while (i < storedKs->size || j < ks->size)
+	{
+		const Key * stored = 0;
+		const char * storedName = 0;
+		if (i < storedKs->size)
+		{
+			stored = (const Key *) storedData (mappedRegion, mmapHeader, mmapMetaData, storedArray[i], SIZEOF_KEY);
+			if (!stored) return -1;
+			storedName = storedData (mappedRegion, mmapHeader, mmapMetaData, stored->key, stored->keySize + stored->keyUSize);
+			if (!storedName || stored->keySize == 0 || storedName[stored->keySize - 1] != '\0') return -1;
+		}
+
+		int cmp;
+		if (!stored)
+		{
+			cmp = 1;
+		}
+		else if (j == ks->size)
+		{
+			cmp = -1;
+		}
+		else
+		{
+			const Key * cur = ks->array[j];
+			cmp = compareUnescapedNames (storedName + stored->keySize, stored->keyUSize, cur->key + cur->keySize,
+						     cur->keyUSize);
+		}
+
+		if (cmp < 0)
+		{
+			const char type = ELEKTRA_MMAP_JOURNAL_REMOVED;
+			if (appendJournal (buffer, &type, 1) != 0 || appendJournalData (buffer, storedName, stored->keySize) != 0)
+			{
+				return -1;
+			}
+			++i;
+		}
+		else if (cmp > 0)
+		{
+			if (appendJournalKey (buffer, ks->array[j]) != 0) return -1;
+			++j;
+		}
+		else
+		{
+			if (!isStoredKeyEqual (mappedRegion, mmapHeader, mmapMetaData, stored, ks->array[j], 1) ||
+			    !isStoredMetaEqual (mappedRegion, mmapHeader, mmapMetaData, stored, ks->array[j]))
+			{
+				if (appendJournalKey (buffer, ks->array[j]) != 0) return -1;
+			}
+			++i;
+			++j;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Reads data written by appendJournalData() from a journal file.
+ *
+ * @param cur position in the journal file, moved behind the data
+ * @param end end of the journal file
+ * @param size set to the size of the data
+ *
+ * @return pointer to the data
+ * @retval 0 if the journal file is corrupt
+ */
+static const char * readJournalData (const char ** cur, const char * end, size_t * size)
+{
+	uint64_t dataSize;
+	if ((size_t) (end - *cur) < sizeof (uint64_t)) return 0;
+	memcpy (&dataSize, *cur, sizeof (uint64_t));
+	*cur += sizeof (uint64_t);
+
+	if (dataSize > (uint64_t) (end - *cur)) return 0;
+	const char * data = *cur;
+	*cur += dataSize;
+	*size = dataSize;
+	return data;
+}
+
+/**
+ * @brief Reads a null terminated string written by appendJournalData() from a journal file.
+ *
+ * @param cur position in the journal file, moved behind the string
+ * @param end end of the journal file
+ *
+ * @return the string
+ * @retval 0 if the journal file is corrupt
+ */
+static const char * readJournalString (const char ** cur, const char * end)
+{
+	size_t size;
+	const char * string = readJournalData (cur, end, &size);
+	if (!string || size == 0 || string[size - 1] != '\0') return 0;
+	return string;
+}
+
+/**
+ * @brief Reads the records of a journal file.
+ *
+ * @param cur the first record
+ * @param end end of the journal file
+ * @param removed keyset where keys with the names of removed keys are appended
+ *
+ * @return keyset with the added and modified keys
+ * @retval 0 if the journal file is corrupt
+ */
+static KeySet * readJournalRecords (const char * cur, const char * end, KeySet * removed)
+{
+	KeySet * changed = ksNew (0, KS_END);
+
+	while (cur < end)
+	{
+		const char type = *cur++;
+		const char * name = readJournalString (&cur, end);
+		Key * key = name ? keyNew (name, KEY_END) : 0;
+		if (!key) goto error;
+
+		if (type == ELEKTRA_MMAP_JOURNAL_REMOVED)
+		{
+			ksAppendKey (removed, key);
+			continue;
+		}
+		ksAppendKey (changed, key);
+		if (type != ELEKTRA_MMAP_JOURNAL_KEY) goto error;
+
+		size_t valueSize;
+		const char * value = readJournalData (&cur, end, &valueSize);
+		if (!value || keySetRaw (key, value, valueSize) == -1) goto error;
+
+		uint64_t numMeta;
+		if ((size_t) (end - cur) < sizeof (uint64_t)) goto error;
+		memcpy (&numMeta, cur, sizeof (uint64_t));
+		cur += sizeof (uint64_t);
+
+		for (uint64_t i = 0; i < numMeta; ++i)
+		{
+			const char * metaName = readJournalString (&cur, end);
+			const char * metaValue = readJournalString (&cur, end);
+			if (!metaName || !metaValue || keySetMeta (key, metaName, metaValue) == -1) goto error;
+		}
+	}
+
+	return changed;
+
+error:
+	ksDel (changed);
+	return 0;
+}
+
+/**
+ * @brief Writes the changes of a keyset since the base file to a journal file.
+ *
+ * The file read by kdbGet() is either a journal file or becomes the base file of the
+ * new journal file, by linking it as `<file>.<inode>.base`. The keyset is compared with
+ * the keyset stored in the base file and all changes are written to the journal file,
+ * which replaces the file. If the journal file would exceed its maximum size, the whole
+ * keyset needs to be written, which folds the journal into a new file.
+ *
+ * When a journal file is folded, the base files of earlier journal files are removed.
+ *
+ * @param mh the plugin data
+ * @param ks the keyset to be written
+ * @param parentKey holding the filename
+ * @param mode the current plugin mode
+ *
+ * @retval 1 if the journal file was written
+ * @retval 0 if the whole keyset needs to be written
+ */
+static int writeJournal (MmapHandle * mh, KeySet * ks, Key * parentKey, PluginMode mode)
+{
+	if (mh->journal == 0) return 0;
+	MmapFile * file = findFile (mh, keyName (parentKey));
+	if (!file) return 0;
+
+	int fd = -1;
+	int newBase = 0;
+	char * basePath = 0;
+	char * mappedRegion = MAP_FAILED;
+	struct stat sbuf;
+	MmapJournalHeader journalHeader;
+	MmapJournalBuffer buffer = { 0, 0, 0, 0 };
+	memset (&journalHeader, 0, SIZEOF_MMAPJOURNALHEADER);
+
+	int baseFd = open (file->fileName, O_RDONLY);
+	if (baseFd == -1) return 0;
+
+	if (isJournalFile (baseFd))
+	{
+		char * journal = readJournal (baseFd, &journalHeader, mode);
+		close (baseFd);
+		baseFd = -1;
+		if (!journal) goto fallback;
+		basePath = journalBasePath (file->fileName, journal + SIZEOF_MMAPJOURNALHEADER);
+		elektraFree (journal);
+		if ((baseFd = open (basePath, O_RDONLY)) == -1) goto fallback;
+		if (fstat (baseFd, &sbuf) != 0 || (uint64_t) sbuf.st_ino != journalHeader.baseInode) goto fallback;
+	}
+	else
+	{
+		// the file becomes the base file of the journal
+		if (fstat (baseFd, &sbuf) != 0) goto fallback;
+		basePath = elektraFormat ("%s.%llx" ELEKTRA_MMAP_JOURNAL_BASE_SUFFIX, file->fileName, (unsigned long long) sbuf.st_ino);
+		newBase = 1;
+	}
+
+	if (sbuf.st_size < 0) goto fallback;
+
+	MmapHeader * mmapHeader;
+	MmapMetaData * mmapMetaData;
+	if ((mappedRegion = mapStoredFile (baseFd, sbuf.st_size, &mmapHeader, &mmapMetaData)) == MAP_FAILED) goto fallback;
+	if (!newBase && (journalHeader.baseSize != mmapHeader->allocSize || journalHeader.baseAddr != mmapMetaData->baseAddr))
+	{
+		goto fallback;
+	}
+
+	const char * baseName = strrchr (basePath, '/');
+	baseName = baseName ? baseName + 1 : basePath;
+	size_t baseNameSize = strlen (baseName) + 1;
+	if (baseNameSize > UINT16_MAX) goto fallback;
+
+	memset (&journalHeader, 0, SIZEOF_MMAPJOURNALHEADER);
+	journalHeader.mmapMagicNumber = ELEKTRA_MAGIC_MMAP_JOURNAL_NUMBER;
+	journalHeader.baseSize = mmapHeader->allocSize;
+	journalHeader.baseInode = sbuf.st_ino;
+	journalHeader.baseAddr = mmapMetaData->baseAddr;
+	journalHeader.formatVersion = ELEKTRA_MMAP_FORMAT_VERSION;
+	journalHeader.baseNameSize = baseNameSize;
+
+	// replaying a larger journal would make kdbGet() slower than reading a new file
+	buffer.maxSize = SIZEOF_MMAPJOURNALHEADER + baseNameSize + mmapHeader->allocSize / 100 * mh->journal;
+	if (appendJournal (&buffer, &journalHeader, SIZEOF_MMAPJOURNALHEADER) != 0 ||
+	    appendJournal (&buffer, baseName, baseNameSize) != 0 ||
+	    appendJournalChanges (&buffer, mappedRegion, mmapHeader, mmapMetaData, ks) != 0)
+	{
+		goto fallback;
+	}
+
+	journalHeader.journalSize = buffer.size;
+#ifdef ELEKTRA_MMAP_CHECKSUM
+	set_bit (journalHeader.formatFlags, MMAP_FLAG_CHECKSUM);
+	journalHeader.checksum = crc32 (0L, Z_NULL, 0);
+	journalHeader.checksum = crc32 (journalHeader.checksum, (const unsigned char *) (buffer.data + SIZEOF_MMAPJOURNALHEADER),
+					buffer.size - SIZEOF_MMAPJOURNALHEADER);
+#endif
+	memcpy (buffer.data, &journalHeader, SIZEOF_MMAPJOURNALHEADER);
+
+	// the file might have been replaced since it was opened
+	struct stat baseBuf;
+	if (newBase && link (file->fileName, basePath) != 0 && errno != EEXIST) goto fallback;
+	if (stat (basePath, &baseBuf) != 0 || baseBuf.st_ino != sbuf.st_ino) goto fallback;
+
+	if (unlink (keyString (parentKey)) != 0 && errno != ENOENT) goto fallback;
+	if ((fd = openFile (parentKey, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR, mode)) == -1) goto fallback;
+
+	size_t writtenBytes = 0;
+	while (writtenBytes < buffer.size)
+	{
+		ssize_t ret = write (fd, buffer.data + writtenBytes, buffer.size - writtenBytes);
+		if (ret == -1 && errno == EINTR) continue;
+		if (ret <= 0) goto fallback;
+		writtenBytes += ret;
+	}
+
+	if (fsync (fd) != 0) goto fallback;
+	ELEKTRA_LOG_DEBUG ("wrote journal of %zu bytes for base file of %" PRIu64 " bytes", buffer.size, journalHeader.baseSize);
+
+	close (fd);
+	munmap (mappedRegion, sbuf.st_size);
+	close (baseFd);
+	elektraFree (basePath);
+	elektraFree (buffer.data);
+	return 1;
+
+fallback:
+	ELEKTRA_LOG_DEBUG ("write the whole keyset");
+	if (fd != -1) close (fd);
+	if (mappedRegion != MAP_FAILED) munmap (mappedRegion, sbuf.st_size);
+	if (baseFd != -1) close (baseFd);
+	if (basePath && !newBase) removeStaleBaseFiles (file->fileName, basePath);
+	if (basePath) elektraFree (basePath);
+	if (buffer.data) elektraFree (buffer.data);
+	return 0;
+}
+
 /* -- Exported Elektra Plugin Functions ------------------------------------------------------------------------------------------------- */
 
 /**
@@ -1231,6 +2170,7 @@ int ELEKTRA_PLUGIN_FUNCTION (open) (Plugin * handle ELEKTRA_UNUSED, Key * errorK
 	if (offsetof (MmapHeader, reservedB) != STATIC_HEADER_OFFSETOF_RESERVED_B) goto error;
 	if (sizeof (MmapFooter) != STATIC_SIZEOF_MMAPFOOTER) goto error;
 	if (offsetof (MmapFooter, mmapMagicNumber) != STATIC_FOOTER_OFFSETOF_MAGICNUMBER) goto error;
+	if (sizeof (MmapJournalHeader) != STATIC_SIZEOF_MMAPJOURNALHEADER) goto error;
 
 	// initialize magic data
 	const uintptr_t magicNumber = generateMagicNumber ();
@@ -1243,6 +2183,22 @@ int ELEKTRA_PLUGIN_FUNCTION (open) (Plugin * handle ELEKTRA_UNUSED, Key * errorK
 	if (magicOpmphmPredictor.ksSize == 0) initMagicOpmphmPredictor (magicNumber);
 #endif
 
+	MmapHandle * mh = elektraCalloc (sizeof (MmapHandle));
+	if (!mh) return ELEKTRA_PLUGIN_STATUS_ERROR;
+	// only the cache plugin reads and writes the global keyset, for backends it holds the data of other plugins
+	mh->globalCache = ksLookupByName (elektraPluginGetConfig (handle), "/globalcache", 0) != 0;
+
+	Key * journal = ksLookupByName (elektraPluginGetConfig (handle), "/journal", 0);
+	if (journal)
+	{
+		// the value is the maximum size of the journal in percent of the base file
+		char * end;
+		long journalSize = strtol (keyString (journal), &end, 10);
+		mh->journal = (*keyString (journal) != '\0' && *end == '\0' && journalSize > 0) ? (size_t) journalSize :
+												      ELEKTRA_MMAP_JOURNAL_DEFAULT_SIZE;
+	}
+	elektraPluginSetData (handle, mh);
+
 	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
 
 error:
@@ -1263,6 +2219,20 @@ error:
 int ELEKTRA_PLUGIN_FUNCTION (close) (Plugin * handle ELEKTRA_UNUSED, Key * errorKey ELEKTRA_UNUSED)
 {
 	// free all plugin resources and shut it down
+	MmapHandle * mh = elektraPluginGetData (handle);
+	if (!mh) return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+
+	MmapFile * file = mh->files;
+	while (file)
+	{
+		MmapFile * next = file->next;
+		elektraFree (file->parentName);
+		elektraFree (file->fileName);
+		elektraFree (file);
+		file = next;
+	}
+	elektraFree (mh);
+	elektraPluginSetData (handle, 0);
 
 	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
 }
@@ -1285,8 +2255,9 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 	// get all keys
 	int errnosave = errno;
 	PluginMode mode = MODE_STORAGE;
+	MmapHandle * mh = elektraPluginGetData (handle);
 
-	if (elektraPluginGetGlobalKeySet (handle) != 0)
+	if (mh->globalCache && elektraPluginGetGlobalKeySet (handle) != 0)
 	{
 		ELEKTRA_LOG_DEBUG ("mmapstorage global position called");
 		mode = MODE_GLOBALCACHE;
@@ -1306,8 +2277,12 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 
 	int fd = -1;
 	char * mappedRegion = MAP_FAILED;
+	KeySet * journalRemoved = 0;
+	KeySet * journalChanged = 0;
 	Key * initialParent = keyDup (parentKey);
+	int retried = 0;
 
+retry:
 	if (elektraStrCmp (keyString (parentKey), STDIN_FILENAME) == 0)
 	{
 		fd = fileno (stdin);
@@ -1325,6 +2300,45 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 		goto error;
 	}
 
+	MmapJournalHeader journalHeader;
+	if (test_bit (mode, MODE_STORAGE) && !test_bit (mode, MODE_NONREGULAR_FILE) && isJournalFile (fd))
+	{
+		// the keyset is stored in the base file, the journal file holds the changes since then
+		char * journal = readJournal (fd, &journalHeader, mode);
+		if (!journal) goto error;
+		journalRemoved = ksNew (0, KS_END);
+		journalChanged = readJournalRecords (journal + SIZEOF_MMAPJOURNALHEADER + journalHeader.baseNameSize,
+						     journal + journalHeader.journalSize, journalRemoved);
+		char * basePath = journalBasePath (keyString (parentKey), journal + SIZEOF_MMAPJOURNALHEADER);
+		elektraFree (journal);
+		if (!journalChanged)
+		{
+			ELEKTRA_MMAP_LOG_WARNING ("journal file is corrupt");
+			elektraFree (basePath);
+			goto error;
+		}
+
+		close (fd);
+		fd = open (basePath, O_RDONLY);
+		elektraFree (basePath);
+		if (fd == -1 && errno == ENOENT && !retried)
+		{
+			// a kdbSet() folded the journal and removed the base file since the journal file was read
+			ELEKTRA_LOG_DEBUG ("base file of journal was removed, read the file again");
+			ksDel (journalRemoved);
+			ksDel (journalChanged);
+			journalRemoved = 0;
+			journalChanged = 0;
+			retried = 1;
+			goto retry;
+		}
+		if (fd == -1 || fstatFile (fd, &sbuf, parentKey, mode) != 1 || (uint64_t) sbuf.st_ino != journalHeader.baseInode)
+		{
+			ELEKTRA_MMAP_LOG_WARNING ("could not open base file of journal");
+			goto error;
+		}
+	}
+
 	if (test_bit (mode, MODE_NONREGULAR_FILE))
 	{
 		// non regular file not mmap compatible, copy to temp file
@@ -1355,7 +2369,7 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 		goto error;
 	}
 
-	mappedRegion = mmapFile ((void *) 0, fd, sbuf.st_size, MAP_PRIVATE, parentKey, mode);
+	mappedRegion = mmapFile (readBaseAddress (fd), fd, sbuf.st_size, MAP_PRIVATE, parentKey, mode);
 	if (mappedRegion == MAP_FAILED)
 	{
 		ELEKTRA_MMAP_LOG_WARNING ("mappedRegion == MAP_FAILED");
@@ -1399,6 +2413,12 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 		goto error;
 	}
 
+	if (journalChanged && (journalHeader.baseSize != mmapHeader->allocSize || journalHeader.baseAddr != mmapMetaData->baseAddr))
+	{
+		ELEKTRA_MMAP_LOG_WARNING ("base file of journal was replaced");
+		goto error;
+	}
+
 #ifdef ELEKTRA_MMAP_CHECKSUM
 	if (verifyChecksum (mappedRegion, mmapHeader, mode) != 0)
 	{
@@ -1419,9 +2439,28 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 		goto error;
 	}
 
-	updatePointers (mmapMetaData, mappedRegion);
+	if ((uintptr_t) mappedRegion != mmapMetaData->baseAddr)
+	{
+		ELEKTRA_LOG_DEBUG ("could not map file at base address, updating pointers");
+		updatePointers (mmapMetaData, mappedRegion);
+	}
+	if (test_bit (mode, MODE_STORAGE) && elektraStrCmp (keyString (initialParent), STDIN_FILENAME) != 0)
+	{
+		rememberFile (mh, keyName (parentKey), keyString (parentKey));
+	}
 	mmapToKeySet (handle, mappedRegion, ks, mode);
 
+	if (journalChanged)
+	{
+		for (size_t i = 0; i < journalRemoved->size; ++i)
+		{
+			keyDel (ksLookup (ks, journalRemoved->array[i], KDB_O_POP));
+		}
+		ksAppend (ks, journalChanged);
+		ksDel (journalRemoved);
+		ksDel (journalChanged);
+	}
+
 	if (close (fd) != 0)
 	{
 		ELEKTRA_MMAP_LOG_WARNING ("could not close");
@@ -1448,6 +2487,8 @@ error:
 		ELEKTRA_MMAP_LOG_WARNING ("could not close");
 	}
 
+	if (journalRemoved) ksDel (journalRemoved);
+	if (journalChanged) ksDel (journalChanged);
 	keySetString (parentKey, keyString (initialParent));
 	if (initialParent) keyDel (initialParent);
 	errno = errnosave;
@@ -1472,8 +2513,9 @@ int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 	// set all keys
 	KeySet * global = 0;
 	PluginMode mode = MODE_STORAGE;
+	MmapHandle * mh = elektraPluginGetData (handle);
 
-	if ((global = elektraPluginGetGlobalKeySet (handle)) != 0)
+	if (mh->globalCache && (global = elektraPluginGetGlobalKeySet (handle)) != 0)
 	{
 		ELEKTRA_LOG_DEBUG ("mmapstorage global position called");
 		mode = MODE_GLOBALCACHE;
@@ -1494,6 +2536,21 @@ int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 	}
 	else
 	{
+		if (test_bit (mode, MODE_STORAGE) && writeJournal (mh, ks, parentKey, mode) == 1)
+		{
+			errno = errnosave;
+			keyDel (initialParent);
+			return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+		}
+#ifndef ELEKTRA_MMAP_CHECKSUM
+		if (test_bit (mode, MODE_STORAGE) && writeChangedValues (mh, ks, parentKey, mode) == 1)
+		{
+			errno = errnosave;
+			keyDel (initialParent);
+			return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+		}
+#endif
+
 		if (unlink (keyString (parentKey)) != 0 && errno != ENOENT)
 		{
 			ELEKTRA_MMAP_LOG_WARNING ("could not unlink");
@@ -1534,6 +2591,9 @@ int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle ELEKTRA_UNUSED, KeySet * ks,
 		goto error;
 	}
 
+	// readers that get a mapping at the base address need no pointer updates
+	if (!test_bit (mode, MODE_NONREGULAR_FILE)) mmapMetaData.baseAddr = randomBaseAddress ();
+
 	MmapFooter mmapFooter;
 	initFooter (&mmapFooter);
 	if (copyKeySetToMmap (mappedRegion, ks, global, &mmapHeader, &mmapMetaData, &mmapFooter, dynArray, mode) != 0)
@@ -14,12 +14,17 @@
 #include <stdio.h> // fopen(), fileno()
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h> // ioctl()
 #include <sys/mman.h>  // mmap()
 #include <sys/stat.h>  // stat(), chmod()
 #include <sys/types.h> // ftruncate ()
 #include <sys/wait.h>  // waitpit()
 #include <unistd.h>    // ftruncate(), pipe(), fork()
 
+#ifdef __linux__
+#include <linux/fs.h> // FICLONE
+#endif
+
 #include <kdbconfig.h>
 #include <kdbprivate.h>
 
@@ -142,7 +147,7 @@ static void test_mmap_get_set (const char * tmpFile)
 static void test_mmap_set_get_global (const char * tmpFile)
 {
 	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
-	KeySet * conf = ksNew (0, KS_END);
+	KeySet * conf = ksNew (1, keyNew ("user/globalcache", KEY_END), KS_END);
 	PLUGIN_OPEN ("mmapstorage");
 	KeySet * ks = ksNew (0, KS_END);
 
@@ -178,7 +183,7 @@ static void test_mmap_set_get_global (const char * tmpFile)
 static void test_mmap_get_global_after_reopen (const char * tmpFile)
 {
 	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
-	KeySet * conf = ksNew (0, KS_END);
+	KeySet * conf = ksNew (1, keyNew ("user/globalcache", KEY_END), KS_END);
 	PLUGIN_OPEN ("mmapstorage");
 	KeySet * ks = ksNew (0, KS_END);
 	plugin->global = ksNew (0, KS_END);
@@ -204,7 +209,7 @@ static void test_mmap_get_global_after_reopen (const char * tmpFile)
 static void test_mmap_set_get_global_metadata (const char * tmpFile)
 {
 	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
-	KeySet * conf = ksNew (0, KS_END);
+	KeySet * conf = ksNew (1, keyNew ("user/globalcache", KEY_END), KS_END);
 	PLUGIN_OPEN ("mmapstorage");
 
 	KeySet * ks = metaTestKeySet ();
@@ -546,6 +551,275 @@ static void test_mmap_get_after_reopen (const char * tmpFile)
 	PLUGIN_CLOSE ();
 }
 
+static int isMappedAt (KeySet * ks, uintptr_t baseAddr, off_t size)
+{
+	return (uintptr_t) ks->array >= baseAddr && (uintptr_t) ks->array < baseAddr + size;
+}
+
+static void test_mmap_base_address (const char * tmpFile)
+{
+	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+	KeySet * ks = simpleTestKeySet ();
+
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+
+	struct stat buf;
+	MmapMetaData mmapMetaData;
+	int fd = open (tmpFile, O_RDONLY);
+	exit_if_fail (fd != -1 && fstat (fd, &buf) == 0, "could not open file");
+	succeed_if (pread (fd, &mmapMetaData, SIZEOF_MMAPMETADATA, OFFSET_MMAPMETADATA) == (ssize_t) SIZEOF_MMAPMETADATA,
+		    "could not read meta data");
+	close (fd);
+#if UINTPTR_MAX > 0xFFFFFFFFu
+	// the base address is random, not the one of the mapping used by kdbSet
+	succeed_if (mmapMetaData.baseAddr >= ELEKTRA_MMAP_BASE_MIN && mmapMetaData.baseAddr < ELEKTRA_MMAP_BASE_MAX &&
+			    mmapMetaData.baseAddr % ELEKTRA_MMAP_BASE_ALIGN == 0,
+		    "file has no random base address");
+#else
+	succeed_if (mmapMetaData.baseAddr == 0, "file has a base address");
+#endif
+
+	// the random address is free in this process, so no pointer needs to be updated
+	KeySet * returned = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, returned, parentKey) == 1, "kdbGet was not successful");
+#if UINTPTR_MAX > 0xFFFFFFFFu
+	succeed_if (isMappedAt (returned, mmapMetaData.baseAddr, buf.st_size), "file not mapped at base address");
+#endif
+	KeySet * expected = simpleTestKeySet ();
+	compare_keyset (expected, returned);
+
+	// the first mapping is still in use, so the pointers must be updated
+	KeySet * relocated = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, relocated, parentKey) == 1, "kdbGet was not successful");
+	succeed_if (!isMappedAt (relocated, mmapMetaData.baseAddr, buf.st_size), "file mapped twice at base address");
+	compare_keyset (expected, relocated);
+
+	ksDel (expected);
+	ksDel (relocated);
+	ksDel (returned);
+
+	keyDel (parentKey);
+	ksDel (ks);
+	PLUGIN_CLOSE ();
+}
+
+static uintptr_t fileBaseAddress (const char * tmpFile)
+{
+	MmapMetaData mmapMetaData;
+	int fd = open (tmpFile, O_RDONLY);
+	exit_if_fail (fd != -1, "could not open file");
+	succeed_if (pread (fd, &mmapMetaData, SIZEOF_MMAPMETADATA, OFFSET_MMAPMETADATA) == (ssize_t) SIZEOF_MMAPMETADATA,
+		    "could not read meta data");
+	close (fd);
+	return mmapMetaData.baseAddr;
+}
+
+static int canCloneFile (const char * tmpFile ELEKTRA_UNUSED)
+{
+#ifdef FICLONE
+	char cloneFile[KEY_NAME_LENGTH];
+	snprintf (cloneFile, sizeof (cloneFile), "%s.clone", tmpFile);
+	int fd = open (tmpFile, O_RDONLY);
+	int cloneFd = open (cloneFile, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	int cloned = fd != -1 && cloneFd != -1 && ioctl (cloneFd, FICLONE, fd) == 0;
+	if (fd != -1) close (fd);
+	if (cloneFd != -1) close (cloneFd);
+	unlink (cloneFile);
+	return cloned;
+#else
+	return 0;
+#endif
+}
+
+static void test_mmap_write_changed_values (const char * tmpFile)
+{
+	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+	KeySet * ks = largeTestKeySet ();
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+	ksDel (ks);
+
+	ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "kdbGet was not successful");
+	uintptr_t baseAddr = fileBaseAddress (tmpFile);
+
+	// a value of the same size is written into a clone of the file
+	int clone = canCloneFile (tmpFile);
+	keySetString (ksLookupByName (ks, TEST_ROOT_KEY "/dir7/key3", 0), "DATA");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (!clone || fileBaseAddress (tmpFile) == baseAddr, "whole file was written for a changed value");
+
+	KeySet * returned = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, returned, parentKey) == 1, "kdbGet was not successful");
+	succeed_if_same_string (keyString (ksLookupByName (returned, TEST_ROOT_KEY "/dir7/key3", 0)), "DATA");
+	succeed_if_same_string (keyString (ksLookupByName (returned, TEST_ROOT_KEY "/dir7/key4", 0)), "data");
+	compare_keyset (ks, returned);
+
+	// the file is written again, if the layout changes
+	keySetString (ksLookupByName (returned, TEST_ROOT_KEY "/dir2/key5", 0), "longer data");
+	keySetMeta (ksLookupByName (returned, TEST_ROOT_KEY "/dir2/key6", 0), "some", "meta");
+	succeed_if (plugin->kdbSet (plugin, returned, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (fileBaseAddress (tmpFile) != baseAddr, "file was not written for a changed layout");
+
+	KeySet * reread = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, reread, parentKey) == 1, "kdbGet was not successful");
+	succeed_if_same_string (keyString (ksLookupByName (reread, TEST_ROOT_KEY "/dir2/key5", 0)), "longer data");
+	succeed_if_same_string (keyString (keyGetMeta (ksLookupByName (reread, TEST_ROOT_KEY "/dir2/key6", 0), "some")), "meta");
+	compare_keyset (returned, reread);
+
+	ksDel (reread);
+	ksDel (returned);
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static int isJournal (const char * tmpFile)
+{
+	uint64_t magicNumber = 0;
+	int fd = open (tmpFile, O_RDONLY);
+	exit_if_fail (fd != -1, "could not open file");
+	succeed_if (pread (fd, &magicNumber, sizeof (uint64_t), 0) == (ssize_t) sizeof (uint64_t), "could not read magic number");
+	close (fd);
+	return magicNumber == ELEKTRA_MAGIC_MMAP_JOURNAL_NUMBER;
+}
+
+static void baseFileName (const char * tmpFile, char * baseFile, size_t size)
+{
+	struct stat sbuf;
+	exit_if_fail (stat (tmpFile, &sbuf) == 0, "could not stat file");
+	snprintf (baseFile, size, "%s.%llx" ELEKTRA_MMAP_JOURNAL_BASE_SUFFIX, tmpFile, (unsigned long long) sbuf.st_ino);
+}
+
+static void test_mmap_journalDisabled (const char * tmpFile)
+{
+	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+
+	// files named like base files are left alone without the journal
+	char baseFile[KEY_NAME_LENGTH];
+	snprintf (baseFile, sizeof (baseFile), "%s.abc" ELEKTRA_MMAP_JOURNAL_BASE_SUFFIX, tmpFile);
+	FILE * file = fopen (baseFile, "w");
+	exit_if_fail (file, "could not create file");
+	fclose (file);
+
+	KeySet * ks = largeTestKeySet ();
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "kdbGet was not successful");
+	keySetString (ksLookupByName (ks, TEST_ROOT_KEY "/dir7/key3", 0), "a longer value");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (!isJournal (tmpFile), "journal was written although it is disabled");
+	succeed_if (access (baseFile, F_OK) == 0, "file was removed although the journal is disabled");
+
+	unlink (baseFile);
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
+static void test_mmap_journal (const char * tmpFile)
+{
+	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
+	KeySet * conf = ksNew (1, keyNew ("user/journal", KEY_VALUE, "50", KEY_END), KS_END);
+	PLUGIN_OPEN ("mmapstorage");
+	KeySet * ks = largeTestKeySet ();
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+	ksDel (ks);
+
+	ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "kdbGet was not successful");
+	char baseFile[KEY_NAME_LENGTH];
+	baseFileName (tmpFile, baseFile, sizeof (baseFile));
+
+	// changes are written to a journal, the file becomes its base file
+	keySetString (ksLookupByName (ks, TEST_ROOT_KEY "/dir7/key3", 0), "a longer value");
+	keySetMeta (ksLookupByName (ks, TEST_ROOT_KEY "/dir2/key6", 0), "some", "meta");
+	keyDel (ksLookupByName (ks, TEST_ROOT_KEY "/dir2/key5", KDB_O_POP));
+	ksAppendKey (ks, keyNew (TEST_ROOT_KEY "/dir2/new", KEY_BINARY, KEY_SIZE, 3, KEY_VALUE, "\x1\0\x2", KEY_END));
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (isJournal (tmpFile), "changes were not written to a journal");
+	succeed_if (access (baseFile, F_OK) == 0, "base file of journal does not exist");
+
+	KeySet * returned = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, returned, parentKey) == 1, "kdbGet was not successful");
+	succeed_if_same_string (keyString (ksLookupByName (returned, TEST_ROOT_KEY "/dir7/key3", 0)), "a longer value");
+	succeed_if (ksLookupByName (returned, TEST_ROOT_KEY "/dir2/key5", 0) == 0, "removed key was returned");
+	succeed_if (keyIsBinary (ksLookupByName (returned, TEST_ROOT_KEY "/dir2/new", 0)), "added key is not binary");
+	compare_keyset (ks, returned);
+
+	// further changes are written to a journal for the same base file
+	keySetString (ksLookupByName (returned, TEST_ROOT_KEY "/dir1/key1", 0), "");
+	keyDel (ksLookupByName (returned, TEST_ROOT_KEY "/dir2/new", KDB_O_POP));
+	succeed_if (plugin->kdbSet (plugin, returned, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (isJournal (tmpFile), "changes were not written to a journal");
+	succeed_if (access (baseFile, F_OK) == 0, "base file of journal does not exist");
+
+	KeySet * reread = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, reread, parentKey) == 1, "kdbGet was not successful");
+	succeed_if (ksLookupByName (reread, TEST_ROOT_KEY "/dir2/new", 0) == 0, "removed key was returned");
+	compare_keyset (returned, reread);
+
+	// the journal is folded into a new file once it is too large
+	for (cursor_t it = 0; it < ksGetSize (reread); ++it)
+	{
+		keySetString (ksAtCursor (reread, it), "a value which is much longer than the value before");
+	}
+	succeed_if (plugin->kdbSet (plugin, reread, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (!isJournal (tmpFile), "large journal was written");
+	ksDel (returned);
+	returned = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, returned, parentKey) == 1, "kdbGet was not successful");
+	compare_keyset (reread, returned);
+
+	// the base file is kept for readers of the replaced journal file
+	char newBaseFile[KEY_NAME_LENGTH];
+	baseFileName (tmpFile, newBaseFile, sizeof (newBaseFile));
+	keySetString (ksLookupByName (returned, TEST_ROOT_KEY "/dir1/key1", 0), "changed");
+	succeed_if (plugin->kdbSet (plugin, returned, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (isJournal (tmpFile), "changes were not written to a journal");
+	succeed_if (access (baseFile, F_OK) == 0, "base file was removed before the next compaction");
+	succeed_if (access (newBaseFile, F_OK) == 0, "base file of journal does not exist");
+
+	ksDel (reread);
+	reread = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, reread, parentKey) == 1, "kdbGet was not successful");
+	compare_keyset (returned, reread);
+
+	// the next compaction removes it
+	for (cursor_t it = 0; it < ksGetSize (reread); ++it)
+	{
+		keySetString (ksAtCursor (reread, it), "a value which is much longer than the value before, once again");
+	}
+	succeed_if (plugin->kdbSet (plugin, reread, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (!isJournal (tmpFile), "large journal was written");
+	succeed_if (access (baseFile, F_OK) != 0, "unused base file was not removed");
+	succeed_if (access (newBaseFile, F_OK) == 0, "base file of replaced journal was removed");
+
+	// a journal without its base file cannot be read
+	ksDel (returned);
+	returned = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, returned, parentKey) == 1, "kdbGet was not successful");
+	baseFileName (tmpFile, baseFile, sizeof (baseFile));
+	keySetString (ksLookupByName (returned, TEST_ROOT_KEY "/dir1/key1", 0), "changed again");
+	succeed_if (plugin->kdbSet (plugin, returned, parentKey) == 1, "kdbSet was not successful");
+	succeed_if (isJournal (tmpFile), "changes were not written to a journal");
+	unlink (baseFile);
+	ksDel (reread);
+	reread = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, reread, parentKey) == ELEKTRA_PLUGIN_STATUS_ERROR, "journal without base file was read");
+
+	unlink (newBaseFile);
+	ksDel (reread);
+	ksDel (returned);
+	ksDel (ks);
+	keyDel (parentKey);
+	PLUGIN_CLOSE ();
+}
+
 static void test_mmap_set_get_large_keyset (const char * tmpFile)
 {
 	Key * parentKey = keyNew (TEST_ROOT_KEY, KEY_VALUE, tmpFile, KEY_END);
@@ -1128,6 +1402,10 @@ int main (int argc, char ** argv)
 	clearStorage (tmpFile);
 	test_mmap_set_get (tmpFile);
 	test_mmap_get_after_reopen (tmpFile);
+	test_mmap_base_address (tmpFile);
+	test_mmap_write_changed_values (tmpFile);
+	test_mmap_journal (tmpFile);
+	test_mmap_journalDisabled (tmpFile);
 	test_mmap_set_get_large_keyset (tmpFile);
 	test_mmap_ks_copy (tmpFile);
 
@@ -14,6 +14,7 @@
 
 #include <kdbease.h>
 #include <kdberrors.h>
+#include <kdbproposal.h>
 
 #include <errno.h>
 #include <string.h>
@@ -59,8 +60,9 @@ int elektraNiGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * paren
 			keySetMeta (k, elektraNi_GetName (mcur, NULL), elektraNi_GetValue (mcur, NULL));
 			// printf("get meta %s %s from %s\n", elektraNi_GetName(mcur, NULL), elektraNi_GetValue (mcur, NULL), keyName(k));
 		}
-		ksAppendKey (returned, k);
+		elektraKsBulkAppendKey (returned, k);
 	}
+	elektraKsBulkFinish (returned);
 
 	elektraNi_Free (root);
 
@@ -0,0 +1,410 @@
+/**
+ * @file
+ *
+ * @brief Source for the compressed variant of the quickdump plugin
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+#include <zstd.h>
+
+#define COMPRESSION_CODEC 's'
+#define COMPRESSION_LEVEL 3
+
+// a zstd block holds at most ZSTD_BLOCKSIZE_MAX bytes and needs at least 4 bytes (header and one repeated byte)
+#define QUICKDUMP_MAX_COMPRESSION_RATIO (ZSTD_BLOCKSIZE_MAX / 4)
+#else
+#include <zlib.h>
+
+#define COMPRESSION_CODEC 'z'
+#define COMPRESSION_LEVEL Z_BEST_SPEED
+
+// deflate compresses at most by this factor
+#define QUICKDUMP_MAX_COMPRESSION_RATIO 1032
+#endif
+
+// the arena is grown for at most this many blocks at once
+#define QUICKDUMP_RESERVE_BLOCKS 64
+
+// blocks are at most this large, unless they end with a large key
+#define QUICKDUMP_MAX_BLOCK_SIZE (4 * QUICKDUMP_BLOCK_SIZE)
+
+/**
+ * @brief The state of the codec, which is reused for all blocks of a file.
+ */
+struct codec
+{
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+	ZSTD_CCtx * compress;
+	ZSTD_DCtx * decompress;
+#else
+	// zlib keeps no state between blocks
+	int unused;
+#endif
+};
+
+/**
+ * @brief Sets up @p codec for either compressing or decompressing blocks.
+ *
+ * @retval true on success
+ * @retval false on memory error
+ */
+static bool openCodec (struct codec * codec, bool compress)
+{
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+	codec->compress = compress ? ZSTD_createCCtx () : NULL;
+	codec->decompress = compress ? NULL : ZSTD_createDCtx ();
+	return codec->compress != NULL || codec->decompress != NULL;
+#else
+	(void) compress;
+	codec->unused = 0;
+	return true;
+#endif
+}
+
+static void closeCodec (struct codec * codec)
+{
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+	ZSTD_freeCCtx (codec->compress);
+	ZSTD_freeDCtx (codec->decompress);
+#else
+	(void) codec;
+#endif
+}
+
+static size_t compressBlockBound (size_t size)
+{
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+	return ZSTD_compressBound (size);
+#else
+	return compressBound (size);
+#endif
+}
+
+/**
+ * @brief Compresses @p size bytes of @p data into @p compressed.
+ *
+ * @param[in,out] compressedSize the space in @p compressed, afterwards the size of the compressed data
+ *
+ * @retval true on success
+ * @retval false on error
+ */
+static bool compressBlock (struct codec * codec, const char * data, size_t size, char * compressed, size_t * compressedSize)
+{
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+	size_t result = ZSTD_compressCCtx (codec->compress, compressed, *compressedSize, data, size, COMPRESSION_LEVEL);
+	if (ZSTD_isError (result)) return false;
+	*compressedSize = result;
+	return true;
+#else
+	(void) codec;
+	uLongf result = *compressedSize;
+	if (compress2 ((Bytef *) compressed, &result, (const Bytef *) data, size, COMPRESSION_LEVEL) != Z_OK) return false;
+	*compressedSize = result;
+	return true;
+#endif
+}
+
+/**
+ * @brief Decompresses a block, which has to be exactly @p size bytes long when decompressed.
+ *
+ * @retval true on success
+ * @retval false if the block is invalid
+ */
+static bool decompressBlock (struct codec * codec, const char * compressed, size_t compressedSize, char * data, size_t size)
+{
+#ifdef ELEKTRA_QUICKDUMP_ZSTD
+	size_t result = ZSTD_decompressDCtx (codec->decompress, data, size, compressed, compressedSize);
+	return !ZSTD_isError (result) && result == size;
+#else
+	(void) codec;
+	uLongf result = size;
+	return uncompress ((Bytef *) data, &result, (const Bytef *) compressed, compressedSize) == Z_OK && result == size;
+#endif
+}
+
+static size_t sharedPrefix (const char * a, size_t aSize, const char * b, size_t bSize)
+{
+	size_t size = aSize < bSize ? aSize : bSize;
+	size_t i = 0;
+	while (i < size && a[i] == b[i])
+	{
+		++i;
+	}
+	return i;
+}
+
+/**
+ * @brief Writes a key name front coded, as read by decodeFrontNameV4().
+ *
+ * @param[in,out] previous the previous name of the block, afterwards the given name
+ */
+static void bufferFrontName (struct stringbuffer * buffer, struct nameV4 * previous, const char * name, size_t size,
+			     const char * unescapedName, size_t unescapedSize)
+{
+	size_t shared = sharedPrefix (previous->name, previous->size - 1, name, size);
+	size_t unescapedShared = sharedPrefix (previous->unescaped, previous->unescapedSize, unescapedName, unescapedSize);
+
+	bufferVarint (buffer, shared);
+	bufferVarint (buffer, unescapedShared);
+	bufferVarint (buffer, size - shared);
+	bufferVarint (buffer, unescapedSize - unescapedShared);
+	bufferData (buffer, name + shared, size - shared);
+	bufferChar (buffer, 0);
+	bufferData (buffer, unescapedName + unescapedShared, unescapedSize - unescapedShared);
+
+	previous->name = name;
+	previous->size = size + 1;
+	previous->unescaped = unescapedName;
+	previous->unescapedSize = unescapedSize;
+}
+
+/**
+ * @brief Writes @p block compressed, unless it is empty.
+ *
+ * A block consists of its decompressed size, its compressed size and the compressed data.
+ *
+ * @param compressed the buffer for the compressed data
+ * @param codec the codec opened for compressing
+ */
+static bool writeCompressedBlock (FILE * file, struct stringbuffer * block, struct stringbuffer * compressed, struct codec * codec,
+				  Key * errorKey)
+{
+	if (block->offset == 0) return true;
+
+	ensureBufferSize (compressed, compressBlockBound (block->offset));
+	size_t compressedSize = compressed->alloc;
+	if (!compressBlock (codec, block->string, block->offset, compressed->string, &compressedSize))
+	{
+		ELEKTRA_SET_INTERNAL_ERROR (errorKey, "Could not compress block");
+		return false;
+	}
+
+	if (!varintWrite (file, block->offset) || !varintWrite (file, compressedSize) ||
+	    fwrite (compressed->string, sizeof (char), compressedSize, file) < compressedSize)
+	{
+		ELEKTRA_SET_RESOURCE_ERROR (errorKey, "Error while writing file");
+		return false;
+	}
+	block->offset = 0;
+	return true;
+}
+
+static void resetFront (struct frontV4 * front)
+{
+	front->name.offset = 0;
+	front->unescaped.offset = 0;
+}
+
+/**
+ * @brief Reads a compressed file block by block.
+ *
+ * Only one decompressed block is kept in memory. Its keys are validated
+ * and then created the same way as the keys of a v4 file.
+ *
+ * @param file the file, positioned after the magic number
+ */
+static int readCompressed (FILE * file, KeySet * returned, Key * parentKey)
+{
+	char * mapped;
+	size_t mappedSize = 0;
+	size_t dataSize;
+	const char * data = loadData (file, &mapped, &mappedSize, &dataSize, parentKey);
+	if (data == NULL)
+	{
+		fclose (file);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+
+	const char * cur = data;
+	const char * end = data + dataSize;
+	if (cur == end || *cur != COMPRESSION_CODEC)
+	{
+		if (cur == end)
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Premature end of file");
+		}
+		else
+		{
+			ELEKTRA_SET_INSTALLATION_ERRORF (parentKey, "The file was compressed with the unsupported codec %c", *cur);
+		}
+		unloadData (data, mapped, mappedSize);
+		fclose (file);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+	++cur;
+
+	// names of the keys are relative to the parent key
+	struct nameV4 parent = { keyName (parentKey), keyGetNameSize (parentKey), keyUnescapedName (parentKey),
+				 keyGetUnescapedNameSize (parentKey) };
+
+	struct frontV4 front;
+	setupBuffer (&front.name, 256);
+	setupBuffer (&front.unescaped, 256);
+	struct stringbuffer block;
+	setupBuffer (&block, QUICKDUMP_BLOCK_SIZE);
+
+	size_t metaAlloc = 16;
+	size_t metaCount = 0;
+	Key ** metaKeys = elektraMalloc (metaAlloc * sizeof (Key *));
+	ElektraArena * arena = elektraArenaNew ();
+	struct codec codec;
+	bool codecOpened = openCodec (&codec, false);
+
+	bool success = metaKeys != NULL && arena != NULL && codecOpened;
+	if (!success) ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+
+	// on errors in later blocks the keys of earlier blocks are removed again
+	size_t returnedSize = returned->size;
+	size_t keyCount = 0;
+	size_t reservedBytes = 0;
+	size_t reservedObjects = 0;
+	while (success)
+	{
+		kdb_unsigned_long_long_t size;
+		size_t compressedSize;
+		if (!varintDecode (&cur, end, &size))
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Premature end of file");
+			success = false;
+			break;
+		}
+
+		if (size == 0)
+		{
+			// end of the keys
+			break;
+		}
+
+		if (!decodeSize (&cur, end, &compressedSize, parentKey))
+		{
+			success = false;
+			break;
+		}
+
+		// larger blocks end with a large key, the codec cannot have compressed them to fewer bytes than this
+		if (size > QUICKDUMP_MAX_BLOCK_SIZE && size / QUICKDUMP_MAX_COMPRESSION_RATIO > compressedSize)
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERRORF (
+				parentKey, "Compressed block of " ELEKTRA_UNSIGNED_LONG_LONG_F " bytes is too large", size);
+			success = false;
+			break;
+		}
+
+		if (size != (size_t) size || (size > block.alloc && elektraRealloc ((void **) &block.string, size) == -1))
+		{
+			ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+			success = false;
+			break;
+		}
+		block.alloc = size > block.alloc ? size : block.alloc;
+
+		if (!decompressBlock (&codec, cur, compressedSize, block.string, size))
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Invalid compressed block");
+			success = false;
+			break;
+		}
+		const char * blockStart = cur;
+		cur += compressedSize;
+
+		// first validate the whole block, so that the keys can be created without any checks
+		struct scanV4 scan = { .metaCount = metaCount };
+		const char * blockEnd = block.string + size;
+		resetFront (&front);
+		if (!scanV4 (block.string, blockEnd, &parent, &front, &scan, parentKey))
+		{
+			success = false;
+			break;
+		}
+
+		if (scan.opmphm != NULL)
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Unexpected hash map in compressed block");
+			success = false;
+			break;
+		}
+
+		if (scan.metaCount > metaAlloc)
+		{
+			while (metaAlloc < scan.metaCount)
+			{
+				metaAlloc *= 2;
+			}
+			success = elektraRealloc ((void **) &metaKeys, metaAlloc * sizeof (Key *)) != -1;
+		}
+
+		if (success && (scan.bytes > reservedBytes || scan.objects > reservedObjects))
+		{
+			// reserve for the following blocks as well, assuming they are similar to this one,
+			// so that the keys do not need a separate chunk for every block
+			size_t blocks = (end - blockStart) / compressedSize;
+			blocks = blocks < 1 ? 1 : blocks > QUICKDUMP_RESERVE_BLOCKS ? QUICKDUMP_RESERVE_BLOCKS : blocks;
+			reservedBytes = scan.bytes * blocks;
+			reservedObjects = scan.objects * blocks;
+			if (elektraArenaReserve (arena, reservedBytes, reservedObjects) == -1)
+			{
+				reservedBytes = scan.bytes;
+				reservedObjects = scan.objects;
+				success = elektraArenaReserve (arena, reservedBytes, reservedObjects) != -1;
+			}
+		}
+
+		if (!success)
+		{
+			ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+			break;
+		}
+		reservedBytes -= scan.bytes;
+		reservedObjects -= scan.objects;
+
+		resetFront (&front);
+		if (!buildKeysV4 (block.string, blockEnd, &parent, &front, scan.keyCount, arena, metaKeys, &metaCount, returned, parentKey))
+		{
+			ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+			success = false;
+			break;
+		}
+		keyCount += scan.keyCount;
+	}
+	for (size_t i = returnedSize; !success && i < returned->size; ++i)
+	{
+		keyDecRef (returned->array[i]);
+		keyDel (returned->array[i]);
+	}
+	if (!success) returned->size = returnedSize;
+	elektraKsBulkFinish (returned);
+
+	closeCodec (&codec);
+	elektraArenaDel (arena);
+	if (metaKeys) elektraFree (metaKeys);
+	elektraFree (block.string);
+	elektraFree (front.name.string);
+	elektraFree (front.unescaped.string);
+
+	// the OPMPHM follows uncompressed, the same as in a v4 file
+	if (success && cur < end)
+	{
+		struct keyV4 key;
+		if (!decodeKeyV4 (&cur, end, NULL, &key, parentKey))
+		{
+			success = false;
+		}
+		else if (key.type != 'o')
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Unexpected data after the last block");
+			success = false;
+		}
+		else if (fseek (file, sizeof (kdb_unsigned_long_long_t) + (cur - data), SEEK_SET) == 0)
+		{
+			success = readOpmphm (file, returned, parentKey, keyCount);
+		}
+	}
+
+	unloadData (data, mapped, mappedSize);
+	fclose (file);
+
+	return success ? ELEKTRA_PLUGIN_STATUS_SUCCESS : ELEKTRA_PLUGIN_STATUS_ERROR;
+}
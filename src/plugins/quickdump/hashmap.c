@@ -0,0 +1,285 @@
+/**
+ * @file
+ *
+ * @brief Persisted OPMPHM for quickdump plugin
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+// number of graph entries converted at once
+#define OPMPHM_GRAPH_CHUNK 1024
+
+/**
+ * Header of a persisted OPMPHM
+ */
+struct opmphmHeader
+{
+	bool sameParent;			 /*!< the OPMPHM was written with the same parent key */
+	kdb_unsigned_long_long_t n;		 /*!< the number of keys */
+	int rUniPar;				 /*!< see Opmphm */
+	kdb_unsigned_long_long_t componentSize;	 /*!< see Opmphm */
+	kdb_unsigned_long_long_t seeds[10];	 /*!< the rUniPar hash function seeds */
+};
+
+/**
+ * @brief Reads everything of the OPMPHM written by writeOpmphm() but the graph.
+ *
+ * @param file the file, positioned after the 'o' marker
+ * @param header the header to fill
+ * @param parentKey the parent key
+ *
+ * @retval true on success
+ * @retval false on read error
+ */
+static bool readOpmphmHeader (FILE * file, struct opmphmHeader * header, Key * parentKey)
+{
+	struct stringbuffer parentBuffer;
+	setupBuffer (&parentBuffer, 4);
+	if (!readStringIntoBuffer (file, &parentBuffer, parentKey))
+	{
+		elektraFree (parentBuffer.string);
+		return false;
+	}
+	header->sameParent = elektraStrCmp (parentBuffer.string, keyName (parentKey)) == 0;
+	elektraFree (parentBuffer.string);
+
+	if (!varintRead (file, &header->n) || (header->rUniPar = fgetc (file)) == EOF || !varintRead (file, &header->componentSize))
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, feof (file) ? "Premature end of file" : "Unknown error");
+		return false;
+	}
+	if (header->rUniPar < 2 || header->rUniPar > 10 || header->componentSize == 0 || header->componentSize > UINT32_MAX)
+	{
+		ELEKTRA_SET_VALIDATION_SEMANTIC_ERROR (parentKey, "Invalid hash map");
+		return false;
+	}
+
+	for (int r = 0; r < header->rUniPar; ++r)
+	{
+		if (!varintRead (file, &header->seeds[r]))
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, feof (file) ? "Premature end of file" : "Unknown error");
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+
+/**
+ * @brief Checks whether the OPMPHM of @p ks maps to the current positions of its keys.
+ */
+static bool opmphmUsable (const KeySet * ks)
+{
+	return ks->opmphm && ks->opmphm->size && (!ks->opmphmDelta || !ks->opmphmDelta->size);
+}
+
+static void opmphmDelete (Opmphm * opmphm)
+{
+	if (opmphm->size && !test_bit (opmphm->flags, OPMPHM_FLAG_MMAP_GRAPH))
+	{
+		elektraFree (opmphm->graph);
+	}
+	if (opmphm->rUniPar && !test_bit (opmphm->flags, OPMPHM_FLAG_MMAP_HASHFUNCTIONSEEDS))
+	{
+		elektraFree (opmphm->hashFunctionSeeds);
+	}
+	if (!test_bit (opmphm->flags, OPMPHM_FLAG_MMAP_STRUCT)) elektraFree (opmphm);
+}
+
+/**
+ * @brief Writes the OPMPHM of @p returned after the last key.
+ *
+ * The OPMPHM is built first, if needed. Nothing is written, if there is no OPMPHM
+ * matching the current keys (e.g. the KeySet was changed since the OPMPHM was built).
+ *
+ * @retval true on success
+ * @retval false on write error
+ */
+static bool writeOpmphm (FILE * file, KeySet * returned, Key * parentKey)
+{
+	if (returned->size == 0) return true;
+
+	// the names must be the same when reading
+	const char * parentName = keyName (parentKey);
+	size_t parentSize = keyGetNameSize (parentKey) - 1;
+	for (size_t i = 0; i < returned->size; ++i)
+	{
+		const char * name = keyName (returned->array[i]);
+		if (strncmp (name, parentName, parentSize) || (name[parentSize] != '/' && name[parentSize] != '\0')) return true;
+	}
+
+	if (!opmphmUsable (returned))
+	{
+		ksLookup (returned, returned->array[0], KDB_O_OPMPHM | KDB_O_NOCASCADING);
+	}
+	if (!opmphmUsable (returned)) return true;
+
+	const Opmphm * opmphm = returned->opmphm;
+
+	// an empty name followed by 'o' marks the OPMPHM
+	if (!writeName (file, "", 0, "", 0, parentKey) || fputc ('o', file) == EOF)
+	{
+		return false;
+	}
+
+	// the OPMPHM hashes full names, it only fits if the parent key is the same when reading
+	if (!writeData (file, keyName (parentKey), keyGetNameSize (parentKey) - 1, parentKey))
+	{
+		return false;
+	}
+
+	if (!varintWrite (file, returned->size) || fputc (opmphm->rUniPar, file) == EOF || !varintWrite (file, opmphm->componentSize))
+	{
+		return false;
+	}
+
+	for (uint8_t r = 0; r < opmphm->rUniPar; ++r)
+	{
+		if (!varintWrite (file, (uint32_t) opmphm->hashFunctionSeeds[r]))
+		{
+			return false;
+		}
+	}
+
+	uint32_t chunk[OPMPHM_GRAPH_CHUNK];
+	size_t count = opmphm->componentSize * opmphm->rUniPar;
+	for (size_t i = 0; i < count; i += OPMPHM_GRAPH_CHUNK)
+	{
+		size_t chunkSize = count - i < OPMPHM_GRAPH_CHUNK ? count - i : OPMPHM_GRAPH_CHUNK;
+		for (size_t j = 0; j < chunkSize; ++j)
+		{
+			chunk[j] = htole32 (opmphm->graph[i + j]);
+		}
+		if (fwrite (chunk, sizeof (uint32_t), chunkSize, file) < chunkSize)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Reads the OPMPHM written by writeOpmphm() and gives it to @p returned.
+ *
+ * The OPMPHM is only used if @p returned consists of exactly the keys read
+ * from the file and @p parentKey is the one used for writing.
+ * Otherwise it is skipped and will be built on demand as usual.
+ *
+ * @param file the file, positioned after the 'o' marker
+ * @param returned the KeySet with all keys of the file
+ * @param parentKey the parent key
+ * @param fromFile the number of keys read from the file
+ *
+ * @retval true on success
+ * @retval false on read error
+ */
+static bool readOpmphm (FILE * file, KeySet * returned, Key * parentKey, size_t fromFile)
+{
+	struct opmphmHeader header;
+	if (!readOpmphmHeader (file, &header, parentKey))
+	{
+		return false;
+	}
+
+	Opmphm * opmphm = elektraCalloc (sizeof (Opmphm));
+	if (!opmphm)
+	{
+		ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+		return false;
+	}
+	opmphm->rUniPar = header.rUniPar;
+	opmphm->componentSize = header.componentSize;
+	opmphm->size = header.componentSize * header.rUniPar * sizeof (uint32_t);
+	opmphm->hashFunctionSeeds = elektraMalloc (header.rUniPar * sizeof (int32_t));
+	opmphm->graph = elektraMalloc (opmphm->size);
+	if (!opmphm->hashFunctionSeeds || !opmphm->graph)
+	{
+		if (opmphm->hashFunctionSeeds) elektraFree (opmphm->hashFunctionSeeds);
+		if (opmphm->graph) elektraFree (opmphm->graph);
+		elektraFree (opmphm);
+		ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+		return false;
+	}
+	for (int r = 0; r < header.rUniPar; ++r)
+	{
+		opmphm->hashFunctionSeeds[r] = (int32_t) (uint32_t) header.seeds[r];
+	}
+
+	size_t count = header.componentSize * header.rUniPar;
+	if (fread (opmphm->graph, sizeof (uint32_t), count, file) < count)
+	{
+		opmphmDelete (opmphm);
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, feof (file) ? "Premature end of file" : "Unknown error");
+		return false;
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		opmphm->graph[i] = le32toh (opmphm->graph[i]);
+	}
+
+	if (fgetc (file) != EOF)
+	{
+		opmphmDelete (opmphm);
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Unexpected data after hash map");
+		return false;
+	}
+
+	if (!header.sameParent || header.n != fromFile || returned->size != fromFile)
+	{
+		// the positions of the keys differ from the ones when writing
+		opmphmDelete (opmphm);
+		return true;
+	}
+
+	if (returned->opmphm) opmphmDelete (returned->opmphm);
+	returned->opmphm = opmphm;
+	// the OPMPHM maps to the current positions, no delta needed
+	if (returned->opmphmDelta) elektraFree (returned->opmphmDelta);
+	returned->opmphmDelta = NULL;
+	// use it right from the first lookup
+	clear_bit (returned->flags, (keyflag_t) KS_FLAG_NAME_CHANGE);
+	return true;
+}
+
+#else
+
+static bool writeOpmphm (FILE * file ELEKTRA_UNUSED, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+{
+	return true;
+}
+
+/**
+ * @brief Skips the OPMPHM written by writeOpmphm(), without optimizations there is no OPMPHM.
+ */
+static bool readOpmphm (FILE * file, KeySet * returned ELEKTRA_UNUSED, Key * parentKey, size_t fromFile ELEKTRA_UNUSED)
+{
+	struct opmphmHeader header;
+	if (!readOpmphmHeader (file, &header, parentKey))
+	{
+		return false;
+	}
+
+	uint32_t chunk[OPMPHM_GRAPH_CHUNK];
+	size_t count = header.componentSize * header.rUniPar;
+	for (size_t i = 0; i < count; i += OPMPHM_GRAPH_CHUNK)
+	{
+		size_t chunkSize = count - i < OPMPHM_GRAPH_CHUNK ? count - i : OPMPHM_GRAPH_CHUNK;
+		if (fread (chunk, sizeof (uint32_t), chunkSize, file) < chunkSize)
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, feof (file) ? "Premature end of file" : "Unknown error");
+			return false;
+		}
+	}
+
+	if (fgetc (file) != EOF)
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Unexpected data after hash map");
+		return false;
+	}
+	return true;
+}
+
+#endif
@@ -11,21 +11,36 @@
 
 #include <kdbendian.h>
 #include <kdbhelper.h>
+#include <kdbobsolete.h> // for keyNameGetOneLevel
+#include <kdbprivate.h>
 
 #include <kdberrors.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #define MAGIC_NUMBER_BASE (0x454b444200000000UL) // EKDB (in ASCII) + Version placeholder
 
 #define MAGIC_NUMBER_V1 ((kdb_unsigned_long_long_t) (MAGIC_NUMBER_BASE + 1))
 #define MAGIC_NUMBER_V2 ((kdb_unsigned_long_long_t) (MAGIC_NUMBER_BASE + 2))
 #define MAGIC_NUMBER_V3 ((kdb_unsigned_long_long_t) (MAGIC_NUMBER_BASE + 3))
+#define MAGIC_NUMBER_V4 ((kdb_unsigned_long_long_t) (MAGIC_NUMBER_BASE + 4))
+
+#define MAGIC_NUMBER_COMPRESSED_BASE (0x454b444300000000UL) // EKDC (in ASCII) + Version placeholder
+
+#define MAGIC_NUMBER_COMPRESSED_V4 ((kdb_unsigned_long_long_t) (MAGIC_NUMBER_COMPRESSED_BASE + 4))
+
+// keys are written in blocks of about this size, compressed blocks are decompressed one at a time
+#define QUICKDUMP_BLOCK_SIZE (256 * 1024)
 
 struct metaLink
 {
 	const void * meta;
-	size_t keyNameSize;
-	const char * keyName;
+	size_t index; // number of the 'm' entry, which wrote the meta key
 };
 
 struct list
@@ -43,7 +58,7 @@ struct stringbuffer
 };
 
 static ssize_t findMetaLink (struct list * list, const Key * meta);
-static void insertMetaLink (struct list * list, size_t index, const Key * meta, Key * key, size_t parentOffset);
+static void insertMetaLink (struct list * list, size_t index, const Key * meta, size_t metaIndex);
 
 static void setupBuffer (struct stringbuffer * buffer, size_t initialAlloc);
 static void ensureBufferSize (struct stringbuffer * buffer, size_t minSize);
@@ -76,6 +91,57 @@ static inline bool writeData (FILE * file, const char * data, kdb_unsigned_long_
 	return true;
 }
 
+static inline bool writeName (FILE * file, const char * name, kdb_unsigned_long_long_t size, const char * unescapedName,
+			      kdb_unsigned_long_long_t unescapedSize, Key * errorKey)
+{
+	if (!varintWrite (file, size) || !varintWrite (file, unescapedSize) || fwrite (name, sizeof (char), size, file) < size ||
+	    fputc (0, file) == EOF || fwrite (unescapedName, sizeof (char), unescapedSize, file) < unescapedSize)
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, feof (file) ? "Premature end of file" : "Unknown error");
+		return false;
+	}
+	return true;
+}
+
+static inline void bufferData (struct stringbuffer * buffer, const void * data, size_t size)
+{
+	if (size == 0) return;
+	ensureBufferSize (buffer, buffer->offset + size);
+	memcpy (&buffer->string[buffer->offset], data, size);
+	buffer->offset += size;
+}
+
+static inline void bufferChar (struct stringbuffer * buffer, char c)
+{
+	ensureBufferSize (buffer, buffer->offset + 1);
+	buffer->string[buffer->offset++] = c;
+}
+
+static inline void bufferVarint (struct stringbuffer * buffer, kdb_unsigned_long_long_t num)
+{
+	ensureBufferSize (buffer, buffer->offset + 9);
+	buffer->offset += varintEncode ((kdb_octet_t *) &buffer->string[buffer->offset], num);
+}
+
+// same layout as writeName()
+static inline void bufferName (struct stringbuffer * buffer, const char * name, size_t size, const char * unescapedName,
+			       size_t unescapedSize)
+{
+	bufferVarint (buffer, size);
+	bufferVarint (buffer, unescapedSize);
+	bufferData (buffer, name, size);
+	bufferChar (buffer, 0);
+	bufferData (buffer, unescapedName, unescapedSize);
+}
+
+// size includes the null terminator, which is always written
+static inline void bufferString (struct stringbuffer * buffer, const char * string, size_t size)
+{
+	bufferVarint (buffer, size);
+	bufferData (buffer, string, size - 1);
+	bufferChar (buffer, 0);
+}
+
 // for v1 and v2 reading
 static inline bool readUInt64 (FILE * file, kdb_unsigned_long_long_t * valuePtr, Key * errorKey)
 {
@@ -159,279 +225,733 @@ static inline bool readStringIntoBuffer (FILE * file, struct stringbuffer * buff
 #include "readv2.c"
 #undef readStringIntoBuffer
 
-int elektraQuickdumpGet (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+#include "hashmap.c"
+
+#include "readv3.c"
+
+/**
+ * A key name in a v4 file: the escaped name, a null terminator and the unescaped name,
+ * the same layout as in a Key
+ */
+struct nameV4
+{
+	const char * name;	/*!< the escaped name, null terminated */
+	size_t size;		/*!< size of the escaped name including the null terminator */
+	const char * unescaped; /*!< the unescaped name */
+	size_t unescapedSize;	/*!< size of the unescaped name */
+};
+
+/**
+ * The previous key name of a block, key names in compressed files only store what differs from it
+ */
+struct frontV4
 {
-	if (!elektraStrCmp (keyName (parentKey), "system/elektra/modules/quickdump"))
+	struct stringbuffer name;      /*!< the escaped name, offset is its size without the null terminator */
+	struct stringbuffer unescaped; /*!< the unescaped name, offset is its size */
+};
+
+struct keyV4
+{
+	struct nameV4 name; /*!< name relative to the parent key */
+	char type;	    /*!< 'b' or 's', or 'o' if the OPMPHM follows */
+	const char * value;
+	size_t valueSize; /*!< for strings including the null terminator */
+};
+
+struct metaV4
+{
+	char type;		       /*!< 'm' for a new meta key, 'c' for a copy */
+	struct nameV4 name;	       /*!< only for 'm' */
+	const char * value;	       /*!< only for 'm' */
+	size_t valueSize;	       /*!< only for 'm', including the null terminator */
+	kdb_unsigned_long_long_t index; /*!< only for 'c', number of the 'm' entry to copy */
+};
+
+static bool decodeSize (const char ** cur, const char * end, size_t * size, Key * errorKey)
+{
+	kdb_unsigned_long_long_t value;
+	if (!varintDecode (cur, end, &value) || value > (size_t) (end - *cur))
 	{
-		KeySet * contract = ksNew (
-			30, keyNew ("system/elektra/modules/quickdump", KEY_VALUE, "quickdump plugin waits for your orders", KEY_END),
-			keyNew ("system/elektra/modules/quickdump/exports", KEY_END),
-			keyNew ("system/elektra/modules/quickdump/exports/get", KEY_FUNC, elektraQuickdumpGet, KEY_END),
-			keyNew ("system/elektra/modules/quickdump/exports/set", KEY_FUNC, elektraQuickdumpSet, KEY_END),
-#include ELEKTRA_README
-			keyNew ("system/elektra/modules/quickdump/infos/version", KEY_VALUE, PLUGINVERSION, KEY_END), KS_END);
-		ksAppend (returned, contract);
-		ksDel (contract);
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Premature end of file");
+		return false;
+	}
+	*size = value;
+	return true;
+}
 
-		return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+static bool decodeNameV4 (const char ** cur, const char * end, struct nameV4 * name, Key * errorKey)
+{
+	size_t size;
+	size_t unescapedSize;
+	if (!decodeSize (cur, end, &size, errorKey) || !decodeSize (cur, end, &unescapedSize, errorKey))
+	{
+		return false;
+	}
+	if (size + 1 + unescapedSize > (size_t) (end - *cur))
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Premature end of file");
+		return false;
 	}
-	// get all keys
 
-	FILE * file = fopen (keyString (parentKey), "rb");
+	const char * escaped = *cur;
+	if (escaped[size] != '\0' || memchr (escaped, '\0', size) != NULL || (size == 0) != (unescapedSize == 0) ||
+	    (unescapedSize > 0 && escaped[size + unescapedSize] != '\0'))
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Invalid key name");
+		return false;
+	}
 
-	if (file == NULL)
+	name->name = escaped;
+	name->size = size + 1;
+	name->unescaped = escaped + size + 1;
+	name->unescapedSize = unescapedSize;
+	*cur += size + 1 + unescapedSize;
+	return true;
+}
+
+/**
+ * @brief Decodes a front coded key name of a compressed file.
+ *
+ * The name consists of the sizes of the prefixes shared with the previous name of @p front,
+ * the sizes of the suffixes and the suffixes in the same layout as in decodeNameV4().
+ * The decoded name points into @p front and stays valid until the next name is decoded.
+ */
+static bool decodeFrontNameV4 (const char ** cur, const char * end, struct frontV4 * front, struct nameV4 * name, Key * errorKey)
+{
+	kdb_unsigned_long_long_t shared;
+	kdb_unsigned_long_long_t unescapedShared;
+	if (!varintDecode (cur, end, &shared) || !varintDecode (cur, end, &unescapedShared))
 	{
-		ELEKTRA_SET_ERROR_GET (parentKey);
-		return ELEKTRA_PLUGIN_STATUS_ERROR;
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Premature end of file");
+		return false;
 	}
 
-	kdb_unsigned_long_long_t magic;
-	if (fread (&magic, sizeof (kdb_unsigned_long_long_t), 1, file) < 1)
+	size_t suffix;
+	size_t unescapedSuffix;
+	if (!decodeSize (cur, end, &suffix, errorKey) || !decodeSize (cur, end, &unescapedSuffix, errorKey))
 	{
-		if (feof (file) && ftell (file) == 0)
+		return false;
+	}
+	if (suffix + 1 + unescapedSuffix > (size_t) (end - *cur))
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Premature end of file");
+		return false;
+	}
+
+	const char * escaped = *cur;
+	if (shared > front->name.offset || unescapedShared > front->unescaped.offset || escaped[suffix] != '\0' ||
+	    memchr (escaped, '\0', suffix) != NULL)
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Invalid key name");
+		return false;
+	}
+
+	size_t size = shared + suffix;
+	size_t unescapedSize = unescapedShared + unescapedSuffix;
+	ensureBufferSize (&front->name, size + 1);
+	ensureBufferSize (&front->unescaped, unescapedSize + 1);
+	memcpy (&front->name.string[shared], escaped, suffix + 1);
+	memcpy (&front->unescaped.string[unescapedShared], escaped + suffix + 1, unescapedSuffix);
+	front->name.offset = size;
+	front->unescaped.offset = unescapedSize;
+
+	if ((size == 0) != (unescapedSize == 0) || (unescapedSize > 0 && front->unescaped.string[unescapedSize - 1] != '\0'))
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Invalid key name");
+		return false;
+	}
+
+	name->name = front->name.string;
+	name->size = size + 1;
+	name->unescaped = front->unescaped.string;
+	name->unescapedSize = unescapedSize;
+	*cur += suffix + 1 + unescapedSuffix;
+	return true;
+}
+
+/**
+ * @brief Decodes a key without its meta keys.
+ *
+ * @param front the previous key name for front coded names, NULL if the name is stored in full
+ */
+static bool decodeKeyV4 (const char ** cur, const char * end, struct frontV4 * front, struct keyV4 * key, Key * errorKey)
+{
+	if (front != NULL ? !decodeFrontNameV4 (cur, end, front, &key->name, errorKey) : !decodeNameV4 (cur, end, &key->name, errorKey))
+	{
+		return false;
+	}
+
+	if (*cur == end)
+	{
+		ELEKTRA_SET_VALIDATION_SEMANTIC_ERROR (errorKey, "Missing key type");
+		return false;
+	}
+	key->type = *(*cur)++;
+
+	switch (key->type)
+	{
+	case 'o':
+		// the OPMPHM follows the last key
+		return true;
+	case 'b':
+	case 's':
+		if (!decodeSize (cur, end, &key->valueSize, errorKey))
 		{
-			fclose (file);
-			return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+			return false;
 		}
-		else
+		key->value = *cur;
+		*cur += key->valueSize;
+		if (key->type == 's' && (key->valueSize == 0 || key->value[key->valueSize - 1] != '\0'))
 		{
-			fclose (file);
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Invalid string value");
+			return false;
 		}
+		return true;
+	default:
+		ELEKTRA_SET_VALIDATION_SEMANTIC_ERRORF (errorKey, "Unknown key type %c", key->type);
+		return false;
 	}
-	magic = be64toh (magic); // magic number is written big endian so EKDB magic string is readable
+}
 
-	switch (magic)
+/**
+ * @retval 1 if a meta entry was decoded
+ * @retval 0 at the end of the key
+ * @retval -1 on error
+ */
+static int decodeMetaV4 (const char ** cur, const char * end, struct metaV4 * meta, Key * errorKey)
+{
+	if (*cur == end)
 	{
-	case MAGIC_NUMBER_V1:
-		return readVersion1 (file, returned, parentKey);
-	case MAGIC_NUMBER_V2:
-		return readVersion2 (file, returned, parentKey);
-	case MAGIC_NUMBER_V3:
-		// break, current version implemented below
-		break;
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Missing key end");
+		return -1;
+	}
+	meta->type = *(*cur)++;
+
+	switch (meta->type)
+	{
+	case 0:
+		return 0;
+	case 'm':
+		if (!decodeNameV4 (cur, end, &meta->name, errorKey) || !decodeSize (cur, end, &meta->valueSize, errorKey))
+		{
+			return -1;
+		}
+		meta->value = *cur;
+		*cur += meta->valueSize;
+		if (meta->valueSize == 0 || meta->value[meta->valueSize - 1] != '\0')
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Invalid meta value");
+			return -1;
+		}
+		return 1;
+	case 'c':
+		if (!varintDecode (cur, end, &meta->index))
+		{
+			ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Premature end of file");
+			return -1;
+		}
+		return 1;
 	default:
-		fclose (file);
-		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERRORF (parentKey, "Unknown magic number " ELEKTRA_UNSIGNED_LONG_LONG_F, magic);
-		return ELEKTRA_PLUGIN_STATUS_ERROR;
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERRORF (errorKey, "Unknown meta type %c", meta->type);
+		return -1;
+	}
+}
+
+/**
+ * @brief Creates a key, whose name and value are allocated from @p arena.
+ *
+ * @param arena the arena
+ * @param parent the name of the parent key, NULL if @p name is not relative
+ * @param name the name
+ * @param value the value, for strings including the null terminator
+ * @param valueSize the size of the value
+ *
+ * @return the new key
+ * @retval NULL on memory error
+ */
+static Key * newKeyV4 (ElektraArena * arena, const struct nameV4 * parent, const struct nameV4 * name, const char * value, size_t valueSize)
+{
+	Key * key = keyNew (0, KEY_END);
+	if (!key) return NULL;
+
+	// no separator for the parent key itself and below the root key "/"
+	size_t parentSize = parent == NULL ? 0 : parent->size - 1;
+	size_t separatorSize = parent == NULL || name->size == 1 || (parentSize > 0 && parent->name[parentSize - 1] == '/') ? 0 : 1;
+	size_t size = parentSize + separatorSize + name->size;
+	size_t unescapedSize = (parent == NULL ? 0 : parent->unescapedSize) + name->unescapedSize;
+
+	key->key = elektraArenaMalloc (arena, size + unescapedSize);
+	if (valueSize > 0) key->data.v = elektraArenaMalloc (arena, valueSize);
+	key->flags |= KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA;
+	if (!key->key || (valueSize > 0 && !key->data.v))
+	{
+		keyDel (key);
+		return NULL;
+	}
+
+	char * cur = key->key;
+	if (parent != NULL)
+	{
+		memcpy (cur, parent->name, parentSize);
+		cur += parentSize;
+	}
+	if (separatorSize) *cur++ = '/';
+	memcpy (cur, name->name, name->size);
+	cur += name->size;
+	if (parent != NULL)
+	{
+		memcpy (cur, parent->unescaped, parent->unescapedSize);
+		cur += parent->unescapedSize;
 	}
+	memcpy (cur, name->unescaped, name->unescapedSize);
+
+	key->keySize = size;
+	key->keyUSize = unescapedSize;
+	if (valueSize > 0) memcpy (key->data.v, value, valueSize);
+	key->dataSize = valueSize;
+	key->flags |= KEY_FLAG_SYNC;
+	return key;
+}
 
-	// setup buffers
-	struct stringbuffer valueBuffer;
-	setupBuffer (&valueBuffer, 4);
+/**
+ * @brief Creates a meta key or takes an equal one from the active intern table.
+ */
+static Key * newMetaV4 (ElektraArena * arena, const struct metaV4 * meta)
+{
+	Key name = { .key = (char *) meta->name.name, .keySize = meta->name.size, .keyUSize = meta->name.unescapedSize };
 
-	struct stringbuffer metaNameBuffer;
-	setupBuffer (&metaNameBuffer, 4);
+	Key * key = elektraMetaInternLookup (&name, meta->value, meta->valueSize);
+	if (key) return key;
 
-	// setup name buffer with parent key
-	struct stringbuffer nameBuffer;
+	key = newKeyV4 (arena, NULL, &meta->name, meta->value, meta->valueSize);
+	if (!key) return NULL;
+	key->flags |= KEY_FLAG_RO_NAME | KEY_FLAG_RO_VALUE | KEY_FLAG_RO_META;
+	elektraMetaInternInsert (key);
+	return key;
+}
 
-	size_t parentSize = keyGetNameSize (parentKey); // includes null terminator
-	setupBuffer (&nameBuffer, parentSize + 4);
+/**
+ * @brief Checks that a name is canonical and relative and that its unescaped name matches it.
+ *
+ * Such names are all a Key can have below its parent, so they cannot escape the parent key
+ * with a namespace or `..` and keys with an unescaped name not matching their name cannot be created.
+ *
+ * @param unescaped buffer for the unescaped name derived from the name
+ *
+ * @retval true if the name is valid, the empty name of the parent key is valid too
+ * @retval false otherwise, an error was set on @p errorKey
+ */
+static bool checkNameV4 (const struct nameV4 * name, struct stringbuffer * unescaped, Key * errorKey)
+{
+	if (name->size == 1) return true;
+
+	// parts are separated by exactly one slash, a canonical name has no "." or ".." parts
+	const char * end = name->name + name->size - 1;
+	const char * next = name->name;
+	const char * part = name->name;
+	size_t partSize = 0;
+	bool valid = elektraValidateKeyName (name->name, name->size);
+	while (valid && *(part = keyNameGetOneLevel (part + partSize, &partSize)) != '\0')
+	{
+		valid = part == next && !(partSize <= 2 && strspn (part, ".") >= partSize);
+		next = part + partSize + 1;
+	}
+	valid = valid && next == end + 1;
 
-	keyGetName (parentKey, nameBuffer.string, parentSize);
-	nameBuffer.string[parentSize - 1] = '/'; // replaces null terminator
-	nameBuffer.string[parentSize] = '\0';    // set new null terminator
-	nameBuffer.offset = parentSize;		 // set offset to null terminator
+	if (valid)
+	{
+		ensureBufferSize (unescaped, name->size + 1);
+		valid = elektraUnescapeKeyName (name->name, unescaped->string) == name->unescapedSize &&
+			memcmp (unescaped->string, name->unescaped, name->unescapedSize) == 0;
+	}
 
-	char c;
-	while ((c = fgetc (file)) != EOF)
+	if (!valid)
+	{
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERRORF (errorKey, "Invalid key name %s", name->name);
+	}
+	return valid;
+}
+
+/**
+ * Result of the first pass over a v4 file or a block of a compressed file
+ */
+struct scanV4
+{
+	size_t keyCount;     /*!< number of keys */
+	size_t metaCount;    /*!< number of 'm' entries, including those of previous blocks */
+	size_t bytes;	     /*!< upper bound for the bytes of all names and values */
+	size_t objects;	     /*!< number of names and values */
+	const char * opmphm; /*!< start of the OPMPHM, NULL if there is none */
+};
+
+/**
+ * @brief Validates the keys with scanV4().
+ *
+ * @param unescaped buffer for checkNameV4()
+ */
+static bool scanKeysV4 (const char * data, const char * end, const struct nameV4 * parent, struct frontV4 * front, struct scanV4 * scan,
+			struct stringbuffer * unescaped, Key * errorKey)
+{
+	const char * cur = data;
+	while (cur < end)
 	{
-		ungetc (c, file);
+		struct keyV4 key;
+		if (!decodeKeyV4 (&cur, end, front, &key, errorKey))
+		{
+			return false;
+		}
 
-		if (!readStringIntoBuffer (file, &nameBuffer, parentKey))
+		if (key.type == 'o')
 		{
-			elektraFree (nameBuffer.string);
-			elektraFree (metaNameBuffer.string);
-			elektraFree (valueBuffer.string);
-			fclose (file);
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
+			scan->opmphm = cur;
+			return true;
 		}
 
-		char type = fgetc (file);
-		if (type == EOF)
+		if (!checkNameV4 (&key.name, unescaped, errorKey))
 		{
-			elektraFree (nameBuffer.string);
-			elektraFree (metaNameBuffer.string);
-			elektraFree (valueBuffer.string);
-			fclose (file);
-			ELEKTRA_SET_VALIDATION_SEMANTIC_ERROR (parentKey, "Missing key type");
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
+			return false;
 		}
 
-		Key * k;
+		scan->bytes += parent->size + parent->unescapedSize + key.name.size + key.name.unescapedSize + key.valueSize;
+		scan->objects += 2;
+		++scan->keyCount;
 
-		switch (type)
+		struct metaV4 meta;
+		int result;
+		while ((result = decodeMetaV4 (&cur, end, &meta, errorKey)) == 1)
 		{
-		case 'b':
-		{
-			// binary key value
-			kdb_unsigned_long_long_t valueSize = 0;
-			if (!varintRead (file, &valueSize))
+			if (meta.type == 'm')
 			{
-				ELEKTRA_SET_RESOURCE_ERROR (parentKey, feof (file) ? "Premature end of file" : "Unknown error");
-				elektraFree (nameBuffer.string);
-				elektraFree (metaNameBuffer.string);
-				elektraFree (valueBuffer.string);
-				fclose (file);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
+				if (meta.name.size == 1)
+				{
+					ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (errorKey, "Invalid meta key name");
+					return false;
+				}
+				if (!checkNameV4 (&meta.name, unescaped, errorKey))
+				{
+					return false;
+				}
 
-			if (valueSize == 0)
-			{
-				k = keyNew (nameBuffer.string, KEY_BINARY, KEY_SIZE, valueSize, KEY_END);
+				scan->bytes += meta.name.size + meta.name.unescapedSize + meta.valueSize;
+				scan->objects += 2;
+				++scan->metaCount;
 			}
-			else
+			else if (meta.index >= scan->metaCount)
 			{
-				void * value = elektraMalloc (valueSize);
-				if (fread (value, sizeof (char), valueSize, file) < valueSize)
-				{
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					fclose (file);
-					ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Error while reading file");
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-				k = keyNew (nameBuffer.string, KEY_BINARY, KEY_SIZE, (size_t) valueSize, KEY_VALUE, value, KEY_END);
-				elektraFree (value);
+				ELEKTRA_SET_VALIDATION_SEMANTIC_ERRORF (
+					errorKey, "Could not copy meta data: Unknown meta key " ELEKTRA_UNSIGNED_LONG_LONG_F, meta.index);
+				return false;
 			}
-			break;
 		}
-		case 's':
+
+		if (result == -1)
 		{
-			// string key value
-			if (!readStringIntoBuffer (file, &valueBuffer, parentKey))
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Validates the keys of a v4 file and counts what the second pass allocates.
+ *
+ * The second pass does not need to check anything afterwards.
+ * The counts are added to @p scan, which has to be initialized.
+ *
+ * @param front the front coding state for a block of a compressed file, NULL for a v4 file
+ *
+ * @retval true if the file is valid
+ * @retval false otherwise, an error was set on @p errorKey
+ */
+static bool scanV4 (const char * data, const char * end, const struct nameV4 * parent, struct frontV4 * front, struct scanV4 * scan,
+		    Key * errorKey)
+{
+	struct stringbuffer unescaped;
+	setupBuffer (&unescaped, 256);
+	bool valid = scanKeysV4 (data, end, parent, front, scan, &unescaped, errorKey);
+	elektraFree (unescaped.string);
+	return valid;
+}
+
+/**
+ * @brief Creates the keys validated by scanV4() and bulk appends them to @p returned.
+ *
+ * @param front the same as for scanV4(), reset to the same state
+ * @param keyCount the number of keys counted by scanV4()
+ * @param arena the arena for the names and values, with space reserved as counted by scanV4()
+ * @param metaKeys the meta keys of the 'm' entries, with space for all counted by scanV4()
+ * @param[in,out] metaCount the number of meta keys already in @p metaKeys
+ *
+ * @retval true on success
+ * @retval false on memory error
+ */
+static bool buildKeysV4 (const char * data, const char * end, const struct nameV4 * parent, struct frontV4 * front, size_t keyCount,
+			 ElektraArena * arena, Key ** metaKeys, size_t * metaCount, KeySet * returned, Key * errorKey)
+{
+	bool success = true;
+	const char * cur = data;
+	for (size_t i = 0; i < keyCount && success; ++i)
+	{
+		struct keyV4 key;
+		decodeKeyV4 (&cur, end, front, &key, errorKey);
+
+		Key * k = newKeyV4 (arena, parent, &key.name, key.value, key.valueSize);
+		success = k != NULL;
+
+		struct metaV4 meta;
+		while (success && decodeMetaV4 (&cur, end, &meta, errorKey) == 1)
+		{
+			if (!k->meta && !(k->meta = ksNew (0, KS_END)))
 			{
-				elektraFree (nameBuffer.string);
-				elektraFree (metaNameBuffer.string);
-				elektraFree (valueBuffer.string);
-				fclose (file);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
+				success = false;
+				break;
 			}
-			k = keyNew (nameBuffer.string, KEY_VALUE, valueBuffer.string, KEY_END);
-			break;
+
+			Key * metaKey = meta.type == 'm' ? (metaKeys[(*metaCount)++] = newMetaV4 (arena, &meta)) : metaKeys[meta.index];
+			success = metaKey != NULL && elektraKsBulkAppendKey (k->meta, metaKey) != -1;
 		}
-		default:
-			elektraFree (nameBuffer.string);
-			elektraFree (metaNameBuffer.string);
-			elektraFree (valueBuffer.string);
-			fclose (file);
-			ELEKTRA_SET_VALIDATION_SEMANTIC_ERRORF (parentKey, "Unknown key type %c", type);
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
+
+		if (k && k->meta) elektraKsBulkFinish (k->meta);
+		if (success && key.type == 'b' && !keyGetMeta (k, "binary")) success = keySetMeta (k, "binary", "") != -1;
+
+		if (!success)
+		{
+			keyDel (k);
+		}
+		else if (elektraKsBulkAppendKey (returned, k) == -1)
+		{
+			success = false;
 		}
+	}
+	return success;
+}
+
+/**
+ * @brief Creates the keys of a v4 file validated by scanV4().
+ *
+ * All names and values are allocated from one arena chunk,
+ * which is freed once the last of these keys and meta keys is deleted.
+ *
+ * @retval true on success
+ * @retval false on memory error, an error was set on @p errorKey
+ */
+static bool buildV4 (const char * data, const char * end, const struct nameV4 * parent, const struct scanV4 * scan, KeySet * returned,
+		     Key * errorKey)
+{
+	ElektraArena * arena = elektraArenaNew ();
+	Key ** metaKeys = elektraMalloc ((scan->metaCount + 1) * sizeof (Key *));
+	if (!arena || !metaKeys || elektraArenaReserve (arena, scan->bytes, scan->objects) == -1)
+	{
+		elektraArenaDel (arena);
+		if (metaKeys) elektraFree (metaKeys);
+		ELEKTRA_SET_OUT_OF_MEMORY_ERROR (errorKey);
+		return false;
+	}
 
-		while ((c = fgetc (file)) != 0)
+	size_t metaCount = 0;
+	bool success = buildKeysV4 (data, end, parent, NULL, scan->keyCount, arena, metaKeys, &metaCount, returned, errorKey);
+	elektraKsBulkFinish (returned);
+
+	elektraFree (metaKeys);
+	elektraArenaDel (arena);
+
+	if (!success)
+	{
+		ELEKTRA_SET_OUT_OF_MEMORY_ERROR (errorKey);
+	}
+	return success;
+}
+
+/**
+ * @brief Reads the rest of @p file after the magic number.
+ *
+ * Regular files are mapped, everything else (e.g. a pipe) is read into a buffer.
+ *
+ * @param file the file, positioned after the magic number
+ * @param[out] mapped the mapping, NULL if the file was read into a buffer
+ * @param[out] mappedSize the size of @p mapped
+ * @param[out] dataSize the size of the returned data
+ * @param errorKey the key for errors
+ *
+ * @return the data, to be released with unloadData()
+ * @retval NULL on error
+ */
+static const char * loadData (FILE * file, char ** mapped, size_t * mappedSize, size_t * dataSize, Key * errorKey)
+{
+	*mapped = NULL;
+#ifndef _WIN32
+	struct stat buf;
+	if (fstat (fileno (file), &buf) == 0 && S_ISREG (buf.st_mode) && (size_t) buf.st_size >= sizeof (kdb_unsigned_long_long_t))
+	{
+		void * map = mmap (NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fileno (file), 0);
+		if (map != MAP_FAILED)
 		{
-			if (c == EOF)
-			{
-				keyDel (k);
-				fclose (file);
-				ELEKTRA_SET_VALIDATION_SYNTACTIC_ERROR (parentKey, "Missing key end");
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
+			*mapped = map;
+			*mappedSize = buf.st_size;
+			*dataSize = *mappedSize - sizeof (kdb_unsigned_long_long_t);
+			return *mapped + sizeof (kdb_unsigned_long_long_t);
+		}
+	}
+#endif
 
-			switch (c)
-			{
-			case 'm':
-			{
-				// meta key
-				if (!readStringIntoBuffer (file, &metaNameBuffer, parentKey))
-				{
-					keyDel (k);
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					elektraFree (valueBuffer.string);
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
+	struct stringbuffer buffer;
+	setupBuffer (&buffer, 4096);
+	size_t read;
+	while ((read = fread (&buffer.string[buffer.offset], sizeof (char), buffer.alloc - buffer.offset, file)) > 0)
+	{
+		buffer.offset += read;
+		ensureBufferSize (&buffer, buffer.offset + 1);
+	}
+	if (ferror (file))
+	{
+		elektraFree (buffer.string);
+		ELEKTRA_SET_RESOURCE_ERROR (errorKey, "Error while reading file");
+		return NULL;
+	}
+	*dataSize = buffer.offset;
+	return buffer.string;
+}
 
-				if (!readStringIntoBuffer (file, &valueBuffer, parentKey))
-				{
-					keyDel (k);
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					elektraFree (valueBuffer.string);
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-				const char * metaValue = valueBuffer.string;
+static void unloadData (const char * data, char * mapped, size_t mappedSize)
+{
+#ifndef _WIN32
+	if (mapped != NULL)
+	{
+		munmap (mapped, mappedSize);
+		return;
+	}
+#else
+	(void) mapped;
+	(void) mappedSize;
+#endif
+	elektraFree ((char *) data);
+}
 
-				keySetMeta (k, metaNameBuffer.string, metaValue);
-				break;
-			}
-			case 'c':
-			{
-				// copy meta
-				if (!readStringIntoBuffer (file, &nameBuffer, parentKey))
-				{
-					keyDel (k);
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					elektraFree (valueBuffer.string);
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+#include "compress.c"
+#else
+static bool writeBlock (FILE * file, struct stringbuffer * block, Key * errorKey)
+{
+	if (fwrite (block->string, sizeof (char), block->offset, file) < block->offset)
+	{
+		ELEKTRA_SET_RESOURCE_ERROR (errorKey, "Error while writing file");
+		return false;
+	}
+	block->offset = 0;
+	return true;
+}
+#endif
 
-				if (!readStringIntoBuffer (file, &metaNameBuffer, parentKey))
-				{
-					keyDel (k);
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					elektraFree (valueBuffer.string);
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
+int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle ELEKTRA_UNUSED, KeySet * returned, Key * parentKey)
+{
+	if (!elektraStrCmp (keyName (parentKey), "system/elektra/modules/" ELEKTRA_PLUGIN_NAME))
+	{
+		KeySet * contract = ksNew (
+			30,
+			keyNew ("system/elektra/modules/" ELEKTRA_PLUGIN_NAME, KEY_VALUE, "quickdump plugin waits for your orders",
+				KEY_END),
+			keyNew ("system/elektra/modules/" ELEKTRA_PLUGIN_NAME "/exports", KEY_END),
+			keyNew ("system/elektra/modules/" ELEKTRA_PLUGIN_NAME "/exports/get", KEY_FUNC, ELEKTRA_PLUGIN_FUNCTION (get),
+				KEY_END),
+			keyNew ("system/elektra/modules/" ELEKTRA_PLUGIN_NAME "/exports/set", KEY_FUNC, ELEKTRA_PLUGIN_FUNCTION (set),
+				KEY_END),
+#include ELEKTRA_README
+			keyNew ("system/elektra/modules/" ELEKTRA_PLUGIN_NAME "/infos/version", KEY_VALUE, PLUGINVERSION, KEY_END), KS_END);
+		ksAppend (returned, contract);
+		ksDel (contract);
 
-				const Key * sourceKey = ksLookupByName (returned, nameBuffer.string, 0);
-				if (sourceKey == NULL)
-				{
-					ELEKTRA_SET_RESOURCE_ERRORF (parentKey, "Could not copy meta data from key '%s': Key not found",
-								     nameBuffer.string);
-					keyDel (k);
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					elektraFree (valueBuffer.string);
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
+		return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+	}
+	// get all keys
 
-				if (keyCopyMeta (k, sourceKey, metaNameBuffer.string) != 1)
-				{
-					ELEKTRA_SET_INTERNAL_ERRORF (parentKey, "Could not copy meta data from key '%s': Error during copy",
-								     &nameBuffer.string[nameBuffer.offset]);
-					keyDel (k);
-					elektraFree (nameBuffer.string);
-					elektraFree (metaNameBuffer.string);
-					elektraFree (valueBuffer.string);
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-				break;
-			}
-			default:
-				keyDel (k);
-				elektraFree (nameBuffer.string);
-				elektraFree (metaNameBuffer.string);
-				elektraFree (valueBuffer.string);
-				fclose (file);
-				ELEKTRA_SET_VALIDATION_SYNTACTIC_ERRORF (parentKey, "Unknown meta type %c", type);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
+	FILE * file = fopen (keyString (parentKey), "rb");
+
+	if (file == NULL)
+	{
+		ELEKTRA_SET_ERROR_GET (parentKey);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+
+	kdb_unsigned_long_long_t magic;
+	if (fread (&magic, sizeof (kdb_unsigned_long_long_t), 1, file) < 1)
+	{
+		if (feof (file) && ftell (file) == 0)
+		{
+			fclose (file);
+			return ELEKTRA_PLUGIN_STATUS_SUCCESS;
 		}
+		else
+		{
+			fclose (file);
+			return ELEKTRA_PLUGIN_STATUS_ERROR;
+		}
+	}
+	magic = be64toh (magic); // magic number is written big endian so EKDB magic string is readable
+
+	switch (magic)
+	{
+	case MAGIC_NUMBER_V1:
+		return readVersion1 (file, returned, parentKey);
+	case MAGIC_NUMBER_V2:
+		return readVersion2 (file, returned, parentKey);
+	case MAGIC_NUMBER_V3:
+		return readVersion3 (file, returned, parentKey);
+	case MAGIC_NUMBER_V4:
+		// break, current version implemented below
+		break;
+	case MAGIC_NUMBER_COMPRESSED_V4:
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+		return readCompressed (file, returned, parentKey);
+#else
+		fclose (file);
+		ELEKTRA_SET_INSTALLATION_ERROR (parentKey,
+						"The file is compressed, it can only be read by the plugin quickdump_compressed");
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+#endif
+	default:
+		fclose (file);
+		ELEKTRA_SET_VALIDATION_SYNTACTIC_ERRORF (parentKey, "Unknown magic number " ELEKTRA_UNSIGNED_LONG_LONG_F, magic);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
 
-		ksAppendKey (returned, k);
+	char * mapped;
+	size_t mappedSize = 0;
+	size_t dataSize;
+	const char * data = loadData (file, &mapped, &mappedSize, &dataSize, parentKey);
+	if (data == NULL)
+	{
+		fclose (file);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
 	}
 
-	elektraFree (nameBuffer.string);
-	elektraFree (metaNameBuffer.string);
-	elektraFree (valueBuffer.string);
+	// names of the keys are relative to the parent key
+	struct nameV4 parent = { keyName (parentKey), keyGetNameSize (parentKey), keyUnescapedName (parentKey),
+				 keyGetUnescapedNameSize (parentKey) };
 
+	// first validate everything, so that the keys can be created without any checks
+	struct scanV4 scan = { 0 };
+	const char * end = data + dataSize;
+	if (!scanV4 (data, end, &parent, NULL, &scan, parentKey) || !buildV4 (data, end, &parent, &scan, returned, parentKey))
+	{
+		unloadData (data, mapped, mappedSize);
+		fclose (file);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+
+	// the OPMPHM is read from the file, if it can be positioned (i.e. not from a pipe)
+	bool success = true;
+	if (scan.opmphm != NULL && fseek (file, sizeof (kdb_unsigned_long_long_t) + (scan.opmphm - data), SEEK_SET) == 0)
+	{
+		success = readOpmphm (file, returned, parentKey, scan.keyCount);
+	}
+
+	unloadData (data, mapped, mappedSize);
 	fclose (file);
 
-	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+	return success ? ELEKTRA_PLUGIN_STATUS_SUCCESS : ELEKTRA_PLUGIN_STATUS_ERROR;
 }
 
-int elektraQuickdumpSet (Plugin * handle, KeySet * returned, Key * parentKey)
+int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle, KeySet * returned, Key * parentKey)
 {
 	cursor_t cursor = ksGetCursor (returned);
 	ksRewind (returned);
@@ -455,8 +975,13 @@ int elektraQuickdumpSet (Plugin * handle, KeySet * returned, Key * parentKey)
 	}
 
 	// magic number is written big endian so EKDB magic string is readable
-	kdb_unsigned_long_long_t magic = htobe64 (MAGIC_NUMBER_V3);
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+	kdb_unsigned_long_long_t magic = htobe64 (MAGIC_NUMBER_COMPRESSED_V4);
+	if (fwrite (&magic, sizeof (kdb_unsigned_long_long_t), 1, file) < 1 || fputc (COMPRESSION_CODEC, file) == EOF)
+#else
+	kdb_unsigned_long_long_t magic = htobe64 (MAGIC_NUMBER_V4);
 	if (fwrite (&magic, sizeof (kdb_unsigned_long_long_t), 1, file) < 1)
+#endif
 	{
 		fclose (file);
 		return ELEKTRA_PLUGIN_STATUS_ERROR;
@@ -469,76 +994,63 @@ int elektraQuickdumpSet (Plugin * handle, KeySet * returned, Key * parentKey)
 
 	// we assume all keys in returned are below parentKey
 	size_t parentOffset = keyGetNameSize (parentKey);
+	size_t parentUnescapedOffset = keyGetUnescapedNameSize (parentKey);
 
 	// ... unless /noparent is in config, then we just take the full
 	// (cascading) keynames as relative to the parentKey
 	KeySet * config = elektraPluginGetConfig (handle);
-	if (ksLookupByName (config, "/noparent", 0) != NULL)
+	bool noParent = ksLookupByName (config, "/noparent", 0) != NULL;
+	if (noParent)
 	{
 		parentOffset = 1;
+		parentUnescapedOffset = 1;
 	}
 
+	// the keys are collected in a block, which is written once it is full
+	struct stringbuffer block;
+	setupBuffer (&block, QUICKDUMP_BLOCK_SIZE);
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+	struct stringbuffer compressed;
+	setupBuffer (&compressed, compressBlockBound (QUICKDUMP_BLOCK_SIZE));
+	struct nameV4 previous = { "", 1, "", 0 };
+	struct codec codec;
+	bool success = openCodec (&codec, true);
+	if (!success) ELEKTRA_SET_OUT_OF_MEMORY_ERROR (parentKey);
+#else
+	bool success = true;
+#endif
+	size_t metaCount = 0;
 	Key * cur;
-	while ((cur = ksNext (returned)) != NULL)
+	while (success && (cur = ksNext (returned)) != NULL)
 	{
 		size_t fullNameSize = keyGetNameSize (cur);
-		if (fullNameSize < parentOffset)
+		size_t fullUnescapedSize = keyGetUnescapedNameSize (cur);
+		if (fullNameSize < parentOffset || fullUnescapedSize < parentUnescapedOffset)
 		{
-			fclose (file);
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
+			success = false;
+			break;
 		}
 
-		kdb_unsigned_long_long_t nameSize = fullNameSize == parentOffset ? 0 : fullNameSize - 1 - parentOffset;
-		if (!writeData (file, keyName (cur) + parentOffset, nameSize, parentKey))
-		{
-			fclose (file);
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
-		}
+		size_t nameSize = fullNameSize == parentOffset ? 0 : fullNameSize - 1 - parentOffset;
+		size_t unescapedSize = fullUnescapedSize - parentUnescapedOffset;
+		const char * name = keyName (cur) + parentOffset;
+		const char * unescapedName = (const char *) keyUnescapedName (cur) + parentUnescapedOffset;
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+		bufferFrontName (&block, &previous, name, nameSize, unescapedName, unescapedSize);
+#else
+		bufferName (&block, name, nameSize, unescapedName, unescapedSize);
+#endif
 
 		if (keyIsBinary (cur))
 		{
-			if (fputc ('b', file) == EOF)
-			{
-				fclose (file);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
-
-			kdb_unsigned_long_long_t valueSize = keyGetValueSize (cur);
-
-			char * value = NULL;
-			if (valueSize > 0)
-			{
-				value = elektraMalloc (valueSize);
-				if (keyGetBinary (cur, value, valueSize) == -1)
-				{
-					fclose (file);
-					elektraFree (value);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-			}
-
-			if (!writeData (file, value, valueSize, parentKey))
-			{
-				fclose (file);
-				elektraFree (value);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
-			elektraFree (value);
+			bufferChar (&block, 'b');
+			bufferVarint (&block, keyGetValueSize (cur));
+			bufferData (&block, keyValue (cur), keyGetValueSize (cur));
 		}
 		else
 		{
-			if (fputc ('s', file) == EOF)
-			{
-				fclose (file);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
-
-			kdb_unsigned_long_long_t valueSize = keyGetValueSize (cur) - 1;
-			if (!writeData (file, keyString (cur), valueSize, parentKey))
-			{
-				fclose (file);
-				return ELEKTRA_PLUGIN_STATUS_ERROR;
-			}
+			bufferChar (&block, 's');
+			bufferString (&block, keyString (cur), keyGetValueSize (cur));
 		}
 
 		keyRewindMeta (cur);
@@ -548,65 +1060,56 @@ int elektraQuickdumpSet (Plugin * handle, KeySet * returned, Key * parentKey)
 			ssize_t result = findMetaLink (&metaKeys, meta);
 			if (result < 0)
 			{
-				if (fputc ('m', file) == EOF)
-				{
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
+				bufferChar (&block, 'm');
+				bufferName (&block, keyName (meta), keyGetNameSize (meta) - 1, keyUnescapedName (meta),
+					    keyGetUnescapedNameSize (meta));
+				bufferString (&block, keyString (meta), keyGetValueSize (meta));
 
-				kdb_unsigned_long_long_t metaNameSize = keyGetNameSize (meta) - 1;
-				if (!writeData (file, keyName (meta), metaNameSize, parentKey))
-				{
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-
-				kdb_unsigned_long_long_t metaValueSize = keyGetValueSize (meta) - 1;
-				if (!writeData (file, keyString (meta), metaValueSize, parentKey))
-				{
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-
-				insertMetaLink (&metaKeys, -result - 1, meta, cur, parentOffset);
+				insertMetaLink (&metaKeys, -result - 1, meta, metaCount++);
 			}
 			else
 			{
-				if (fputc ('c', file) == EOF)
-				{
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-
-				kdb_unsigned_long_long_t keyNameSize = metaKeys.array[result]->keyNameSize;
-				if (!writeData (file, metaKeys.array[result]->keyName, keyNameSize, parentKey))
-				{
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
-
-				kdb_unsigned_long_long_t metaNameSize = keyGetNameSize (meta) - 1;
-				if (!writeData (file, keyName (meta), metaNameSize, parentKey))
-				{
-					fclose (file);
-					return ELEKTRA_PLUGIN_STATUS_ERROR;
-				}
+				bufferChar (&block, 'c');
+				bufferVarint (&block, metaKeys.array[result]->index);
 			}
 		}
 
-		if (fputc (0, file) == EOF)
+		bufferChar (&block, 0);
+
+		if (block.offset >= QUICKDUMP_BLOCK_SIZE)
 		{
-			fclose (file);
-			return ELEKTRA_PLUGIN_STATUS_ERROR;
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+			success = writeCompressedBlock (file, &block, &compressed, &codec, parentKey);
+			previous = (struct nameV4){ "", 1, "", 0 };
+#else
+			success = writeBlock (file, &block, parentKey);
+#endif
 		}
 	}
 
+#ifdef ELEKTRA_QUICKDUMP_COMPRESSION
+	// an empty block ends the keys
+	success = success && writeCompressedBlock (file, &block, &compressed, &codec, parentKey) && varintWrite (file, 0);
+	closeCodec (&codec);
+	elektraFree (compressed.string);
+#else
+	success = success && writeBlock (file, &block, parentKey);
+#endif
+	elektraFree (block.string);
+
 	for (size_t i = 0; i < metaKeys.size; ++i)
 	{
 		elektraFree (metaKeys.array[i]);
 	}
 	elektraFree (metaKeys.array);
 
+	// with /noparent the names differ when reading, so would the positions of the OPMPHM
+	if (!success || (!noParent && ksLookupByName (config, "/opmphm", 0) != NULL && !writeOpmphm (file, returned, parentKey)))
+	{
+		fclose (file);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+
 	fclose (file);
 
 	ksSetCursor (returned, cursor);
@@ -656,7 +1159,7 @@ ssize_t findMetaLink (struct list * list, const Key * meta)
 	return -insertpos - 1;
 }
 
-void insertMetaLink (struct list * list, size_t index, const Key * meta, Key * key, size_t parentOffset)
+void insertMetaLink (struct list * list, size_t index, const Key * meta, size_t metaIndex)
 {
 	if (list->size + 1 >= list->alloc)
 	{
@@ -666,9 +1169,7 @@ void insertMetaLink (struct list * list, size_t index, const Key * meta, Key * k
 
 	struct metaLink * link = elektraMalloc (sizeof (struct metaLink));
 	link->meta = meta;
-	size_t fullNameSize = keyGetNameSize (key);
-	link->keyNameSize = fullNameSize <= parentOffset ? 0 : fullNameSize - 1 - parentOffset;
-	link->keyName = keyName (key) + parentOffset;
+	link->index = metaIndex;
 
 	if (index < list->size)
 	{
@@ -704,9 +1205,9 @@ void ensureBufferSize (struct stringbuffer * buffer, size_t minSize)
 Plugin * ELEKTRA_PLUGIN_EXPORT
 {
 	// clang-format off
-	return elektraPluginExport ("quickdump",
-				    ELEKTRA_PLUGIN_GET,	&elektraQuickdumpGet,
-				    ELEKTRA_PLUGIN_SET,	&elektraQuickdumpSet,
+	return elektraPluginExport (ELEKTRA_PLUGIN_NAME,
+				    ELEKTRA_PLUGIN_GET,	&ELEKTRA_PLUGIN_FUNCTION (get),
+				    ELEKTRA_PLUGIN_SET,	&ELEKTRA_PLUGIN_FUNCTION (set),
 				    ELEKTRA_PLUGIN_END);
 	// clang-format on
 }
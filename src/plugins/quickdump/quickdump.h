@@ -13,8 +13,8 @@
 #include <kdbplugin.h>
 
 
-int elektraQuickdumpGet (Plugin * handle, KeySet * ks, Key * parentKey);
-int elektraQuickdumpSet (Plugin * handle, KeySet * ks, Key * parentKey);
+int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle, KeySet * ks, Key * parentKey);
+int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle, KeySet * ks, Key * parentKey);
 
 Plugin * ELEKTRA_PLUGIN_EXPORT;
 
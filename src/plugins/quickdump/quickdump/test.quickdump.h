@@ -22,14 +22,14 @@ static KeySet * test_quickdump_expected (void)
 		      keyNew ("dir/tests/bench/__868", KEY_VALUE, "UVM0OPTf68yNXij", KEY_END), k8, KS_END);
 }
 
-static unsigned char test_quickdump_parentKeyValue_data[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x03, 0x01,
-							      0x73, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x00 };
+static unsigned char test_quickdump_parentKeyValue_data[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x01, 0x01, 0x00, 0x73, 0x0d,
+							      0x76, 0x61, 0x6c, 0x75, 0x65, 0x00, 0x00 };
 
-static size_t test_quickdump_parentKeyValue_dataSize = 17;
+static size_t test_quickdump_parentKeyValue_dataSize = 20;
 
 static unsigned char test_quickdump_noParent_data[] = {
-	0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x03, 0x01, 0x73, 0x0b, 0x76, 0x61, 0x6c,
-	0x75, 0x65, 0x00, 0x03, 0x61, 0x73, 0x0d, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x31, 0x00
+	0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x01, 0x01, 0x00, 0x73, 0x0d, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x00, 0x00, 0x03, 0x05,
+	0x61, 0x00, 0x61, 0x00, 0x73, 0x0f, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x31, 0x00, 0x00
 };
 
-static size_t test_quickdump_noParent_dataSize = 28;
+static size_t test_quickdump_noParent_dataSize = 36;
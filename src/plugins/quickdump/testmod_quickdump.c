@@ -272,6 +272,159 @@ static void test_readV2 (void)
 	ksDel (ks);
 }
 
+static void test_readV3 (void)
+{
+	printf ("test update v3 to current\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	char * infile = elektraStrDup (srcdir_file ("quickdump/test.v3.quickdump"));
+	char * infileV4 = elektraStrDup (srcdir_file ("quickdump/test.quickdump"));
+	char * outfile = elektraStrDup (srcdir_file ("quickdump/test.quickdump.out"));
+
+	{
+		Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, infile, KEY_END);
+
+		KeySet * conf = ksNew (0, KS_END);
+		PLUGIN_OPEN ("quickdump");
+
+		KeySet * expected = test_quickdump_expected ();
+
+		succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+		compare_keyset (expected, ks);
+
+		Key * k1 = ksLookupByName (ks, "dir/tests/bench/__112", 0);
+		Key * k8 = ksLookupByName (ks, "dir/tests/bench/__911", 0);
+		succeed_if (keyGetMeta (k1, "meta/_35") == keyGetMeta (k8, "meta/_35"), "copy meta failed");
+
+		ksDel (expected);
+
+		keyDel (getKey);
+		PLUGIN_CLOSE ();
+	}
+
+	{
+		Key * setKey = keyNew ("dir/tests/bench", KEY_VALUE, outfile, KEY_END);
+
+		KeySet * conf = ksNew (0, KS_END);
+		PLUGIN_OPEN ("quickdump");
+
+		succeed_if (plugin->kdbSet (plugin, ks, setKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbSet was not successful");
+
+		succeed_if (compare_binary_files (infileV4, outfile) == 0, "files differ");
+		remove (outfile);
+
+		keyDel (setKey);
+		PLUGIN_CLOSE ();
+	}
+
+	elektraFree (infile);
+	elektraFree (infileV4);
+	elektraFree (outfile);
+	ksDel (ks);
+}
+
+static void test_arena (void)
+{
+	printf ("test arena\n");
+
+	KeySet * ks = ksNew (0, KS_END);
+	char * infile = elektraStrDup (srcdir_file ("quickdump/test.quickdump"));
+
+	Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, infile, KEY_END);
+
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("quickdump");
+
+	succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+
+	Key * k1 = ksLookupByName (ks, "dir/tests/bench/__112", 0);
+	Key * k2 = ksLookupByName (ks, "dir/tests/bench/__333", 0);
+	exit_if_fail (k1 != NULL && k2 != NULL, "keys not found");
+	succeed_if (test_bit (k1->flags, KEY_FLAG_ARENA_KEY) && test_bit (k1->flags, KEY_FLAG_ARENA_DATA), "name and value not in arena");
+	succeed_if (test_bit (keyGetMeta (k1, "meta/_35")->flags, KEY_FLAG_ARENA_KEY), "meta key not in arena");
+
+	// changed names and values are moved to the heap
+	succeed_if (keySetString (k1, "changed") == sizeof ("changed"), "could not set value");
+	succeed_if (!test_bit (k1->flags, KEY_FLAG_ARENA_DATA), "value still in arena");
+	succeed_if_same_string (keyString (k1), "changed");
+
+	Key * dup = keyDup (k2);
+	succeed_if (keyAddBaseName (dup, "child") > 0, "could not add base name");
+	succeed_if (!test_bit (dup->flags, KEY_FLAG_ARENA_KEY), "name still in arena");
+	succeed_if_same_string (keyName (dup), "dir/tests/bench/__333/child");
+	succeed_if_same_string (keyString (dup), "SxTUAjM6OIpUV6s");
+
+	// the arena is freed after the last key
+	ksDel (ks);
+	succeed_if_same_string (keyString (dup), "SxTUAjM6OIpUV6s");
+	keyDel (dup);
+
+	keyDel (getKey);
+	PLUGIN_CLOSE ();
+
+	elektraFree (infile);
+}
+
+static void test_invalid (void)
+{
+	printf ("test invalid files\n");
+
+	// 'c' entry without 'm' entry
+	unsigned char invalidCopy[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x03, 0x05, 0x61, 0x00,
+					0x61, 0x00, 0x73, 0x03, 0x00, 0x63, 0x01, 0x00 };
+	// string value without null terminator
+	unsigned char invalidString[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x03,
+					  0x05, 0x61, 0x00, 0x61, 0x00, 0x73, 0x03, 0x78, 0x00 };
+	// unescaped name without null terminator
+	unsigned char invalidName[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x03,
+					0x05, 0x61, 0x00, 0x61, 0x61, 0x73, 0x03, 0x00, 0x00 };
+	// compressed file, only read by the variant quickdump_compressed
+	unsigned char compressed[] = { 0x45, 0x4b, 0x44, 0x43, 0x00, 0x00, 0x00, 0x04, 0x7a, 0x01 };
+	const unsigned char * invalid[] = { invalidCopy, invalidString, invalidName, compressed };
+	size_t invalidSize[] = { sizeof (invalidCopy), sizeof (invalidString), sizeof (invalidName), sizeof (compressed) };
+
+	FILE * file = fopen (srcdir_file ("quickdump/test.quickdump"), "rb");
+	exit_if_fail (file != NULL, "could not open test file");
+	unsigned char data[4096];
+	size_t dataSize = fread (data, sizeof (char), sizeof (data), file);
+	fclose (file);
+
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("quickdump");
+
+	for (size_t i = 0; i < 4; ++i)
+	{
+		file = fopen (elektraFilename (), "wb");
+		fwrite (invalid[i], sizeof (char), invalidSize[i], file);
+		fclose (file);
+
+		Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+		KeySet * ks = ksNew (0, KS_END);
+		succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_ERROR, "invalid file was read");
+		succeed_if (ksGetSize (ks) == 0, "keys of invalid file were added");
+		ksDel (ks);
+		keyDel (getKey);
+	}
+
+	// truncated files are either read up to a complete key or rejected
+	for (size_t size = 8; size < dataSize; ++size)
+	{
+		file = fopen (elektraFilename (), "wb");
+		fwrite (data, sizeof (char), size, file);
+		fclose (file);
+
+		Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+		KeySet * ks = ksNew (0, KS_END);
+		int ret = plugin->kdbGet (plugin, ks, getKey);
+		succeed_if (ret == ELEKTRA_PLUGIN_STATUS_SUCCESS || ksGetSize (ks) == 0, "keys of truncated file were added");
+		succeed_if (ksGetSize (ks) < 8, "truncated file has all keys");
+		ksDel (ks);
+		keyDel (getKey);
+	}
+
+	PLUGIN_CLOSE ();
+}
+
 static void test_parentKeyValue (void)
 {
 	printf ("test parent key value\n");
@@ -365,7 +518,190 @@ static void test_varint (void)
 
 		snprintf (errorBuf, sizeof (errorBuf), "conversion for %" PRIX64 " wrong, got %" PRIX64, testNumbers[i], result);
 		succeed_if (testNumbers[i] == result, errorBuf);
+
+		char buffer[9];
+		f = fopen (elektraFilename (), "rb");
+		size_t size = fread (buffer, sizeof (char), sizeof (buffer), f);
+		fclose (f);
+
+		const char * cur = buffer;
+		result = 0;
+		succeed_if (varintDecode (&cur, buffer + size, &result), "decode error");
+		succeed_if (cur == buffer + size, "wrong varint size");
+		snprintf (errorBuf, sizeof (errorBuf), "decoding of %" PRIX64 " wrong, got %" PRIX64, testNumbers[i], result);
+		succeed_if (testNumbers[i] == result, errorBuf);
+
+		cur = buffer;
+		succeed_if (!varintDecode (&cur, buffer + size - 1, &result), "truncated varint decoded");
+	}
+}
+
+/**
+ * Writes a v4 file with the key @p name below the parent key, with a meta key @p metaName if it is not NULL.
+ */
+static void writeNames (const char * name, const char * unescaped, size_t unescapedSize, const char * metaName, const char * metaUnescaped,
+			size_t metaUnescapedSize)
+{
+	FILE * file = fopen (elektraFilename (), "wb");
+	exit_if_fail (file != NULL, "could not write test file");
+	fwrite ("EKDB\0\0\0\x04", sizeof (char), 8, file);
+	varintWrite (file, strlen (name));
+	varintWrite (file, unescapedSize);
+	fwrite (name, sizeof (char), strlen (name) + 1, file);
+	fwrite (unescaped, sizeof (char), unescapedSize, file);
+	fwrite ("s\x03", sizeof (char), 3, file);
+	if (metaName != NULL)
+	{
+		fputc ('m', file);
+		varintWrite (file, strlen (metaName));
+		varintWrite (file, metaUnescapedSize);
+		fwrite (metaName, sizeof (char), strlen (metaName) + 1, file);
+		fwrite (metaUnescaped, sizeof (char), metaUnescapedSize, file);
+		fwrite ("\x03", sizeof (char), 2, file);
+	}
+	fputc (0, file);
+	fclose (file);
+}
+
+static int readNames (Plugin * plugin, KeySet * ks)
+{
+	Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+	int ret = plugin->kdbGet (plugin, ks, getKey);
+	keyDel (getKey);
+	return ret;
+}
+
+static void test_invalidNames (void)
+{
+	printf ("test invalid names\n");
+
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("quickdump");
+
+	// the names stored for keys the plugin writes
+	writeNames ("a\\/b/%", "a/b\0", 5, "meta/#0", "meta\0#0", 8);
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (readNames (plugin, ks) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "valid names were not read");
+	Key * key = ksLookupByName (ks, "dir/tests/bench/a\\/b/%", 0);
+	succeed_if (key != NULL && keyGetMeta (key, "meta/#0") != NULL, "key with valid names not read");
+	ksDel (ks);
+
+	struct
+	{
+		const char * name;
+		const char * unescaped;
+		size_t unescapedSize;
+	} invalid[] = {
+		{ "/a", "\0a", 3 }, // absolute name
+		{ "../a", "..\0a", 5 }, // above the parent key
+		{ "a/./b", "a\0.\0b", 6 }, // not canonical
+		{ "a//b", "a\0b", 4 }, // empty part
+		{ "a/", "a", 2 }, // trailing separator
+		{ "a\\", "a\\", 3 }, // escaped null terminator
+		{ "a/b", "a\0c", 4 }, // other unescaped name
+		{ "a/b", "a/b", 4 }, // other number of parts
+		{ "a\\/b", "a\0b", 4 }, // escaped separator as separator
+	};
+
+	for (size_t i = 0; i < sizeof (invalid) / sizeof (invalid[0]); ++i)
+	{
+		writeNames (invalid[i].name, invalid[i].unescaped, invalid[i].unescapedSize, NULL, NULL, 0);
+		ks = ksNew (0, KS_END);
+		succeed_if (readNames (plugin, ks) == ELEKTRA_PLUGIN_STATUS_ERROR, "key with invalid name was read");
+		succeed_if (ksGetSize (ks) == 0, "key with invalid name was added");
+		ksDel (ks);
+
+		writeNames ("a", "a", 2, invalid[i].name, invalid[i].unescaped, invalid[i].unescapedSize);
+		ks = ksNew (0, KS_END);
+		succeed_if (readNames (plugin, ks) == ELEKTRA_PLUGIN_STATUS_ERROR, "meta key with invalid name was read");
+		succeed_if (ksGetSize (ks) == 0, "key with invalid meta name was added");
+		ksDel (ks);
+	}
+
+	// meta keys need a name
+	writeNames ("a", "a", 2, "", "", 0);
+	ks = ksNew (0, KS_END);
+	succeed_if (readNames (plugin, ks) == ELEKTRA_PLUGIN_STATUS_ERROR, "meta key without name was read");
+	ksDel (ks);
+
+	PLUGIN_CLOSE ();
+}
+
+static void test_opmphm (void)
+{
+	printf ("test opmphm\n");
+
+	const size_t n = 1000;
+	char name[64];
+	KeySet * input = ksNew (n, KS_END);
+	for (size_t i = 0; i < n; ++i)
+	{
+		snprintf (name, sizeof (name), "dir/tests/bench/section%zu/key%zu", i % 10, i);
+		ksAppendKey (input, keyNew (name, KEY_VALUE, "value", KEY_END));
+	}
+	char * outfile = elektraStrDup (srcdir_file ("quickdump/test.quickdump.out"));
+
+	{
+		Key * setKey = keyNew ("dir/tests/bench", KEY_VALUE, outfile, KEY_END);
+
+		KeySet * conf = ksNew (1, keyNew ("user/opmphm", KEY_END), KS_END);
+		PLUGIN_OPEN ("quickdump");
+
+		succeed_if (plugin->kdbSet (plugin, input, setKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbSet was not successful");
+
+		keyDel (setKey);
+		PLUGIN_CLOSE ();
+	}
+
+	{
+		Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, outfile, KEY_END);
+
+		KeySet * conf = ksNew (0, KS_END);
+		PLUGIN_OPEN ("quickdump");
+
+		KeySet * actual = ksNew (0, KS_END);
+		succeed_if (plugin->kdbGet (plugin, actual, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+		compare_keyset (input, actual);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		succeed_if (actual->opmphm && actual->opmphm->size, "OPMPHM not restored");
+#endif
+		for (size_t i = 0; i < n; ++i)
+		{
+			succeed_if (ksLookup (actual, input->array[i], KDB_O_OPMPHM) == actual->array[i], "key not found with OPMPHM");
+		}
+		succeed_if (!ksLookupByName (actual, "dir/tests/bench/nothere", KDB_O_OPMPHM), "found key that is not there");
+
+		ksDel (actual);
+
+		keyDel (getKey);
+		PLUGIN_CLOSE ();
+	}
+
+	{
+		// other parent, other key names, the OPMPHM must not be used
+		Key * getKey = keyNew ("dir/tests/other", KEY_VALUE, outfile, KEY_END);
+
+		KeySet * conf = ksNew (0, KS_END);
+		PLUGIN_OPEN ("quickdump");
+
+		KeySet * actual = ksNew (0, KS_END);
+		succeed_if (plugin->kdbGet (plugin, actual, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+		succeed_if ((size_t) ksGetSize (actual) == n, "wrong size");
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+		succeed_if (!actual->opmphm || !actual->opmphm->size, "OPMPHM of other parent used");
+#endif
+		succeed_if (ksLookupByName (actual, "dir/tests/other/section3/key3", KDB_O_OPMPHM), "key not found");
+
+		ksDel (actual);
+
+		keyDel (getKey);
+		PLUGIN_CLOSE ();
 	}
+
+	remove (outfile);
+
+	elektraFree (outfile);
+	ksDel (input);
 }
 
 int main (int argc, char ** argv)
@@ -376,12 +712,17 @@ int main (int argc, char ** argv)
 	init (argc, argv);
 
 	test_varint ();
+	test_invalidNames ();
 
 	test_basics ();
 	test_noParent ();
 	test_readV1 ();
 	test_readV2 ();
+	test_readV3 ();
+	test_arena ();
+	test_invalid ();
 	test_parentKeyValue ();
+	test_opmphm ();
 
 	print_result ("testmod_quickdump");
 
@@ -0,0 +1,291 @@
+/**
+ * @file
+ *
+ * @brief Tests for quickdump_compressed plugin variant
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <kdbconfig.h>
+#include <kdbtypes.h>
+
+#include <tests_plugin.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "quickdump/test.quickdump.h"
+
+static KeySet * roundtrip (KeySet * input, const char * parent, KeySet * setConf)
+{
+	KeySet * actual = ksNew (0, KS_END);
+
+	{
+		Key * setKey = keyNew (parent, KEY_VALUE, elektraFilename (), KEY_END);
+
+		KeySet * conf = setConf;
+		PLUGIN_OPEN ("quickdump_compressed");
+
+		succeed_if (plugin->kdbSet (plugin, input, setKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbSet was not successful");
+
+		keyDel (setKey);
+		PLUGIN_CLOSE ();
+	}
+
+	FILE * file = fopen (elektraFilename (), "rb");
+	exit_if_fail (file != NULL, "could not open written file");
+	unsigned char magic[8];
+	succeed_if (fread (magic, sizeof (char), sizeof (magic), file) == sizeof (magic) && memcmp (magic, "EKDC\0\0\0\4", 8) == 0,
+		    "file not compressed");
+	fclose (file);
+
+	{
+		Key * getKey = keyNew (parent, KEY_VALUE, elektraFilename (), KEY_END);
+
+		KeySet * conf = ksNew (0, KS_END);
+		PLUGIN_OPEN ("quickdump_compressed");
+
+		succeed_if (plugin->kdbGet (plugin, actual, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+
+		keyDel (getKey);
+		PLUGIN_CLOSE ();
+	}
+
+	return actual;
+}
+
+static void test_basics (void)
+{
+	printf ("test basics\n");
+
+	KeySet * expected = test_quickdump_expected ();
+	KeySet * actual = roundtrip (expected, "dir/tests/bench", ksNew (0, KS_END));
+	compare_keyset (expected, actual);
+
+	Key * k1 = ksLookupByName (actual, "dir/tests/bench/__112", 0);
+	Key * k8 = ksLookupByName (actual, "dir/tests/bench/__911", 0);
+	succeed_if (keyGetMeta (k1, "meta/_35") == keyGetMeta (k8, "meta/_35"), "copy meta failed");
+
+	ksDel (actual);
+	ksDel (expected);
+}
+
+static void test_readUncompressed (void)
+{
+	printf ("test read uncompressed\n");
+
+	Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, srcdir_file ("quickdump/test.quickdump"), KEY_END);
+
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("quickdump_compressed");
+
+	KeySet * expected = test_quickdump_expected ();
+	KeySet * ks = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+	compare_keyset (expected, ks);
+
+	ksDel (ks);
+	ksDel (expected);
+	keyDel (getKey);
+
+	// the files written by the uncompressed variant in testmod_quickdump
+	const unsigned char * data[] = { test_quickdump_parentKeyValue_data, test_quickdump_noParent_data };
+	size_t dataSize[] = { test_quickdump_parentKeyValue_dataSize, test_quickdump_noParent_dataSize };
+	for (size_t i = 0; i < 2; ++i)
+	{
+		FILE * file = fopen (elektraFilename (), "wb");
+		fwrite (data[i], sizeof (char), dataSize[i], file);
+		fclose (file);
+
+		getKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+		ks = ksNew (0, KS_END);
+		succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_SUCCESS, "call to kdbGet was not successful");
+		succeed_if ((size_t) ksGetSize (ks) == i + 1, "wrong size");
+		succeed_if_same_string (keyString (ksLookupByName (ks, "dir/tests/bench", 0)), "value");
+		ksDel (ks);
+		keyDel (getKey);
+	}
+
+	PLUGIN_CLOSE ();
+}
+
+static void test_blocks (void)
+{
+	printf ("test blocks\n");
+
+	// enough keys for several blocks, the meta keys are copied across blocks
+	const size_t n = 20000;
+	char name[64];
+	char value[64];
+	Key * metaTemplate = keyNew ("/", KEY_META, "meta/a", "a", KEY_META, "meta/b", "b", KEY_END);
+	KeySet * input = ksNew (n, KS_END);
+	for (size_t i = 0; i < n; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/bench/section%zu/sub\\/key%zu", i % 7, i);
+		snprintf (value, sizeof (value), "value%zu", i * 7919);
+		Key * key = keyNew (name, KEY_VALUE, value, KEY_END);
+		keyCopyMeta (key, metaTemplate, i % 3 == 0 ? "meta/a" : "meta/b");
+		if (i % 100 == 0) keySetMeta (key, "meta/unique", value);
+		if (i % 11 == 0) keySetBinary (key, value, i % 5);
+		ksAppendKey (input, key);
+	}
+	ksAppendKey (input, keyNew ("user/tests/bench", KEY_VALUE, "parent", KEY_END));
+	ksAppendKey (input, keyNew ("user/tests/bench/#0/%/_", KEY_END));
+
+	// a single key larger than the maximum block size, compressed as well as possible
+	size_t largeSize = 8 * 1024 * 1024;
+	char * large = elektraCalloc (largeSize);
+	ksAppendKey (input, keyNew ("user/tests/bench/large", KEY_BINARY, KEY_SIZE, largeSize, KEY_VALUE, large, KEY_END));
+	elektraFree (large);
+
+	KeySet * actual = roundtrip (input, "user/tests/bench", ksNew (0, KS_END));
+	compare_keyset (input, actual);
+
+	Key * first = ksLookupByName (actual, "user/tests/bench/section0/sub\\/key0", 0);
+	Key * last = ksLookupByName (actual, "user/tests/bench/section6/sub\\/key19998", 0);
+	exit_if_fail (first != NULL && last != NULL, "keys not found");
+	succeed_if (keyGetMeta (first, "meta/a") == keyGetMeta (last, "meta/a"), "meta key not copied across blocks");
+
+	ksDel (actual);
+	ksDel (input);
+	keyDel (metaTemplate);
+}
+
+static void test_noParent (void)
+{
+	printf ("test noparent\n");
+
+	KeySet * input = ksNew (3, keyNew ("", KEY_VALUE, "value", KEY_END), keyNew ("/a", KEY_VALUE, "value1", KEY_END),
+				keyNew ("/a/b", KEY_VALUE, "value2", KEY_END), KS_END);
+	KeySet * expected = ksNew (3, keyNew ("dir/tests/bench", KEY_VALUE, "value", KEY_END),
+				   keyNew ("dir/tests/bench/a", KEY_VALUE, "value1", KEY_END),
+				   keyNew ("dir/tests/bench/a/b", KEY_VALUE, "value2", KEY_END), KS_END);
+
+	KeySet * actual = roundtrip (input, "dir/tests/bench", ksNew (1, keyNew ("user/noparent", KEY_END), KS_END));
+	compare_keyset (expected, actual);
+
+	ksDel (actual);
+	ksDel (expected);
+	ksDel (input);
+}
+
+static void test_opmphm (void)
+{
+	printf ("test opmphm\n");
+
+	const size_t n = 1000;
+	char name[64];
+	KeySet * input = ksNew (n, KS_END);
+	for (size_t i = 0; i < n; ++i)
+	{
+		snprintf (name, sizeof (name), "dir/tests/bench/section%zu/key%zu", i % 10, i);
+		ksAppendKey (input, keyNew (name, KEY_VALUE, "value", KEY_END));
+	}
+
+	KeySet * actual = roundtrip (input, "dir/tests/bench", ksNew (1, keyNew ("user/opmphm", KEY_END), KS_END));
+	compare_keyset (input, actual);
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	succeed_if (actual->opmphm && actual->opmphm->size, "OPMPHM not restored");
+#endif
+	for (size_t i = 0; i < n; ++i)
+	{
+		succeed_if (ksLookup (actual, input->array[i], KDB_O_OPMPHM) == actual->array[i], "key not found with OPMPHM");
+	}
+
+	ksDel (actual);
+	ksDel (input);
+}
+
+static void test_invalid (void)
+{
+	printf ("test invalid files\n");
+
+	KeySet * expected = test_quickdump_expected ();
+	KeySet * written = roundtrip (expected, "dir/tests/bench", ksNew (0, KS_END));
+	ksDel (written);
+	ksDel (expected);
+
+	FILE * file = fopen (elektraFilename (), "rb");
+	exit_if_fail (file != NULL, "could not open test file");
+	unsigned char data[4096];
+	size_t dataSize = fread (data, sizeof (char), sizeof (data), file);
+	fclose (file);
+
+	// unknown codec
+	unsigned char codec[] = { 0x45, 0x4b, 0x44, 0x43, 0x00, 0x00, 0x00, 0x04, 0x78, 0x01 };
+	// block of 16 bytes, which are not compressed
+	unsigned char block[] = { 0x45, 0x4b, 0x44, 0x43, 0x00, 0x00, 0x00, 0x04, data[8], 0x21, 0x09, 0x01, 0x02, 0x03, 0x04, 0x01 };
+
+	KeySet * conf = ksNew (0, KS_END);
+	PLUGIN_OPEN ("quickdump_compressed");
+
+	const unsigned char * invalid[] = { codec, block };
+	size_t invalidSize[] = { sizeof (codec), sizeof (block) };
+	for (size_t i = 0; i < 2; ++i)
+	{
+		file = fopen (elektraFilename (), "wb");
+		fwrite (invalid[i], sizeof (char), invalidSize[i], file);
+		fclose (file);
+
+		Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+		KeySet * ks = ksNew (0, KS_END);
+		succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_ERROR, "invalid file was read");
+		succeed_if (ksGetSize (ks) == 0, "keys of invalid file were added");
+		ksDel (ks);
+		keyDel (getKey);
+	}
+
+	// block of 2^40 bytes, which 4 compressed bytes cannot hold
+	unsigned char large[] = { 0x45, 0x4b, 0x44, 0x43, 0x00, 0x00, 0x00, 0x04, data[8], 0x20, 0x00,
+				  0x00, 0x00, 0x00, 0x40, 0x09, 0x01, 0x02, 0x03, 0x04, 0x01 };
+	file = fopen (elektraFilename (), "wb");
+	fwrite (large, sizeof (char), sizeof (large), file);
+	fclose (file);
+
+	Key * largeKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+	KeySet * largeKs = ksNew (0, KS_END);
+	succeed_if (plugin->kdbGet (plugin, largeKs, largeKey) == ELEKTRA_PLUGIN_STATUS_ERROR, "too large block was read");
+	succeed_if (strstr (keyString (keyGetMeta (largeKey, "error/reason")), "too large") != NULL, "too large block was not rejected");
+	ksDel (largeKs);
+	keyDel (largeKey);
+
+	// all keys are in one block, so truncated files are rejected
+	for (size_t size = 8; size < dataSize; ++size)
+	{
+		file = fopen (elektraFilename (), "wb");
+		fwrite (data, sizeof (char), size, file);
+		fclose (file);
+
+		Key * getKey = keyNew ("dir/tests/bench", KEY_VALUE, elektraFilename (), KEY_END);
+		KeySet * ks = ksNew (0, KS_END);
+		succeed_if (plugin->kdbGet (plugin, ks, getKey) == ELEKTRA_PLUGIN_STATUS_ERROR, "truncated file was read");
+		succeed_if (ksGetSize (ks) == 0, "keys of truncated file were added");
+		ksDel (ks);
+		keyDel (getKey);
+	}
+
+	PLUGIN_CLOSE ();
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("QUICKDUMP COMPRESSED     TESTS\n");
+	printf ("=============================\n\n");
+
+	init (argc, argv);
+
+	test_basics ();
+	test_readUncompressed ();
+	test_blocks ();
+	test_noParent ();
+	test_opmphm ();
+	test_invalid ();
+
+	print_result ("testmod_quickdump_compressed");
+
+	return nbError;
+}
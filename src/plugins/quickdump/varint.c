@@ -64,10 +64,45 @@ static bool varintRead (FILE * file, kdb_unsigned_long_long_t * result)
 	return true;
 }
 
-static bool varintWrite (FILE * file, kdb_unsigned_long_long_t num)
+static bool varintDecode (const char ** cur, const char * end, kdb_unsigned_long_long_t * result)
 {
-	kdb_octet_t varint[9];
+	const kdb_octet_t * varint = (const kdb_octet_t *) *cur;
+	if (*cur >= end)
+	{
+		return false;
+	}
+
+	unsigned int ctz = ffs (varint[0]);
+	unsigned int len = ctz == 0 ? 9 : ctz;
+	if ((size_t) (end - *cur) < len)
+	{
+		return false;
+	}
+	*cur += len;
+
+	kdb_unsigned_long_long_t num = 0;
+	if (ctz == 0)
+	{
+		for (unsigned int i = 1; i < len; ++i)
+		{
+			num |= (kdb_unsigned_long_long_t) varint[i] << ((i - 1) * 8u);
+		}
+	}
+	else
+	{
+		num = varint[0] >> len;
+		for (unsigned int i = 1; i < len; ++i)
+		{
+			num |= (kdb_unsigned_long_long_t) varint[i] << (i * 8u - ctz);
+		}
+	}
+
+	*result = num;
+	return true;
+}
 
+static unsigned int varintEncode (kdb_octet_t * varint, kdb_unsigned_long_long_t num)
+{
 	unsigned int len = 64 - __builtin_clzll (num | 1u);
 	len = 1 + (len - 1) / 7;
 
@@ -89,5 +124,12 @@ static bool varintWrite (FILE * file, kdb_unsigned_long_long_t num)
 		num >>= 8u;
 	}
 
+	return len;
+}
+
+static bool varintWrite (FILE * file, kdb_unsigned_long_long_t num)
+{
+	kdb_octet_t varint[9];
+	unsigned int len = varintEncode (varint, num);
 	return fwrite (varint, sizeof (kdb_octet_t), len, file) == len;
 }
@@ -11,7 +11,7 @@
 #include <kdbassert.h>
 #include <kdbconfig.h>
 #include <kdbhelper.h>  // elektraStrDup
-#include <kdbprivate.h> // KDB_CACHE_PREFIX
+#include <kdbprivate.h> // KDB_CACHE_PREFIX, KDB_SYNC_PREFIX, KDB_STAT_PREFIX
 #include <kdbproposal.h>
 
 #include "kdbos.h"
@@ -33,6 +33,10 @@
 
 #include <dirent.h>
 
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#endif
+
 #include <kdberrors.h>
 #include <kdblogger.h>
 #include <kdbmacros.h>
@@ -57,13 +61,17 @@ static unsigned char elektraResolverMutexInitialized = 0;
 static void resolverInit (resolverHandle * p, const char * path)
 {
 	p->fd = -1;
+	p->syncFd = -1;
 	p->mtime.tv_sec = 0;
 	p->mtime.tv_nsec = 0;
 	p->filemode = KDB_FILE_MODE;
 	p->dirmode = KDB_FILE_MODE | KDB_DIR_MODE;
 	p->removalNeeded = 0;
 	p->isMissing = 0;
+	p->dirty = 0;
 	p->timeFix = 1;
+	p->wd = -1;
+	p->ino = 0;
 
 	p->filename = 0;
 	p->dirname = 0;
@@ -102,9 +110,208 @@ static resolverHandle * elektraGetResolverHandle (Plugin * handle, Key * parentK
 	return 0;
 }
 
+#ifdef HAVE_INOTIFY
+/* All handles of this resolver with a watch share one inotify instance,
+ * so that many mountpoints do not exhaust the per-user instance limit.
+ * The watches have their own mutex, so that kdbGet() does not wait for
+ * a kdbSet() holding elektraResolverMutex until its commit. */
+#ifdef ELEKTRA_LOCK_MUTEX
+static pthread_mutex_t elektraWatchMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static int elektraWatchFd = -1;
+static resolverHandle ** elektraWatches;
+static size_t elektraWatchCount;
+
+#define ELEKTRA_WATCH_EVENTS                                                                                                               \
+	(IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF |   \
+	 IN_ONLYDIR)
+
+static void elektraWatchLock (void)
+{
+#ifdef ELEKTRA_LOCK_MUTEX
+	pthread_mutex_lock (&elektraWatchMutex);
+#endif
+}
+
+static void elektraWatchUnlock (void)
+{
+#ifdef ELEKTRA_LOCK_MUTEX
+	pthread_mutex_unlock (&elektraWatchMutex);
+#endif
+}
+
+static void elektraWatchSetDirty (resolverHandle * pk, int dirty)
+{
+	__atomic_store_n (&pk->dirty, dirty, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Removes the watch with the descriptor wd from all handles
+ *
+ * The handles are marked dirty, they stat their file again.
+ */
+static void elektraWatchForget (int wd)
+{
+	size_t j = 0;
+	for (size_t i = 0; i < elektraWatchCount; ++i)
+	{
+		if (elektraWatches[i]->wd == wd)
+		{
+			elektraWatches[i]->wd = -1;
+			elektraWatchSetDirty (elektraWatches[i], 1);
+		}
+		else
+		{
+			elektraWatches[j++] = elektraWatches[i];
+		}
+	}
+	elektraWatchCount = j;
+	inotify_rm_watch (elektraWatchFd, wd);
+}
+
+/**
+ * @brief Reads all pending events and marks the handles of the files concerned dirty
+ *
+ * Must be called with the watches locked.
+ */
+static void elektraWatchRead (void)
+{
+	char buffer[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	ssize_t len;
+
+	while (elektraWatchFd != -1 && (len = read (elektraWatchFd, buffer, sizeof (buffer))) > 0)
+	{
+		for (char * ptr = buffer; ptr < buffer + len;)
+		{
+			const struct inotify_event * event = (const struct inotify_event *) ptr;
+			ptr += sizeof (struct inotify_event) + event->len;
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				// events were lost
+				for (size_t i = 0; i < elektraWatchCount; ++i)
+				{
+					elektraWatchSetDirty (elektraWatches[i], 1);
+				}
+				continue;
+			}
+
+			if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT))
+			{
+				// the directory itself is gone
+				elektraWatchForget (event->wd);
+				continue;
+			}
+
+			for (size_t i = 0; i < elektraWatchCount; ++i)
+			{
+				resolverHandle * pk = elektraWatches[i];
+				if (pk->wd == event->wd && event->len && !strcmp (event->name, strrchr (pk->filename, '/') + 1))
+				{
+					elektraWatchSetDirty (pk, 1);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Watches the directory of the file of pk
+ *
+ * Must be called with the watches locked.
+ * Symbolic links are not watched, changes of their target would be missed.
+ *
+ * @retval 0 if the file is watched now
+ * @retval -1 if the file cannot be watched
+ */
+static int elektraWatchAdd (resolverHandle * pk)
+{
+	struct stat buf;
+	if (!pk->dirname || !strchr (pk->filename, '/')) return -1;
+	if (lstat (pk->filename, &buf) == 0 && S_ISLNK (buf.st_mode)) return -1;
+
+	if (elektraWatchFd == -1)
+	{
+		elektraWatchFd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+		if (elektraWatchFd == -1) return -1;
+	}
+
+	if (elektraRealloc ((void **) &elektraWatches, (elektraWatchCount + 1) * sizeof (resolverHandle *)) == -1) return -1;
+
+	int wd = inotify_add_watch (elektraWatchFd, pk->dirname, ELEKTRA_WATCH_EVENTS);
+	if (wd == -1) return -1;
+
+	pk->wd = wd;
+	elektraWatchSetDirty (pk, 0);
+	elektraWatches[elektraWatchCount++] = pk;
+	return 0;
+}
+
+/**
+ * @brief Stops watching the file of pk
+ *
+ * Closes the inotify instance once no file is watched anymore.
+ */
+static void elektraWatchRemove (resolverHandle * pk)
+{
+	elektraWatchLock ();
+	if (pk->wd == -1)
+	{
+		elektraWatchUnlock ();
+		return;
+	}
+
+	int shared = 0;
+	size_t j = 0;
+	for (size_t i = 0; i < elektraWatchCount; ++i)
+	{
+		if (elektraWatches[i] == pk) continue;
+		if (elektraWatches[i]->wd == pk->wd) shared = 1;
+		elektraWatches[j++] = elektraWatches[i];
+	}
+	elektraWatchCount = j;
+
+	if (!shared) inotify_rm_watch (elektraWatchFd, pk->wd);
+	pk->wd = -1;
+
+	if (elektraWatchCount == 0 && elektraWatchFd != -1)
+	{
+		close (elektraWatchFd);
+		elektraWatchFd = -1;
+		elektraFree (elektraWatches);
+		elektraWatches = 0;
+	}
+	elektraWatchUnlock ();
+}
+
+/**
+ * @brief Reads the pending events and marks pk clean after our own commit
+ *
+ * The events of the commit must not lead to another update. Others may have
+ * changed the file since the commit, so pk is only marked clean if the file
+ * still has the inode and modification time of the committed file.
+ */
+static void elektraWatchClean (resolverHandle * pk)
+{
+	elektraWatchLock ();
+	if (pk->wd != -1)
+	{
+		elektraWatchRead ();
+		struct stat buf;
+		if (stat (pk->filename, &buf) == 0 && pk->ino != 0 && buf.st_ino == pk->ino &&
+		    ELEKTRA_STAT_SECONDS (buf) == pk->mtime.tv_sec && ELEKTRA_STAT_NANO_SECONDS (buf) == pk->mtime.tv_nsec)
+		{
+			elektraWatchSetDirty (pk, 0);
+		}
+	}
+	elektraWatchUnlock ();
+}
+#endif
 
 static void resolverCloseOne (resolverHandle * p)
 {
+#ifdef HAVE_INOTIFY
+	elektraWatchRemove (p);
+#endif
 	elektraFree (p->filename);
 	p->filename = 0;
 	elektraFree (p->dirname);
@@ -119,6 +326,7 @@ static void resolverClose (resolverHandles * p)
 	resolverCloseOne (&p->dir);
 	resolverCloseOne (&p->user);
 	resolverCloseOne (&p->system);
+	keyDel (p->statKey);
 	elektraFree (p);
 }
 
@@ -431,6 +639,95 @@ static char * elektraCacheKeyName (char * filename)
 	return name;
 }
 
+/**
+ * @brief stat the file, or use the result kdbGet() already has
+ *
+ * @param global the global keyset, may be 0
+ * @param statKey the key KDB_STAT_PREFIX to look up in global
+ * @param filename the file to stat
+ * @param[out] buf the result of stat
+ *
+ * @retval 1 if the file exists
+ * @retval 0 if stat failed
+ *
+ * @see KDB_STAT_PREFIX
+ */
+static int elektraStatFile (KeySet * global, Key * statKey, const char * filename, ElektraStat * buf)
+{
+	Key * found = global ? ksLookup (global, statKey, 0) : 0;
+	ssize_t size = found ? keyGetValueSize (found) : 0;
+	if (size > (ssize_t) sizeof (ElektraStat))
+	{
+		// the stat result is followed by the name of the file that was stat'ed
+		const char * file = (const char *) keyValue (found) + sizeof (ElektraStat);
+		if (file[size - sizeof (ElektraStat) - 1] == '\0' && !strcmp (file, filename))
+		{
+			memcpy (buf, keyValue (found), sizeof (ElektraStat));
+			return buf->found;
+		}
+	}
+
+	struct stat status;
+	if (stat (filename, &status) == -1) return 0;
+
+	buf->found = 1;
+	buf->mode = status.st_mode;
+	buf->uid = status.st_uid;
+	buf->gid = status.st_gid;
+	buf->mtimeSec = ELEKTRA_STAT_SECONDS (status);
+	buf->mtimeNsec = ELEKTRA_STAT_NANO_SECONDS (status);
+	return 1;
+}
+
+#ifdef HAVE_INOTIFY
+/**
+ * @brief Tell kdbGet() that it does not need to stat the file anymore
+ *
+ * @param global the global keyset, may be 0
+ * @param statKey the key KDB_STAT_PREFIX to look up in global
+ *
+ * @see KDB_STAT_PREFIX
+ */
+static void elektraStatSetWatched (KeySet * global, Key * statKey)
+{
+	Key * found = global ? ksLookup (global, statKey, 0) : 0;
+	ssize_t size = found ? keyGetValueSize (found) : 0;
+	if (size < (ssize_t) sizeof (ElektraStat)) return;
+
+	// keep the name of the file following the stat result
+	char * value = elektraMalloc (size);
+	if (!value) return;
+	memcpy (value, keyValue (found), size);
+	((ElektraStat *) value)->watched = 1;
+	keySetRaw (found, value, size);
+	elektraFree (value);
+}
+
+/**
+ * @brief Check the watch of the file of pk
+ *
+ * Starts to watch the file if it is not watched yet.
+ * The watch is started before the file is stat'ed, so no change is missed.
+ *
+ * @param pk the handle of the file
+ * @param[out] changed set to 1 if an event arrived for the file
+ *
+ * @retval 1 if the file is watched and unchanged since the last kdbGet()
+ * @retval 0 if the file needs to be stat'ed
+ */
+static int elektraWatchCheck (resolverHandle * pk, int * changed)
+{
+	elektraWatchLock ();
+	elektraWatchRead ();
+	int dirty = __atomic_exchange_n (&pk->dirty, 0, __ATOMIC_RELAXED);
+	int unchanged = pk->wd != -1 && !dirty;
+	if (pk->wd == -1) elektraWatchAdd (pk);
+	*changed = dirty;
+	elektraWatchUnlock ();
+	return unchanged;
+}
+#endif
+
 int ELEKTRA_PLUGIN_FUNCTION (open) (Plugin * handle, Key * errorKey)
 {
 	KeySet * resolverConfig = elektraPluginGetConfig (handle);
@@ -448,6 +745,8 @@ int ELEKTRA_PLUGIN_FUNCTION (open) (Plugin * handle, Key * errorKey)
 	resolverInit (&p->dir, path);
 	resolverInit (&p->user, path);
 	resolverInit (&p->system, path);
+	p->statKey = keyNew (KDB_STAT_PREFIX, KEY_END);
+	p->watch = ksLookupByName (resolverConfig, "/watch", 0) != 0;
 
 #if defined(ELEKTRA_RESOLVER_RECURSIVE_MUTEX_INITIALIZATION)
 	// PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP is available in glibc only
@@ -535,11 +834,28 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle, KeySet * returned, Key * par
 	keySetString (parentKey, pk->filename);
 
 	int errnoSave = errno;
-	struct stat buf;
+	KeySet * global = elektraPluginGetGlobalKeySet (handle);
+	resolverHandles * ps = elektraPluginGetData (handle);
+	ElektraStat buf;
+	int changed = 0;
+
+#ifdef HAVE_INOTIFY
+	if (ps->watch)
+	{
+		int unchanged = elektraWatchCheck (pk, &changed);
+		if (pk->wd != -1) elektraStatSetWatched (global, ps->statKey);
+		if (unchanged)
+		{
+			// no event, so storage has no job
+			errno = errnoSave;
+			return 0;
+		}
+	}
+#endif
 
 	ELEKTRA_LOG ("stat file %s", pk->filename);
 	/* Start file IO with stat() */
-	if (stat (pk->filename, &buf) == -1)
+	if (!elektraStatFile (global, ps->statKey, pk->filename, &buf))
 	{
 		// no file, so storage has no job
 		errno = errnoSave;
@@ -553,14 +869,14 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle, KeySet * returned, Key * par
 	else
 	{
 		// successful, remember mode, uid and gid
-		pk->filemode = buf.st_mode;
-		pk->gid = buf.st_gid;
-		pk->uid = buf.st_uid;
+		pk->filemode = buf.mode;
+		pk->gid = buf.gid;
+		pk->uid = buf.uid;
 		pk->isMissing = 0;
 	}
 
-	/* Check if update needed */
-	if (pk->mtime.tv_sec == ELEKTRA_STAT_SECONDS (buf) && pk->mtime.tv_nsec == ELEKTRA_STAT_NANO_SECONDS (buf))
+	/* Check if update needed, an event means the file changed even with the same time */
+	if (!changed && pk->mtime.tv_sec == buf.mtimeSec && pk->mtime.tv_nsec == buf.mtimeNsec)
 	{
 		// no update, so storage has no job
 		errno = errnoSave;
@@ -568,29 +884,28 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle, KeySet * returned, Key * par
 	}
 
 	/* Check if cache update needed */
-	KeySet * global;
 	char * name = 0;
 
-	if ((global = elektraPluginGetGlobalKeySet (handle)) != NULL && ELEKTRA_STAT_NANO_SECONDS (buf) != 0)
+	if (global != NULL && buf.mtimeNsec != 0)
 	{
 		name = elektraCacheKeyName (pk->filename);
 
 		ELEKTRA_LOG_DEBUG ("global-cache: check cache update needed?");
 		Key * time = ksLookupByName (global, name, KDB_O_NONE);
-		if (time && keyGetValueSize (time) == sizeof (struct timespec))
+		if (!changed && time && keyGetValueSize (time) == sizeof (struct timespec))
 		{
 			struct timespec cached;
 			keyGetBinary (time, &cached, sizeof (struct timespec));
-			if (cached.tv_sec == ELEKTRA_STAT_SECONDS (buf) && cached.tv_nsec == ELEKTRA_STAT_NANO_SECONDS (buf))
+			if (cached.tv_sec == buf.mtimeSec && cached.tv_nsec == buf.mtimeNsec)
 			{
 				ELEKTRA_LOG_DEBUG ("global-cache: no update needed, everything is fine");
 				ELEKTRA_LOG_DEBUG ("cached.tv_sec:\t%ld", cached.tv_sec);
 				ELEKTRA_LOG_DEBUG ("cached.tv_nsec:\t%ld", cached.tv_nsec);
-				ELEKTRA_LOG_DEBUG ("buf.tv_sec:\t%ld", ELEKTRA_STAT_SECONDS (buf));
-				ELEKTRA_LOG_DEBUG ("buf.tv_nsec:\t%ld", ELEKTRA_STAT_NANO_SECONDS (buf));
+				ELEKTRA_LOG_DEBUG ("buf.tv_sec:\t%ld", (long) buf.mtimeSec);
+				ELEKTRA_LOG_DEBUG ("buf.tv_nsec:\t%ld", (long) buf.mtimeNsec);
 				// update timestamp inside resolver
-				pk->mtime.tv_sec = ELEKTRA_STAT_SECONDS (buf);
-				pk->mtime.tv_nsec = ELEKTRA_STAT_NANO_SECONDS (buf);
+				pk->mtime.tv_sec = buf.mtimeSec;
+				pk->mtime.tv_nsec = buf.mtimeNsec;
 
 				if (name) elektraFree (name);
 				errno = errnoSave;
@@ -599,11 +914,11 @@ int ELEKTRA_PLUGIN_FUNCTION (get) (Plugin * handle, KeySet * returned, Key * par
 		}
 	}
 
-	pk->mtime.tv_sec = ELEKTRA_STAT_SECONDS (buf);
-	pk->mtime.tv_nsec = ELEKTRA_STAT_NANO_SECONDS (buf);
+	pk->mtime.tv_sec = buf.mtimeSec;
+	pk->mtime.tv_nsec = buf.mtimeNsec;
 
 	/* Persist modification times for cache */
-	if (global != NULL && ELEKTRA_STAT_NANO_SECONDS (buf) != 0)
+	if (global != NULL && buf.mtimeNsec != 0)
 	{
 		ELEKTRA_LOG_DEBUG ("global-cache: adding file modufication times");
 		Key * time = keyNew (name, KEY_BINARY, KEY_SIZE, sizeof (struct timespec), KEY_VALUE, &(pk->mtime), KEY_END);
@@ -964,18 +1279,37 @@ static void elektraUpdateFileTime (resolverHandle * pk, int fd, Key * parentKey)
 #endif
 }
 
+/**
+ * @brief Releases the locks of the configuration file and the committed file
+ *
+ * @param pk
+ * @param fd the descriptor of the committed file
+ * @param parentKey
+ */
+static void elektraSetUnlock (resolverHandle * pk, int fd, Key * parentKey)
+{
+	elektraUnlockFile (pk->fd, parentKey);
+	elektraCloseFile (pk->fd, parentKey);
+	elektraUnlockFile (fd, parentKey);
+	elektraCloseFile (fd, parentKey);
+	elektraUnlockMutex (parentKey);
+}
+
 /**
  * @brief Now commit the temporary file to be final
  *
  * @param pk
  * @param parentKey
+ * @param global the global keyset, if it contains KDB_SYNC_PREFIX the directory
+ *        is not synced but added below it and the locks are kept in pk->syncFd
+ *        until kdbSet() commits again
  *
- * It will also reset pk->fd
+ * It will also reset pk->fd, unless the locks are kept
  *
  * @retval 0 on success
  * @retval -1 on error
  */
-static int elektraSetCommit (resolverHandle * pk, Key * parentKey)
+static int elektraSetCommit (resolverHandle * pk, Key * parentKey, KeySet * global)
 {
 	int ret = 0;
 
@@ -998,12 +1332,14 @@ static int elektraSetCommit (resolverHandle * pk, Key * parentKey)
 	ELEKTRA_LOG_DEBUG ("old.tv_sec:\t%ld", pk->mtime.tv_sec);
 	ELEKTRA_LOG_DEBUG ("old.tv_nsec:\t%ld", pk->mtime.tv_nsec);
 	struct stat buf;
+	pk->ino = 0;
 	if (fstat (fd, &buf) == -1)
 	{
 		ELEKTRA_ADD_RESOURCE_WARNINGF (parentKey, "Failed to stat file '%s'. Reason: %s", pk->tempfile, strerror (errno));
 	}
 	else
 	{
+		pk->ino = buf.st_ino;
 		if (!(pk->mtime.tv_sec == ELEKTRA_STAT_SECONDS (buf) && pk->mtime.tv_nsec == ELEKTRA_STAT_NANO_SECONDS (buf)))
 		{
 			/* Update timestamp */
@@ -1054,19 +1390,36 @@ static int elektraSetCommit (resolverHandle * pk, Key * parentKey)
 	// file is present now!
 	pk->isMissing = 0;
 
-	DIR * dirp = opendir (pk->dirname);
-	// checking dirp not needed, fsync will have EBADF
-	if (fsync (dirfd (dirp)) == -1)
+	Key * syncKey = global ? ksLookupByName (global, KDB_SYNC_PREFIX, 0) : 0;
+	if (syncKey && ret == 0)
 	{
-		ELEKTRA_ADD_RESOURCE_WARNINGF (parentKey, "Could not sync directory '%s'. Reason: %s", pk->dirname, strerror (errno));
+		// kdbSet() syncs every directory once after all commits and commits again,
+		// so that no other writer sees the renamed file before the directory is synced
+		Key * dirKey = keyNew (KDB_SYNC_PREFIX, KEY_VALUE, pk->dirname, KEY_END);
+		keyAddName (dirKey, pk->dirname);
+		ksAppendKey (global, dirKey);
+		keySetString (syncKey, "locked");
+		pk->syncFd = fd;
+		return ret;
 	}
-	closedir (dirp);
 
-	elektraUnlockFile (pk->fd, parentKey);
-	elektraCloseFile (pk->fd, parentKey);
-	elektraUnlockFile (fd, parentKey);
-	elektraCloseFile (fd, parentKey);
-	elektraUnlockMutex (parentKey);
+	if (!syncKey)
+	{
+		DIR * dirp = opendir (pk->dirname);
+		// checking dirp not needed, fsync will have EBADF
+		if (fsync (dirfd (dirp)) == -1)
+		{
+			ELEKTRA_ADD_RESOURCE_WARNINGF (parentKey, "Could not sync directory '%s'. Reason: %s", pk->dirname,
+						       strerror (errno));
+		}
+		closedir (dirp);
+	}
+
+	elektraSetUnlock (pk, fd, parentKey);
+
+#ifdef HAVE_INOTIFY
+	if (ret == 0) elektraWatchClean (pk);
+#endif
 
 	return ret;
 }
@@ -1080,7 +1433,17 @@ int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle, KeySet * ks, Key * parentKey
 	int ret = 1;
 
 	ELEKTRA_LOG ("entering resolver::set %d \"%s\"", pk->fd, pk->filename);
-	if (pk->fd == -1)
+	if (pk->syncFd != -1)
+	{
+		// kdbSet() synced the directory after the commit
+		elektraSetUnlock (pk, pk->syncFd, parentKey);
+#ifdef HAVE_INOTIFY
+		elektraWatchClean (pk);
+#endif
+		pk->syncFd = -1;
+		pk->fd = -1;
+	}
+	else if (pk->fd == -1)
 	{
 		// no fd up to now, so we are in first phase
 
@@ -1130,13 +1493,13 @@ int ELEKTRA_PLUGIN_FUNCTION (set) (Plugin * handle, KeySet * ks, Key * parentKey
 		keySetString (parentKey, pk->filename);
 
 		/* we have an fd, so we are in second phase*/
-		if (elektraSetCommit (pk, parentKey) == -1)
+		if (elektraSetCommit (pk, parentKey, elektraPluginGetGlobalKeySet (handle)) == -1)
 		{
 			ret = -1;
 		}
 
-		// reset for next time
-		pk->fd = -1;
+		// reset for next time, unless the locks are kept until kdbSet() commits again
+		if (pk->syncFd == -1) pk->fd = -1;
 	}
 
 	ELEKTRA_LOG ("leaving resolver::set %d \"%s\"", pk->fd, pk->filename);
@@ -27,12 +27,16 @@ typedef struct _resolverHandle resolverHandle;
 struct _resolverHandle
 {
 	int fd;				///< Descriptor to the locking file
+	int syncFd;			///< Descriptor to the committed file, locked until kdbSet() synced the directory, -1 otherwise
 	struct timespec mtime;		///< Previous timestamp of the file
 	mode_t filemode;		///< The mode to set (from previous file)
 	mode_t dirmode;			///< The mode to set for new directories
 	unsigned int removalNeeded : 1; ///< Error on freshly created files need removal
 	unsigned int isMissing : 1;     ///< when doing kdbGet(), no file was there
+	int dirty;			///< an inotify event for the file arrived since the last kdbGet(), accessed atomically
 	int timeFix;			///< time increment to use for fixing the time
+	int wd;				///< inotify watch descriptor of dirname, -1 if not watched
+	ino_t ino;			///< inode of the last committed file, 0 if unknown
 
 	char * dirname;  ///< directory where real+temp file is
 	char * filename; ///< the full path to the configuration file
@@ -54,6 +58,9 @@ struct _resolverHandles
 	resolverHandle dir;
 	resolverHandle user;
 	resolverHandle system;
+
+	Key * statKey; ///< to look up KDB_STAT_PREFIX in the global keyset
+	int watch;     ///< watch the files with inotify instead of stat'ing them in every kdbGet()
 };
 
 void ELEKTRA_PLUGIN_FUNCTION (freeHandle) (ElektraResolved *);
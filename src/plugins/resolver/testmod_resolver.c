@@ -10,7 +10,9 @@
 
 #include <kdbinternal.h>
 
+#include <fcntl.h>
 #include <langinfo.h>
+#include <sys/stat.h>
 
 #include "resolver.h"
 
@@ -298,6 +300,265 @@ void test_checkfile (void)
 	ksDel (modules);
 }
 
+/**
+ * Sets the value of statKey like kdbGet() does, see KDB_STAT_PREFIX.
+ */
+static void setStat (Key * statKey, const ElektraStat * stat, const char * file)
+{
+	size_t fileSize = file ? strlen (file) + 1 : 0;
+	char * value = elektraMalloc (sizeof (ElektraStat) + fileSize);
+	memcpy (value, stat, sizeof (ElektraStat));
+	if (file) memcpy (value + sizeof (ElektraStat), file, fileSize);
+	keySetBinary (statKey, value, sizeof (ElektraStat) + fileSize);
+	elektraFree (value);
+}
+
+static void test_statcache (void)
+{
+	printf ("Resolve with stat results of kdbGet\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	Plugin * plugin = elektraPluginOpen ("resolver", modules, set_pluginconf (), 0);
+	exit_if_fail (plugin, "could not load resolver plugin");
+	KeySet * global = ksNew (0, KS_END);
+	plugin->global = global;
+
+	Key * parentKey = keyNew ("user", KEY_END);
+	KeySet * ks = ksNew (0, KS_END);
+	resolverHandles * h = elektraPluginGetData (plugin);
+	exit_if_fail (h != 0, "no plugin handle");
+
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "file should be missing");
+	succeed_if_same_string (keyString (parentKey), h->user.filename);
+
+	// the stat result of another file must not be used
+	ElektraStat stat = { .found = 1, .mode = 0100600, .mtimeSec = 5, .mtimeNsec = 0 };
+	Key * statKey = keyNew (KDB_STAT_PREFIX, KEY_BINARY, KEY_END);
+	setStat (statKey, &stat, "/not/the/file.ecf");
+	ksAppendKey (global, statKey);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "stat result of other file used");
+
+	// nor a stat result without file or with a file name that is not terminated
+	setStat (statKey, &stat, 0);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "stat result without file used");
+	setStat (statKey, &stat, h->user.filename);
+	char * unterminated = elektraMalloc (keyGetValueSize (statKey) - 1);
+	memcpy (unterminated, keyValue (statKey), keyGetValueSize (statKey) - 1);
+	keySetBinary (statKey, unterminated, keyGetValueSize (statKey) - 1);
+	elektraFree (unterminated);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "stat result with unterminated file used");
+
+	setStat (statKey, &stat, h->user.filename);
+
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "stat result of kdbGet not used");
+	succeed_if (h->user.mtime.tv_sec == 5, "modification time of stat result not used");
+	succeed_if (h->user.filemode == 0100600, "mode of stat result not used");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "no update needed with same stat result");
+
+	stat.found = 0;
+	setStat (statKey, &stat, h->user.filename);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "file should be missing");
+	succeed_if (h->user.mtime.tv_sec == 0, "modification time of missing file not reset");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	ksDel (global);
+	elektraPluginClose (plugin, 0);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+static void test_syncLater (void)
+{
+	printf ("Commit and leave syncing the directory to kdbSet\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	Plugin * plugin = elektraPluginOpen ("resolver", modules, set_pluginconf (), 0);
+	exit_if_fail (plugin, "could not load resolver plugin");
+	KeySet * global = ksNew (0, KS_END);
+	plugin->global = global;
+
+	Key * parentKey = keyNew ("user", KEY_END);
+	KeySet * ks = ksNew (1, keyNew ("user/key", KEY_VALUE, "value", KEY_END), KS_END);
+	resolverHandles * h = elektraPluginGetData (plugin);
+	exit_if_fail (h != 0, "no plugin handle");
+	mkdir (h->user.dirname, 0700);
+	unlink (h->user.filename);
+
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "file should be missing");
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "could not prepare");
+	FILE * temp = fopen (keyString (parentKey), "w");
+	exit_if_fail (temp, "could not write temporary file");
+	fclose (temp);
+
+	Key * syncKey = keyNew (KDB_SYNC_PREFIX, KEY_END);
+	ksAppendKey (global, syncKey);
+	succeed_if (plugin->kdbCommit (plugin, ks, parentKey) == 1, "could not commit");
+	succeed_if (access (h->user.filename, F_OK) == 0, "file not committed");
+
+	// the directory is left to kdbSet() and the locks are kept until then
+	Key * dirKey = keyNew (KDB_SYNC_PREFIX, KEY_END);
+	keyAddName (dirKey, h->user.dirname);
+	Key * found = ksLookup (global, dirKey, 0);
+	succeed_if (found, "directory not added");
+	if (found) succeed_if_same_string (keyString (found), h->user.dirname);
+	keyDel (dirKey);
+	succeed_if (*keyString (syncKey), "kept locks not reported");
+	int fd = h->user.fd;
+	int syncFd = h->user.syncFd;
+	succeed_if (fd >= 0 && fcntl (fd, F_GETFD) != -1, "configuration file not kept open");
+	succeed_if (syncFd >= 0 && fcntl (syncFd, F_GETFD) != -1, "committed file not kept open");
+
+	// the second commit releases the locks
+	succeed_if (plugin->kdbCommit (plugin, ks, parentKey) == 1, "could not release locks");
+	succeed_if (h->user.fd == -1 && h->user.syncFd == -1, "locks not released");
+	succeed_if (fcntl (fd, F_GETFD) == -1 && fcntl (syncFd, F_GETFD) == -1, "files not closed");
+
+	unlink (h->user.filename);
+	ksDel (ks);
+	keyDel (parentKey);
+	ksDel (global);
+	elektraPluginClose (plugin, 0);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+#ifdef HAVE_INOTIFY
+static void writeWatchedFile (const char * filename, const char * content)
+{
+	FILE * file = fopen (filename, "w");
+	exit_if_fail (file, "could not write file");
+	fputs (content, file);
+	fclose (file);
+
+	// always the same modification time
+	struct timespec times[2] = { { 5, 100 }, { 5, 100 } };
+	succeed_if (utimensat (AT_FDCWD, filename, times, 0) == 0, "could not set modification time");
+}
+
+static int watchedReported (Key * statKey)
+{
+	ElektraStat result;
+	exit_if_fail (keyGetValueSize (statKey) >= (ssize_t) sizeof (ElektraStat), "stat result too small");
+	memcpy (&result, keyValue (statKey), sizeof (ElektraStat));
+	return result.watched;
+}
+
+static void test_watch (void)
+{
+	printf ("Resolve with watched files\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	KeySet * conf = set_pluginconf ();
+	ksAppendKey (conf, keyNew ("user/watch", KEY_VALUE, "1", KEY_END));
+	Plugin * plugin = elektraPluginOpen ("resolver", modules, conf, 0);
+	exit_if_fail (plugin, "could not load resolver plugin");
+	KeySet * global = ksNew (0, KS_END);
+	plugin->global = global;
+	ElektraStat result = { 0 };
+	Key * statKey = keyNew (KDB_STAT_PREFIX, KEY_BINARY, KEY_END);
+	setStat (statKey, &result, 0);
+	ksAppendKey (global, statKey);
+
+	Key * parentKey = keyNew ("user", KEY_END);
+	KeySet * ks = ksNew (0, KS_END);
+	resolverHandles * h = elektraPluginGetData (plugin);
+	exit_if_fail (h != 0, "no plugin handle");
+	mkdir (h->user.dirname, 0700);
+	unlink (h->user.filename);
+
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "file should be missing");
+	succeed_if (h->user.wd != -1, "directory of missing file not watched");
+	succeed_if (watchedReported (statKey), "watch not reported to kdbGet");
+
+	writeWatchedFile (h->user.filename, "first");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "created file not noticed");
+	succeed_if (h->user.mtime.tv_sec == 5, "modification time not updated");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "unchanged file needs update");
+
+	writeWatchedFile (h->user.filename, "second");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "rewrite with same modification time not noticed");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "unchanged file needs update");
+
+	char * other = elektraFormat ("%s/other.ecf", h->user.dirname);
+	writeWatchedFile (other, "other");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "change of other file in directory noticed");
+	unlink (other);
+	elektraFree (other);
+
+	unlink (h->user.filename);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "file should be missing");
+	succeed_if (h->user.isMissing, "removed file not noticed");
+	succeed_if (h->user.mtime.tv_sec == 0, "modification time of missing file not reset");
+
+	ksDel (ks);
+	keyDel (parentKey);
+	ksDel (global);
+	elektraPluginClose (plugin, 0);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
+static void commitWatched (Plugin * plugin, KeySet * ks, Key * parentKey)
+{
+	succeed_if (plugin->kdbSet (plugin, ks, parentKey) == 1, "could not prepare");
+	FILE * temp = fopen (keyString (parentKey), "w");
+	exit_if_fail (temp, "could not write temporary file");
+	fclose (temp);
+	succeed_if (plugin->kdbCommit (plugin, ks, parentKey) == 1, "could not commit");
+}
+
+static void test_watchCommit (void)
+{
+	printf ("Commit watched files\n");
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	KeySet * conf = set_pluginconf ();
+	ksAppendKey (conf, keyNew ("user/watch", KEY_VALUE, "1", KEY_END));
+	Plugin * plugin = elektraPluginOpen ("resolver", modules, conf, 0);
+	exit_if_fail (plugin, "could not load resolver plugin");
+	KeySet * global = ksNew (0, KS_END);
+	plugin->global = global;
+
+	Key * parentKey = keyNew ("user", KEY_END);
+	KeySet * ks = ksNew (1, keyNew ("user/key", KEY_VALUE, "value", KEY_END), KS_END);
+	resolverHandles * h = elektraPluginGetData (plugin);
+	exit_if_fail (h != 0, "no plugin handle");
+	mkdir (h->user.dirname, 0700);
+	unlink (h->user.filename);
+
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "file should be missing");
+	commitWatched (plugin, ks, parentKey);
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "own commit needs update");
+
+	// the file is changed before the locks of the commit are released
+	Key * syncKey = keyNew (KDB_SYNC_PREFIX, KEY_END);
+	ksAppendKey (global, syncKey);
+	commitWatched (plugin, ks, parentKey);
+	succeed_if (*keyString (syncKey), "kept locks not reported");
+	writeWatchedFile (h->user.filename, "external");
+	succeed_if (plugin->kdbCommit (plugin, ks, parentKey) == 1, "could not release locks");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 1, "change after commit not noticed");
+	succeed_if (plugin->kdbGet (plugin, ks, parentKey) == 0, "unchanged file needs update");
+
+	unlink (h->user.filename);
+	ksDel (ks);
+	keyDel (parentKey);
+	ksDel (global);
+	elektraPluginClose (plugin, 0);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+#endif
+
 static void check_xdg (void)
 {
 	KeySet * modules = ksNew (0, KS_END);
@@ -338,6 +599,12 @@ int main (int argc, char ** argv)
 	test_name ();
 	test_lockname ();
 	test_tempname ();
+	test_statcache ();
+	test_syncLater ();
+#ifdef HAVE_INOTIFY
+	test_watch ();
+	test_watchCommit ();
+#endif
 
 
 	print_result ("testmod_resolver");
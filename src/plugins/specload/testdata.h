@@ -14,14 +14,16 @@
 
 #define DEFAULT_SPEC ksNew (50, keyNew (PARENT_KEY "/mykey", KEY_META, "default", "7", KEY_END), KS_END)
 
-unsigned char default_spec_expected[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x03, 0x0B, 0x6d, 0x79, 0x6b, 0x65, 0x79,
-					  0x73, 0x01, 0x6d, 0x0F, 0x64, 0x65, 0x66, 0x61, 0x75, 0x6c, 0x74, 0x03, 0x37, 0x00 };
-unsigned int default_spec_expected_size = 28;
+unsigned char default_spec_expected[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x0b, 0x0d, 0x6d, 0x79, 0x6b, 0x65, 0x79, 0x00,
+					  0x6d, 0x79, 0x6b, 0x65, 0x79, 0x00, 0x73, 0x03, 0x00, 0x6d, 0x0f, 0x11, 0x64, 0x65, 0x66, 0x61,
+					  0x75, 0x6c, 0x74, 0x00, 0x64, 0x65, 0x66, 0x61, 0x75, 0x6c, 0x74, 0x00, 0x05, 0x37, 0x00, 0x00 };
+unsigned int default_spec_expected_size = 48;
 
 #define NOPARENT_SPEC ksNew (50, keyNew ("/mykey", KEY_META, "default", "7", KEY_END), KS_END)
 
-unsigned char noparent_spec_expected[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x03, 0x0B, 0x6d, 0x79, 0x6b, 0x65, 0x79,
-					   0x73, 0x01, 0x6d, 0x0F, 0x64, 0x65, 0x66, 0x61, 0x75, 0x6c, 0x74, 0x03, 0x37, 0x00 };
-unsigned int noparent_spec_expected_size = 28;
+unsigned char noparent_spec_expected[] = { 0x45, 0x4b, 0x44, 0x42, 0x00, 0x00, 0x00, 0x04, 0x0b, 0x0d, 0x6d, 0x79, 0x6b, 0x65, 0x79, 0x00,
+					   0x6d, 0x79, 0x6b, 0x65, 0x79, 0x00, 0x73, 0x03, 0x00, 0x6d, 0x0f, 0x11, 0x64, 0x65, 0x66, 0x61,
+					   0x75, 0x6c, 0x74, 0x00, 0x64, 0x65, 0x66, 0x61, 0x75, 0x6c, 0x74, 0x00, 0x05, 0x37, 0x00, 0x00 };
+unsigned int noparent_spec_expected_size = 48;
 
 #endif // ELEKTRA_SPECLOAD_TESTDATA_H
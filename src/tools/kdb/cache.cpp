@@ -58,8 +58,13 @@ int CacheCommand::execute (Cmdline const & cl)
 	}
 	else if (cmd == "clear")
 	{
+		// clear the shared memory cache if it is used
+		KeySet pluginConfig = cl.getPluginsConfig ();
+		Key shm = conf.lookup ("system/elektra/cache/shm");
+		if (shm) pluginConfig.append (Key ("system/shm", KEY_VALUE, shm.getString ().c_str (), KEY_END));
+
 		Modules modules;
-		PluginPtr plugin = modules.load ("cache", cl.getPluginsConfig ());
+		PluginPtr plugin = modules.load ("cache", pluginConfig);
 
 		KeySet ks;
 		parentKey.setMeta ("cache/clear", "1");
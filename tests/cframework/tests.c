@@ -342,20 +342,14 @@ void output_backend (Backend * backend)
 
 void output_trie (Trie * trie)
 {
-	int i;
-	for (i = 0; i < KDB_MAX_UCHAR; ++i)
+	for (size_t i = 0; i < trie->size; ++i)
 	{
-		if (trie->value[i])
+		const TrieNode * node = &trie->nodes[i];
+		if (node->value)
 		{
-			printf ("output_trie: %p, mp: %s %s [%d]\n", (void *) trie->value[i], keyName (trie->value[i]->mountpoint),
-				keyString (trie->value[i]->mountpoint), i);
+			printf ("output_trie: %p, mp: %s %s [%zu]\n", (void *) node->value, keyName (node->value->mountpoint),
+				keyString (node->value->mountpoint), i);
 		}
-		if (trie->children[i]) output_trie (trie->children[i]);
-	}
-	if (trie->empty_value)
-	{
-		printf ("empty_value: %p, mp: %s %s\n", (void *) trie->empty_value, keyName (trie->empty_value->mountpoint),
-			keyString (trie->empty_value->mountpoint));
 	}
 }
 
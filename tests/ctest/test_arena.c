@@ -0,0 +1,301 @@
+/**
+ * @file
+ *
+ * @brief Tests for the arena of Key and KeySet structs.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <kdbproposal.h>
+#include <tests_internal.h>
+
+static void test_arenaAlloc (void)
+{
+	printf ("Test arena allocation\n");
+
+	ElektraArena * arena = elektraArenaNew ();
+	exit_if_fail (arena, "could not create arena");
+
+	succeed_if (elektraArenaCalloc (sizeof (Key)) == 0, "no arena active, must allocate from heap");
+
+	ElektraArena * previous = elektraArenaActivate (arena);
+	succeed_if (previous == 0, "there should be no arena active before");
+
+	Key * key = keyNew ("user/tests/arena", KEY_VALUE, "value", KEY_META, "meta", "data", KEY_END);
+	Key * empty = keyNew (0);
+	KeySet * ks = ksNew (0, KS_END);
+
+	succeed_if (elektraArenaActivate (previous) == arena, "wrong active arena");
+
+	Key * heap = keyNew ("user/tests/heap", KEY_END);
+
+	succeed_if (test_bit (key->flags, KEY_FLAG_ARENA_STRUCT), "key not allocated from arena");
+	succeed_if (test_bit (empty->flags, KEY_FLAG_ARENA_STRUCT), "empty key not allocated from arena");
+	succeed_if (test_bit (key->meta->flags, KS_FLAG_ARENA_STRUCT), "meta keyset not allocated from arena");
+	succeed_if (test_bit (ks->flags, KS_FLAG_ARENA_STRUCT), "keyset not allocated from arena");
+	succeed_if (!test_bit (heap->flags, KEY_FLAG_ARENA_STRUCT), "key allocated from inactive arena");
+
+	// the arena can be deleted while its objects are still in use
+	elektraArenaDel (arena);
+
+	succeed_if_same_string (keyName (key), "user/tests/arena");
+	succeed_if_same_string (keyString (key), "value");
+	succeed_if_same_string (keyString (keyGetMeta (key, "meta")), "data");
+
+	keySetName (key, "user/tests/arena/renamed/with/a/longer/name");
+	keySetString (key, "a new and longer value");
+	succeed_if_same_string (keyName (key), "user/tests/arena/renamed/with/a/longer/name");
+	succeed_if_same_string (keyString (key), "a new and longer value");
+
+	keyClear (key);
+	succeed_if (test_bit (key->flags, KEY_FLAG_ARENA_STRUCT), "keyClear must keep the arena flag");
+
+	ksAppendKey (ks, heap);
+	ksAppendKey (ks, empty);
+	ksDel (ks);
+	keyDel (key);
+}
+
+static void test_arenaDup (void)
+{
+	printf ("Test arena duplication\n");
+
+	ElektraArena * arena = elektraArenaNew ();
+	ElektraArena * previous = elektraArenaActivate (arena);
+
+	Key * heap = 0;
+	Key * key = keyNew ("user/tests/arena", KEY_VALUE, "value", KEY_END);
+	Key * dup = keyDup (key);
+
+	elektraArenaActivate (previous);
+	heap = keyDup (key);
+
+	succeed_if (test_bit (dup->flags, KEY_FLAG_ARENA_STRUCT), "duplicate not allocated from arena");
+	succeed_if (!test_bit (heap->flags, KEY_FLAG_ARENA_STRUCT), "duplicate must not inherit arena flag");
+	succeed_if_same_string (keyString (dup), "value");
+	succeed_if_same_string (keyString (heap), "value");
+
+	keyDel (key);
+	keyDel (dup);
+	elektraArenaDel (arena);
+	keyDel (heap);
+}
+
+static void test_arenaChunks (void)
+{
+	printf ("Test arena with many chunks\n");
+
+	const size_t count = 4 * ELEKTRA_ARENA_CHUNK_SIZE / sizeof (Key);
+
+	ElektraArena * arena = elektraArenaNew ();
+	ElektraArena * previous = elektraArenaActivate (arena);
+
+	KeySet * ks = ksNew (0, KS_END);
+	Key * survivor = 0;
+	char name[64];
+	for (size_t i = 0; i < count; ++i)
+	{
+		snprintf (name, sizeof (name), "user/tests/arena/%zu", i);
+		Key * key = keyNew (name, KEY_VALUE, name, KEY_END);
+		if (i == count / 2)
+		{
+			survivor = key;
+			keyIncRef (survivor);
+		}
+		ksAppendKey (ks, key);
+	}
+
+	elektraArenaActivate (previous);
+
+	succeed_if ((size_t) ksGetSize (ks) == count, "wrong size");
+	ksDel (ks);
+	elektraArenaDel (arena);
+
+	// the chunk of the survivor must still be there
+	snprintf (name, sizeof (name), "user/tests/arena/%zu", count / 2);
+	succeed_if_same_string (keyName (survivor), name);
+	succeed_if_same_string (keyString (survivor), name);
+	keyDecRef (survivor);
+	keyDel (survivor);
+}
+
+/**
+ * Creates a key whose name and value are allocated from @p arena, as done by storage plugins.
+ */
+static Key * arenaKeyNew (ElektraArena * arena, const char * name, const char * value)
+{
+	Key * heap = keyNew (name, KEY_VALUE, value, KEY_END);
+	Key * key = keyNew (0, KEY_END);
+	key->key = elektraArenaMalloc (arena, heap->keySize + heap->keyUSize);
+	memcpy (key->key, heap->key, heap->keySize + heap->keyUSize);
+	key->keySize = heap->keySize;
+	key->keyUSize = heap->keyUSize;
+	key->data.v = elektraArenaMalloc (arena, heap->dataSize);
+	memcpy (key->data.v, heap->data.v, heap->dataSize);
+	key->dataSize = heap->dataSize;
+	key->flags |= KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA;
+	keyDel (heap);
+	return key;
+}
+
+static void test_arenaNameValue (void)
+{
+	printf ("Test names and values in arena\n");
+
+	ElektraArena * arena = elektraArenaNew ();
+	succeed_if (elektraArenaReserve (arena, 4 * ELEKTRA_ARENA_CHUNK_SIZE, 10) == 0, "could not reserve space");
+
+	// larger than ELEKTRA_ARENA_MAX_OBJECT, fits into the reserved space
+	char * large = elektraArenaMalloc (arena, 2 * ELEKTRA_ARENA_CHUNK_SIZE);
+	exit_if_fail (large, "could not allocate large object");
+	memset (large, 'x', 2 * ELEKTRA_ARENA_CHUNK_SIZE);
+
+	Key * renamed = arenaKeyNew (arena, "user/tests/arena/renamed", "value");
+	Key * added = arenaKeyNew (arena, "user/tests/arena/added", "value");
+	Key * base = arenaKeyNew (arena, "user/tests/arena/base", "value");
+	Key * changed = arenaKeyNew (arena, "user/tests/arena/changed", "value");
+	Key * removed = arenaKeyNew (arena, "user/tests/arena/removed", "value");
+	Key * copy = arenaKeyNew (arena, "user/tests/arena/copy", "value");
+	Key * cleared = arenaKeyNew (arena, "user/tests/arena/cleared", "value");
+	elektraArenaDel (arena);
+	elektraArenaFree (large);
+
+	succeed_if_same_string (keyName (renamed), "user/tests/arena/renamed");
+	succeed_if_same_string (keyString (renamed), "value");
+
+	keySetName (renamed, "user/tests/arena/renamed/with/a/longer/name");
+	succeed_if_same_string (keyName (renamed), "user/tests/arena/renamed/with/a/longer/name");
+	succeed_if (!test_bit (renamed->flags, KEY_FLAG_ARENA_KEY), "name was moved to the heap");
+	succeed_if (test_bit (renamed->flags, KEY_FLAG_ARENA_DATA), "value was not changed");
+
+	keyAddName (added, "../sibling/child");
+	succeed_if_same_string (keyName (added), "user/tests/arena/sibling/child");
+	succeed_if_same_string (keyBaseName (added), "child");
+
+	keyAddBaseName (base, "child");
+	succeed_if_same_string (keyName (base), "user/tests/arena/base/child");
+	keySetBaseName (base, "other");
+	succeed_if_same_string (keyName (base), "user/tests/arena/base/other");
+
+	// the new value may point into the old one
+	keySetString (changed, keyString (changed) + 1);
+	succeed_if_same_string (keyString (changed), "alue");
+	succeed_if (!test_bit (changed->flags, KEY_FLAG_ARENA_DATA), "value was moved to the heap");
+	keySetString (changed, "a new and longer value");
+	succeed_if_same_string (keyString (changed), "a new and longer value");
+
+	keySetBinary (removed, 0, 0);
+	succeed_if (keyGetValueSize (removed) == 0, "value not removed");
+
+	Key * dup = keyDup (copy);
+	succeed_if (!test_bit (dup->flags, KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA), "duplicate must not inherit arena flags");
+	succeed_if (keyCopy (copy, renamed) == 1, "could not copy key");
+	succeed_if (!test_bit (copy->flags, KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA), "copied key must be on the heap");
+	succeed_if_same_string (keyName (copy), "user/tests/arena/renamed/with/a/longer/name");
+	succeed_if_same_string (keyName (dup), "user/tests/arena/copy");
+
+	keyClear (cleared);
+	succeed_if (!test_bit (cleared->flags, KEY_FLAG_ARENA_KEY | KEY_FLAG_ARENA_DATA), "keyClear must remove arena flags");
+
+	keyDel (renamed);
+	keyDel (added);
+	keyDel (base);
+	keyDel (changed);
+	keyDel (removed);
+	keyDel (dup);
+	keyDel (copy);
+	keyDel (cleared);
+}
+
+typedef struct
+{
+	Key ** keys;
+	size_t count;
+	size_t offset;
+	size_t stride;
+} ArenaDelTask;
+
+static void arenaDelTask (void * data)
+{
+	ArenaDelTask * task = data;
+	for (size_t i = task->offset; i < task->count; i += task->stride)
+	{
+		keyDel (task->keys[i]);
+	}
+}
+
+static void test_arenaThreads (void)
+{
+	printf ("Test arena with keys deleted by several threads\n");
+
+	const size_t threads = 4;
+	const size_t count = 16 * ELEKTRA_ARENA_CHUNK_SIZE / sizeof (Key);
+	ElektraThreadPool * pool = elektraThreadPoolNew (threads);
+	exit_if_fail (pool, "could not create thread pool");
+	Key ** keys = elektraMalloc (count * sizeof (Key *));
+	ArenaDelTask tasks[4];
+	char name[64];
+
+	for (size_t round = 0; round < 10; ++round)
+	{
+		// the keys of neighbouring indices share chunks, but are deleted by different threads
+		ElektraArena * arena = elektraArenaNew ();
+		ElektraArena * previous = elektraArenaActivate (arena);
+		for (size_t i = 0; i < count; ++i)
+		{
+			snprintf (name, sizeof (name), "user/tests/arena/%zu", i);
+			keys[i] = arenaKeyNew (arena, name, name);
+		}
+		elektraArenaActivate (previous);
+		if (round % 2) elektraArenaDel (arena);
+
+		for (size_t t = 0; t < threads; ++t)
+		{
+			tasks[t] = (ArenaDelTask){ .keys = keys, .count = count, .offset = t, .stride = threads };
+		}
+		elektraThreadPoolRun (pool, arenaDelTask, tasks, threads, sizeof (ArenaDelTask));
+
+		// the chunks of the keys are freed either here or by the last keyDel above
+		if (round % 2 == 0) elektraArenaDel (arena);
+	}
+
+	elektraFree (keys);
+	elektraThreadPoolDel (pool);
+}
+
+static void test_ksNewArena (void)
+{
+	printf ("Test ksNewArena\n");
+
+	KeySet * ks = elektraKsNewArena (10);
+	exit_if_fail (ks, "could not create keyset with arena");
+	succeed_if (ks->arena != 0, "keyset has no arena");
+	succeed_if (!test_bit (ks->flags, KS_FLAG_ARENA_STRUCT), "keyset itself must be on the heap");
+
+	// only kdbGet uses the arena
+	Key * key = keyNew ("user/tests/arena", KEY_END);
+	succeed_if (!test_bit (key->flags, KEY_FLAG_ARENA_STRUCT), "key allocated from arena outside of kdbGet");
+	ksAppendKey (ks, key);
+	succeed_if (ksGetSize (ks) == 1, "wrong size");
+
+	ksDel (ks);
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("ARENA        TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_arenaAlloc ();
+	test_arenaDup ();
+	test_arenaChunks ();
+	test_arenaNameValue ();
+	test_arenaThreads ();
+	test_ksNewArena ();
+
+	printf ("\ntest_arena RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -7,6 +7,7 @@
  */
 
 #include <kdbease.h>
+#include <kdbproposal.h>
 #include <tests_internal.h>
 
 ssize_t ksCopyInternal (KeySet * ks, size_t to, size_t from);
@@ -205,6 +206,287 @@ static void test_ksNoAlloc (void)
 	ksDel (ks);
 }
 
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+static void test_ksPrefixes (void)
+{
+	printf ("Test name prefixes\n");
+
+	char name[100];
+	KeySet * ks = ksNew (0, KS_END);
+	// common parts longer than the prefix and names shorter than the prefix
+	ksAppendKey (ks, keyNew ("user", KEY_END));
+	ksAppendKey (ks, keyNew ("user/a", KEY_END));
+	for (int i = 0; i < 2 * KEYSET_PREFIX_MIN; ++i)
+	{
+		snprintf (name, sizeof (name), "user/a/very/long/common/part/%d", i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+		snprintf (name, sizeof (name), "user/%d", i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+	}
+	succeed_if (ks->prefixes == 0, "prefixes built without lookups");
+
+	for (int i = 0; i < 2 * KEYSET_PREFIX_MIN; ++i)
+	{
+		snprintf (name, sizeof (name), "user/%d", i);
+		succeed_if (ksLookupByName (ks, name, KDB_O_BINSEARCH) != 0, "key not found");
+	}
+	succeed_if (ks->prefixes != 0, "prefixes not built after lookups");
+
+	// ksAppendKey keeps the prefixes up to date
+	ksAppendKey (ks, keyNew ("user/a/very/long/common/part/0/below", KEY_END));
+	ksAppendKey (ks, keyNew ("user/a/very/long", KEY_END));
+	ksAppendKey (ks, keyNew ("system", KEY_END));
+	succeed_if (ks->prefixes != 0, "prefixes dropped by ksAppendKey");
+
+	succeed_if (ksLookupByName (ks, "user/a/very/long/common/part/0/below", KDB_O_BINSEARCH) != 0, "key not found");
+	succeed_if (ksLookupByName (ks, "user/a/very/long", KDB_O_BINSEARCH) != 0, "key not found");
+	succeed_if (ksLookupByName (ks, "system", KDB_O_BINSEARCH) != 0, "key not found");
+	succeed_if (ksLookupByName (ks, "user", KDB_O_BINSEARCH) != 0, "key not found");
+	succeed_if (ksLookupByName (ks, "user/a", KDB_O_BINSEARCH) != 0, "key not found");
+	succeed_if (ksLookupByName (ks, "user/a/very", KDB_O_BINSEARCH) == 0, "found not existing key");
+	succeed_if (ksLookupByName (ks, "user/a/very/long/common/part/999", KDB_O_BINSEARCH) == 0, "found not existing key");
+	for (int i = 0; i < 2 * KEYSET_PREFIX_MIN; ++i)
+	{
+		snprintf (name, sizeof (name), "user/a/very/long/common/part/%d", i);
+		Key * found = ksLookupByName (ks, name, KDB_O_BINSEARCH);
+		succeed_if (found != 0, "key not found");
+		if (found) succeed_if_same_string (keyName (found), name);
+	}
+
+	// order is still correct
+	Key * prev = 0;
+	Key * cur;
+	ksRewind (ks);
+	while ((cur = ksNext (ks)) != 0)
+	{
+		if (prev) succeed_if (keyCmp (prev, cur) < 0, "keyset not sorted");
+		prev = cur;
+	}
+
+	// removal of keys drops the prefixes
+	Key * cutpoint = keyNew ("user/a/very/long/common", KEY_END);
+	KeySet * cut = ksCut (ks, cutpoint);
+	succeed_if (ks->prefixes == 0, "prefixes not dropped by ksCut");
+	succeed_if (ksGetSize (cut) == 2 * KEYSET_PREFIX_MIN + 1, "wrong size of cut keyset");
+	succeed_if (ksLookupByName (ks, "user/a/very/long/common/part/0", KDB_O_BINSEARCH) == 0, "found cut key");
+	succeed_if (ksLookupByName (ks, "user/a/very/long", KDB_O_BINSEARCH) != 0, "key not found");
+	keyDel (cutpoint);
+	ksDel (cut);
+
+	ksDel (ks);
+}
+#endif
+
+static void test_ksBulk (void)
+{
+	printf ("Test bulk append\n");
+
+	Key * shared = keyNew ("user/bulk/shared", KEY_END);
+	keyIncRef (shared);
+	Key * first = keyNew ("user/bulk/dup", KEY_VALUE, "first", KEY_END);
+	keyIncRef (first);
+
+	KeySet * ks = ksNew (0, KS_END);
+	ksAppendKey (ks, keyNew ("user/bulk/m", KEY_VALUE, "old", KEY_END));
+	ksAppendKey (ks, keyNew ("user/bulk/z", KEY_END));
+
+	succeed_if (elektraKsBulkAppendKey (ks, keyNew ("user/bulk/b", KEY_END)) == 3, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, first) == 4, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, keyNew ("user/bulk/m", KEY_VALUE, "new", KEY_END)) == 5, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, shared) == 6, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, keyNew ("user/bulk/dup", KEY_VALUE, "second", KEY_END)) == 7, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, keyNew ("user/bulk", KEY_END)) == 8, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, shared) == 9, "wrong size");
+	succeed_if (elektraKsBulkAppendKey (ks, keyNew (0)) == -1, "key without name must not be appended");
+	succeed_if (keyIsLocked (shared, KEY_LOCK_NAME), "name of appended key must be locked");
+
+	succeed_if (elektraKsBulkFinish (ks) == 6, "duplicates not removed");
+	succeed_if (ksCurrent (ks) == 0, "cursor not rewound");
+
+	const char * expected[] = { "user/bulk", "user/bulk/b", "user/bulk/dup", "user/bulk/m", "user/bulk/shared", "user/bulk/z" };
+	for (ssize_t i = 0; i < ksGetSize (ks); ++i)
+	{
+		succeed_if_same_string (keyName (ksAtCursor (ks, i)), expected[i]);
+	}
+	succeed_if_same_string (keyString (ksLookupByName (ks, "user/bulk/dup", 0)), "second");
+	succeed_if_same_string (keyString (ksLookupByName (ks, "user/bulk/m", 0)), "new");
+	succeed_if (keyGetRef (first) == 1, "replaced key still referenced by keyset");
+	succeed_if (keyGetRef (shared) == 2, "key appended twice must be referenced once by keyset");
+
+	// the keyset is usable as usual afterwards
+	ksAppendKey (ks, keyNew ("user/bulk/c", KEY_END));
+	succeed_if (ksGetSize (ks) == 7, "wrong size after append");
+	succeed_if (ksLookupByName (ks, "user/bulk/c", 0) != 0, "appended key not found");
+	ksDel (ks);
+
+	succeed_if (keyGetRef (shared) == 1, "wrong reference count after ksDel");
+	keyDecRef (shared);
+	keyDel (shared);
+	keyDecRef (first);
+	keyDel (first);
+
+	// ksNew uses the bulk append, later keys win
+	ks = ksNew (3, keyNew ("user/b", KEY_VALUE, "1", KEY_END), keyNew ("user/a", KEY_END), keyNew ("user/b", KEY_VALUE, "2", KEY_END),
+		    KS_END);
+	succeed_if (ksGetSize (ks) == 2, "duplicates not removed by ksNew");
+	succeed_if_same_string (keyName (ksAtCursor (ks, 0)), "user/a");
+	succeed_if_same_string (keyString (ksLookupByName (ks, "user/b", 0)), "2");
+	ksDel (ks);
+
+	// larger unsorted input
+	ks = ksNew (0, KS_END);
+	char name[64];
+	for (int i = 0; i < 1000; ++i)
+	{
+		snprintf (name, sizeof (name), "user/bulk/%d", (i * 7919) % 500);
+		elektraKsBulkAppendKey (ks, keyNew (name, KEY_VALUE, name, KEY_META, "index", "x", KEY_END));
+	}
+	succeed_if (elektraKsBulkFinish (ks) == 500, "wrong size of large keyset");
+	for (ssize_t i = 1; i < ksGetSize (ks); ++i)
+	{
+		succeed_if (keyCmp (ksAtCursor (ks, i - 1), ksAtCursor (ks, i)) < 0, "large keyset not sorted");
+	}
+	ksDel (ks);
+}
+
+static void test_ksMerge (void)
+{
+	printf ("Test merging append\n");
+
+	char name[64];
+	KeySet * ks = ksNew (0, KS_END);
+	KeySet * toAppend = ksNew (0, KS_END);
+
+	// even keys in ks, every third key in toAppend
+	for (int i = 0; i < 300; i += 2)
+	{
+		snprintf (name, sizeof (name), "user/merge/%03d", i);
+		ksAppendKey (ks, keyNew (name, KEY_VALUE, "ks", KEY_END));
+	}
+	for (int i = 0; i < 300; i += 3)
+	{
+		snprintf (name, sizeof (name), "user/merge/%03d", i);
+		ksAppendKey (toAppend, keyNew (name, KEY_VALUE, "toAppend", KEY_END));
+	}
+
+	Key * shared = ksLookupByName (ks, "user/merge/000", 0);
+	ksAppendKey (toAppend, shared);
+	Key * replaced = ksLookupByName (ks, "user/merge/006", 0);
+	keyIncRef (replaced);
+	succeed_if (toAppend->size >= KEYSET_MERGE_MIN, "toAppend too small to be merged");
+
+	succeed_if (ksAppend (ks, toAppend) == 200, "wrong size after merge");
+	succeed_if (ksGetSize (toAppend) == 100, "toAppend must be unchanged");
+	succeed_if_same_string (keyName (ksCurrent (ks)), "user/merge/297");
+	for (ssize_t i = 1; i < ksGetSize (ks); ++i)
+	{
+		succeed_if (keyCmp (ksAtCursor (ks, i - 1), ksAtCursor (ks, i)) < 0, "merged keyset not sorted");
+	}
+	for (int i = 0; i < 300; ++i)
+	{
+		snprintf (name, sizeof (name), "user/merge/%03d", i);
+		Key * found = ksLookupByName (ks, name, 0);
+		if (i % 2 && i % 3)
+		{
+			succeed_if (!found, "key not in any keyset found");
+		}
+		else if (i == 0)
+		{
+			succeed_if (found == shared, "key in both keysets must stay");
+		}
+		else
+		{
+			succeed_if (found != 0, "key not found after merge");
+			succeed_if_same_string (keyString (found), i % 3 ? "ks" : "toAppend");
+		}
+	}
+
+	succeed_if (keyGetRef (shared) == 2, "key in both keysets must be referenced once by each");
+	succeed_if (keyGetRef (replaced) == 1, "replaced key still referenced by keyset");
+	succeed_if (keyGetRef (ksLookupByName (ks, "user/merge/003", 0)) == 2, "appended key not referenced by both keysets");
+	succeed_if (keyIsLocked (ksLookupByName (ks, "user/merge/009", 0), KEY_LOCK_NAME), "name of appended key must be locked");
+
+	ksDel (toAppend);
+	ksDel (ks);
+	keyDecRef (replaced);
+	keyDel (replaced);
+
+	// merge into an empty keyset
+	ks = ksNew (0, KS_END);
+	toAppend = ksNew (0, KS_END);
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf (name, sizeof (name), "user/merge/%03d", i);
+		ksAppendKey (toAppend, keyNew (name, KEY_END));
+	}
+	succeed_if (ksAppend (ks, toAppend) == 100, "wrong size after merge into empty keyset");
+	succeed_if (ksAppend (ks, toAppend) == 100, "appending the same keys must not change the size");
+	succeed_if (ksAppend (ks, ks) == 100, "appending a keyset to itself must not change the size");
+	for (ssize_t i = 0; i < ksGetSize (ks); ++i)
+	{
+		succeed_if (ksAtCursor (ks, i) == ksAtCursor (toAppend, i), "keys differ after merge into empty keyset");
+		succeed_if (keyGetRef (ksAtCursor (ks, i)) == 2, "wrong reference count after merge into empty keyset");
+	}
+	ksDel (toAppend);
+	ksDel (ks);
+}
+
+static void test_ksFindHierarchy (void)
+{
+	printf ("Test find hierarchy\n");
+
+	KeySet * ks = ksNew (20, keyNew ("/sw/app", KEY_END), keyNew ("system/sw", KEY_END), keyNew ("user/sw", KEY_END),
+			     keyNew ("user/sw/app", KEY_END), keyNew ("user/sw/app/a", KEY_END), keyNew ("user/sw/app/b", KEY_END),
+			     keyNew ("user/sw/app#", KEY_END), keyNew ("user/sw/app2", KEY_END), keyNew ("user/sw/apps/x", KEY_END),
+			     keyNew ("user/sw/b", KEY_END), KS_END);
+	ksLookupByName (ks, "user/sw/b", 0);
+	Key * cursor = ksCurrent (ks);
+
+	Key * root = keyNew ("user/sw/app", KEY_END);
+	ssize_t end = -1;
+	ssize_t it = elektraKsFindHierarchy (ks, root, &end);
+	succeed_if (it == 3 && end == 6, "wrong range of user/sw/app");
+	const char * expected[] = { "user/sw/app", "user/sw/app/a", "user/sw/app/b" };
+	for (ssize_t i = it; i < end && i - it < 3; ++i)
+	{
+		succeed_if_same_string (keyName (ksAtCursor (ks, i)), expected[i - it]);
+	}
+	succeed_if (ksGetSize (ks) == 10, "keyset must not be changed");
+	succeed_if (ksCurrent (ks) == cursor, "cursor must not be changed");
+
+	// root not in keyset
+	keySetName (root, "user/sw/apps");
+	it = elektraKsFindHierarchy (ks, root, &end);
+	succeed_if (end - it == 1, "wrong size of range without root");
+	succeed_if_same_string (keyName (ksAtCursor (ks, it)), "user/sw/apps/x");
+
+	keySetName (root, "user/sw/c");
+	it = elektraKsFindHierarchy (ks, root, &end);
+	succeed_if (it == end && it == ksGetSize (ks), "range must be empty");
+
+	keySetName (root, "user");
+	it = elektraKsFindHierarchy (ks, root, &end);
+	succeed_if (it == 2 && end == 10, "wrong range of namespace");
+
+	// only cascading keys for cascading root
+	keySetName (root, "/sw");
+	it = elektraKsFindHierarchy (ks, root, &end);
+	succeed_if (it == 0 && end == 1, "wrong range of cascading root");
+
+	succeed_if (elektraKsFindHierarchy (0, root, &end) == -1, "no error on NULL keyset");
+	succeed_if (elektraKsFindHierarchy (ks, 0, &end) == -1, "no error on NULL root");
+
+	// the same keys as ksCut
+	keySetName (root, "user/sw/app");
+	it = elektraKsFindHierarchy (ks, root, &end);
+	KeySet * cut = ksCut (ks, root);
+	succeed_if (ksGetSize (cut) == end - it, "ksCut cut other keys");
+	ksDel (cut);
+
+	keyDel (root);
+	ksDel (ks);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KS         TESTS\n");
@@ -218,6 +500,12 @@ int main (int argc, char ** argv)
 	test_cascadingLookup ();
 	test_creatingLookup ();
 	test_ksNoAlloc ();
+	test_ksBulk ();
+	test_ksMerge ();
+	test_ksFindHierarchy ();
+#ifdef ELEKTRA_ENABLE_OPTIMIZATIONS
+	test_ksPrefixes ();
+#endif
 
 	printf ("\ntest_ks RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
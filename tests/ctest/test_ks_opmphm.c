@@ -208,8 +208,20 @@ void test_Invalidate (void)
 		exit_if_fail (ks->opmphm, "build opmphm");
 		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
 
-		// insert new one
-		succeed_if (ksAppendKey (ks, keyNew ("/k", KEY_END)) > 0, "invalidate");
+		// insert new one, goes to the delta
+		succeed_if (ksAppendKey (ks, keyNew ("/k", KEY_END)) > 0, "not invalidate");
+
+		exit_if_fail (ks->opmphm, "build opmphm");
+		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
+		succeed_if (ksLookupByName (ks, "/k", KDB_O_OPMPHM), "key in delta not found");
+
+		// insert until the delta is full
+		char name[30];
+		for (size_t i = 0; i < OPMPHM_DELTA_MAX; ++i)
+		{
+			snprintf (name, sizeof (name), "/l%zu", i);
+			succeed_if (ksAppendKey (ks, keyNew (name, KEY_END)) > 0, "append");
+		}
 
 		exit_if_fail (ks->opmphm, "build opmphm");
 		succeed_if (!opmphmIsBuild (ks->opmphm), "empty opmphm");
@@ -244,10 +256,12 @@ void test_Invalidate (void)
 		exit_if_fail (ks->opmphm, "build opmphm");
 		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
 
-		succeed_if (ksAppend (ks, appendSuper) > 0, "invalidate");
+		// the new key goes to the delta
+		succeed_if (ksAppend (ks, appendSuper) > 0, "not invalidate");
 
 		exit_if_fail (ks->opmphm, "build opmphm");
-		succeed_if (!opmphmIsBuild (ks->opmphm), "empty opmphm");
+		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
+		succeed_if (ksLookupByName (ks, "/k", KDB_O_OPMPHM), "key in delta not found");
 
 		// cleanup
 		ksDel (ks);
@@ -314,10 +328,12 @@ void test_Invalidate (void)
 		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
 
 		Key * popKey = ksPop (ks);
-		succeed_if (popKey, "invalidate");
+		succeed_if (popKey, "not invalidate");
 
 		exit_if_fail (ks->opmphm, "build opmphm");
-		succeed_if (!opmphmIsBuild (ks->opmphm), "empty opmphm");
+		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
+		succeed_if (!ksLookupByName (ks, "/j", KDB_O_OPMPHM), "popped key found");
+		succeed_if (ksLookupByName (ks, "/i", KDB_O_OPMPHM), "key not found");
 
 		// cleanup
 		ksDel (ks);
@@ -337,10 +353,12 @@ void test_Invalidate (void)
 		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
 
 		Key * popKey = elektraKsPopAtCursor (ks, 1);
-		succeed_if (popKey, "invalidate");
+		succeed_if (popKey, "not invalidate");
 
 		exit_if_fail (ks->opmphm, "build opmphm");
-		succeed_if (!opmphmIsBuild (ks->opmphm), "empty opmphm");
+		succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
+		succeed_if (!ksLookupByName (ks, "/b", KDB_O_OPMPHM), "popped key found");
+		succeed_if (ksLookupByName (ks, "/c", KDB_O_OPMPHM) == ks->array[1], "moved key not found");
 
 		// cleanup
 		ksDel (ks);
@@ -348,6 +366,124 @@ void test_Invalidate (void)
 	}
 }
 
+void test_Delta (void)
+{
+	const size_t n = 2000;
+	char name[20];
+
+	KeySet * ks = ksNew (n, KS_END);
+	for (size_t i = 0; i < n; i += 2)
+	{
+		snprintf (name, sizeof (name), "/key%05zu", i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+	}
+
+	// trigger build
+	succeed_if (!ksLookupByName (ks, "/nothere", KDB_O_OPMPHM), "key found");
+	exit_if_fail (ks->opmphm, "build opmphm");
+	succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
+
+	// interleave insertions, removals and lookups
+	int32_t seed = 42;
+	size_t rebuilds = 0;
+	for (size_t round = 0; round < 500; ++round)
+	{
+		elektraRand (&seed);
+		size_t i = (uint32_t) seed % n;
+		snprintf (name, sizeof (name), "/key%05zu", i);
+		if (round % 3 == 0)
+		{
+			keyDel (ksLookupByName (ks, name, KDB_O_POP | KDB_O_OPMPHM));
+		}
+		else
+		{
+			ksAppendKey (ks, keyNew (name, KEY_END));
+		}
+		if (!opmphmIsBuild (ks->opmphm)) ++rebuilds;
+
+		// every key must be found at its position, with the OPMPHM and the binary search
+		for (size_t j = 0; j < n; ++j)
+		{
+			snprintf (name, sizeof (name), "/key%05zu", j);
+			Key * expected = ksLookupByName (ks, name, KDB_O_BINSEARCH);
+			cursor_t cursor = ksGetCursor (ks);
+			Key * found = ksLookupByName (ks, name, KDB_O_OPMPHM);
+			succeed_if (found == expected, "OPMPHM with delta differs from binary search");
+			if (found) succeed_if (ksGetCursor (ks) == cursor, "wrong cursor");
+		}
+	}
+	succeed_if (rebuilds > 0 && rebuilds < 500 / 4, "delta should take several alterations");
+
+	// a copy takes the delta
+	KeySet * copy = ksDup (ks);
+	for (size_t j = 0; j < n; ++j)
+	{
+		snprintf (name, sizeof (name), "/key%05zu", j);
+		Key * expected = ksLookupByName (ks, name, KDB_O_BINSEARCH);
+		succeed_if (ksLookupByName (copy, name, KDB_O_OPMPHM) == expected, "OPMPHM of copy differs");
+	}
+
+	ksDel (copy);
+	ksDel (ks);
+}
+
+static const char * getName (void * data)
+{
+	return keyName ((Key *) data);
+}
+
+void test_ParallelBuild (void)
+{
+	const size_t n = 4 * OPMPHM_PARALLEL_MIN_N;
+	char name[30];
+
+	KeySet * ks = ksNew (n, KS_END);
+	for (size_t i = 0; i < n; ++i)
+	{
+		snprintf (name, sizeof (name), "/parallel/key%zu", i);
+		ksAppendKey (ks, keyNew (name, KEY_END));
+	}
+
+	// the graph must not depend on the number of threads
+	uint8_t r = opmphmOptR (n);
+	double c = opmphmMinC (r) + opmphmOptC (n);
+	Opmphm * opmphm[2] = { opmphmNew (), opmphmNew () };
+	exit_if_fail (opmphm[0] && opmphm[1], "opmphmNew");
+	for (size_t t = 0; t < 2; ++t)
+	{
+		OpmphmGraph * graph = opmphmGraphNew (opmphm[t], r, n, c);
+		exit_if_fail (graph, "opmphmGraphNew");
+		OpmphmInit init;
+		init.getName = getName;
+		init.data = (void **) ks->array;
+		init.initSeed = 47658589;
+		int ret;
+		size_t mappings = 0;
+		do
+		{
+			ret = opmphmMappingParallel (opmphm[t], graph, &init, n, t ? 4 : 1);
+		} while (ret && ++mappings < 10);
+		exit_if_fail (!ret, "opmphmMappingParallel");
+		succeed_if (!opmphmAssignment (opmphm[t], graph, n, 1), "opmphmAssignment");
+		opmphmGraphDel (graph);
+	}
+	succeed_if (opmphm[0]->size == opmphm[1]->size, "graphs differ in size");
+	succeed_if (!memcmp (opmphm[0]->graph, opmphm[1]->graph, opmphm[0]->size), "graphs differ");
+	opmphmDel (opmphm[0]);
+	opmphmDel (opmphm[1]);
+
+	// ksLookup
+	succeed_if (!ksLookupByName (ks, "/nothere", KDB_O_OPMPHM | KDB_O_OPMPHM_PARALLEL), "key found");
+	exit_if_fail (ks->opmphm, "build opmphm");
+	succeed_if (opmphmIsBuild (ks->opmphm), "build opmphm");
+	for (size_t i = 0; i < n; ++i)
+	{
+		succeed_if (ksLookup (ks, ks->array[i], KDB_O_OPMPHM) == ks->array[i], "key not found");
+	}
+
+	ksDel (ks);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("KS OPMPHM      TESTS\n");
@@ -358,6 +494,8 @@ int main (int argc, char ** argv)
 	test_keyNotFound ();
 	test_Copy ();
 	test_Invalidate ();
+	test_Delta ();
+	test_ParallelBuild ();
 
 	print_result ("test_ks_opmphm");
 
@@ -0,0 +1,98 @@
+/**
+ * @file
+ *
+ * @brief Tests for opening the plugins of backends lazily.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <../../src/libs/elektra/backend.c>
+#include <../../src/libs/elektra/mount.c>
+#include <../../src/libs/elektra/split.c>
+#include <../../src/libs/elektra/trie.c>
+#include <tests_internal.h>
+
+#define LAZY_MOUNTPOINT "user/tests/lazy"
+
+/**
+ * Mounts a backend below LAZY_MOUNTPOINT, whose plugin does not exist, without opening it.
+ */
+static Backend * lazyMount (KDB * handle)
+{
+	KeySet * config = ksNew (5, keyNew ("system/elektra/mountpoints/lazy", KEY_END),
+				 keyNew ("system/elektra/mountpoints/lazy/getplugins", KEY_END),
+				 keyNew ("system/elektra/mountpoints/lazy/getplugins/#1doesnotexist", KEY_END),
+				 keyNew ("system/elektra/mountpoints/lazy/mountpoint", KEY_VALUE, LAZY_MOUNTPOINT, KEY_END), KS_END);
+	Key * errorKey = keyNew ("", KEY_END);
+	Backend * backend = backendOpenLazy (config, errorKey);
+	exit_if_fail (backend, "could not create backend");
+	succeed_if (!keyGetMeta (errorKey, "warnings"), "warnings before the plugins were opened");
+	exit_if_fail (mountBackend (handle, backend, errorKey) == 1, "could not mount backend");
+	keyDel (errorKey);
+	return backend;
+}
+
+static int lazyGet (KDB * handle, const char * name, int warnings)
+{
+	KeySet * ks = ksNew (0, KS_END);
+	Key * parentKey = keyNew (name, KEY_END);
+	int ret = kdbGet (handle, ks, parentKey);
+	succeed_if (!keyGetMeta (parentKey, "warnings") == !warnings, warnings ? "no warning for missing plugin" : "unexpected warnings");
+	keyDel (parentKey);
+	ksDel (ks);
+	return ret;
+}
+
+static void test_lazyGet (void)
+{
+	printf ("Test opening the plugins with kdbGet\n");
+
+	Key * errorKey = keyNew ("", KEY_END);
+	KDB * handle = kdbOpen (errorKey);
+	exit_if_fail (handle, "could not open kdb");
+	keyDel (errorKey);
+
+	Backend * backend = lazyMount (handle);
+	lazyGet (handle, "user/tests/lazyother", 0);
+	succeed_if (backend->config != 0, "backend that was not read was opened");
+
+	// problems while opening the plugins are warnings of the first kdbGet
+	lazyGet (handle, LAZY_MOUNTPOINT, 1);
+	succeed_if (backend->config == 0, "backend was not opened");
+	succeed_if_same_string (keyString (backend->mountpoint), "missing");
+	lazyGet (handle, LAZY_MOUNTPOINT, 0);
+
+	kdbClose (handle, 0);
+}
+
+static void test_lazyModules (void)
+{
+	printf ("Test opening all plugins with kdbGet of system/elektra/modules\n");
+
+	Key * errorKey = keyNew ("", KEY_END);
+	KDB * handle = kdbOpen (errorKey);
+	exit_if_fail (handle, "could not open kdb");
+	keyDel (errorKey);
+
+	Backend * backend = lazyMount (handle);
+	lazyGet (handle, KDB_SYSTEM_ELEKTRA "/modules", 1);
+	succeed_if (backend->config == 0, "backend was not opened for system/elektra/modules");
+	succeed_if_same_string (keyString (backend->mountpoint), "missing");
+
+	kdbClose (handle, 0);
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("LAZY         TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_lazyGet ();
+	test_lazyModules ();
+
+	printf ("\ntest_lazy RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
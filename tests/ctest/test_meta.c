@@ -266,6 +266,123 @@ static void test_metaKeySet (void)
 	keyDel (key);
 }
 
+static void test_metaIntern (void)
+{
+	printf ("Test interned metadata\n");
+
+	ElektraMetaIntern * intern = elektraMetaInternNew ();
+	exit_if_fail (intern, "could not create intern table");
+
+	Key * heap = keyNew ("user/heap", KEY_META, "type", "long", KEY_END);
+
+	ElektraMetaIntern * previous = elektraMetaInternActivate (intern);
+	succeed_if (previous == 0, "there should be no intern table active before");
+
+	Key * a = keyNew ("user/a", KEY_META, "type", "long", KEY_META, "default", "5", KEY_END);
+	Key * b = keyNew ("user/b", KEY_META, "type", "long", KEY_META, "default", "6", KEY_END);
+	Key * c = keyNew ("user/c", KEY_END);
+	keySetMeta (c, "type", "long");
+	keySetMeta (c, "default", "6");
+
+	succeed_if (keyGetMeta (a, "type") == keyGetMeta (b, "type"), "equal metadata not shared");
+	succeed_if (keyGetMeta (a, "type") == keyGetMeta (c, "type"), "equal metadata not shared");
+	succeed_if (keyGetMeta (b, "default") == keyGetMeta (c, "default"), "equal metadata not shared");
+	succeed_if (keyGetMeta (a, "default") != keyGetMeta (b, "default"), "different metadata shared");
+	succeed_if (keyGetMeta (a, "type") != keyGetMeta (heap, "type"), "metadata from before activation shared");
+	succeed_if_same_string (keyString (keyGetMeta (b, "default")), "6");
+
+	// changing metadata of one key must not change the others
+	keySetMeta (c, "type", "string");
+	succeed_if_same_string (keyString (keyGetMeta (a, "type")), "long");
+	succeed_if_same_string (keyString (keyGetMeta (c, "type")), "string");
+
+	// setting the same value again keeps the shared meta key
+	keySetMeta (a, "type", "long");
+	succeed_if (keyGetMeta (a, "type") == keyGetMeta (b, "type"), "equal metadata not shared after setting again");
+	succeed_if_same_string (keyString (keyGetMeta (a, "type")), "long");
+
+	keySetMeta (b, "default", 0);
+	succeed_if (keyGetMeta (b, "default") == 0, "metadata not removed");
+	succeed_if_same_string (keyString (keyGetMeta (c, "default")), "6");
+
+	succeed_if (elektraMetaInternActivate (previous) == intern, "wrong active intern table");
+
+	Key * d = keyNew ("user/d", KEY_META, "type", "long", KEY_END);
+	succeed_if (keyGetMeta (a, "type") != keyGetMeta (d, "type"), "metadata shared with inactive intern table");
+
+	// the table keeps metadata of deleted keys
+	keyDel (a);
+	keyDel (c);
+	succeed_if_same_string (keyString (keyGetMeta (b, "type")), "long");
+
+	elektraMetaInternActivate (intern);
+	Key * e = keyNew ("user/e", KEY_META, "type", "long", KEY_META, "default", "5", KEY_END);
+	elektraMetaInternActivate (previous);
+	succeed_if (keyGetMeta (b, "type") == keyGetMeta (e, "type"), "metadata not shared after deleting keys");
+	succeed_if_same_string (keyString (keyGetMeta (e, "default")), "5");
+
+	// metadata outlives the table
+	elektraMetaInternDel (intern);
+	succeed_if_same_string (keyString (keyGetMeta (b, "type")), "long");
+	succeed_if_same_string (keyString (keyGetMeta (e, "default")), "5");
+
+	keyDel (b);
+	keyDel (d);
+	keyDel (e);
+	keyDel (heap);
+}
+
+static void test_metaInternMany (void)
+{
+	printf ("Test interned metadata with many values\n");
+
+	const int count = 20 * ELEKTRA_META_INTERN_MIN;
+	ElektraMetaIntern * intern = elektraMetaInternNew ();
+	ElektraMetaIntern * previous = elektraMetaInternActivate (intern);
+
+	KeySet * ks = ksNew (0, KS_END);
+	char name[32];
+	char value[32];
+	for (int i = 0; i < 2 * count; ++i)
+	{
+		snprintf (name, sizeof (name), "user/key/%d", i);
+		snprintf (value, sizeof (value), "%d", i % count);
+		ksAppendKey (ks, keyNew (name, KEY_META, "default", value, KEY_META, "type", "long", KEY_END));
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		snprintf (name, sizeof (name), "user/key/%d", i);
+		Key * first = ksLookupByName (ks, name, 0);
+		snprintf (name, sizeof (name), "user/key/%d", i + count);
+		Key * second = ksLookupByName (ks, name, 0);
+		succeed_if (keyGetMeta (first, "default") == keyGetMeta (second, "default"), "equal metadata not shared");
+	}
+
+	// drop every second key, the metadata of the others must stay shared
+	for (int i = 0; i < 2 * count; i += 2)
+	{
+		snprintf (name, sizeof (name), "user/key/%d", i);
+		keyDel (ksLookupByName (ks, name, KDB_O_POP));
+	}
+
+	for (int i = 1; i < 2 * count; i += 2)
+	{
+		snprintf (name, sizeof (name), "user/key/%d", i);
+		snprintf (value, sizeof (value), "%d", i % count);
+		Key * key = ksLookupByName (ks, name, 0);
+		succeed_if_same_string (keyString (keyGetMeta (key, "default")), value);
+
+		Key * check = keyNew ("user/check", KEY_META, "default", value, KEY_END);
+		succeed_if (keyGetMeta (check, "default") == keyGetMeta (key, "default"), "metadata not shared");
+		keyDel (check);
+	}
+
+	elektraMetaInternActivate (previous);
+	elektraMetaInternDel (intern);
+	ksDel (ks);
+}
+
 static void test_metaArrayToKS (void)
 {
 	Key * test = keyNew ("/a", KEY_META, "dep", "#1", KEY_META, "dep/#0", "/b", KEY_META, "dep/#1", "/c", KEY_END);
@@ -521,6 +638,8 @@ int main (int argc, char ** argv)
 	test_owner ();
 	test_mode ();
 	test_metaKeySet ();
+	test_metaIntern ();
+	test_metaInternMany ();
 
 	test_metaArrayToKS ();
 	test_top ();
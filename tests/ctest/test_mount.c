@@ -222,6 +222,8 @@ static void test_simpletrie (void)
 	Backend * backend2 = trieLookup (kdb->trie, key);
 	succeed_if (backend == backend2, "should be same backend");
 
+	succeed_if (backend->config == 0, "plugins should be opened by mountOpen");
+
 	succeed_if (backend->getplugins[0] == 0, "there should be no plugin");
 	exit_if_fail (backend->getplugins[1] != 0, "there should be a plugin");
 	succeed_if (backend->getplugins[2] == 0, "there should be no plugin");
@@ -329,6 +331,8 @@ static void test_two (void)
 	Backend * backend2 = trieLookup (kdb->trie, key);
 	succeed_if (backend == backend2, "should be same backend");
 
+	succeed_if (backend->config == 0, "plugins should be opened by mountOpen");
+
 	succeed_if (backend->getplugins[0] == 0, "there should be no plugin");
 	exit_if_fail (backend->getplugins[1] != 0, "there should be a plugin");
 	succeed_if (backend->getplugins[2] == 0, "there should be no plugin");
@@ -427,6 +431,77 @@ static void test_us (void)
 	kdb_del (kdb);
 }
 
+static KeySet * missingplugin_config (void)
+{
+	return ksNew (5, keyNew ("system/elektra/mountpoints", KEY_END), keyNew ("system/elektra/mountpoints/broken", KEY_END),
+		      keyNew ("system/elektra/mountpoints/broken/getplugins", KEY_END),
+		      keyNew ("system/elektra/mountpoints/broken/getplugins/#1doesnotexist", KEY_END),
+		      keyNew ("system/elektra/mountpoints/broken/mountpoint", KEY_VALUE, "user/tests/backend/broken", KEY_END), KS_END);
+}
+
+static void test_missingplugin (void)
+{
+	printf ("Test mount with missing plugin\n");
+
+	KDB * kdb = kdb_new ();
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	// the problem is reported by mountOpen, i.e. by kdbOpen and not by the first kdbGet
+	Key * errorKey = keyNew ("", KEY_END);
+	succeed_if (mountOpen (kdb, missingplugin_config (), modules, errorKey) == 0, "missing plugin should not fail mountOpen");
+	succeed_if (keyGetMeta (errorKey, "warnings"), "no warning for missing plugin");
+
+	Key * key = keyNew ("user/tests/backend/broken", KEY_END);
+	Backend * backend = trieLookup (kdb->trie, key);
+	exit_if_fail (backend, "backend should be mounted");
+	succeed_if (backend->config == 0, "plugins should be opened by mountOpen");
+	succeed_if_same_string (keyString (backend->mountpoint), "missing");
+	exit_if_fail (backend->getplugins[0] != 0, "there should be the missing plugin");
+	succeed_if_same_string (backend->getplugins[0]->name, "missing");
+	succeed_if (backend->getplugins[1] == 0, "there should be no plugin");
+
+	keyDel (errorKey);
+	keyDel (key);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+	kdb_del (kdb);
+}
+
+static void test_lazymissingplugin (void)
+{
+	printf ("Test lazy mount with missing plugin\n");
+
+	KDB * kdb = kdb_new ();
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	KeySet * config = missingplugin_config ();
+	ksAppendKey (config, keyNew ("system/elektra/lazy", KEY_END));
+	succeed_if (mountOpen (kdb, config, modules, 0) == 0, "missing plugin should not fail mountOpen");
+
+	Key * key = keyNew ("user/tests/backend/broken", KEY_END);
+	Backend * backend = trieLookup (kdb->trie, key);
+	exit_if_fail (backend, "backend should be mounted");
+	succeed_if (backend->config != 0, "configuration of plugins should be kept");
+	succeed_if_same_string (keyString (backend->mountpoint), "broken");
+
+	Key * errorKey = keyNew ("", KEY_END);
+	succeed_if (backendOpenPlugins (backend, modules, 0, errorKey) == -1, "plugin should be missing");
+	succeed_if (keyGetMeta (errorKey, "warnings"), "no warning for missing plugin");
+	succeed_if_same_string (keyString (backend->mountpoint), "missing");
+	exit_if_fail (backend->getplugins[0] != 0, "there should be the missing plugin");
+	succeed_if_same_string (backend->getplugins[0]->name, "missing");
+	succeed_if (backend->getplugins[1] == 0, "there should be no plugin");
+	succeed_if (backendOpenPlugins (backend, modules, 0, errorKey) == 0, "plugins should be opened only once");
+
+	keyDel (errorKey);
+	keyDel (key);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+	kdb_del (kdb);
+}
+
 KeySet * endings_config (void)
 {
 	return ksNew (5, keyNew ("system/elektra/mountpoints", KEY_END), keyNew ("system/elektra/mountpoints/slash", KEY_END),
@@ -1055,6 +1130,8 @@ int main (int argc, char ** argv)
 	test_simpletrie ();
 	test_two ();
 	test_us ();
+	test_missingplugin ();
+	test_lazymissingplugin ();
 	test_endings ();
 	test_oldroot ();
 	test_cascading ();
@@ -0,0 +1,507 @@
+/**
+ * @file
+ *
+ * @brief Tests for reading and writing backends in parallel.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <../../src/libs/elektra/backend.c>
+#include <../../src/libs/elektra/mount.c>
+#include <../../src/libs/elektra/split.c>
+#include <../../src/libs/elektra/trie.c>
+#include <kdberrors.h>
+#include <tests_internal.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+static pthread_t mainThread;
+#endif
+
+#define PARALLEL_PARENT "user/tests/parallel"
+#define PARALLEL_GLOBAL "system/elektra/tests/parallel/"
+#define PARALLEL_NODIR "/nonexistent/elektra/test_parallel"
+
+// what the set plugins did, indexed by the first letter of the backend name
+static char written[26];
+static char writtenByMain[26];
+static char committed[26];
+static char unlocked[26];
+static char unlockedAfterSync[26];
+static char rolledBack[26];
+// the global key PARALLEL_GLOBAL "shared" and its metakey as seen by the get plugins
+static const Key * sharedSeen[26];
+static const Key * sharedMetaSeen[26];
+
+static const char * parallelConfig (Plugin * handle, const char * name)
+{
+	Key * key = ksLookupByName (elektraPluginGetConfig (handle), name, 0);
+	return key ? keyString (key) : 0;
+}
+
+static int parallelResolverGet (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey)
+{
+	// no file is read, every get needs an update
+	keySetString (parentKey, parallelConfig (handle, "/file"));
+	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+}
+
+static int parallelResolverSet (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey)
+{
+	keySetString (parentKey, parallelConfig (handle, "/file"));
+	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+}
+
+/**
+ * Commits nothing, but leaves syncing its directory to kdbSet() like the resolver
+ * and keeps its locks until it is committed a second time.
+ */
+static int parallelResolverCommit (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+{
+	const char name = parallelConfig (handle, "/name")[0];
+	KeySet * global = elektraPluginGetGlobalKeySet (handle);
+	if (committed[name - 'a'])
+	{
+		unlocked[name - 'a'] = 1;
+		unlockedAfterSync[name - 'a'] = !ksLookupByName (global, KDB_SYNC_PREFIX, 0);
+		return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+	}
+	committed[name - 'a'] = 1;
+
+	const char * dir = parallelConfig (handle, "/dir");
+	Key * syncKey = ksLookupByName (global, KDB_SYNC_PREFIX, 0);
+	if (dir && syncKey)
+	{
+		Key * dirKey = keyNew (KDB_SYNC_PREFIX, KEY_VALUE, dir, KEY_END);
+		keyAddName (dirKey, dir);
+		ksAppendKey (global, dirKey);
+		keySetString (syncKey, "locked");
+	}
+	else
+	{
+		unlocked[name - 'a'] = 1;
+	}
+	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+}
+
+static int parallelResolverError (Plugin * handle, KeySet * returned ELEKTRA_UNUSED, Key * parentKey ELEKTRA_UNUSED)
+{
+	rolledBack[parallelConfig (handle, "/name")[0] - 'a'] = 1;
+	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+}
+
+/**
+ * A storage plugin that adds a key below its parent, optionally adds a warning or fails,
+ * and adds a key to the global keyset. It is threadsafe if configured in /threadsafe.
+ */
+static int parallelStorageGet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	const char * name = parallelConfig (handle, "/name");
+	if (!strcmp (keyName (parentKey), "system/elektra/modules/parallel"))
+	{
+		ksAppendKey (returned, keyNew ("system/elektra/modules/parallel/infos/status", KEY_VALUE,
+					       parallelConfig (handle, "/threadsafe") ? "maintained threadsafe" : "maintained", KEY_END));
+		return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+	}
+
+	Key * shared = ksLookupByName (elektraPluginGetGlobalKeySet (handle), PARALLEL_GLOBAL "shared", 0);
+	sharedSeen[name[0] - 'a'] = shared;
+	sharedMetaSeen[name[0] - 'a'] = shared ? keyGetMeta (shared, "meta") : 0;
+
+	Key * key = keyNew (keyName (parentKey), KEY_VALUE, name, KEY_END);
+	keyAddBaseName (key, "key");
+	ksAppendKey (returned, key);
+
+	Key * global = keyNew (PARALLEL_GLOBAL, KEY_VALUE, keyName (parentKey), KEY_END);
+	keyAddBaseName (global, name);
+#ifdef HAVE_PTHREAD
+	if (pthread_equal (pthread_self (), mainThread)) keySetMeta (global, "main", "1");
+#endif
+	ksAppendKey (elektraPluginGetGlobalKeySet (handle), global);
+
+	if (parallelConfig (handle, "/warning"))
+	{
+		ELEKTRA_ADD_RESOURCE_WARNINGF (parentKey, "Warning of %s", name);
+	}
+	if (parallelConfig (handle, "/error"))
+	{
+		ELEKTRA_SET_RESOURCE_ERRORF (parentKey, "Error of %s", name);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+}
+
+/**
+ * A storage plugin that records that it wrote and adds a key to the global keyset,
+ * or fails if configured in /seterror.
+ *
+ * A failing storage plugin appends a key to the keyset and leaves the cursor on it,
+ * so that kdbSet() warns about this error key, which is not in the keyset of the user.
+ */
+static int parallelStorageSet (Plugin * handle, KeySet * returned, Key * parentKey)
+{
+	const char * name = parallelConfig (handle, "/name");
+	written[name[0] - 'a'] = 1;
+#ifdef HAVE_PTHREAD
+	if (pthread_equal (pthread_self (), mainThread)) writtenByMain[name[0] - 'a'] = 1;
+#endif
+
+	Key * global = keyNew (PARALLEL_GLOBAL "set", KEY_VALUE, keyName (parentKey), KEY_END);
+	keyAddBaseName (global, name);
+	ksAppendKey (elektraPluginGetGlobalKeySet (handle), global);
+
+	if (parallelConfig (handle, "/seterror"))
+	{
+		Key * key = keyNew (keyName (parentKey), KEY_END);
+		keyAddBaseName (key, "error");
+		ksAppendKey (returned, key);
+		ksLookup (returned, key, 0);
+		ELEKTRA_SET_RESOURCE_ERRORF (parentKey, "Error of %s", name);
+		return ELEKTRA_PLUGIN_STATUS_ERROR;
+	}
+	return ELEKTRA_PLUGIN_STATUS_SUCCESS;
+}
+
+/**
+ * Mounts a backend named @p name below PARALLEL_PARENT.
+ *
+ * @param flags the configuration of the plugins, e.g. /threadsafe or /dir
+ */
+static void parallelMount (KDB * handle, const char * name, KeySet * flags)
+{
+	Backend * backend = elektraCalloc (sizeof (Backend));
+	backend->specsize = -1;
+	backend->dirsize = -1;
+	backend->usersize = -1;
+	backend->systemsize = -1;
+
+	Key * mountpoint = keyNew (PARALLEL_PARENT, KEY_VALUE, name, KEY_END);
+	keyAddBaseName (mountpoint, name);
+	backend->mountpoint = mountpoint;
+	keyIncRef (backend->mountpoint);
+
+	KeySet * config = ksNew (2, keyNew ("user/name", KEY_VALUE, name, KEY_END),
+				 keyNew ("user/file", KEY_VALUE, PARALLEL_NODIR "/file", KEY_END), KS_END);
+	ksAppend (config, flags);
+	ksDel (flags);
+
+	Plugin * resolver = elektraPluginExport ("resolver", ELEKTRA_PLUGIN_GET, &parallelResolverGet, ELEKTRA_PLUGIN_SET,
+						 &parallelResolverSet, ELEKTRA_PLUGIN_COMMIT, &parallelResolverCommit, ELEKTRA_PLUGIN_ERROR,
+						 &parallelResolverError, ELEKTRA_PLUGIN_END);
+	resolver->config = ksDup (config);
+	resolver->global = handle->global;
+	resolver->refcounter = 4;
+	backend->getplugins[RESOLVER_PLUGIN] = resolver;
+	backend->setplugins[RESOLVER_PLUGIN] = resolver;
+	backend->setplugins[COMMIT_PLUGIN] = resolver;
+	backend->errorplugins[STORAGE_PLUGIN] = resolver;
+
+	Plugin * storage = elektraPluginExport ("parallel", ELEKTRA_PLUGIN_GET, &parallelStorageGet, ELEKTRA_PLUGIN_SET,
+						&parallelStorageSet, ELEKTRA_PLUGIN_END);
+	storage->config = config;
+	storage->global = handle->global;
+	storage->refcounter = 2;
+	backend->getplugins[STORAGE_PLUGIN] = storage;
+	backend->setplugins[STORAGE_PLUGIN] = storage;
+
+	Key * errorKey = keyNew ("", KEY_END);
+	succeed_if (mountBackend (handle, backend, errorKey) == 1, "could not mount backend");
+	keyDel (errorKey);
+}
+
+static KDB * parallelOpen (void)
+{
+	Key * errorKey = keyNew ("", KEY_END);
+	KDB * handle = kdbOpen (errorKey);
+	exit_if_fail (handle, "could not open kdb");
+	keyDel (errorKey);
+
+	if (!handle->threadPool) handle->threadPool = elektraThreadPoolNew (4);
+	exit_if_fail (handle->threadPool, "could not create thread pool");
+
+	parallelMount (handle, "a", ksNew (1, keyNew ("user/threadsafe", KEY_END), KS_END));
+	parallelMount (handle, "b", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/warning", KEY_END), KS_END));
+	parallelMount (handle, "c", ksNew (1, keyNew ("user/warning", KEY_END), KS_END));
+	parallelMount (handle, "d", ksNew (1, keyNew ("user/threadsafe", KEY_END), KS_END));
+	parallelMount (handle, "e", ksNew (0, KS_END));
+	return handle;
+}
+
+static void test_parallelGet (void)
+{
+	printf ("Test parallel kdbGet\n");
+
+	KDB * handle = parallelOpen ();
+	KeySet * ks = ksNew (0, KS_END);
+	Key * parentKey = keyNew (PARALLEL_PARENT, KEY_END);
+	Key * shared = keyNew (PARALLEL_GLOBAL "shared", KEY_META, "meta", "1", KEY_END);
+	const Key * sharedMeta = keyGetMeta (shared, "meta");
+	ksAppendKey (handle->global, shared);
+	memset (sharedSeen, 0, sizeof (sharedSeen));
+
+	succeed_if (kdbGet (handle, ks, parentKey) == 1, "kdbGet failed");
+	succeed_if (!keyGetMeta (parentKey, "error"), "kdbGet set an error");
+	succeed_if_same_string (keyName (parentKey), PARALLEL_PARENT);
+
+	const char * names[] = { "a", "b", "c", "d", "e" };
+	char name[64];
+	for (size_t i = 0; i < 5; ++i)
+	{
+		// every backend gets its own keys and metakeys in its copy of the global keyset
+		succeed_if (sharedSeen[i] && sharedSeen[i] != shared, "global key shared with the backend");
+		succeed_if (sharedMetaSeen[i] && sharedMetaSeen[i] != sharedMeta, "global metakey shared with the backend");
+
+		snprintf (name, sizeof (name), PARALLEL_PARENT "/%s/key", names[i]);
+		Key * key = ksLookupByName (ks, name, 0);
+		succeed_if (key, "key of backend missing");
+		if (key) succeed_if_same_string (keyString (key), names[i]);
+
+		snprintf (name, sizeof (name), PARALLEL_GLOBAL "%s", names[i]);
+		Key * global = ksLookupByName (handle->global, name, 0);
+		succeed_if (global, "global key of backend missing");
+#ifdef HAVE_PTHREAD
+		// backends with plugins that are not threadsafe are read by the calling thread
+		if (global && (i == 2 || i == 4)) succeed_if (keyGetMeta (global, "main"), "backend not read by the calling thread");
+#endif
+	}
+
+	// warnings of all backends are merged in the order of the split
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "Warning of b");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/reason")), "Warning of c");
+	succeed_if (!keyGetMeta (parentKey, "warnings/#02"), "too many warnings");
+
+	keyDel (parentKey);
+	ksDel (ks);
+	kdbClose (handle, 0);
+}
+
+static void test_parallelGetError (void)
+{
+	printf ("Test parallel kdbGet with failing backends\n");
+
+	KDB * handle = parallelOpen ();
+	parallelMount (handle, "f", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/error", KEY_END), KS_END));
+	parallelMount (handle, "g", ksNew (1, keyNew ("user/error", KEY_END), KS_END));
+	parallelMount (handle, "h", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/error", KEY_END), KS_END));
+
+	KeySet * ks = ksNew (1, keyNew (PARALLEL_PARENT "/a/key", KEY_VALUE, "old", KEY_END), KS_END);
+	Key * parentKey = keyNew (PARALLEL_PARENT, KEY_END);
+
+	succeed_if (kdbGet (handle, ks, parentKey) == -1, "kdbGet did not fail");
+	succeed_if_same_string (keyName (parentKey), PARALLEL_PARENT);
+
+	// the first failing backend in the order of the split wins, as if they were read one after another
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/reason")), "Error of f");
+	succeed_if (keyGetMeta (parentKey, "error/number"), "error without number");
+
+	// unlike the sequential read, the backends after the failing one were read too
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#00/reason")), "Warning of b");
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "warnings/#01/reason")), "Warning of c");
+	succeed_if (ksLookupByName (handle->global, PARALLEL_GLOBAL "h", 0), "global key of backend after failure missing");
+
+	// the keyset is not changed on errors
+	succeed_if (ksGetSize (ks) == 1, "keyset changed by failing kdbGet");
+	succeed_if_same_string (keyString (ksLookupByName (ks, PARALLEL_PARENT "/a/key", 0)), "old");
+
+	keyDel (parentKey);
+	ksDel (ks);
+	kdbClose (handle, 0);
+}
+
+static int hasWarning (Key * parentKey, const char * reason)
+{
+	int count = 0;
+	char name[sizeof ("warnings/#00/reason")];
+	for (int i = 0; i < 100; ++i)
+	{
+		snprintf (name, sizeof (name), "warnings/#%02d/reason", i);
+		const Key * warning = keyGetMeta (parentKey, name);
+		if (warning && !strcmp (keyString (warning), reason)) ++count;
+	}
+	return count;
+}
+
+/**
+ * Does kdbGet() on all backends, adds a key to each of them and calls kdbSet().
+ *
+ * @param threads 0 to write the backends one after another
+ */
+static int parallelSet (KDB * handle, Key * parentKey, int threads)
+{
+	memset (written, 0, sizeof (written));
+	memset (writtenByMain, 0, sizeof (writtenByMain));
+	memset (committed, 0, sizeof (committed));
+	memset (unlocked, 0, sizeof (unlocked));
+	memset (unlockedAfterSync, 0, sizeof (unlockedAfterSync));
+	memset (rolledBack, 0, sizeof (rolledBack));
+
+	// the warnings of kdbGet() are not of interest
+	KeySet * ks = ksNew (0, KS_END);
+	Key * getKey = keyNew (PARALLEL_PARENT, KEY_END);
+	succeed_if (kdbGet (handle, ks, getKey) == 1, "kdbGet failed");
+	keyDel (getKey);
+
+	KeySet * added = ksNew (0, KS_END);
+	for (ssize_t i = 0; i < ksGetSize (ks); ++i)
+	{
+		Key * key = ksAtCursor (ks, i);
+		if (strcmp (keyBaseName (key), "key")) continue;
+		Key * newKey = keyNew (keyName (key), KEY_VALUE, "new", KEY_END);
+		keySetBaseName (newKey, "new");
+		ksAppendKey (added, newKey);
+	}
+	ksAppend (ks, added);
+	ksDel (added);
+
+	ElektraThreadPool * pool = handle->threadPool;
+	if (!threads) handle->threadPool = 0;
+	int ret = kdbSet (handle, ks, parentKey);
+	handle->threadPool = pool;
+
+	ksDel (ks);
+	return ret;
+}
+
+static void test_parallelSet (int threads)
+{
+	printf ("Test %s kdbSet\n", threads ? "parallel" : "sequential");
+
+	char dir1[] = "/tmp/elektra-test_parallel-XXXXXX";
+	char dir2[] = "/tmp/elektra-test_parallel-XXXXXX";
+	exit_if_fail (mkdtemp (dir1) && mkdtemp (dir2), "could not create directories");
+
+	KDB * handle = parallelOpen ();
+	parallelMount (handle, "f", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/dir", KEY_VALUE, dir1, KEY_END), KS_END));
+	parallelMount (handle, "g", ksNew (1, keyNew ("user/dir", KEY_VALUE, dir1, KEY_END), KS_END));
+	parallelMount (handle, "h", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/dir", KEY_VALUE, dir2, KEY_END), KS_END));
+	Key * parentKey = keyNew (PARALLEL_PARENT, KEY_END);
+
+	succeed_if (parallelSet (handle, parentKey, threads) == 1, "kdbSet failed");
+	succeed_if (!keyGetMeta (parentKey, "error"), "kdbSet set an error");
+	succeed_if (!keyGetMeta (parentKey, "warnings"), "kdbSet added warnings");
+	succeed_if_same_string (keyName (parentKey), PARALLEL_PARENT);
+
+	char name[64];
+	for (int i = 0; i < 8; ++i)
+	{
+		succeed_if (written[i], "backend not written");
+		succeed_if (committed[i], "backend not committed");
+		succeed_if (unlocked[i], "backend not unlocked");
+		succeed_if (!rolledBack[i], "backend rolled back");
+
+		// the global keys of all backends are merged back
+		snprintf (name, sizeof (name), PARALLEL_GLOBAL "set/%c", 'a' + i);
+		succeed_if (ksLookupByName (handle->global, name, 0), "global key of backend missing");
+	}
+#ifdef HAVE_PTHREAD
+	// backends with plugins that are not threadsafe are written by the calling thread
+	succeed_if (writtenByMain['c' - 'a'] && writtenByMain['e' - 'a'] && writtenByMain['g' - 'a'],
+		    "backend not written by the calling thread");
+#endif
+
+	// the directories of the backends are synced once after all commits, before the locks are released
+	succeed_if (!ksLookupByName (handle->global, KDB_SYNC_PREFIX, 0), "directories to sync left in global keyset");
+	for (int i = 'f' - 'a'; i <= 'h' - 'a'; ++i)
+	{
+		succeed_if (unlockedAfterSync[i] == threads, "backend not unlocked after its directory was synced");
+	}
+
+	keyDel (parentKey);
+	kdbClose (handle, 0);
+	rmdir (dir1);
+	rmdir (dir2);
+}
+
+static void test_parallelSetSyncError (void)
+{
+	printf ("Test parallel kdbSet with directories that cannot be synced\n");
+
+	char dir[] = "/tmp/elektra-test_parallel-XXXXXX";
+	exit_if_fail (mkdtemp (dir), "could not create directory");
+
+	KDB * handle = parallelOpen ();
+	parallelMount (handle, "f", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/dir", KEY_VALUE, dir, KEY_END), KS_END));
+	parallelMount (handle, "g", ksNew (1, keyNew ("user/dir", KEY_VALUE, PARALLEL_NODIR, KEY_END), KS_END));
+	parallelMount (handle, "h", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/dir", KEY_VALUE, PARALLEL_NODIR, KEY_END),
+					   KS_END));
+	Key * parentKey = keyNew (PARALLEL_PARENT, KEY_END);
+
+	succeed_if (parallelSet (handle, parentKey, 1) == -1, "kdbSet did not fail");
+	succeed_if_same_string (keyName (parentKey), PARALLEL_PARENT);
+
+	// the missing directory is synced once and fails kdbSet, but the commits cannot be rolled back
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/reason")),
+				"Could not sync directory '" PARALLEL_NODIR "'. Reason: No such file or directory");
+	succeed_if (!keyGetMeta (parentKey, "warnings"), "kdbSet added warnings");
+	for (int i = 0; i < 8; ++i)
+	{
+		succeed_if (committed[i], "backend not committed");
+		succeed_if (unlocked[i], "backend not unlocked");
+		succeed_if (!rolledBack[i], "backend rolled back");
+	}
+
+	keyDel (parentKey);
+	kdbClose (handle, 0);
+	rmdir (dir);
+}
+
+static void test_parallelSetError (int threads)
+{
+	printf ("Test %s kdbSet with failing backends\n", threads ? "parallel" : "sequential");
+
+	KDB * handle = parallelOpen ();
+	parallelMount (handle, "f", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/seterror", KEY_END), KS_END));
+	parallelMount (handle, "g", ksNew (1, keyNew ("user/seterror", KEY_END), KS_END));
+	parallelMount (handle, "h", ksNew (2, keyNew ("user/threadsafe", KEY_END), keyNew ("user/seterror", KEY_END), KS_END));
+	Key * parentKey = keyNew (PARALLEL_PARENT, KEY_END);
+
+	succeed_if (parallelSet (handle, parentKey, threads) == -1, "kdbSet did not fail");
+	succeed_if_same_string (keyName (parentKey), PARALLEL_PARENT);
+
+	// the first failing backend in the order of the split sets the error, the others add warnings
+	succeed_if_same_string (keyString (keyGetMeta (parentKey, "error/reason")), "Error of f");
+	succeed_if (hasWarning (parentKey, "Error of g") == 1, "error of second failing backend not added as warning");
+	succeed_if (hasWarning (parentKey, "Error of h") == 1, "error of third failing backend not added as warning");
+
+	// the error key is the key of the last failing backend
+#define PARALLEL_ERROR_KEY(name) "Error key " PARALLEL_PARENT "/" name "/error not found in keyset even though it was found before"
+	succeed_if (hasWarning (parentKey, PARALLEL_ERROR_KEY ("h")) == 1, "error key is not the one of the last failing backend");
+	succeed_if (!hasWarning (parentKey, PARALLEL_ERROR_KEY ("f")), "error key is the one of the first failing backend");
+#undef PARALLEL_ERROR_KEY
+
+	// all backends are written, none is committed and all are rolled back
+	for (int i = 0; i < 8; ++i)
+	{
+		succeed_if (written[i], "backend not written");
+		succeed_if (!committed[i], "backend committed");
+		succeed_if (rolledBack[i], "backend not rolled back");
+	}
+
+	keyDel (parentKey);
+	kdbClose (handle, 0);
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("PARALLEL     TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+#ifdef HAVE_PTHREAD
+	mainThread = pthread_self ();
+#endif
+
+	test_parallelGet ();
+	test_parallelGetError ();
+	test_parallelSet (0);
+	test_parallelSet (1);
+	test_parallelSetSyncError ();
+	test_parallelSetError (0);
+	test_parallelSetError (1);
+
+	printf ("\ntest_parallel RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
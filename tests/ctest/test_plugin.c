@@ -164,6 +164,29 @@ static void test_name (void)
 	ksDel (modules);
 }
 
+static void test_threadSafe (void)
+{
+	printf ("Test thread safety of plugins\n");
+
+	Plugin * missing = elektraPluginMissing ();
+	succeed_if (elektraPluginIsThreadSafe (missing) == 0, "missing plugin must not be threadsafe");
+	missing->kdbGet = 0;
+	succeed_if (elektraPluginIsThreadSafe (missing) == 1, "plugin without get must be threadsafe");
+	elektraPluginClose (missing, 0);
+
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+	Plugin * dump = elektraPluginOpen ("dump", modules, ksNew (0, KS_END), 0);
+	if (dump)
+	{
+		// see infos/status in README.md of dump
+		succeed_if (elektraPluginIsThreadSafe (dump) == 1, "dump must be threadsafe");
+		elektraPluginClose (dump, 0);
+	}
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+}
+
 int main (int argc, char ** argv)
 {
 	printf (" PLUGINS  TESTS\n");
@@ -174,6 +197,7 @@ int main (int argc, char ** argv)
 	test_process ();
 	test_simple ();
 	test_name ();
+	test_threadSafe ();
 
 	printf ("\ntest_plugin RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
@@ -0,0 +1,224 @@
+/**
+ * @file
+ *
+ * @brief Tests for the snapshot of the bootstrap configuration.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <../../src/libs/elektra/snapshot.c>
+#include <tests_internal.h>
+
+static char * snapshotFile;
+
+static KeySet * createBootstrap (void)
+{
+	return ksNew (10, keyNew ("system/elektra/mountpoints", KEY_END),
+		      keyNew ("system/elektra/mountpoints/user\\/tests\\/snapshot", KEY_VALUE, "a backend", KEY_META, "comment/#0",
+			      "first comment", KEY_META, "order", "1", KEY_END),
+		      keyNew ("system/elektra/mountpoints/user\\/tests\\/snapshot/config/path", KEY_VALUE, "snapshot.ecf", KEY_END),
+		      keyNew ("system/elektra/mountpoints/user\\/tests\\/snapshot/getplugins/#0resolver", KEY_VALUE, "resolver", KEY_END),
+		      keyNew ("system/elektra/mountpoints/user\\/tests\\/snapshot/mountpoint", KEY_VALUE, "user/tests/snapshot", KEY_END),
+		      keyNew ("system/elektra/binary", KEY_BINARY, KEY_SIZE, 4, KEY_VALUE, "\0\1\2\3", KEY_END),
+		      keyNew ("system/elektra/empty", KEY_BINARY, KEY_END), keyNew ("system/elektra/snapshot", KEY_VALUE, "1", KEY_END),
+		      KS_END);
+}
+
+static void touchBootstrap (const char * content)
+{
+	FILE * file = fopen (elektraFilename (), "w");
+	exit_if_fail (file, "could not write bootstrap file");
+	fputs (content, file);
+	fclose (file);
+}
+
+static void test_roundtrip (void)
+{
+	printf ("Test snapshot roundtrip\n");
+
+	touchBootstrap ("bootstrap");
+	KeySet * bootstrap = createBootstrap ();
+	succeed_if (elektraSnapshotWrite (snapshotFile, elektraFilename (), bootstrap) == 0, "could not write snapshot");
+
+	KeySet * keys = ksNew (0, KS_END);
+	succeed_if (elektraSnapshotRead (snapshotFile, elektraFilename (), keys) == 1, "could not read snapshot");
+	compare_keyset (keys, bootstrap);
+
+	Key * key = ksLookupByName (keys, "system/elektra/mountpoints/user\\/tests\\/snapshot", 0);
+	succeed_if (key && !strcmp (keyString (keyGetMeta (key, "comment/#0")), "first comment"), "metadata not restored");
+	succeed_if (key && !strcmp (keyString (keyGetMeta (key, "order")), "1"), "metadata not restored");
+	succeed_if (key && !strcmp (keyUnescapedName (key), "system\0elektra\0mountpoints\0user/tests/snapshot"),
+		    "unescaped name not restored");
+
+	key = ksLookupByName (keys, "system/elektra/binary", 0);
+	succeed_if (key && keyIsBinary (key) && keyGetValueSize (key) == 4 && !memcmp (keyValue (key), "\0\1\2\3", 4),
+		    "binary value not restored");
+	key = ksLookupByName (keys, "system/elektra/empty", 0);
+	succeed_if (key && keyIsBinary (key) && keyGetValueSize (key) == 0, "empty binary value not restored");
+
+	ksDel (keys);
+	ksDel (bootstrap);
+}
+
+static void test_outdated (void)
+{
+	printf ("Test outdated snapshot\n");
+
+	touchBootstrap ("bootstrap");
+	KeySet * bootstrap = createBootstrap ();
+	succeed_if (elektraSnapshotWrite (snapshotFile, elektraFilename (), bootstrap) == 0, "could not write snapshot");
+
+	// the size of the bootstrap file changes
+	touchBootstrap ("modified bootstrap");
+	KeySet * keys = ksNew (1, keyNew ("user/unchanged", KEY_END), KS_END);
+	succeed_if (elektraSnapshotRead (snapshotFile, elektraFilename (), keys) == -1, "outdated snapshot was read");
+	succeed_if (ksGetSize (keys) == 1, "keys changed by outdated snapshot");
+
+	elektraSnapshotRemove (snapshotFile);
+	succeed_if (elektraSnapshotRead (snapshotFile, elektraFilename (), keys) == 0, "removed snapshot was read");
+	succeed_if (ksGetSize (keys) == 1, "keys changed without snapshot");
+
+	ksDel (keys);
+	ksDel (bootstrap);
+}
+
+static void test_otherBootstrap (void)
+{
+	printf ("Test snapshot of another bootstrap file\n");
+
+	touchBootstrap ("bootstrap");
+	KeySet * bootstrap = createBootstrap ();
+	succeed_if (elektraSnapshotWrite (snapshotFile, elektraFilename (), bootstrap) == 0, "could not write snapshot");
+
+	// e.g. with another XDG_CONFIG_DIRS, another bootstrap file is resolved
+	char * other = elektraFormat ("%s/other.ecf", tempHome);
+	FILE * file = fopen (other, "w");
+	exit_if_fail (file, "could not write other bootstrap file");
+	fputs ("bootstrap", file);
+	fclose (file);
+
+	KeySet * keys = ksNew (0, KS_END);
+	succeed_if (elektraSnapshotRead (snapshotFile, other, keys) == -1, "snapshot of another bootstrap file was read");
+	succeed_if (ksGetSize (keys) == 0, "keys of another bootstrap file added");
+
+	// every bootstrap file has its own snapshot file
+	char * first = elektraSnapshotFile (elektraFilename ());
+	char * second = elektraSnapshotFile (other);
+	succeed_if (first && second && strcmp (first, second), "bootstrap files share a snapshot file");
+	succeed_if (first && !strncmp (first, tempHome, strlen (tempHome)), "snapshot file not in HOME");
+	succeed_if (elektraSnapshotFile ("relative.ecf") == 0, "snapshot file for relative bootstrap file");
+	succeed_if (elektraSnapshotFile (0) == 0, "snapshot file without bootstrap file");
+
+	elektraFree (first);
+	elektraFree (second);
+	unlink (other);
+	elektraFree (other);
+	elektraSnapshotRemove (snapshotFile);
+	ksDel (keys);
+	ksDel (bootstrap);
+}
+
+static void test_truncated (void)
+{
+	printf ("Test truncated snapshot\n");
+
+	touchBootstrap ("bootstrap");
+	KeySet * bootstrap = createBootstrap ();
+	succeed_if (elektraSnapshotWrite (snapshotFile, elektraFilename (), bootstrap) == 0, "could not write snapshot");
+
+	struct stat buf;
+	exit_if_fail (stat (snapshotFile, &buf) == 0, "snapshot missing");
+	for (off_t size = buf.st_size - 8; size > 0; size -= 24)
+	{
+		succeed_if (truncate (snapshotFile, size) == 0, "could not truncate snapshot");
+		KeySet * keys = ksNew (0, KS_END);
+		succeed_if (elektraSnapshotRead (snapshotFile, elektraFilename (), keys) == -1, "truncated snapshot was read");
+		succeed_if (ksGetSize (keys) == 0, "keys of truncated snapshot added");
+		ksDel (keys);
+	}
+
+	elektraSnapshotRemove (snapshotFile);
+	ksDel (bootstrap);
+}
+
+/**
+ * Writes a snapshot and replaces @p name in it with as many bytes of @p replacement.
+ */
+static void writeReplaced (const char * name, const char * replacement)
+{
+	touchBootstrap ("bootstrap");
+	KeySet * bootstrap = createBootstrap ();
+	succeed_if (elektraSnapshotWrite (snapshotFile, elektraFilename (), bootstrap) == 0, "could not write snapshot");
+	ksDel (bootstrap);
+
+	FILE * file = fopen (snapshotFile, "r+");
+	exit_if_fail (file, "could not open snapshot");
+	char buffer[4096];
+	size_t size = fread (buffer, 1, sizeof (buffer), file);
+	exit_if_fail (size < sizeof (buffer), "snapshot too large");
+	size_t found = 0;
+	while (found + strlen (name) < size && memcmp (buffer + found, name, strlen (name) + 1))
+		++found;
+	exit_if_fail (found + strlen (name) < size, "name not in snapshot");
+	fseek (file, found, SEEK_SET);
+	fwrite (replacement, 1, strlen (name), file);
+	fclose (file);
+}
+
+static void test_invalidNames (void)
+{
+	printf ("Test snapshot with invalid names\n");
+
+	// all of the size of system/elektra/empty
+	const char * replacements[] = {
+		"system/elektra/empt\\", // invalid escape
+		"system/elektra/../xx", // parent of system/elektra
+		"user/elektra/emptyxx", // other namespace
+		"system/elektra/em\0ty", // embedded null
+	};
+	for (size_t i = 0; i < sizeof (replacements) / sizeof (replacements[0]); ++i)
+	{
+		writeReplaced ("system/elektra/empty", replacements[i]);
+		KeySet * keys = ksNew (0, KS_END);
+		succeed_if (elektraSnapshotRead (snapshotFile, elektraFilename (), keys) == -1, "snapshot with invalid name was read");
+		succeed_if (ksGetSize (keys) == 0, "keys of snapshot with invalid name added");
+		ksDel (keys);
+	}
+
+	elektraSnapshotRemove (snapshotFile);
+}
+
+static void test_nobootstrap (void)
+{
+	printf ("Test snapshot without bootstrap file\n");
+
+	KeySet * bootstrap = createBootstrap ();
+	succeed_if (elektraSnapshotWrite (snapshotFile, 0, bootstrap) == -1, "snapshot without bootstrap file written");
+	succeed_if (elektraSnapshotWrite (snapshotFile, "relative.ecf", bootstrap) == -1, "snapshot with relative bootstrap file written");
+	succeed_if (elektraSnapshotRead (snapshotFile, elektraFilename (), bootstrap) == 0, "snapshot was written");
+	ksDel (bootstrap);
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("SNAPSHOT   TESTS\n");
+	printf ("================\n\n");
+
+	init (argc, argv);
+
+	snapshotFile = elektraFormat ("%s/bootstrap.snapshot", tempHome);
+
+	test_roundtrip ();
+	test_outdated ();
+	test_otherBootstrap ();
+	test_truncated ();
+	test_invalidNames ();
+	test_nobootstrap ();
+
+	elektraSnapshotRemove (snapshotFile);
+	elektraFree (snapshotFile);
+
+	printf ("\ntest_snapshot RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
@@ -841,6 +841,68 @@ static void test_realworld (void)
 	keyDel (parent);
 }
 
+static void test_cacheappoint (void)
+{
+	printf ("Test appoint of cached keys\n");
+
+	Key * parent = 0;
+	KDB * handle = elektraCalloc (sizeof (struct _KDB));
+	handle->split = splitNew ();
+	KeySet * modules = ksNew (0, KS_END);
+	elektraModulesInit (modules, 0);
+
+	mountOpen (handle, set_realworld (), modules, 0);
+	succeed_if (mountDefault (handle, modules, 1, 0) == 0, "could not mount default backends");
+
+	KeySet * ks = ksNew (5, keyNew ("user/sw/apps/app1/default/fromuser", KEY_END), keyNew ("system/users/fromuser", KEY_END),
+			     keyNew ("user/outside", KEY_VALUE, "test", KEY_END), KS_END);
+	KeySet * cache = ksNew (9, keyNew ("user/sw/apps/app1/default", KEY_END),
+				keyNew ("user/sw/apps/app1/default/maximize", KEY_VALUE, "1", KEY_END),
+				keyNew ("system/hosts/markusbyte", KEY_VALUE, "stale", KEY_END), keyNew ("system/users", KEY_END),
+				keyNew ("system/users/markus", KEY_END), keyNew ("system/outside", KEY_VALUE, "stale", KEY_END), KS_END);
+	KeySet * split0 = ksNew (2, keyNew ("user/sw/apps/app1/default", KEY_END),
+				 keyNew ("user/sw/apps/app1/default/maximize", KEY_VALUE, "1", KEY_END), KS_END);
+	KeySet * split9 = ksNew (2, keyNew ("system/users", KEY_END), keyNew ("system/users/markus", KEY_END), KS_END);
+
+	Split * split = splitNew ();
+
+	succeed_if (splitBuildup (split, handle, parent) == 1, "should need sync");
+	succeed_if (split->size == 11, "size not correct");
+	succeed_if_same_string (keyName (split->parents[0]), "user/sw/apps/app1/default");
+	succeed_if_same_string (keyName (split->parents[3]), "system/hosts");
+	succeed_if_same_string (keyName (split->parents[9]), "system/users");
+
+	// app1 and users had a cache hit, hosts changed
+	split->syncbits[0] |= SPLIT_FLAG_SYNC | SPLIT_FLAG_CACHE;
+	split->syncbits[3] |= SPLIT_FLAG_SYNC;
+	split->syncbits[9] |= SPLIT_FLAG_SYNC | SPLIT_FLAG_CACHE;
+
+	succeed_if (splitAppoint (split, handle, ks) == 1, "could not appoint keys");
+	succeed_if (split->size == 12, "size not correct (def not added)");
+	succeed_if (splitCacheAppoint (split, handle, cache) == 2, "wrong number of backends from cache");
+
+	succeed_if (split->syncbits[0] == 0, "cached backend still needs sync");
+	succeed_if (split->syncbits[3] == SPLIT_FLAG_SYNC, "changed backend does not need sync");
+	succeed_if (split->syncbits[9] == 0, "cached backend still needs sync");
+	compare_keyset (split->keysets[0], split0);
+	succeed_if (ksGetSize (split->keysets[3]) == 0, "stale keys appointed to changed backend");
+	compare_keyset (split->keysets[9], split9);
+	succeed_if (ksGetSize (split->keysets[8]) == 0, "keys of root backend without cache hit appointed");
+	succeed_if (ksGetSize (split->keysets[7]) == 1, "keys of user not appointed");
+
+	splitDel (split);
+
+	ksDel (ks);
+	ksDel (cache);
+	ksDel (split0);
+	ksDel (split9);
+	elektraModulesClose (modules, 0);
+	ksDel (modules);
+
+	kdbClose (handle, parent);
+	keyDel (parent);
+}
+
 
 int main (int argc, char ** argv)
 {
@@ -858,6 +920,7 @@ int main (int argc, char ** argv)
 	test_triesizes ();
 	test_merge ();
 	test_realworld ();
+	test_cacheappoint ();
 
 
 	printf ("\ntest_splitget RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
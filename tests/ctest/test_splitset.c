@@ -1282,6 +1282,48 @@ static void test_state (void)
 }
 
 
+static void test_partition (void)
+{
+	printf ("Test partition by mountpoints\n");
+
+	KDB * handle = kdb_open ();
+
+	succeed_if (mountOpen (handle, set_realworld (), handle->modules, 0) == 0, "could not open mountpoints");
+	succeed_if (mountDefault (handle, handle->modules, 1, 0) == 0, "could not open default backend");
+
+	KeySet * ks = ksNew (
+		30, keyNew ("/sw/cascading", KEY_END), keyNew ("spec/sw/apps/app1", KEY_END), keyNew ("dir/sw/apps/app1", KEY_END),
+		keyNew ("user", KEY_END), keyNew ("user/sw/apps", KEY_END), keyNew ("user/sw/apps/app1/default", KEY_END),
+		keyNew ("user/sw/apps/app1/default/key", KEY_END), keyNew ("user/sw/apps/app1/defaultkey", KEY_END),
+		keyNew ("user/sw/apps/app2", KEY_END), keyNew ("user/sw/apps/app2/key", KEY_END), keyNew ("user/sw/apps/app2\\/key", KEY_END),
+		keyNew ("user/sw/apps/app2key", KEY_END), keyNew ("user/sw/kde/default/key", KEY_END), keyNew ("user/sw/kdex", KEY_END),
+		keyNew ("system/elektra/key", KEY_END), keyNew ("system/elektra/mountpoints", KEY_END), keyNew ("system/groups/key", KEY_END),
+		keyNew ("system/hosts", KEY_END), keyNew ("system/users/key", KEY_END), keyNew ("system/userskey", KEY_END), KS_END);
+
+	SplitRange * ranges = 0;
+	ssize_t count = splitPartition (handle, ks, &ranges);
+	exit_if_fail (count > 0, "could not partition");
+
+	size_t pos = 0;
+	for (ssize_t r = 0; r < count; ++r)
+	{
+		succeed_if (ranges[r].start == pos, "ranges are not adjacent");
+		succeed_if (ranges[r].start < ranges[r].end, "range is empty");
+		pos = ranges[r].end;
+		if (!ranges[r].backend) continue;
+		for (size_t i = ranges[r].start; i < ranges[r].end; ++i)
+		{
+			succeed_if (ranges[r].backend == mountGetBackend (handle, ks->array[i]), "range has wrong backend");
+		}
+	}
+	succeed_if (pos == (size_t) ksGetSize (ks), "not all keys in ranges");
+	succeed_if (!ranges[0].backend, "cascading key must be looked up");
+
+	elektraFree (ranges);
+	ksDel (ks);
+	kdb_close (handle);
+}
+
 int main (int argc, char ** argv)
 {
 	printf ("SPLIT SET   TESTS\n");
@@ -1301,6 +1343,7 @@ int main (int argc, char ** argv)
 	test_emptysplit ();
 	test_nothingsync ();
 	test_state ();
+	test_partition ();
 
 	printf ("\ntest_splitset RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
 
@@ -0,0 +1,104 @@
+/**
+ * @file
+ *
+ * @brief Tests for the thread pool.
+ *
+ * @copyright BSD License (see LICENSE.md or https://www.libelektra.org)
+ */
+
+#include <tests_internal.h>
+
+typedef struct
+{
+	size_t index;
+	size_t calls;
+	size_t result;
+} Task;
+
+static void runTask (void * data)
+{
+	Task * task = data;
+	++task->calls;
+	// some work, so that the tasks overlap
+	size_t result = task->index;
+	for (size_t i = 0; i < 10000; ++i)
+	{
+		result = result * 31 + i;
+	}
+	task->result = result;
+}
+
+static void checkBatch (ElektraThreadPool * pool, size_t count)
+{
+	Task * tasks = elektraCalloc (count * sizeof (Task) + 1);
+	for (size_t i = 0; i < count; ++i)
+	{
+		tasks[i].index = i;
+	}
+
+	elektraThreadPoolRun (pool, runTask, tasks, count, sizeof (Task));
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Task expected = { i, 0, 0 };
+		runTask (&expected);
+		succeed_if (tasks[i].calls == 1, "task not run exactly once");
+		succeed_if (tasks[i].result == expected.result, "wrong result of task");
+	}
+	elektraFree (tasks);
+}
+
+static void test_threadPool (void)
+{
+	printf ("Test thread pool\n");
+
+	ElektraThreadPool * pool = elektraThreadPoolNew (4);
+	exit_if_fail (pool, "could not create thread pool");
+#ifdef HAVE_PTHREAD
+	succeed_if (elektraThreadPoolSize (pool) == 4, "wrong number of threads");
+#else
+	succeed_if (elektraThreadPoolSize (pool) == 0, "pool without pthreads must not have threads");
+#endif
+
+	checkBatch (pool, 0);
+	checkBatch (pool, 1);
+	checkBatch (pool, 3);
+	for (size_t i = 0; i < 100; ++i)
+	{
+		checkBatch (pool, 64);
+	}
+	checkBatch (pool, 1000);
+
+	elektraThreadPoolDel (pool);
+}
+
+static void test_threadPoolWithoutThreads (void)
+{
+	printf ("Test thread pool without threads\n");
+
+	ElektraThreadPool * pool = elektraThreadPoolNew (0);
+	exit_if_fail (pool, "could not create thread pool");
+	succeed_if (elektraThreadPoolSize (pool) == 0, "wrong number of threads");
+	checkBatch (pool, 10);
+	elektraThreadPoolDel (pool);
+
+	// without pool everything runs in the calling thread
+	succeed_if (elektraThreadPoolSize (0) == 0, "NULL pool must not have threads");
+	checkBatch (0, 10);
+	elektraThreadPoolDel (0);
+}
+
+int main (int argc, char ** argv)
+{
+	printf ("THREAD POOL  TESTS\n");
+	printf ("==================\n\n");
+
+	init (argc, argv);
+
+	test_threadPool ();
+	test_threadPoolWithoutThreads ();
+
+	printf ("\ntest_threadpool RESULTS: %d test(s) done. %d error(s).\n", nbTest, nbError);
+
+	return nbError;
+}
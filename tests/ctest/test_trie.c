@@ -94,15 +94,9 @@ static void test_simple (void)
 
 static void collect_mountpoints (Trie * trie, KeySet * mountpoints)
 {
-	int i;
-	for (i = 0; i < KDB_MAX_UCHAR; ++i)
+	for (size_t i = 0; i < trie->size; ++i)
 	{
-		if (trie->value[i]) ksAppendKey (mountpoints, ((Backend *) trie->value[i])->mountpoint);
-		if (trie->children[i]) collect_mountpoints (trie->children[i], mountpoints);
-	}
-	if (trie->empty_value)
-	{
-		ksAppendKey (mountpoints, ((Backend *) trie->empty_value)->mountpoint);
+		if (trie->nodes[i].value) ksAppendKey (mountpoints, trie->nodes[i].value->mountpoint);
 	}
 }
 